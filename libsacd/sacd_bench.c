@@ -0,0 +1,541 @@
+/**
+ * sacd-bench - per-stage throughput of the extraction pipeline
+ *
+ * Generates SACD images (a stereo DSD area and a multichannel DST area),
+ * then times each stage the extractor runs a sector through:
+ *
+ *   read         raw sector reads from the image
+ *   demux        audio frame reassembly from read sectors
+ *   dst_decode   DST frame decoding (multichannel area)
+ *   pcm          de-interleave and DSD to PCM conversion (88.2 kHz, 24-bit)
+ *   extract      sacd_extractor_start() end to end, DSF into null sinks, no hashes
+ *   write_dsf    the same with the default options, so the writer path (silence
+ *   write_dsdiff check, level meter, hashes, headers) is included; the difference
+ *                from extract is the cost of writing that format
+ *
+ * Results are one line per stage: name, MB/s of disc sectors, ns/sector and
+ * sectors processed, of the median of several runs. With --baseline, a stage
+ * is slow when even its fastest run falls more than the tolerance below the
+ * stored median; it is then measured again, and only reported (exit status 1)
+ * if it stays slow, so a noisy run doesn't fail the check. Baselines are per
+ * machine and never committed: record one locally with --write-baseline.
+ *
+ * Copyright (c) 2024
+ * Licensed under MIT License
+ */
+
+#include "sacd_generator.h"
+#include "sacd_internal.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+#include <getopt.h>
+
+#define BENCH_MAX_STAGES   16
+#define BENCH_PCM_SECONDS  5          /* PCM conversion is slow; time a slice */
+#define BENCH_MIN_TIME_NS  200000000ULL /* Fast stages repeat until this much is measured */
+#define BENCH_MAX_RUNS     100
+#define BENCH_RECHECKS     3          /* Extra rounds for a stage whose best run is below its baseline */
+
+typedef struct {
+    char name[32];
+    double mb_per_s;
+    double ns_per_sector;
+    uint64_t sectors;
+} bench_result_t;
+
+typedef struct {
+    bench_result_t results[BENCH_MAX_STAGES];
+    int count;
+} bench_results_t;
+
+/* An area's audio sectors loaded into memory */
+typedef struct {
+    const sacd_area_t *area;
+    uint8_t *sectors;               /* Followed by one spare sector */
+    uint32_t count;
+} area_data_t;
+
+/* An area's audio frames, back to back, as the demultiplexer emits them */
+typedef struct {
+    uint8_t *data;
+    size_t used;
+    size_t *sizes;
+    uint32_t count;
+    uint32_t capacity;
+} frame_list_t;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static double stage_mb_per_s(uint64_t sectors, uint64_t elapsed_ns) {
+    return (double)sectors * SACD_LSN_SIZE / 1e6 / ((double)elapsed_ns / 1e9);
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t*)a, y = *(const uint64_t*)b;
+    return (x > y) - (x < y);
+}
+
+static void record(bench_results_t *results, const char *name, uint64_t sectors, uint64_t elapsed_ns) {
+    if (results->count >= BENCH_MAX_STAGES || sectors == 0) {
+        return;
+    }
+    bench_result_t *r = &results->results[results->count++];
+    snprintf(r->name, sizeof(r->name), "%s", name);
+    r->sectors = sectors;
+    if (elapsed_ns == 0) {
+        elapsed_ns = 1;
+    }
+    r->ns_per_sector = (double)elapsed_ns / (double)sectors;
+    r->mb_per_s = stage_mb_per_s(sectors, elapsed_ns);
+}
+
+/* Audio sectors of every track in an area */
+static uint32_t area_first_lsn(const sacd_area_t *area) {
+    return area->tracks[0].start_lsn;
+}
+
+static uint32_t area_sector_count(const sacd_area_t *area) {
+    const sacd_track_t *last = &area->tracks[area->track_count - 1];
+    return last->start_lsn + last->length_lsn - area_first_lsn(area);
+}
+
+static sacd_result_t load_area(sacd_disc_t *disc, const sacd_area_t *area, area_data_t *data) {
+    data->area = area;
+    data->count = area_sector_count(area);
+    data->sectors = calloc((size_t)data->count + 1, SACD_LSN_SIZE);
+    if (!data->sectors) {
+        return SACD_RESULT_OUT_OF_MEMORY;
+    }
+
+    sacd_disc_internal_t *internal = (sacd_disc_internal_t*)disc->internal_data;
+    for (uint32_t i = 0; i < data->count; i++) {
+        SACD_CHECK_RESULT(sacd_internal_read_sector(internal, area_first_lsn(area) + i,
+                                                    data->sectors + (size_t)i * SACD_LSN_SIZE));
+    }
+    return SACD_RESULT_OK;
+}
+
+/* ---- Stages ---- */
+
+static uint64_t bench_read(sacd_disc_t *disc, const area_data_t *data, uint8_t *buffer) {
+    sacd_disc_internal_t *internal = (sacd_disc_internal_t*)disc->internal_data;
+    uint32_t first = area_first_lsn(data->area);
+
+    uint64_t start = now_ns();
+    for (uint32_t i = 0; i < data->count; i++) {
+        if (sacd_internal_read_sector(internal, first + i, buffer) != SACD_RESULT_OK) {
+            return 0;
+        }
+    }
+    return now_ns() - start;
+}
+
+static sacd_result_t count_frame(const sacd_audio_frame_t *frame, void *userdata) {
+    *(volatile size_t*)userdata += frame->size;
+    return SACD_RESULT_OK;
+}
+
+static uint64_t bench_demux(const area_data_t *data, volatile size_t *sink) {
+    sacd_demux_t demux;
+    sacd_internal_demux_init(&demux, data->area->channel_count);
+
+    uint64_t start = now_ns();
+    for (uint32_t i = 0; i < data->count; i++) {
+        sacd_internal_demux_sector(&demux, area_first_lsn(data->area) + i,
+                                   data->sectors + (size_t)i * SACD_LSN_SIZE, count_frame, (void*)sink);
+    }
+    sacd_internal_demux_flush(&demux, count_frame, (void*)sink);
+    uint64_t elapsed = now_ns() - start;
+
+    sacd_internal_demux_free(&demux);
+    return elapsed;
+}
+
+static sacd_result_t keep_frame(const sacd_audio_frame_t *frame, void *userdata) {
+    frame_list_t *list = (frame_list_t*)userdata;
+    if (list->count == list->capacity) {
+        list->capacity = list->capacity ? list->capacity * 2 : 1024;
+        size_t *sizes = realloc(list->sizes, list->capacity * sizeof(size_t));
+        if (!sizes) {
+            return SACD_RESULT_OUT_OF_MEMORY;
+        }
+        list->sizes = sizes;
+    }
+
+    /* Frames never hold more than the sectors they came from */
+    memcpy(list->data + list->used, frame->data, frame->size);
+    list->used += frame->size;
+    list->sizes[list->count] = frame->size;
+    list->count++;
+    return SACD_RESULT_OK;
+}
+
+/* Reassemble an area's frames (untimed) */
+static sacd_result_t collect_frames(const area_data_t *data, frame_list_t *list) {
+    memset(list, 0, sizeof(frame_list_t));
+    list->data = malloc((size_t)data->count * SACD_LSN_SIZE);
+    if (!list->data) {
+        return SACD_RESULT_OUT_OF_MEMORY;
+    }
+
+    sacd_demux_t demux;
+    sacd_internal_demux_init(&demux, data->area->channel_count);
+    sacd_result_t result = SACD_RESULT_OK;
+    for (uint32_t i = 0; result == SACD_RESULT_OK && i < data->count; i++) {
+        result = sacd_internal_demux_sector(&demux, area_first_lsn(data->area) + i,
+                                            data->sectors + (size_t)i * SACD_LSN_SIZE, keep_frame, list);
+    }
+    if (result == SACD_RESULT_OK) {
+        result = sacd_internal_demux_flush(&demux, keep_frame, list);
+    }
+    sacd_internal_demux_free(&demux);
+    return result;
+}
+
+static void free_frames(frame_list_t *list) {
+    free(list->data);
+    free(list->sizes);
+}
+
+static uint64_t bench_dst_decode(const frame_list_t *frames) {
+    sacd_dst_decoder_t decoder;
+    if (sacd_internal_dst_decoder_init(&decoder) != SACD_RESULT_OK) {
+        return 0;
+    }
+
+    uint64_t start = now_ns();
+    const uint8_t *frame = frames->data;
+    for (uint32_t i = 0; i < frames->count; i++) {
+        uint8_t *output = NULL;
+        size_t output_size = 0;
+        sacd_internal_dst_decode_frame(&decoder, frame, frames->sizes[i], &output, &output_size);
+        free(output);
+        frame += frames->sizes[i];
+    }
+    uint64_t elapsed = now_ns() - start;
+
+    sacd_internal_dst_decoder_cleanup(&decoder);
+    return elapsed;
+}
+
+/* Convert a slice of the frames, a sector's worth at a time */
+static uint64_t bench_pcm(const uint8_t *payload, size_t size, int channel_count) {
+    sacd_pcm_converter_t *converter;
+    if (sacd_internal_pcm_converter_create(&converter, channel_count, 88200, SACD_PCM_S24, NULL) != SACD_RESULT_OK) {
+        return 0;
+    }
+
+    uint64_t start = now_ns();
+    for (size_t offset = 0; offset < size; offset += SACD_LSN_SIZE) {
+        const uint8_t *pcm;
+        size_t pcm_size;
+        size_t chunk = (size - offset < SACD_LSN_SIZE) ? size - offset : SACD_LSN_SIZE;
+        sacd_internal_pcm_convert(converter, payload + offset, chunk, &pcm, &pcm_size);
+    }
+    const uint8_t *pcm;
+    size_t pcm_size;
+    sacd_internal_pcm_flush(converter, &pcm, &pcm_size);
+    uint64_t elapsed = now_ns() - start;
+
+    sacd_internal_pcm_converter_destroy(converter);
+    return elapsed;
+}
+
+/* Extract an area into null sinks; without hashes only reading, demultiplexing and framing remain */
+static uint64_t bench_extract(sacd_disc_t *disc, const sacd_area_t *area, const char *output_dir,
+                              sacd_output_format_t format, bool hashes) {
+    sacd_extraction_options_t options;
+    sacd_extraction_options_init(&options);
+    options.format = format;
+    options.sink_type = SACD_SINK_NULL;
+    if (!hashes) {
+        options.checksums = 0;
+    }
+
+    sacd_extractor_t *extractor;
+    if (sacd_extractor_create(disc, area, output_dir, &options, &extractor) != SACD_RESULT_OK) {
+        return 0;
+    }
+    sacd_extractor_add_all_tracks(extractor);
+
+    uint64_t start = now_ns();
+    sacd_result_t result = sacd_extractor_start(extractor);
+    if (result == SACD_RESULT_OK) {
+        result = sacd_extractor_wait(extractor);
+    }
+    uint64_t elapsed = now_ns() - start;
+
+    sacd_extractor_destroy(extractor);
+    return (result == SACD_RESULT_OK) ? elapsed : 0;
+}
+
+/* ---- Baseline ---- */
+
+static void print_results(FILE *out, const bench_results_t *results) {
+    fprintf(out, "# stage\tmb_per_s\tns_per_sector\tsectors\n");
+    for (int i = 0; i < results->count; i++) {
+        const bench_result_t *r = &results->results[i];
+        fprintf(out, "%s\t%.1f\t%.1f\t%llu\n", r->name, r->mb_per_s, r->ns_per_sector,
+                (unsigned long long)r->sectors);
+    }
+}
+
+/* Read a baseline written by --write-baseline; false if there is none */
+static bool load_baseline(const char *path, bench_results_t *baseline) {
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return false;
+    }
+
+    baseline->count = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), file) && baseline->count < BENCH_MAX_STAGES) {
+        bench_result_t *r = &baseline->results[baseline->count];
+        if (line[0] != '#' && sscanf(line, "%31s %lf", r->name, &r->mb_per_s) == 2) {
+            baseline->count++;
+        }
+    }
+
+    fclose(file);
+    return true;
+}
+
+/* The slowest a stage may be against the baseline, 0 if it has no entry */
+static double baseline_limit(const bench_results_t *baseline, const char *name, double tolerance) {
+    for (int i = 0; i < baseline->count; i++) {
+        if (strcmp(baseline->results[i].name, name) == 0) {
+            return baseline->results[i].mb_per_s * (1.0 - tolerance / 100.0);
+        }
+    }
+    return 0.0;
+}
+
+static void usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [options]\n"
+            "\n"
+            "  -i, --iterations N        Minimum runs per stage, the median is reported (default 5)\n"
+            "  -l, --length SECONDS      Generated track length (default 30)\n"
+            "  -b, --baseline FILE       Fail if a stage stays slower than this baseline\n"
+            "  -t, --tolerance PCT       Allowed slowdown against the baseline (default 25)\n"
+            "  -w, --write-baseline FILE Store these results as the baseline\n"
+            "  -h, --help                Show this help\n",
+            program);
+}
+
+int main(int argc, char **argv) {
+    int iterations = 5;
+    double seconds = 30.0;
+    double tolerance = 25.0;
+    const char *baseline = NULL;
+    const char *write_baseline = NULL;
+
+    static const struct option long_options[] = {
+        { "iterations",     required_argument, NULL, 'i' },
+        { "length",         required_argument, NULL, 'l' },
+        { "baseline",       required_argument, NULL, 'b' },
+        { "tolerance",      required_argument, NULL, 't' },
+        { "write-baseline", required_argument, NULL, 'w' },
+        { "help",           no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "i:l:b:t:w:h", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 'i': iterations = atoi(optarg); break;
+        case 'l': seconds = atof(optarg); break;
+        case 'b': baseline = optarg; break;
+        case 't': tolerance = atof(optarg); break;
+        case 'w': write_baseline = optarg; break;
+        case 'h': usage(argv[0]); return 0;
+        default: usage(argv[0]); return 1;
+        }
+    }
+    if (iterations < 1 || seconds <= 0.0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    /* Generated images and the (unused) output directory live in a scratch directory */
+    const char *tmp = getenv("TMPDIR");
+    char work_dir[4096], iso_path[4096 + 16], output_dir[4096 + 16];
+    snprintf(work_dir, sizeof(work_dir), "%s/sacd-bench-XXXXXX", tmp ? tmp : "/tmp");
+    if (!mkdtemp(work_dir)) {
+        perror("sacd-bench: mkdtemp");
+        return 1;
+    }
+    snprintf(iso_path, sizeof(iso_path), "%s/bench.iso", work_dir);
+    snprintf(output_dir, sizeof(output_dir), "%s/out", work_dir);
+
+    sacd_generator_options_t generator;
+    sacd_generator_options_init(&generator);
+    generator.content = SACD_GENERATOR_NOISE;
+    generator.areas[0].track_count = 3;
+    generator.areas[0].track_frames = (uint32_t)(seconds * SACD_FRAME_RATE);
+    generator.areas[1].present = true;
+    generator.areas[1].channel_count = 6;
+    generator.areas[1].track_count = 1;
+    generator.areas[1].track_frames = (uint32_t)(seconds * SACD_FRAME_RATE);
+
+    int status = 1;
+    sacd_disc_t *disc = NULL;
+    area_data_t stereo = { 0 }, multichannel = { 0 };
+    frame_list_t payload = { 0 }, frames = { 0 };
+    uint8_t *buffer = NULL;
+    bench_results_t results = { .count = 0 };
+
+    sacd_result_t result = sacd_generator_write_iso(iso_path, &generator);
+    if (result == SACD_RESULT_OK) {
+        result = sacd_disc_open(iso_path, &disc);
+    }
+    const sacd_area_t *stereo_area = disc ? sacd_disc_get_area(disc, SACD_AREA_STEREO) : NULL;
+    const sacd_area_t *mc_area = disc ? sacd_disc_get_area(disc, SACD_AREA_MULTICHANNEL) : NULL;
+    if (result == SACD_RESULT_OK && (!stereo_area || !mc_area)) {
+        result = SACD_RESULT_INVALID_AREA;
+    }
+    if (result == SACD_RESULT_OK) {
+        result = load_area(disc, stereo_area, &stereo);
+    }
+    if (result == SACD_RESULT_OK) {
+        result = load_area(disc, mc_area, &multichannel);
+    }
+    if (result == SACD_RESULT_OK) {
+        result = collect_frames(&multichannel, &frames);
+    }
+
+    /* Demultiplexed stereo frames, as the writers receive them */
+    if (result == SACD_RESULT_OK) {
+        result = collect_frames(&stereo, &payload);
+    }
+    buffer = malloc(SACD_LSN_SIZE);
+    if (result == SACD_RESULT_OK && (!buffer || payload.count == 0)) {
+        result = buffer ? SACD_RESULT_INVALID_AREA : SACD_RESULT_OUT_OF_MEMORY;
+    }
+
+    if (result != SACD_RESULT_OK) {
+        fprintf(stderr, "sacd-bench: setup failed: %s\n", sacd_result_string(result));
+        goto cleanup;
+    }
+
+    /* PCM conversion runs on a slice of the frames */
+    uint32_t pcm_frames = payload.count;
+    if (pcm_frames > BENCH_PCM_SECONDS * SACD_FRAME_RATE) {
+        pcm_frames = BENCH_PCM_SECONDS * SACD_FRAME_RATE;
+    }
+    size_t pcm_size = 0;
+    for (uint32_t i = 0; i < pcm_frames; i++) {
+        pcm_size += payload.sizes[i];
+    }
+    uint32_t pcm_sectors = (uint32_t)((uint64_t)stereo.count * pcm_frames / payload.count);
+
+    struct {
+        const char *name;
+        uint64_t sectors;
+    } stages[] = {
+        { "read",         stereo.count },
+        { "demux",        stereo.count },
+        { "dst_decode",   multichannel.count },
+        { "pcm",          pcm_sectors },
+        { "extract",      stereo.count },
+        { "write_dsf",    stereo.count },
+        { "write_dsdiff", stereo.count },
+    };
+    int stage_count = (int)(sizeof(stages) / sizeof(stages[0]));
+    volatile size_t checksum = 0;
+
+    bench_results_t limits = { .count = 0 };
+    if (baseline && !load_baseline(baseline, &limits)) {
+        fprintf(stderr, "sacd-bench: no baseline at %s (create one with --write-baseline)\n", baseline);
+        baseline = NULL;
+    }
+    int regressions = 0;
+
+    for (int s = 0; s < stage_count; s++) {
+        double limit = baseline ? baseline_limit(&limits, stages[s].name, tolerance) : 0.0;
+        uint64_t runs[BENCH_MAX_RUNS];
+        int run_count = 0;
+        uint64_t best = 0;
+        for (int round = 0; round <= BENCH_RECHECKS; round++) {
+            uint64_t total = 0;
+            run_count = 0;
+            while (run_count < iterations || (total < BENCH_MIN_TIME_NS && run_count < BENCH_MAX_RUNS)) {
+                uint64_t elapsed = 0;
+                switch (s) {
+                case 0: elapsed = bench_read(disc, &stereo, buffer); break;
+                case 1: elapsed = bench_demux(&stereo, &checksum); break;
+                case 2: elapsed = bench_dst_decode(&frames); break;
+                case 3: elapsed = bench_pcm(payload.data, pcm_size, stereo_area->channel_count); break;
+                case 4: elapsed = bench_extract(disc, stereo_area, output_dir, SACD_FORMAT_DSF, false); break;
+                case 5: elapsed = bench_extract(disc, stereo_area, output_dir, SACD_FORMAT_DSF, true); break;
+                case 6: elapsed = bench_extract(disc, stereo_area, output_dir, SACD_FORMAT_DSDIFF, true); break;
+                }
+                if (elapsed == 0) {
+                    fprintf(stderr, "sacd-bench: stage %s failed\n", stages[s].name);
+                    goto cleanup;
+                }
+                total += elapsed;
+                if (run_count < BENCH_MAX_RUNS) {
+                    runs[run_count++] = elapsed;
+                }
+                if (best == 0 || elapsed < best) {
+                    best = elapsed;
+                }
+            }
+
+            /* Only slow if even the fastest run is: anything else is noise, so measure again */
+            if (stage_mb_per_s(stages[s].sectors, best) >= limit) {
+                break;
+            }
+        }
+
+        /* The median run is what the stage reports */
+        qsort(runs, (size_t)run_count, sizeof(uint64_t), compare_u64);
+        record(&results, stages[s].name, stages[s].sectors, runs[run_count / 2]);
+
+        if (stage_mb_per_s(stages[s].sectors, best) < limit) {
+            fprintf(stderr, "REGRESSION %s: %.1f MB/s at best, baseline allows %.1f MB/s\n",
+                    stages[s].name, stage_mb_per_s(stages[s].sectors, best), limit);
+            regressions++;
+        }
+    }
+
+    print_results(stdout, &results);
+    fflush(stdout);
+    status = 0;
+
+    if (write_baseline) {
+        FILE *file = fopen(write_baseline, "w");
+        if (!file) {
+            perror(write_baseline);
+            status = 1;
+        } else {
+            print_results(file, &results);
+            fclose(file);
+        }
+    }
+    if (regressions > 0) {
+        status = 1;
+    }
+
+cleanup:
+    if (disc) {
+        sacd_disc_close(disc);
+    }
+    free(stereo.sectors);
+    free(multichannel.sectors);
+    free_frames(&frames);
+    free_frames(&payload);
+    free(buffer);
+    unlink(iso_path);
+    rmdir(output_dir);
+    rmdir(work_dir);
+    return status;
+}
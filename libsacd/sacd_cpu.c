@@ -0,0 +1,215 @@
+/**
+ * SACD Library - CPU Placement
+ *
+ * CPU sets, NUMA node discovery and pinned thread creation. An extraction's
+ * threads are kept on one set of CPUs (by default one NUMA node) so sector,
+ * DSD and PCM buffers handed between them stay in the local caches and
+ * memory. Buffers are allocated by the threads after they are pinned, so the
+ * kernel's first-touch policy places their pages on the same node.
+ *
+ * Node topology comes from sysfs; without it (or on other platforms) the
+ * machine is treated as a single node and nothing is pinned.
+ */
+
+#include "sacd_lib.h"
+#include "sacd_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sched.h>
+#include <pthread.h>
+
+#define NODE_SYSFS "/sys/devices/system/node"
+
+/* Clear a set */
+void sacd_internal_cpuset_clear(sacd_cpuset_t *set) {
+    memset(set, 0, sizeof(*set));
+}
+
+/* Add a CPU to a set */
+void sacd_internal_cpuset_add(sacd_cpuset_t *set, int cpu) {
+    if (cpu >= 0 && cpu < SACD_MAX_CPUS) {
+        set->bits[cpu / 64] |= 1ULL << (cpu % 64);
+    }
+}
+
+/* Check whether a set contains a CPU */
+bool sacd_internal_cpuset_has(const sacd_cpuset_t *set, int cpu) {
+    return cpu >= 0 && cpu < SACD_MAX_CPUS && (set->bits[cpu / 64] >> (cpu % 64)) & 1;
+}
+
+/* Number of CPUs in a set */
+int sacd_internal_cpuset_count(const sacd_cpuset_t *set) {
+    int count = 0;
+    for (int i = 0; i < SACD_MAX_CPUS / 64; i++) {
+        count += __builtin_popcountll(set->bits[i]);
+    }
+    return count;
+}
+
+/* Parse a CPU list such as "0-3,8,10-11" */
+sacd_result_t sacd_internal_cpuset_parse(const char *list, sacd_cpuset_t *set) {
+    if (!list || !set) {
+        return SACD_RESULT_ERROR;
+    }
+
+    sacd_internal_cpuset_clear(set);
+
+    const char *p = list;
+    while (*p) {
+        while (isspace((unsigned char)*p)) {
+            p++;
+        }
+        if (!isdigit((unsigned char)*p)) {
+            return SACD_RESULT_ERROR;
+        }
+
+        char *end;
+        long first = strtol(p, &end, 10);
+        long last = first;
+        p = end;
+        if (*p == '-') {
+            p++;
+            if (!isdigit((unsigned char)*p)) {
+                return SACD_RESULT_ERROR;
+            }
+            last = strtol(p, &end, 10);
+            p = end;
+        }
+        if (last < first || last >= SACD_MAX_CPUS) {
+            return SACD_RESULT_ERROR;
+        }
+        for (long cpu = first; cpu <= last; cpu++) {
+            sacd_internal_cpuset_add(set, (int)cpu);
+        }
+
+        while (isspace((unsigned char)*p)) {
+            p++;
+        }
+        if (*p == ',') {
+            p++;
+        } else if (*p) {
+            return SACD_RESULT_ERROR;
+        }
+    }
+
+    return sacd_internal_cpuset_count(set) > 0 ? SACD_RESULT_OK : SACD_RESULT_ERROR;
+}
+
+/* CPUs of a NUMA node */
+sacd_result_t sacd_internal_numa_node_cpus(int node, sacd_cpuset_t *set) {
+    char path[64];
+    snprintf(path, sizeof(path), NODE_SYSFS "/node%d/cpulist", node);
+
+    FILE *file = fopen(path, "r");
+    if (!file) {
+        return SACD_RESULT_ERROR;
+    }
+
+    char list[1024];
+    bool ok = fgets(list, sizeof(list), file) != NULL;
+    fclose(file);
+    if (!ok) {
+        return SACD_RESULT_ERROR;
+    }
+
+    list[strcspn(list, "\n")] = '\0';
+    return sacd_internal_cpuset_parse(list, set);
+}
+
+/* Number of NUMA nodes (nodes are numbered 0..n-1) */
+int sacd_internal_numa_node_count(void) {
+    static int cached = 0;
+
+    int count = __atomic_load_n(&cached, __ATOMIC_RELAXED);
+    if (count == 0) {
+        sacd_cpuset_t set;
+        while (count < SACD_MAX_CPUS && sacd_internal_numa_node_cpus(count, &set) == SACD_RESULT_OK) {
+            count++;
+        }
+        if (count == 0) {
+            count = 1;
+        }
+        __atomic_store_n(&cached, count, __ATOMIC_RELAXED);
+    }
+
+    return count;
+}
+
+/* NUMA node of a CPU (0 if unknown) */
+int sacd_internal_numa_node_of_cpu(int cpu) {
+    int nodes = sacd_internal_numa_node_count();
+    for (int node = 0; node < nodes; node++) {
+        sacd_cpuset_t set;
+        if (sacd_internal_numa_node_cpus(node, &set) == SACD_RESULT_OK &&
+            sacd_internal_cpuset_has(&set, cpu)) {
+            return node;
+        }
+    }
+    return 0;
+}
+
+/* NUMA node the calling thread is running on */
+int sacd_internal_current_numa_node(void) {
+#ifdef __linux__
+    int cpu = sched_getcpu();
+    if (cpu >= 0) {
+        return sacd_internal_numa_node_of_cpu(cpu);
+    }
+#endif
+    return 0;
+}
+
+#ifdef __linux__
+static void to_cpu_set(const sacd_cpuset_t *set, cpu_set_t *cpus) {
+    CPU_ZERO(cpus);
+    for (int cpu = 0; cpu < SACD_MAX_CPUS && cpu < CPU_SETSIZE; cpu++) {
+        if (sacd_internal_cpuset_has(set, cpu)) {
+            CPU_SET(cpu, cpus);
+        }
+    }
+}
+#endif
+
+/* Restrict the calling thread to a set of CPUs */
+sacd_result_t sacd_internal_pin_thread(const sacd_cpuset_t *set) {
+#ifdef __linux__
+    cpu_set_t cpus;
+    to_cpu_set(set, &cpus);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0) {
+        SACD_DEBUG_LOG("Failed to pin thread to %d CPUs", sacd_internal_cpuset_count(set));
+        return SACD_RESULT_ERROR;
+    }
+    return SACD_RESULT_OK;
+#else
+    (void)set;
+    return SACD_RESULT_ERROR;
+#endif
+}
+
+/* Create a thread that only ever runs on 'cpus' (NULL = anywhere) */
+int sacd_internal_thread_create(pthread_t *thread, const sacd_cpuset_t *cpus,
+                                void *(*start)(void *), void *arg) {
+#ifdef __linux__
+    if (cpus) {
+        pthread_attr_t attr;
+        cpu_set_t set;
+        to_cpu_set(cpus, &set);
+        pthread_attr_init(&attr);
+        pthread_attr_setaffinity_np(&attr, sizeof(set), &set);
+        int result = pthread_create(thread, &attr, start, arg);
+        pthread_attr_destroy(&attr);
+        if (result != EINVAL) {
+            return result;
+        }
+        /* None of the CPUs are usable (e.g. offline); run unpinned */
+        SACD_DEBUG_LOG("Ignoring unusable CPU set for new thread");
+    }
+#else
+    (void)cpus;
+#endif
+    return pthread_create(thread, NULL, start, arg);
+}
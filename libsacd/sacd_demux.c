@@ -0,0 +1,155 @@
+/**
+ * SACD Library - Audio Sector Demultiplexer
+ *
+ * Reassembles the 1/75 second audio frames of an area from its audio
+ * sectors. Each sector starts with a header byte, then the packet info
+ * (frame start flag, data type and length of every packet), then the frame
+ * info (timecode, and for DST the sector count, of every frame starting in
+ * the sector), then the packet payloads. A frame's audio packets may run
+ * across any number of sectors, and one sector may hold the end of one
+ * frame and the starts of several more.
+ *
+ * Frames are collected in one buffer that is reused for every frame, so
+ * the steady state allocates nothing. A plain DSD frame has a fixed size
+ * and is emitted as soon as it is complete; a DST frame is complete when
+ * the next frame starts (or the stream ends).
+ */
+
+#include "sacd_lib.h"
+#include "sacd_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Bytes of one plain DSD frame per channel */
+#define DSD_FRAME_BYTES (SACD_SAMPLING_FREQ / SACD_FRAME_RATE / 8)
+
+/* Set up a demultiplexer for an area with 'channel_count' channels */
+void sacd_internal_demux_init(sacd_demux_t *demux, int channel_count) {
+    memset(demux, 0, sizeof(sacd_demux_t));
+    demux->frame.channel_count = channel_count;
+}
+
+/* Forget any partly assembled frame (the next sector doesn't follow on) */
+void sacd_internal_demux_reset(sacd_demux_t *demux) {
+    demux->open = false;
+    demux->frame.size = 0;
+}
+
+/* Release the frame buffer */
+void sacd_internal_demux_free(sacd_demux_t *demux) {
+    free(demux->frame.data);
+    demux->frame.data = NULL;
+    demux->capacity = 0;
+    sacd_internal_demux_reset(demux);
+}
+
+/* Size of a complete frame, 0 if only the next frame start tells */
+static size_t complete_size(const sacd_demux_t *demux) {
+    return demux->frame.dst_encoded ? 0 : (size_t)DSD_FRAME_BYTES * demux->frame.channel_count;
+}
+
+/* Hand the assembled frame to the caller */
+static sacd_result_t emit(sacd_demux_t *demux, sacd_frame_callback_t callback, void *userdata) {
+    if (!demux->open) {
+        return SACD_RESULT_OK;
+    }
+    demux->open = false;
+    if (demux->frame.size == 0) {
+        return SACD_RESULT_OK;
+    }
+    demux->frames_emitted++;
+    return callback(&demux->frame, userdata);
+}
+
+/* Append a packet's payload to the frame */
+static sacd_result_t append(sacd_demux_t *demux, const uint8_t *data, size_t length) {
+    size_t needed = demux->frame.size + length;
+    if (needed > demux->capacity) {
+        size_t capacity = demux->capacity ? demux->capacity : 32 * SACD_LSN_SIZE;
+        while (capacity < needed) {
+            capacity *= 2;
+        }
+        uint8_t *buffer = realloc(demux->frame.data, capacity);
+        if (!buffer) {
+            return SACD_RESULT_OUT_OF_MEMORY;
+        }
+        demux->frame.data = buffer;
+        demux->capacity = capacity;
+    }
+
+    memcpy(demux->frame.data + demux->frame.size, data, length);
+    demux->frame.size += length;
+    return SACD_RESULT_OK;
+}
+
+/* Feed the next sector of the stream; completed frames are passed to 'callback' */
+sacd_result_t sacd_internal_demux_sector(sacd_demux_t *demux, uint32_t lsn, const uint8_t *sector_data,
+                                         sacd_frame_callback_t callback, void *userdata) {
+    if (!demux || !sector_data || !callback) {
+        return SACD_RESULT_ERROR;
+    }
+
+    sacd_audio_sector_t sector;
+    sacd_result_t result = sacd_internal_parse_audio_sector(sector_data, &sector);
+    if (result != SACD_RESULT_OK) {
+        /* The frame in progress has lost its continuation */
+        sacd_internal_demux_reset(demux);
+        return result;
+    }
+
+    int frame_info = 0;
+    for (int i = 0; i < sector.packet_count; i++) {
+        const sacd_audio_packet_t *packet = &sector.packets[i];
+
+        if (packet->frame_start) {
+            SACD_CHECK_RESULT(emit(demux, callback, userdata));
+
+            sacd_audio_frame_t *frame = &demux->frame;
+            if (frame_info < sector.frame_count) {
+                frame->timecode = sector.frame_timecodes[frame_info];
+                frame->sector_count = sector.dst_encoded ? sector.frame_sector_counts[frame_info] : 0;
+                frame_info++;
+            } else {
+                /* Frame info missing: assume the frame follows the last one */
+                sacd_internal_frames_to_time(sacd_internal_time_to_frames(&frame->timecode) + 1,
+                                             &frame->timecode);
+                frame->sector_count = 0;
+            }
+            frame->dst_encoded = sector.dst_encoded;
+            frame->start_lsn = lsn;
+            frame->size = 0;
+            demux->open = true;
+        }
+
+        /* Continuation of a frame that started before the stream did */
+        if (packet->data_type != SACD_PACKET_AUDIO || !demux->open) {
+            continue;
+        }
+
+        size_t length = packet->length;
+        size_t complete = complete_size(demux);
+        if (complete && demux->frame.size + length > complete) {
+            length = complete - demux->frame.size;  /* Anything beyond a full frame is not audio */
+        }
+        SACD_CHECK_RESULT(append(demux, packet->data, length));
+        if (complete && demux->frame.size == complete) {
+            SACD_CHECK_RESULT(emit(demux, callback, userdata));
+        }
+    }
+
+    return SACD_RESULT_OK;
+}
+
+/* End of the stream: pass on the last frame */
+sacd_result_t sacd_internal_demux_flush(sacd_demux_t *demux, sacd_frame_callback_t callback, void *userdata) {
+    if (!demux || !callback) {
+        return SACD_RESULT_ERROR;
+    }
+
+    /* A plain DSD frame that is still open was cut short */
+    if (complete_size(demux)) {
+        sacd_internal_demux_reset(demux);
+        return SACD_RESULT_OK;
+    }
+    return emit(demux, callback, userdata);
+}
@@ -13,6 +13,7 @@
 #include <fcntl.h>
 #include <errno.h>
 #include <sys/stat.h>
+#include <pthread.h>
 
 /* Internal disc structure */
 typedef struct sacd_disc_internal {
@@ -35,19 +36,15 @@ typedef struct sacd_disc_internal {
     /* Text data */
     uint8_t *text_data;           /* Raw text data */
     
+    /* Frame indexes, built on first use */
+    sacd_frame_index_t frame_index[SACD_MAX_AREAS];
+    pthread_mutex_t index_mutex;  /* Guards frame_index */
+    
     /* State */
     bool is_open;                 /* True if disc is open */
     bool areas_parsed;            /* True if areas have been parsed */
 } sacd_disc_internal_t;
 
-/* SACD constants from the specification */
-#define SACD_MASTER_TOC_START_LSN  510
-#define SACD_MASTER_TOC_LENGTH     10
-
-/* SACD signature markers */
-#define SACD_SIGNATURE             "SACDMTOC"
-#define SACD_TEXT_SIGNATURE        "SACDText"
-
 /* Endian conversion helpers */
 static uint16_t be16_to_cpu(const uint8_t *data) {
     return (data[0] << 8) | data[1];
@@ -107,6 +104,35 @@ static char *parse_text_field(const uint8_t *data, size_t offset, size_t max_siz
     return result;
 }
 
+/* Parse one text field of SACDText: the disc's own text, else the album's */
+static char *parse_master_text_field(const uint8_t *text, int field, sacd_charset_t charset) {
+    uint16_t position = be16_to_cpu(text + 32 + field * 2);    /* Disc text */
+    if (position == 0) {
+        position = be16_to_cpu(text + 16 + field * 2);         /* Album text */
+    }
+    /* Positions are offsets within the sector; 0 means the field is absent */
+    if (position == 0) {
+        return NULL;
+    }
+    return parse_text_field(text, position, SACD_LSN_SIZE, charset);
+}
+
+/* Parse the SACDText sector following the master TOC header */
+static void parse_master_text(const uint8_t *text, sacd_charset_t charset, sacd_text_t *out) {
+    if (memcmp(text, "SACDText", 8) != 0) {
+        return;
+    }
+    
+    out->title = parse_master_text_field(text, 0, charset);
+    out->artist = parse_master_text_field(text, 1, charset);
+    out->publisher = parse_master_text_field(text, 2, charset);
+    out->copyright = parse_master_text_field(text, 3, charset);
+    out->title_phonetic = parse_master_text_field(text, 4, charset);
+    out->artist_phonetic = parse_master_text_field(text, 5, charset);
+    out->publisher_phonetic = parse_master_text_field(text, 6, charset);
+    out->copyright_phonetic = parse_master_text_field(text, 7, charset);
+}
+
 /* Parse master TOC (Table of Contents) */
 static sacd_result_t parse_master_toc(sacd_disc_internal_t *internal) {
     if (!internal->master_toc_data) {
@@ -145,21 +171,20 @@ static sacd_result_t parse_master_toc(sacd_disc_internal_t *internal) {
     uint32_t area_1_toc_start = be32_to_cpu(data + 64);  /* 2-channel area */
     uint32_t area_2_toc_start = be32_to_cpu(data + 72);  /* Multi-channel area */
     
-    /* Parse disc type */
-    disc->is_hybrid = (data[80] & 0x01) != 0;
+    /* Parse disc type (bit 7 = hybrid) */
+    disc->is_hybrid = (data[80] & 0x80) != 0;
     
     /* Parse area TOC sizes */
     uint16_t area_1_toc_size = be16_to_cpu(data + 84);
     uint16_t area_2_toc_size = be16_to_cpu(data + 86);
     
     /* Parse date */
-    disc->year = be16_to_cpu(data + 104);    /* Fixed offset */
-    disc->month = data[106];
-    disc->day = data[107];
+    disc->year = be16_to_cpu(data + 120);    /* After the disc genres */
+    disc->month = data[122];
+    disc->day = data[123];
     
-    /* Set placeholder text information */
-    disc->text.title = strdup("SACD Album");
-    disc->text.artist = strdup("Unknown Artist");
+    /* Parse album/disc text from the first text channel */
+    parse_master_text(data + SACD_LSN_SIZE, (sacd_charset_t)data[138], &disc->text);
     
     /* Initialize area count to 0 - will be set during area parsing */
     disc->area_count = 0;
@@ -208,6 +233,12 @@ static sacd_result_t parse_area_toc(sacd_disc_internal_t *internal, int area_ind
     /* Parse channel count */
     area->channel_count = data[32];
     
+    /* Parse frame format (low nibble): 0 = DST, 2 = DSD 3-in-14, 3 = DSD 3-in-16 */
+    uint8_t frame_format = data[21] & 0x0F;
+    sacd_frame_format_t area_frame_format = (frame_format == 0) ? SACD_FRAME_DST :
+                                            (frame_format == 2) ? SACD_FRAME_DSD_3_IN_14 :
+                                                                  SACD_FRAME_DSD_3_IN_16;
+    
     /* Parse sample frequency (should be 2822400 for DSD) */
     area->sample_frequency = SACD_SAMPLING_FREQ;
     
@@ -232,6 +263,8 @@ static sacd_result_t parse_area_toc(sacd_disc_internal_t *internal, int area_ind
                 area->tracks[i].start_lsn = be32_to_cpu(p + 8 + i * 4);
                 area->tracks[i].length_lsn = be32_to_cpu(p + 8 + (255 + i) * 4);
                 area->tracks[i].channel_count = area->channel_count;
+                area->tracks[i].frame_format = area_frame_format;
+                area->tracks[i].dst_encoded = (area_frame_format == SACD_FRAME_DST);
             }
             p += SACD_LSN_SIZE;
         }
@@ -375,6 +408,10 @@ sacd_result_t sacd_disc_open(const char *iso_path, sacd_disc_t **disc) {
         return SACD_RESULT_IO_ERROR;
     }
     internal->file_size = st.st_size;
+    pthread_mutex_init(&internal->index_mutex, NULL);
+    
+    /* Linked before parsing so that closing on failure frees everything */
+    internal->public.internal_data = internal;
     
     /* Parse disc structure */
     sacd_result_t result = parse_disc_structure(internal);
@@ -384,7 +421,6 @@ sacd_result_t sacd_disc_open(const char *iso_path, sacd_disc_t **disc) {
     }
     
     internal->is_open = true;
-    internal->public.internal_data = internal;
     *disc = &internal->public;
     
     return SACD_RESULT_OK;
@@ -413,7 +449,9 @@ void sacd_disc_close(sacd_disc_t *disc) {
     
     for (int i = 0; i < SACD_MAX_AREAS; i++) {
         free(internal->area_data[i]);
+        sacd_internal_frame_index_free(&internal->frame_index[i]);
     }
+    pthread_mutex_destroy(&internal->index_mutex);
     
     /* Free text fields */
     free(disc->text.title);
@@ -483,42 +521,164 @@ const sacd_area_t *sacd_disc_get_best_area(const sacd_disc_t *disc) {
     return sacd_disc_get_area(disc, SACD_AREA_MULTICHANNEL);
 }
 
-/* Read a sector from SACD disc (wrapper function) */
-sacd_result_t sacd_internal_read_sector(sacd_disc_internal_t *internal, uint32_t lsn, uint8_t *buffer) {
-    return read_sector(internal, lsn, buffer);
+/* Slot of an area's frame index, NULL if the area isn't on this disc */
+static sacd_frame_index_t *frame_index_slot(sacd_disc_internal_t *internal, const sacd_area_t *area) {
+    for (int i = 0; i < internal->public.area_count; i++) {
+        if (area == &internal->public.areas[i]) {
+            return &internal->frame_index[i];
+        }
+    }
+    return NULL;
 }
 
-/* Extract DSD audio data from a sector */
-uint8_t *sacd_internal_extract_dsd_from_sector(const uint8_t *sector_data, size_t *audio_size) {
-    if (!sector_data || !audio_size) {
-        return NULL;
+/* Identity of the disc an area belongs to: a hash of the master TOC's and the area TOC's first sectors */
+uint64_t sacd_internal_disc_area_id(const sacd_disc_internal_t *internal, const sacd_area_t *area) {
+    sacd_xxh3_state_t state;
+    sacd_internal_xxh3_init(&state);
+    sacd_internal_xxh3_update(&state, internal->master_toc_data, SACD_LSN_SIZE);
+    for (int i = 0; i < internal->public.area_count; i++) {
+        if (area == &internal->public.areas[i] && internal->area_data[i]) {
+            sacd_internal_xxh3_update(&state, internal->area_data[i], SACD_LSN_SIZE);
+        }
+    }
+    return sacd_internal_xxh3_digest(&state);
+}
+
+sacd_result_t sacd_internal_disc_frame_index(sacd_disc_internal_t *disc, const sacd_area_t *area,
+                                             const sacd_frame_index_t **index) {
+    sacd_frame_index_t *slot = frame_index_slot(disc, area);
+    if (!slot) {
+        return SACD_RESULT_INVALID_AREA;
     }
     
-    /* 
-     * SACD sector structure:
-     * - First 16 bytes: Sector header
-     * - Next 2048 bytes: Audio data 
-     * - Last 288 bytes: Error correction/subcode
-     * 
-     * For now, extract the main audio payload from sector
-     */
+    sacd_result_t result = SACD_RESULT_OK;
+    pthread_mutex_lock(&disc->index_mutex);
+    if (slot->frame_count == 0) {
+        result = sacd_internal_frame_index_build(disc, area, slot);
+    }
+    pthread_mutex_unlock(&disc->index_mutex);
     
-    /* Skip 16-byte sector header */
-    const uint8_t *audio_start = sector_data + 16;
+    *index = slot;
+    return result;
+}
+
+sacd_result_t sacd_disc_find_frame(const sacd_disc_t *disc, const sacd_area_t *area,
+                                   const sacd_time_t *time, uint32_t *lsn) {
+    if (!disc || !area || !time || !lsn) {
+        return SACD_RESULT_ERROR;
+    }
     
-    /* Audio data is 2048 bytes after header */
-    size_t raw_audio_size = 2048;
+    const sacd_frame_index_t *index;
+    SACD_CHECK_RESULT(sacd_internal_disc_frame_index(disc->internal_data, area, &index));
+    return sacd_internal_frame_index_lookup(index, sacd_internal_time_to_frames(time), lsn);
+}
+
+sacd_result_t sacd_disc_save_frame_index(const sacd_disc_t *disc, const sacd_area_t *area, const char *path) {
+    if (!disc || !area || !path) {
+        return SACD_RESULT_ERROR;
+    }
     
-    /* Allocate buffer for extracted audio */
-    uint8_t *audio_data = malloc(raw_audio_size);
-    if (!audio_data) {
-        *audio_size = 0;
-        return NULL;
+    const sacd_frame_index_t *index;
+    SACD_CHECK_RESULT(sacd_internal_disc_frame_index(disc->internal_data, area, &index));
+    return sacd_internal_frame_index_save(index, area, sacd_internal_disc_area_id(disc->internal_data, area), path);
+}
+
+sacd_result_t sacd_disc_load_frame_index(const sacd_disc_t *disc, const sacd_area_t *area, const char *path) {
+    if (!disc || !area || !path) {
+        return SACD_RESULT_ERROR;
+    }
+    
+    sacd_disc_internal_t *internal = (sacd_disc_internal_t*)disc->internal_data;
+    sacd_frame_index_t *slot = frame_index_slot(internal, area);
+    if (!slot) {
+        return SACD_RESULT_INVALID_AREA;
+    }
+    
+    /* An index already in memory is as good as the file's */
+    sacd_result_t result = SACD_RESULT_OK;
+    pthread_mutex_lock(&internal->index_mutex);
+    if (slot->frame_count == 0) {
+        result = sacd_internal_frame_index_load(slot, area, sacd_internal_disc_area_id(internal, area), path);
+    }
+    pthread_mutex_unlock(&internal->index_mutex);
+    return result;
+}
+
+/* Read a sector from SACD disc (wrapper function) */
+sacd_result_t sacd_internal_read_sector(sacd_disc_internal_t *internal, uint32_t lsn, uint8_t *buffer) {
+    return read_sector(internal, lsn, buffer);
+}
+
+/* Read consecutive sectors in one request */
+sacd_result_t sacd_internal_read_sectors(sacd_disc_internal_t *disc, uint32_t start_lsn,
+                                         uint32_t sector_count, uint8_t *buffer) {
+    if (!disc || !buffer) {
+        return SACD_RESULT_ERROR;
     }
     
-    /* Copy the audio data */
-    memcpy(audio_data, audio_start, raw_audio_size);
-    *audio_size = raw_audio_size;
+    size_t size = (size_t)sector_count * SACD_LSN_SIZE;
+    off_t offset = (off_t)start_lsn * SACD_LSN_SIZE;
+    size_t done = 0;
+    while (done < size) {
+        ssize_t bytes_read = pread(disc->fd, buffer + done, size - done, offset + (off_t)done);
+        if (bytes_read < 0 && errno == EINTR) {
+            continue;
+        }
+        if (bytes_read <= 0) {
+            return SACD_RESULT_IO_ERROR;
+        }
+        done += (size_t)bytes_read;
+    }
     
-    return audio_data;
-}
\ No newline at end of file
+    return SACD_RESULT_OK;
+}
+
+/* Parse the packet and frame layout of an audio sector */
+sacd_result_t sacd_internal_parse_audio_sector(const uint8_t *sector_data, sacd_audio_sector_t *sector) {
+    if (!sector_data || !sector) {
+        return SACD_RESULT_ERROR;
+    }
+
+    memset(sector, 0, sizeof(sacd_audio_sector_t));
+
+    /* Header byte: packet_info_count:3, frame_info_count:3, reserved:1, dst_encoded:1 */
+    uint8_t header = sector_data[0];
+    sector->packet_count = header >> 5;
+    sector->frame_count = (header >> 2) & 0x07;
+    sector->dst_encoded = header & 0x01;
+
+    size_t offset = 1;
+
+    /* Packet info: frame_start:1, reserved:1, data_type:3, packet_length:11 */
+    for (int i = 0; i < sector->packet_count; i++) {
+        const uint8_t *info = sector_data + offset;
+        sector->packets[i].frame_start = (info[0] >> 7) & 0x01;
+        sector->packets[i].data_type = (info[0] >> 3) & 0x07;
+        sector->packets[i].length = (uint16_t)(((info[0] & 0x07) << 8) | info[1]);
+        offset += 2;
+    }
+
+    /* Frame info: timecode (and DST sector count) of each frame starting here */
+    for (int i = 0; i < sector->frame_count; i++) {
+        const uint8_t *info = sector_data + offset;
+        sector->frame_timecodes[i].minutes = info[0];
+        sector->frame_timecodes[i].seconds = info[1];
+        sector->frame_timecodes[i].frames = info[2];
+        offset += 3;
+        if (sector->dst_encoded) {
+            sector->frame_sector_counts[i] = (info[3] >> 2) & 0x1F;
+            offset += 1;
+        }
+    }
+
+    /* Packet payloads follow in order */
+    for (int i = 0; i < sector->packet_count; i++) {
+        if (offset + sector->packets[i].length > SACD_LSN_SIZE) {
+            return SACD_RESULT_INVALID_FILE;
+        }
+        sector->packets[i].data = sector_data + offset;
+        offset += sector->packets[i].length;
+    }
+
+    return SACD_RESULT_OK;
+}
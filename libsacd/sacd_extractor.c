@@ -16,6 +16,60 @@
 #include <errno.h>
 #include <unistd.h>
 
+/* Queue entries from SACD_MAX_TRACKS on are time ranges */
+static bool is_range(int entry) {
+    return entry >= SACD_MAX_TRACKS;
+}
+
+/* What a queue entry extracts: an area track, or a range described as one */
+static const sacd_track_t *queue_track(const sacd_extractor_internal_t *internal, int entry) {
+    return is_range(entry) ? &internal->ranges[entry - SACD_MAX_TRACKS] : &internal->area->tracks[entry];
+}
+
+/* Parse the CPU lists of SACD_CPU_PLACEMENT_MANUAL */
+static sacd_result_t parse_manual_cpus(sacd_extractor_internal_t *internal) {
+    const sacd_extraction_options_t *options = &internal->options;
+    
+    if (options->extraction_cpus) {
+        SACD_CHECK_RESULT(sacd_internal_cpuset_parse(options->extraction_cpus, &internal->extraction_cpus));
+        internal->pin_extraction = true;
+    }
+    if (options->worker_cpus) {
+        SACD_CHECK_RESULT(sacd_internal_cpuset_parse(options->worker_cpus, &internal->worker_cpus));
+        internal->pin_workers = true;
+    } else if (internal->pin_extraction) {
+        internal->worker_cpus = internal->extraction_cpus;
+        internal->pin_workers = true;
+    }
+    
+    return SACD_RESULT_OK;
+}
+
+/* Pin the extraction thread (on itself) and choose its workers' CPUs */
+static void place_threads(sacd_extractor_internal_t *internal) {
+    if (internal->options.cpu_placement == SACD_CPU_PLACEMENT_AUTO) {
+        /* One node keeps the whole pipeline's buffers in local memory */
+        int nodes = sacd_internal_numa_node_count();
+        internal->pin_extraction = false;
+        internal->pin_workers = false;
+        if (nodes > 1) {
+            int node = internal->options.numa_node;
+            if (node < 0 || node >= nodes) {
+                node = sacd_internal_current_numa_node();
+            }
+            if (sacd_internal_numa_node_cpus(node, &internal->extraction_cpus) == SACD_RESULT_OK) {
+                internal->worker_cpus = internal->extraction_cpus;
+                internal->pin_extraction = true;
+                internal->pin_workers = true;
+            }
+        }
+    }
+    
+    if (internal->pin_extraction) {
+        sacd_internal_pin_thread(&internal->extraction_cpus);
+    }
+}
+
 /* Create an extractor */
 sacd_result_t sacd_extractor_create(
     const sacd_disc_t *disc,
@@ -30,6 +84,10 @@ sacd_result_t sacd_extractor_create(
     
     *extractor = NULL;
     
+    if (options->sink_type == SACD_SINK_FD && options->sink_fd < 0) {
+        return SACD_RESULT_ERROR;
+    }
+    
     /* Allocate internal structure */
     sacd_extractor_internal_t *internal = calloc(1, sizeof(sacd_extractor_internal_t));
     if (!internal) {
@@ -50,6 +108,17 @@ sacd_result_t sacd_extractor_create(
     
     /* Copy options */
     internal->options = *options;
+    if (options->cpu_placement == SACD_CPU_PLACEMENT_MANUAL &&
+        parse_manual_cpus(internal) != SACD_RESULT_OK) {
+        free(internal->output_dir);
+        free(internal);
+        return SACD_RESULT_ERROR;
+    }
+    /* The lists are parsed; don't keep pointers into the caller's memory */
+    internal->options.extraction_cpus = NULL;
+    internal->options.worker_cpus = NULL;
+    sacd_internal_throttle_set_rate(&internal->read_throttle, options->read_bytes_per_sec);
+    sacd_internal_throttle_set_rate(&internal->write_throttle, options->write_bytes_per_sec);
     
     /* Initialize track queue */
     internal->track_queue_capacity = 16;
@@ -77,10 +146,11 @@ sacd_result_t sacd_extractor_create(
         free(internal);
         return result;
     }
+    sacd_internal_demux_init(&internal->demux, area->channel_count);
     
-    /* Create output directory if it doesn't exist */
+    /* Create output directory if it doesn't exist (only files go there) */
     struct stat st;
-    if (stat(output_dir, &st) != 0) {
+    if (options->sink_type == SACD_SINK_FILE && stat(output_dir, &st) != 0) {
         if (mkdir(output_dir, 0755) != 0) {
             sacd_internal_dst_decoder_cleanup(&internal->dst_decoder);
             pthread_mutex_destroy(&internal->state_mutex);
@@ -111,24 +181,28 @@ void sacd_extractor_destroy(sacd_extractor_t *extractor) {
     /* Cancel and wait for any running extraction */
     if (internal->is_running) {
         sacd_extractor_cancel(extractor);
-        sacd_extractor_wait(extractor);
     }
+    sacd_extractor_wait(extractor);
     
-    /* Close any open output file */
-    if (internal->current_output_file) {
-        fclose(internal->current_output_file);
-    }
+    /* Close any open output */
+    sacd_sink_close(internal->current_output);
     
     /* Cleanup DST decoder */
     sacd_internal_dst_decoder_cleanup(&internal->dst_decoder);
     
+    sacd_internal_demux_free(&internal->demux);
+    sacd_internal_silence_free(&internal->silence);
+    
     /* Destroy mutex */
     pthread_mutex_destroy(&internal->state_mutex);
     
     /* Free allocated memory */
+    for (int i = 0; i < internal->range_count; i++) {
+        free(internal->ranges[i].text.title);
+    }
+    free(internal->ranges);
     free(internal->track_queue);
     free(internal->output_dir);
-    free(internal->current_frame.data);
     free(internal);
 }
 
@@ -182,6 +256,100 @@ sacd_result_t sacd_extractor_add_tracks(
     return SACD_RESULT_OK;
 }
 
+/* Add a time range to extraction queue */
+sacd_result_t sacd_extractor_add_range(
+    sacd_extractor_t *extractor,
+    const sacd_time_t *start_time,
+    const sacd_time_t *end_time) {
+    
+    if (!extractor || !start_time || !end_time) {
+        return SACD_RESULT_ERROR;
+    }
+    
+    sacd_extractor_internal_t *internal = (sacd_extractor_internal_t*)extractor->internal_data;
+    if (!internal) {
+        return SACD_RESULT_ERROR;
+    }
+    
+    const sacd_area_t *area = internal->area;
+    uint32_t first_frame = sacd_internal_time_to_frames(start_time);
+    uint32_t end_frame = sacd_internal_time_to_frames(end_time);
+    if (start_time->seconds >= 60 || start_time->frames >= SACD_FRAME_RATE ||
+        end_time->seconds >= 60 || end_time->frames >= SACD_FRAME_RATE || end_frame <= first_frame) {
+        return SACD_RESULT_ERROR;
+    }
+    
+    /* The track the range starts in names the output and takes its statistics */
+    int track_num = -1;
+    for (int i = 0; i < area->track_count; i++) {
+        if (sacd_internal_time_to_frames(&area->tracks[i].start_time) > first_frame) {
+            break;
+        }
+        track_num = i;
+    }
+    if (track_num < 0) {
+        track_num = 0;
+    }
+    const sacd_track_t *last = &area->tracks[area->track_count - 1];
+    if (end_frame > sacd_internal_time_to_frames(&last->start_time) + sacd_internal_time_to_frames(&last->duration)) {
+        return SACD_RESULT_INVALID_TRACK;
+    }
+    
+    const sacd_track_t *track = &area->tracks[track_num];
+    const char *title = (track->text.title && track->text.title[0]) ? track->text.title : "Track";
+    size_t title_size = strlen(title) + 32;
+    char *range_title = malloc(title_size);
+    if (!range_title) {
+        return SACD_RESULT_OUT_OF_MEMORY;
+    }
+    snprintf(range_title, title_size, "%s [%02d.%02d.%02d-%02d.%02d.%02d]", title,
+             start_time->minutes, start_time->seconds, start_time->frames,
+             end_time->minutes, end_time->seconds, end_time->frames);
+    
+    pthread_mutex_lock(&internal->state_mutex);
+    
+    /* Check if extraction is running */
+    if (internal->is_running) {
+        pthread_mutex_unlock(&internal->state_mutex);
+        free(range_title);
+        return SACD_RESULT_ERROR;
+    }
+    
+    if (internal->range_count == internal->range_capacity ||
+        internal->track_queue_count == internal->track_queue_capacity) {
+        int range_capacity = internal->range_capacity ? internal->range_capacity * 2 : 8;
+        sacd_track_t *ranges = realloc(internal->ranges, range_capacity * sizeof(sacd_track_t));
+        if (ranges) {
+            internal->ranges = ranges;
+            internal->range_capacity = range_capacity;
+        }
+        int queue_capacity = internal->track_queue_capacity * 2;
+        int *queue = realloc(internal->track_queue, queue_capacity * sizeof(int));
+        if (queue) {
+            internal->track_queue = queue;
+            internal->track_queue_capacity = queue_capacity;
+        }
+        if (!ranges || !queue) {
+            pthread_mutex_unlock(&internal->state_mutex);
+            free(range_title);
+            return SACD_RESULT_OUT_OF_MEMORY;
+        }
+    }
+    
+    /* Described as a track; its sectors are found when the extraction plans it */
+    sacd_track_t *range = &internal->ranges[internal->range_count];
+    *range = *track;
+    range->text.title = range_title;
+    range->start_time = *start_time;
+    sacd_internal_frames_to_time(end_frame - first_frame, &range->duration);
+    range->start_lsn = 0;
+    range->length_lsn = 0;
+    internal->track_queue[internal->track_queue_count++] = SACD_MAX_TRACKS + internal->range_count++;
+    
+    pthread_mutex_unlock(&internal->state_mutex);
+    return SACD_RESULT_OK;
+}
+
 /* Add all tracks to extraction queue */
 sacd_result_t sacd_extractor_add_all_tracks(sacd_extractor_t *extractor) {
     if (!extractor) {
@@ -210,195 +378,1218 @@ sacd_result_t sacd_extractor_add_all_tracks(sacd_extractor_t *extractor) {
     return result;
 }
 
-/* Extract a single track */
-static sacd_result_t extract_track(sacd_extractor_internal_t *internal, int track_index) {
-    const sacd_track_t *track = &internal->area->tracks[track_index];
-    sacd_result_t result;
+#define SACD_CHECKSUM_MANIFEST "audio-checksums.txt"
+
+/* Start (or continue) the checksum manifest for this run */
+static void open_checksum_manifest(sacd_extractor_internal_t *internal) {
+    if (!internal->options.checksums || !internal->options.write_checksum_manifest ||
+        internal->options.sink_type != SACD_SINK_FILE) {
+        return;
+    }
     
-    /* Create output filename */
-    char filename[1024];
-    result = sacd_internal_create_filename(&internal->options, track, 
-                                         internal->output_dir, filename, sizeof(filename));
-    if (result != SACD_RESULT_OK) {
-        return result;
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s", internal->output_dir, SACD_CHECKSUM_MANIFEST);
+    
+    /* Resumed runs keep the entries of tracks completed earlier */
+    struct stat st;
+    if (internal->options.resume && stat(path, &st) == 0) {
+        return;
     }
     
-    /* Call track start callback */
-    if (internal->options.track_start_callback) {
-        internal->options.track_start_callback(track->number + 1, track, filename,
-                                             internal->options.callback_userdata);
+    FILE *manifest = fopen(path, "w");
+    if (manifest) {
+        fprintf(manifest, "# Audio payload checksums (file headers excluded)\n");
+        fclose(manifest);
     }
+}
+
+/* Append a track's checksums to the manifest, in BSD tagged format */
+static sacd_result_t append_checksum_manifest(sacd_extractor_internal_t *internal,
+                                              const char *filename,
+                                              const sacd_track_report_t *report) {
+    if (!report->checksum_types || !internal->options.write_checksum_manifest ||
+        internal->options.sink_type != SACD_SINK_FILE) {
+        return SACD_RESULT_OK;
+    }
+    
+    char path[1024];
+    snprintf(path, sizeof(path), "%s/%s", internal->output_dir, SACD_CHECKSUM_MANIFEST);
     
-    /* Open output file */
-    internal->current_output_file = fopen(filename, "wb");
-    if (!internal->current_output_file) {
+    FILE *manifest = fopen(path, "a");
+    if (!manifest) {
         return SACD_RESULT_IO_ERROR;
     }
     
-    /* Estimate audio data size */
-    size_t estimated_audio_size = sacd_estimate_track_file_size(track, internal->options.format);
+    const char *basename = strrchr(filename, '/');
+    basename = basename ? basename + 1 : filename;
     
-    /* Write format-specific header */
-    if (internal->options.format == SACD_FORMAT_DSF) {
-        result = sacd_internal_write_dsf_header(internal->current_output_file, 
-                                              track, internal->area, estimated_audio_size);
-    } else {
-        result = sacd_internal_write_dsdiff_header(internal->current_output_file,
-                                                 track, internal->area, estimated_audio_size);
+    static const sacd_checksum_type_t types[] = {
+        SACD_CHECKSUM_XXH3, SACD_CHECKSUM_MD5, SACD_CHECKSUM_SHA256
+    };
+    for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++) {
+        char hex[65];
+        if (sacd_checksum_format(report, types[i], hex, sizeof(hex))) {
+            fprintf(manifest, "%s (%s) = %s\n", sacd_checksum_name(types[i]), basename, hex);
+        }
     }
     
-    if (result != SACD_RESULT_OK) {
-        fclose(internal->current_output_file);
-        internal->current_output_file = NULL;
-        return result;
+    return (fclose(manifest) == 0) ? SACD_RESULT_OK : SACD_RESULT_IO_ERROR;
+}
+
+/* Feed the audio payload already in a resumed file back through the hashes */
+static sacd_result_t rehash_partial_payload(sacd_extractor_internal_t *internal, FILE *file,
+                                            const sacd_journal_entry_t *entry) {
+    if (!internal->checksum.types || entry->bytes_written == 0) {
+        return SACD_RESULT_OK;
     }
     
-    /* Extract real DSD audio data from SACD sectors */
-    internal->bytes_written = 0;
+    off_t payload_start = (off_t)(entry->file_offset - entry->bytes_written);
+    if (fseeko(file, payload_start, SEEK_SET) != 0) {
+        return SACD_RESULT_IO_ERROR;
+    }
     
-    SACD_DEBUG_LOG("Track %d: Extracting from LSN %d to %d (%d sectors)",
-                   track->number, track->start_lsn, track->start_lsn + track->length_lsn - 1, track->length_lsn);
+    uint8_t buffer[65536];
+    uint64_t remaining = entry->bytes_written;
+    while (remaining > 0) {
+        size_t chunk = remaining < sizeof(buffer) ? (size_t)remaining : sizeof(buffer);
+        if (fread(buffer, 1, chunk, file) != chunk) {
+            return SACD_RESULT_IO_ERROR;
+        }
+        sacd_internal_checksum_update(&internal->checksum, buffer, chunk);
+        remaining -= chunk;
+    }
     
-    /* REAL SACD AUDIO EXTRACTION */
-    uint8_t *sector_buffer = malloc(SACD_LSN_SIZE);
-    if (!sector_buffer) {
-        fclose(internal->current_output_file);
-        internal->current_output_file = NULL;
-        return SACD_RESULT_OUT_OF_MEMORY;
+    return (fseeko(file, (off_t)entry->file_offset, SEEK_SET) == 0) ? SACD_RESULT_OK : SACD_RESULT_IO_ERROR;
+}
+
+/* Account for output work that began at 'start' */
+static void count_write(sacd_extractor_internal_t *internal, uint64_t start) {
+    uint64_t elapsed = sacd_internal_clock_ns() - start;
+    internal->stats.write_ns += elapsed;
+    if (elapsed > SACD_STATS_STALL_NS) {
+        internal->stats.write_stalls++;
+    }
+}
+
+/* Make the live counters visible to sacd_extractor_get_stats() */
+static void publish_stats(sacd_extractor_internal_t *internal) {
+    internal->stats.decode_stalls = sacd_internal_pcm_converter_stalls(internal->pcm_converter) +
+                                    sacd_internal_flac_encoder_stalls(internal->flac_encoder);
+    
+    sacd_internal_seqlock_write_begin(&internal->stats_lock);
+    internal->published_stats = internal->stats;
+    if (internal->current_output) {
+        internal->published_stats.bytes_written += internal->current_output->position - internal->output_base;
+    }
+    sacd_internal_seqlock_write_end(&internal->stats_lock);
+}
+
+/* Hold the extraction to the bandwidth limits, charging one sector read and its output */
+static void throttle_io(sacd_extractor_internal_t *internal, uint64_t *now) {
+    uint64_t written = 0;
+    if (internal->current_output) {
+        uint64_t position = internal->current_output->position;
+        written = position - internal->throttle_mark;
+        internal->throttle_mark = position;
     }
     
-    size_t bytes_written = 0;
-    uint32_t sectors_processed = 0;
+    uint64_t waited = sacd_internal_throttle(&internal->read_throttle, SACD_LSN_SIZE,
+                                             &internal->cancel_requested) +
+                      sacd_internal_throttle(&internal->write_throttle, written,
+                                             &internal->cancel_requested);
+    if (waited > 0) {
+        internal->stats.throttle_ns += waited;
+        *now = sacd_internal_clock_ns();
+    }
+}
+
+/* Make the current progress visible to sacd_extractor_get_progress() */
+static void publish_progress(sacd_extractor_internal_t *internal, bool running) {
+    int count = internal->track_queue_count;
+    int index = internal->current_track_index;
+    sacd_progress_t *progress = &internal->progress;
+    
+    sacd_internal_seqlock_write_begin(&internal->progress_lock);
+    progress->running = running;
+    progress->result = internal->result;
+    progress->track_number = queue_track(internal, internal->track_queue[index])->number + 1;
+    progress->queue_index = index;
+    progress->total_tracks = count;
+    progress->track_progress_percent = internal->current_track_progress;
+    progress->overall_progress_percent = (index * 100 + internal->current_track_progress) / count;
+    progress->track_bytes_written = internal->bytes_written;
+    progress->total_bytes_written = internal->total_bytes_written;
+    progress->sequence++;
+    sacd_internal_seqlock_write_end(&internal->progress_lock);
+}
+
+/* Deliver progress_callback from the published snapshots */
+static void *notifier_thread(void *arg) {
+    sacd_extractor_internal_t *internal = (sacd_extractor_internal_t*)arg;
+    struct timespec interval = { 0, SACD_PROGRESS_NOTIFY_MS * 1000000L };
+    int last_track = -1;
+    int last_progress = -1;
     
-    /* Read each sector in the track */
-    for (uint32_t lsn = track->start_lsn; lsn < track->start_lsn + track->length_lsn && !internal->cancel_requested; lsn++) {
-        /* Read sector from disc */
-        sacd_result_t sector_result = sacd_internal_read_sector(internal->disc_internal, lsn, sector_buffer);
-        if (sector_result != SACD_RESULT_OK) {
-            SACD_DEBUG_LOG("Failed to read sector %d: %s", lsn, sacd_result_string(sector_result));
-            free(sector_buffer);
-            fclose(internal->current_output_file);
-            internal->current_output_file = NULL;
-            return sector_result;
-        }
+    while (!__atomic_load_n(&internal->notifier_stop, __ATOMIC_ACQUIRE)) {
+        sacd_progress_t progress;
+        sacd_internal_seqlock_read(&internal->progress_lock, &progress, &internal->progress, sizeof(progress));
         
-        /* Extract DSD audio data from sector */
-        size_t audio_data_size;
-        uint8_t *audio_data = sacd_internal_extract_dsd_from_sector(sector_buffer, &audio_data_size);
-        if (!audio_data || audio_data_size == 0) {
-            /* Skip sectors without audio data */
-            continue;
+        if (progress.track_number != last_track || progress.track_progress_percent != last_progress) {
+            last_track = progress.track_number;
+            last_progress = progress.track_progress_percent;
+            
+            const sacd_track_t *track = &internal->area->tracks[progress.track_number - 1];
+            char status[256];
+            snprintf(status, sizeof(status), "Extracting track %d/%d: %s (%d%%) - %llu MB",
+                    progress.queue_index + 1, progress.total_tracks,
+                    track->text.title ? track->text.title : "Unknown", progress.track_progress_percent,
+                    (unsigned long long)(progress.track_bytes_written / (1024 * 1024)));
+            
+            internal->options.progress_callback(progress.track_number, progress.total_tracks,
+                                              progress.track_progress_percent,
+                                              progress.overall_progress_percent, status,
+                                              internal->options.callback_userdata);
         }
         
-        /* Process DST decompression if needed */
-        if (track->dst_encoded) {
-            uint8_t *decompressed_data = NULL;
-            size_t decompressed_size = 0;
-            
-            sacd_result_t dst_result = sacd_internal_dst_decode_frame(&internal->dst_decoder, 
-                                                                   audio_data, audio_data_size,
-                                                                   &decompressed_data, &decompressed_size);
-            if (dst_result == SACD_RESULT_OK && decompressed_data) {
-                /* Write decompressed DSD data */
-                if (fwrite(decompressed_data, 1, decompressed_size, internal->current_output_file) != decompressed_size) {
-                    free(decompressed_data);
-                    free(sector_buffer);
-                    fclose(internal->current_output_file);
-                    internal->current_output_file = NULL;
-                    return SACD_RESULT_IO_ERROR;
-                }
-                bytes_written += decompressed_size;
-                free(decompressed_data);
-            }
+        nanosleep(&interval, NULL);
+    }
+    
+    return NULL;
+}
+
+/* Make the output durable up to its current position and journal the checkpoint */
+static sacd_result_t checkpoint_track(
+    sacd_extractor_internal_t *internal,
+    const sacd_track_t *track,
+    const char *filename,
+    uint32_t next_lsn,
+    uint32_t next_frame,
+    size_t bytes_written) {
+    
+    if (!internal->journal.path) {
+        return SACD_RESULT_OK;
+    }
+    
+    sacd_sink_t *sink = internal->current_output;
+    uint64_t start = sacd_internal_clock_ns();
+    sacd_result_t result = sink->flush(sink, true);
+    count_write(internal, start);
+    SACD_CHECK_RESULT(result);
+    
+    return sacd_internal_journal_checkpoint(&internal->journal, track->number, filename,
+                                            next_lsn, next_frame, bytes_written, sink->position);
+}
+
+/* Reopen a partial file from an earlier run and cut it back to its checkpoint */
+static FILE *reopen_partial_file(const char *filename, const sacd_journal_entry_t *entry,
+                                 sacd_output_format_t format) {
+    FILE *file = fopen(filename, "r+b");
+    if (!file) {
+        return NULL;
+    }
+    
+    /* The header must be intact and the checkpointed data present */
+    char magic[4];
+    const char *expected = (format == SACD_FORMAT_DSF) ? "DSD " : "FRM8";
+    struct stat st;
+    if (fread(magic, 1, 4, file) != 4 || memcmp(magic, expected, 4) != 0 ||
+        fstat(fileno(file), &st) != 0 || (uint64_t)st.st_size < entry->file_offset) {
+        fclose(file);
+        return NULL;
+    }
+    
+    /* Anything past the checkpoint was never confirmed durable */
+    if (ftruncate(fileno(file), (off_t)entry->file_offset) != 0 ||
+        fseeko(file, (off_t)entry->file_offset, SEEK_SET) != 0) {
+        fclose(file);
+        return NULL;
+    }
+    
+    return file;
+}
+
+/* Write encoded output and account for it */
+static sacd_result_t write_output(sacd_extractor_internal_t *internal, const uint8_t *data,
+                                  size_t size, size_t *bytes_written) {
+    if (size == 0) {
+        return SACD_RESULT_OK;
+    }
+    
+    uint64_t start = sacd_internal_clock_ns();
+    sacd_result_t result = internal->current_output->write(internal->current_output, data, size);
+    count_write(internal, start);
+    SACD_CHECK_RESULT(result);
+    sacd_internal_checksum_update(&internal->checksum, data, size);
+    *bytes_written += size;
+    return SACD_RESULT_OK;
+}
+
+/* Write a block of DSD audio, through the PCM converter and FLAC encoder if in use */
+static sacd_result_t write_audio(sacd_extractor_internal_t *internal, const uint8_t *data,
+                                 size_t size, size_t *bytes_written) {
+    if (internal->pcm_converter) {
+        SACD_CHECK_RESULT(sacd_internal_pcm_convert(internal->pcm_converter, data, size, &data, &size));
+    }
+    if (internal->flac_encoder && size > 0) {
+        SACD_CHECK_RESULT(sacd_internal_flac_encode(internal->flac_encoder, data, size, &data, &size));
+    }
+    
+    return write_output(internal, data, size, bytes_written);
+}
+
+/* Write the audio still held in the converter and encoder at the end of a track */
+static sacd_result_t flush_audio(sacd_extractor_internal_t *internal, size_t *bytes_written) {
+    if (!internal->pcm_converter) {
+        return SACD_RESULT_OK;
+    }
+    
+    const uint8_t *data;
+    size_t size;
+    SACD_CHECK_RESULT(sacd_internal_pcm_flush(internal->pcm_converter, &data, &size));
+    
+    if (internal->flac_encoder) {
+        if (size > 0) {
+            SACD_CHECK_RESULT(sacd_internal_flac_encode(internal->flac_encoder, data, size, &data, &size));
+            SACD_CHECK_RESULT(write_output(internal, data, size, bytes_written));
+        }
+        SACD_CHECK_RESULT(sacd_internal_flac_flush(internal->flac_encoder, &data, &size));
+    }
+    
+    return write_output(internal, data, size, bytes_written);
+}
+
+/* Write one frame of DSD, unless it is silence being trimmed; held silence goes first */
+static sacd_result_t write_dsd_frame(sacd_extractor_internal_t *internal, uint32_t frame,
+                                     const uint8_t *data, size_t size, size_t *bytes_written) {
+    sacd_silence_t *silence = &internal->silence;
+    bool write;
+    SACD_CHECK_RESULT(sacd_internal_silence_frame(silence, frame, data, size, &write));
+    if (!write) {
+        return SACD_RESULT_OK;
+    }
+    
+    for (int r = 0; r < silence->run_count; r++) {
+        const sacd_silence_run_t *run = &silence->runs[r];
+        for (uint32_t i = 0; i < run->count; i++) {
+            sacd_internal_level_frame(&internal->level_meter, run->frame + i,
+                                      silence->held + run->offset, run->size);
+            SACD_CHECK_RESULT(write_audio(internal, silence->held + run->offset, run->size, bytes_written));
+        }
+    }
+    sacd_internal_silence_release(silence);
+    
+    sacd_internal_level_frame(&internal->level_meter, frame, data, size);
+    return write_audio(internal, data, size, bytes_written);
+}
+
+/* Write one audio frame: DST verbatim as a DSTF chunk or decoded, DSD as it is */
+static sacd_result_t write_frame(sacd_extractor_internal_t *internal, const sacd_audio_frame_t *frame,
+                                 size_t *bytes_written) {
+    if (!frame->dst_encoded) {
+        return write_dsd_frame(internal, sacd_internal_time_to_frames(&frame->timecode),
+                               frame->data, frame->size, bytes_written);
+    }
+    
+    if (!internal->dst_passthrough) {
+        uint8_t *decoded = NULL;
+        size_t decoded_size = 0;
+        sacd_result_t result = sacd_internal_dst_decode_frame(&internal->dst_decoder, frame->data, frame->size,
+                                                              &decoded, &decoded_size);
+        if (result == SACD_RESULT_OK && decoded) {
+            result = write_dsd_frame(internal, sacd_internal_time_to_frames(&frame->timecode),
+                                     decoded, decoded_size, bytes_written);
         } else {
-            /* Write raw DSD data directly */
-            if (fwrite(audio_data, 1, audio_data_size, internal->current_output_file) != audio_data_size) {
-                free(sector_buffer);
-                fclose(internal->current_output_file);
-                internal->current_output_file = NULL;
-                return SACD_RESULT_IO_ERROR;
-            }
-            bytes_written += audio_data_size;
+            /* An undecodable frame is dropped, not fatal */
+            result = SACD_RESULT_OK;
         }
-        
-        sectors_processed++;
-        internal->bytes_written = bytes_written;
-        
-        /* Update progress */
-        int track_progress = (int)((sectors_processed * 100ULL) / track->length_lsn);
-        internal->current_track_progress = track_progress;
-        
-        /* Only call progress callback every 1% to reduce overhead */
-        static int last_reported_progress = -1;
-        if (internal->options.progress_callback && track_progress != last_reported_progress) {
-            last_reported_progress = track_progress;
-            int overall_progress = ((internal->current_track_index * 100) + track_progress) / 
-                                 internal->track_queue_count;
-            
-            char status[256];
-            snprintf(status, sizeof(status), "Extracting track %d/%d: %s (%d%%) - %zu MB",
-                    internal->current_track_index + 1, internal->track_queue_count,
-                    track->text.title ? track->text.title : "Unknown", track_progress,
-                    bytes_written / (1024 * 1024));
-            
-            internal->options.progress_callback(track->number + 1, internal->track_queue_count,
-                                              track_progress, overall_progress, status,
+        free(decoded);
+        return result;
+    }
+    
+    uint64_t start = sacd_internal_clock_ns();
+    sacd_result_t result = sacd_internal_write_dst_frame(internal->current_output, &internal->dst_index,
+                                                         frame->data, frame->size);
+    count_write(internal, start);
+    SACD_CHECK_RESULT(result);
+    sacd_internal_checksum_update(&internal->checksum, frame->data, frame->size);
+    *bytes_written += frame->size;
+    return SACD_RESULT_OK;
+}
+
+/* Open the sink a track is written to */
+static sacd_result_t open_track_sink(sacd_extractor_internal_t *internal, const char *filename,
+                                     sacd_sink_t **sink) {
+    switch (internal->options.sink_type) {
+        case SACD_SINK_FD:
+            return sacd_sink_open_fd(internal->options.sink_fd, sink);
+        case SACD_SINK_MEMORY:
+            return sacd_sink_open_memory(sink);
+        case SACD_SINK_NULL:
+            return sacd_sink_open_null(sink);
+        case SACD_SINK_FILE:
+        default:
+            return sacd_sink_open_file(filename, sink);
+    }
+}
+
+/* Close the current track's sink, handing a completed memory track to the caller first */
+static sacd_result_t close_track_sink(sacd_extractor_internal_t *internal, const sacd_track_t *track,
+                                      bool completed) {
+    sacd_sink_t *sink = internal->current_output;
+    internal->current_output = NULL;
+    if (!sink) {
+        return SACD_RESULT_OK;
+    }
+    internal->stats.bytes_written += sink->position - internal->output_base;
+    
+    if (completed && internal->options.sink_type == SACD_SINK_MEMORY &&
+        internal->options.track_data_callback) {
+        size_t size;
+        const uint8_t *data = sacd_sink_memory_data(sink, &size);
+        internal->options.track_data_callback(track->number + 1, track, data, size,
                                               internal->options.callback_userdata);
+    }
+    
+    return sacd_sink_close(sink);
+}
+
+/* Sample frames per channel the converter makes from a track's DSD payload */
+static uint64_t converted_pcm_frames(sacd_extractor_internal_t *internal, const sacd_track_t *track,
+                                     uint64_t dsd_size) {
+    /* One filtered sample per DSD byte, then halved (rounding up) per decimation stage */
+    uint64_t frames = dsd_size / track->channel_count;
+    for (uint32_t rate = SACD_SAMPLING_FREQ / 8; rate > internal->options.pcm_sample_rate; rate /= 2) {
+        frames = (frames + 1) / 2;
+    }
+    return frames;
+}
+
+/*
+ * Tracks are cut from the area's frame stream by frame timecode rather than
+ * by sector: a track's first and last frames usually share a sector with its
+ * neighbours. The pause before a track (the frames between the end of the
+ * previous track and its start, or from the start of the area for the first
+ * track) belongs to it when include_pauses is set, and to no track otherwise.
+ */
+
+/* A queued track's place in the area's frame stream */
+typedef struct {
+    int track_index;                  /* Index into area->tracks (where a range starts) */
+    const sacd_track_t *track;        /* What is written: the track or a range */
+    bool range;
+    uint32_t first_frame;             /* Timecodes of the frames written to the track */
+    uint32_t end_frame;
+    uint32_t read_start;              /* Sectors holding those frames */
+    uint32_t read_end;
+    bool done;                        /* Written, skipped or failed; later frames are dropped */
+} sweep_track_t;
+
+/* Output of the track being written */
+typedef struct {
+    const sacd_track_t *track;
+    char filename[1024];
+    uint32_t resume_lsn;              /* First sector still needed by a resumed track */
+    uint32_t resume_frame;            /* Frames before this one are already in the file */
+    uint32_t next_frame;              /* Frame after the last one written */
+    size_t bytes_written;
+    bool skipped;                     /* Completed by an earlier run */
+    bool journaled;                   /* Progress is kept in the journal (not for ranges) */
+    uint32_t since_checkpoint;
+    uint64_t start_ns;
+} track_output_t;
+
+/* One pass over a run of queued tracks */
+typedef struct {
+    sacd_extractor_internal_t *internal;
+    sweep_track_t *spans;
+    int span_count;
+    int queue_start;                  /* Queue position of spans[0] */
+    int open;                         /* Span being written, -1 = none */
+    uint32_t jump_lsn;                /* Next sector worth reading, set when a track begins */
+    track_output_t output;
+} sweep_t;
+
+/* Frames a queue entry covers: a track (with the pause before it if wanted) or a range */
+static void entry_frames(const sacd_extractor_internal_t *internal, int entry,
+                         uint32_t *first_frame, uint32_t *end_frame) {
+    const sacd_track_t *track = queue_track(internal, entry);
+    *first_frame = sacd_internal_time_to_frames(&track->start_time);
+    *end_frame = *first_frame + sacd_internal_time_to_frames(&track->duration);
+    
+    if (is_range(entry) || !internal->options.include_pauses) {
+        return;
+    }
+    /* Area time starts at zero, so the first track's pause is everything before it */
+    uint32_t pause_frame = 0;
+    if (entry > 0) {
+        const sacd_track_t *previous = &internal->area->tracks[entry - 1];
+        pause_frame = sacd_internal_time_to_frames(&previous->start_time) +
+                      sacd_internal_time_to_frames(&previous->duration);
+    }
+    if (pause_frame < *first_frame) {
+        *first_frame = pause_frame;
+    }
+}
+
+/* Place a queue entry in the frame stream and on the disc */
+static sacd_result_t plan_span(sacd_extractor_internal_t *internal, int entry, sweep_track_t *span) {
+    const sacd_area_t *area = internal->area;
+    const sacd_track_t *track = queue_track(internal, entry);
+    
+    memset(span, 0, sizeof(sweep_track_t));
+    span->track_index = track->number;
+    span->track = track;
+    span->range = is_range(entry);
+    entry_frames(internal, entry, &span->first_frame, &span->end_frame);
+    
+    if (span->range) {
+        /* Only the sectors holding the range's frames are read */
+        const sacd_frame_index_t *index;
+        SACD_CHECK_RESULT(sacd_internal_disc_frame_index(internal->disc_internal, area, &index));
+        if (sacd_internal_frame_index_lookup(index, span->first_frame, &span->read_start) != SACD_RESULT_OK) {
+            return SACD_RESULT_INVALID_TRACK;
+        }
+        /* The last frame ends in the sector the next one starts in */
+        if (sacd_internal_frame_index_lookup(index, span->end_frame, &span->read_end) == SACD_RESULT_OK) {
+            span->read_end++;
+        } else {
+            span->read_end = index->end_lsn;
+        }
+        sacd_track_t *range = &internal->ranges[entry - SACD_MAX_TRACKS];
+        range->start_lsn = span->read_start;
+        range->length_lsn = span->read_end - span->read_start;
+        return SACD_RESULT_OK;
+    }
+    
+    span->read_start = track->start_lsn;
+    span->read_end = track->start_lsn + track->length_lsn;
+    
+    /* The pause may begin in the previous track's last sector */
+    if (internal->options.include_pauses) {
+        uint32_t pause_lsn = area->start_lsn;
+        if (entry > 0) {
+            const sacd_track_t *previous = &area->tracks[entry - 1];
+            pause_lsn = previous->start_lsn + previous->length_lsn;
+            if (pause_lsn > 0) {
+                pause_lsn--;
+            }
+        }
+        if (pause_lsn < span->read_start) {
+            span->read_start = pause_lsn;
+        }
+    }
+    return SACD_RESULT_OK;
+}
+
+/* Open a track's output and write its header; a track finished by an earlier run is only reported */
+static sacd_result_t begin_track(sacd_extractor_internal_t *internal, const sweep_track_t *span,
+                                 track_output_t *out) {
+    const sacd_track_t *track = span->track;
+    sacd_result_t result;
+    
+    out->track = track;
+    out->journaled = internal->journal.path && !span->range;
+    out->resume_lsn = 0;
+    out->resume_frame = 0;
+    out->next_frame = span->first_frame;
+    out->bytes_written = 0;
+    out->skipped = false;
+    out->since_checkpoint = 0;
+    
+    /* Create output filename */
+    result = sacd_internal_create_filename(&internal->options, track,
+                                         internal->output_dir, out->filename, sizeof(out->filename));
+    if (result != SACD_RESULT_OK) {
+        return result;
+    }
+    const char *filename = out->filename;
+    
+    const sacd_journal_entry_t *entry = out->journaled ?
+                                        sacd_internal_journal_lookup(&internal->journal, track->number) : NULL;
+    if (entry && strcmp(entry->filename, filename) != 0) {
+        entry = NULL; /* Naming options changed since the journal was written */
+    }
+    
+    /* Completed by an earlier run: report it and move on */
+    struct stat st;
+    if (entry && entry->state == SACD_JOURNAL_DONE &&
+        stat(filename, &st) == 0 && (uint64_t)st.st_size >= entry->bytes_written) {
+        SACD_DEBUG_LOG("Track %d: already complete in journal, skipping", track->number);
+    
+        if (internal->options.track_start_callback) {
+            internal->options.track_start_callback(track->number + 1, track, filename,
+                                                 internal->options.callback_userdata);
+        }
+        internal->total_bytes_written += entry->bytes_written;
+        if (internal->options.track_complete_callback) {
+            /* Checksums for this track are in the manifest from the earlier run */
+            sacd_track_report_t report;
+            memset(&report, 0, sizeof(report));
+            internal->options.track_complete_callback(track->number + 1, track, filename,
+                                                    entry->bytes_written, &report,
+                                                    internal->options.callback_userdata);
+        }
+        out->skipped = true;
+        return SACD_RESULT_OK;
+    }
+    
+    /* Call track start callback */
+    if (internal->options.track_start_callback) {
+        internal->options.track_start_callback(track->number + 1, track, filename,
+                                             internal->options.callback_userdata);
+    }
+    
+    sacd_internal_checksum_init(&internal->checksum, internal->options.checksums);
+    
+    /* DSDIFF can carry DST frames as they are on disc */
+    internal->dst_passthrough = track->dst_encoded && !internal->options.convert_dst &&
+                                (internal->options.format == SACD_FORMAT_DSDIFF ||
+                                 internal->options.format == SACD_FORMAT_DSDIFF_EM);
+    
+    /*
+     * Continue a partial file from its last durable checkpoint. Checkpoints fall
+     * at frame starts and record the next frame to write, and DST frames decode
+     * on their own, so decoded DST resumes like plain DSD. Converted PCM, the
+     * DSTI index of DST passed through and
+     * held back silence depend on state that is not journaled, so those tracks
+     * restart.
+     */
+    if (entry && entry->state == SACD_JOURNAL_PARTIAL && !internal->pcm_converter &&
+        !internal->dst_passthrough && !internal->options.trim_silence &&
+        entry->next_lsn >= span->read_start && entry->next_lsn <= span->read_end &&
+        entry->next_frame >= span->first_frame && entry->next_frame <= span->end_frame) {
+        FILE *file = reopen_partial_file(filename, entry, internal->options.format);
+        if (file && rehash_partial_payload(internal, file, entry) != SACD_RESULT_OK) {
+            /* Unreadable partial payload: start the track over */
+            fclose(file);
+            file = NULL;
+            sacd_internal_checksum_init(&internal->checksum, internal->options.checksums);
+        }
+        if (file && sacd_internal_sink_from_file(file, entry->file_offset,
+                                                 &internal->current_output) != SACD_RESULT_OK) {
+            fclose(file);
+        }
+        if (internal->current_output) {
+            internal->output_base = internal->current_output->position;
+            internal->throttle_mark = internal->output_base;
+            out->resume_lsn = entry->next_lsn;
+            out->resume_frame = entry->next_frame;
+            out->next_frame = entry->next_frame;
+            out->bytes_written = entry->bytes_written;
+            SACD_DEBUG_LOG("Track %d: resuming at LSN %u (%zu bytes already written)",
+                           track->number, out->resume_lsn, out->bytes_written);
         }
     }
     
-    free(sector_buffer);
+    if (!internal->current_output) {
+        uint64_t start = sacd_internal_clock_ns();
+        result = open_track_sink(internal, filename, &internal->current_output);
+        if (result != SACD_RESULT_OK) {
+            return result;
+        }
+        sacd_sink_t *sink = internal->current_output;
+        internal->output_base = sink->position;
+        internal->throttle_mark = sink->position;
+    
+        /*
+         * Headers of a sink that can't seek are never patched, so they are
+         * written with the exact sizes up front. DST frame sizes aren't known
+         * ahead, so such tracks are decoded instead of passed through.
+         */
+        bool exact = !sink->pwrite;
+        uint64_t dsd_size = (uint64_t)(span->end_frame - span->first_frame) * track->channel_count *
+                            (SACD_SAMPLING_FREQ / SACD_FRAME_RATE / 8);
+        if (exact) {
+            internal->dst_passthrough = false;
+        }
+    
+        /* Estimate audio data size */
+        size_t estimated_audio_size = exact ? (size_t)dsd_size :
+                                      sacd_estimate_track_file_size(track, internal->options.format);
+    
+        /* Write format-specific header */
+        if (internal->flac_encoder) {
+            sacd_internal_pcm_converter_reset(internal->pcm_converter);
+            uint64_t estimated_samples = exact ? converted_pcm_frames(internal, track, dsd_size) :
+                                         sacd_estimate_pcm_data_size(track, internal->options.pcm_sample_rate,
+                                                                     SACD_PCM_S24) / (track->channel_count * 3);
+            result = sacd_internal_flac_write_header(internal->flac_encoder, sink, estimated_samples);
+        } else if (internal->pcm_converter) {
+            int sample_bytes = (internal->options.pcm_sample_format == SACD_PCM_F32) ? 4 : 3;
+            uint64_t pcm_size = exact ? converted_pcm_frames(internal, track, dsd_size) *
+                                        track->channel_count * sample_bytes :
+                                sacd_estimate_pcm_data_size(track, internal->options.pcm_sample_rate,
+                                                            internal->options.pcm_sample_format);
+            sacd_internal_pcm_converter_reset(internal->pcm_converter);
+            result = sacd_internal_write_pcm_header(sink, internal->options.format, track,
+                                                    internal->options.pcm_sample_rate,
+                                                    internal->options.pcm_sample_format, pcm_size);
+        } else if (internal->dst_passthrough) {
+            result = sacd_internal_write_dsdiff_dst_header(sink, track, internal->area, &internal->dst_index);
+        } else if (internal->options.format == SACD_FORMAT_DSF) {
+            result = sacd_internal_write_dsf_header(sink, track, internal->area, estimated_audio_size);
+        } else {
+            result = sacd_internal_write_dsdiff_header(sink, track, internal->area, estimated_audio_size);
+        }
+        count_write(internal, start);
+    
+        if (result != SACD_RESULT_OK) {
+            close_track_sink(internal, track, false);
+            return result;
+        }
+    }
+    
+    /*
+     * DST passed through is never decoded, so its levels and silence aren't
+     * known. A header written with exact sizes can't be trimmed to.
+     */
+    bool measure = internal->options.measure_levels && !internal->dst_passthrough;
+    sacd_internal_level_init(&internal->level_meter, measure ? track->channel_count : 0,
+                             span->first_frame, span->end_frame - span->first_frame);
+    sacd_internal_silence_reset(&internal->silence, !internal->dst_passthrough,
+                                internal->options.trim_silence && internal->current_output->pwrite);
+    
+    internal->bytes_written = out->bytes_written;
+    SACD_DEBUG_LOG("Track %d: frames %u to %u, LSN %u to %u",
+                   track->number, span->first_frame, span->end_frame - 1,
+                   span->read_start, span->read_end - 1);
+    return SACD_RESULT_OK;
+}
+
+/* Give up on the track being written */
+static void abandon_track(sacd_extractor_internal_t *internal, track_output_t *out) {
+    close_track_sink(internal, out->track, false);
+    sacd_internal_dst_index_free(&internal->dst_index);
+}
+
+/*
+ * Finish the track being written. 'finished' is false when the extraction
+ * was cancelled: the partial file is then kept resumable from 'next_lsn'
+ * instead of being finalized.
+ */
+static sacd_result_t end_track(sacd_extractor_internal_t *internal, track_output_t *out,
+                               uint32_t next_lsn, bool finished) {
+    const sacd_track_t *track = out->track;
+    const char *filename = out->filename;
+    sacd_extractor_stats_t *stats = &internal->stats;
+    sacd_result_t result;
+    
+    if (!finished) {
+        result = out->journaled ? checkpoint_track(internal, track, filename, next_lsn, out->next_frame,
+                                                   out->bytes_written) :
+                                  SACD_RESULT_OK;
+        abandon_track(internal, out);
+        return (result == SACD_RESULT_OK) ? SACD_RESULT_CANCELLED : result;
+    }
+    
+    sacd_internal_silence_finish(&internal->silence);
+    
+    uint64_t decode_start = sacd_internal_clock_ns();
+    uint64_t write_ns = stats->write_ns;
+    result = internal->dst_passthrough ? SACD_RESULT_OK : flush_audio(internal, &out->bytes_written);
+    stats->decode_ns += (sacd_internal_clock_ns() - decode_start) - (stats->write_ns - write_ns);
+    if (result != SACD_RESULT_OK) {
+        abandon_track(internal, out);
+        return result;
+    }
+    size_t bytes_written = out->bytes_written;
+    internal->bytes_written = bytes_written;
     
-    SACD_DEBUG_LOG("Track %d: Extracted %zu bytes from %d sectors", 
-                   track->number, bytes_written, sectors_processed);
+    SACD_DEBUG_LOG("Track %d: Extracted %zu bytes", track->number, bytes_written);
     
     /* Finalize file headers */
-    result = sacd_internal_finalize_file_headers(internal->current_output_file,
-                                               internal->options.format, bytes_written);
+    uint64_t finalize_start = sacd_internal_clock_ns();
+    if (internal->flac_encoder) {
+        result = sacd_internal_flac_finalize(internal->flac_encoder, internal->current_output);
+    } else if (internal->dst_passthrough) {
+        result = sacd_internal_finalize_dsdiff_dst(internal->current_output, &internal->dst_index);
+        sacd_internal_dst_index_free(&internal->dst_index);
+    } else if (internal->pcm_converter) {
+        int sample_bytes = (internal->options.pcm_sample_format == SACD_PCM_F32) ? 4 : 3;
+        result = sacd_internal_finalize_pcm_header(internal->current_output,
+                                                   internal->options.format, bytes_written,
+                                                   track->channel_count * sample_bytes);
+    } else {
+        result = sacd_internal_finalize_file_headers(internal->current_output,
+                                                   internal->options.format, bytes_written,
+                                                   track->channel_count);
+    }
+    
+    /* The journal may only call the track done once the file is durable */
+    if (result == SACD_RESULT_OK && out->journaled) {
+        result = internal->current_output->flush(internal->current_output, true);
+    }
+    
+    /* Close output */
+    sacd_result_t close_result = close_track_sink(internal, track, result == SACD_RESULT_OK);
+    if (result == SACD_RESULT_OK) {
+        result = close_result;
+    }
+    count_write(internal, finalize_start);
     
-    /* Close output file */
-    fclose(internal->current_output_file);
-    internal->current_output_file = NULL;
+    if (result == SACD_RESULT_OK && out->journaled) {
+        result = sacd_internal_journal_complete(&internal->journal, track->number, filename, bytes_written);
+    }
     
     if (result == SACD_RESULT_OK) {
         internal->total_bytes_written += bytes_written;
-        
+    
+        sacd_track_report_t report;
+        memset(&report, 0, sizeof(report));
+        sacd_internal_checksum_final(&internal->checksum, &report);
+        report.levels = internal->level_meter.report;
+        report.silence = internal->silence.report;
+    
+        if (append_checksum_manifest(internal, filename, &report) != SACD_RESULT_OK) {
+            SACD_DEBUG_LOG("Track %d: failed to update checksum manifest", track->number);
+        }
+    
         /* Call track complete callback */
         if (internal->options.track_complete_callback) {
             internal->options.track_complete_callback(track->number + 1, track, filename,
-                                                    bytes_written, internal->options.callback_userdata);
+                                                    bytes_written, &report,
+                                                    internal->options.callback_userdata);
         }
     }
     
     return result;
 }
 
+/* Account for a track that was written, skipped, failed or interrupted */
+static void record_track(sacd_extractor_internal_t *internal, int track_index, sacd_result_t result,
+                         uint64_t start_ns) {
+    internal->stats.track_wall_ns[track_index] += sacd_internal_clock_ns() - start_ns;
+    if (result != SACD_RESULT_CANCELLED) {
+        internal->stats.tracks_pending--;
+    }
+    if (result == SACD_RESULT_OK) {
+        internal->stats.tracks_completed++;
+    }
+    publish_stats(internal);
+    publish_progress(internal, true);
+    
+    if (result != SACD_RESULT_OK) {
+        SACD_DEBUG_LOG("Track %d extraction failed: %s", track_index, sacd_result_string(result));
+        if (internal->result == SACD_RESULT_OK) {
+            internal->result = result;
+        }
+    }
+}
+
+/* Stop writing the open span, finishing its track or (on an error or cancellation) not */
+static void close_span(sacd_extractor_internal_t *internal, sweep_t *sweep, sacd_result_t result,
+                       uint32_t next_lsn) {
+    if (sweep->open < 0) {
+        return;
+    }
+    
+    sweep_track_t *span = &sweep->spans[sweep->open];
+    if (result == SACD_RESULT_OK || result == SACD_RESULT_CANCELLED) {
+        result = end_track(internal, &sweep->output, next_lsn, result == SACD_RESULT_OK);
+    } else {
+        abandon_track(internal, &sweep->output);
+    }
+    record_track(internal, span->track_index, result, sweep->output.start_ns);
+    span->done = true;
+    sweep->open = -1;
+}
+
+/* Start writing a span's track */
+static void open_span(sacd_extractor_internal_t *internal, sweep_t *sweep, int index) {
+    sweep_track_t *span = &sweep->spans[index];
+    track_output_t *out = &sweep->output;
+    
+    internal->current_track_index = sweep->queue_start + index;
+    internal->current_track_progress = 0;
+    internal->bytes_written = 0;
+    publish_progress(internal, true);
+    
+    out->start_ns = sacd_internal_clock_ns();
+    sacd_result_t result = begin_track(internal, span, out);
+    if (result != SACD_RESULT_OK || out->skipped) {
+        /* Nothing to write; don't read the rest of the track */
+        record_track(internal, span->track_index, result, out->start_ns);
+        span->done = true;
+        sweep->jump_lsn = span->read_end - 1;
+        return;
+    }
+    
+    sweep->open = index;
+    sweep->jump_lsn = out->resume_lsn;
+}
+
+/* The span a frame belongs to, -1 if none still wants it */
+static int find_span(const sweep_t *sweep, uint32_t frame) {
+    if (sweep->open >= 0) {
+        const sweep_track_t *span = &sweep->spans[sweep->open];
+        if (frame >= span->first_frame && frame < span->end_frame) {
+            return sweep->open;
+        }
+    }
+    for (int i = 0; i < sweep->span_count; i++) {
+        const sweep_track_t *span = &sweep->spans[i];
+        if (!span->done && frame >= span->first_frame && frame < span->end_frame) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+/* Write a demultiplexed frame to the track it belongs to */
+static sacd_result_t route_frame(const sacd_audio_frame_t *frame, void *userdata) {
+    sweep_t *sweep = (sweep_t*)userdata;
+    sacd_extractor_internal_t *internal = sweep->internal;
+    uint32_t frame_number = sacd_internal_time_to_frames(&frame->timecode);
+    
+    int span = find_span(sweep, frame_number);
+    if (span != sweep->open) {
+        close_span(internal, sweep, SACD_RESULT_OK, frame->start_lsn);
+        if (span >= 0) {
+            open_span(internal, sweep, span);
+        }
+    }
+    
+    /* Frames of no wanted track, or already in a resumed file */
+    if (sweep->open < 0 || frame_number < sweep->output.resume_frame) {
+        return SACD_RESULT_OK;
+    }
+    
+    sacd_result_t result = write_frame(internal, frame, &sweep->output.bytes_written);
+    if (result != SACD_RESULT_OK) {
+        close_span(internal, sweep, result, frame->start_lsn);
+    } else {
+        sweep->output.next_frame = frame_number + 1;
+    }
+    return SACD_RESULT_OK;
+}
+
+/* Feed one sector to the demultiplexer; its completed frames go to their tracks */
+static void sweep_sector(sacd_extractor_internal_t *internal, sweep_t *sweep, uint32_t lsn,
+                         const uint8_t *sector_data) {
+    if (sacd_internal_demux_sector(&internal->demux, lsn, sector_data, route_frame, sweep) != SACD_RESULT_OK) {
+        SACD_DEBUG_LOG("Sector %u: malformed audio sector, skipped", lsn);
+    }
+}
+
+/* First sector a track resumed from here would need: the start of the frame being assembled */
+static uint32_t resume_point(const sacd_extractor_internal_t *internal, uint32_t next_lsn) {
+    return internal->demux.open ? internal->demux.frame.start_lsn : next_lsn;
+}
+
+/* After a sector: pacing, statistics, checkpoints and progress */
+static void account_sector(sacd_extractor_internal_t *internal, sweep_t *sweep, uint32_t lsn,
+                           uint32_t *since_publish, uint64_t *now) {
+    throttle_io(internal, now);
+    
+    bool publish = (++*since_publish >= SACD_STATS_PUBLISH_SECTORS);
+    if (publish) {
+        *since_publish = 0;
+        publish_stats(internal);
+    }
+    
+    if (sweep->open < 0) {
+        return;
+    }
+    track_output_t *out = &sweep->output;
+    internal->bytes_written = out->bytes_written;
+    
+    /* Periodically make progress durable so a crash loses little work */
+    if (out->journaled && ++out->since_checkpoint >= internal->options.checkpoint_sectors) {
+        out->since_checkpoint = 0;
+        sacd_result_t result = checkpoint_track(internal, out->track, out->filename,
+                                                resume_point(internal, lsn + 1), out->next_frame,
+                                                out->bytes_written);
+        if (result != SACD_RESULT_OK) {
+            close_span(internal, sweep, result, lsn + 1);
+            return;
+        }
+    }
+    
+    /* Update progress every 1%, and with the statistics for the byte count */
+    const sacd_track_t *track = out->track;
+    int track_progress = 0;
+    if (lsn >= track->start_lsn && track->length_lsn > 0) {
+        track_progress = (int)(((lsn - track->start_lsn + 1) * 100ULL) / track->length_lsn);
+        if (track_progress > 100) {
+            track_progress = 100;
+        }
+    }
+    if (track_progress != internal->current_track_progress || publish) {
+        internal->current_track_progress = track_progress;
+        publish_progress(internal, true);
+    }
+}
+
+/*
+ * Extract queued tracks [queue_start, queue_start + count) in one pass over
+ * the disc. The tracks' sectors are read in order in large reads, merging
+ * ranges separated by less than a read so that nearby tracks cost no seek,
+ * and each frame is written to the track it belongs to.
+ */
+static void sweep_tracks(sacd_extractor_internal_t *internal, int queue_start, int count) {
+    sweep_t sweep;
+    memset(&sweep, 0, sizeof(sweep));
+    sweep.spans = calloc((size_t)count, sizeof(sweep_track_t));
+    sweep.span_count = count;
+    sweep.queue_start = queue_start;
+    sweep.open = -1;
+    sweep.internal = internal;
+    uint8_t *buffer = malloc((size_t)SACD_SWEEP_READ_SECTORS * SACD_LSN_SIZE);
+    if (!sweep.spans || !buffer) {
+        for (int i = 0; i < count; i++) {
+            record_track(internal, queue_track(internal, internal->track_queue[queue_start + i])->number,
+                         SACD_RESULT_OUT_OF_MEMORY, sacd_internal_clock_ns());
+        }
+        free(sweep.spans);
+        free(buffer);
+        return;
+    }
+    for (int i = 0; i < count; i++) {
+        sacd_result_t result = plan_span(internal, internal->track_queue[queue_start + i], &sweep.spans[i]);
+        if (result != SACD_RESULT_OK) {
+            SACD_DEBUG_LOG("Queue entry %d: no sectors for its frames", queue_start + i);
+            internal->current_track_index = queue_start + i;
+            record_track(internal, sweep.spans[i].track_index, result, sacd_internal_clock_ns());
+            sweep.spans[i].done = true;
+        }
+    }
+    
+    sacd_extractor_stats_t *stats = &internal->stats;
+    uint32_t since_publish = 0;
+    uint64_t now = sacd_internal_clock_ns();
+    
+    int next = 0;
+    while (next < count && !internal->cancel_requested) {
+        if (sweep.spans[next].done) {
+            next++;
+            continue;
+        }
+    
+        /* Read through to the next track unless a seek is cheaper */
+        uint32_t range_start = sweep.spans[next].read_start;
+        uint32_t range_end = sweep.spans[next].read_end;
+        for (next++; next < count; next++) {
+            const sweep_track_t *span = &sweep.spans[next];
+            if (span->done) {
+                continue;
+            }
+            if (span->read_start < range_start || span->read_start > range_end + SACD_SWEEP_READ_SECTORS) {
+                break;
+            }
+            if (span->read_end > range_end) {
+                range_end = span->read_end;
+            }
+        }
+    
+        uint32_t buffered_lsn = 0;
+        uint32_t buffered = 0;
+        uint32_t lsn;
+        sacd_internal_demux_reset(&internal->demux);
+        for (lsn = range_start; lsn < range_end && !internal->cancel_requested; lsn++) {
+            if (lsn < buffered_lsn || lsn >= buffered_lsn + buffered) {
+                buffered_lsn = lsn;
+                buffered = range_end - lsn;
+                if (buffered > SACD_SWEEP_READ_SECTORS) {
+                    buffered = SACD_SWEEP_READ_SECTORS;
+                }
+    
+                uint64_t read_start = now;
+                sacd_result_t result = sacd_internal_read_sectors(internal->disc_internal, lsn, buffered, buffer);
+                if (result != SACD_RESULT_OK && buffered > 1) {
+                    /* Find the bad sector, keep the good ones */
+                    buffered = 1;
+                    result = sacd_internal_read_sectors(internal->disc_internal, lsn, 1, buffer);
+                }
+                now = sacd_internal_clock_ns();
+                stats->read_ns += now - read_start;
+                if (now - read_start > SACD_STATS_STALL_NS) {
+                    stats->read_stalls++;
+                }
+                if (result != SACD_RESULT_OK) {
+                    SACD_DEBUG_LOG("Failed to read sector %u: %s", lsn, sacd_result_string(result));
+                    buffered = 0;
+                    sacd_internal_demux_reset(&internal->demux);
+                    close_span(internal, &sweep, result, lsn);
+                    continue;
+                }
+            }
+            stats->sectors_read++;
+            stats->bytes_read += SACD_LSN_SIZE;
+    
+            /* Everything but the output writes counts as decoding */
+            uint64_t decode_start = now;
+            uint64_t write_ns = stats->write_ns;
+            sweep.jump_lsn = 0;
+            sweep_sector(internal, &sweep, lsn, buffer + (size_t)(lsn - buffered_lsn) * SACD_LSN_SIZE);
+            now = sacd_internal_clock_ns();
+            stats->decode_ns += (now - decode_start) - (stats->write_ns - write_ns);
+    
+            account_sector(internal, &sweep, lsn, &since_publish, &now);
+    
+            /* Skip what a resumed or already complete track doesn't need */
+            if (sweep.jump_lsn > lsn + 1) {
+                lsn = (sweep.jump_lsn < range_end ? sweep.jump_lsn : range_end) - 1;
+                sacd_internal_demux_reset(&internal->demux);
+            }
+        }
+    
+        /* The open track's frames all lie within the range; if cancelled, it resumes at 'lsn' */
+        if (internal->cancel_requested) {
+            close_span(internal, &sweep, SACD_RESULT_CANCELLED, resume_point(internal, lsn));
+        } else {
+            sacd_internal_demux_flush(&internal->demux, route_frame, &sweep);
+            close_span(internal, &sweep, SACD_RESULT_OK, lsn);
+        }
+    }
+    
+    /* A track whose frames never turned up */
+    for (int i = 0; i < count && !internal->cancel_requested; i++) {
+        if (!sweep.spans[i].done) {
+            SACD_DEBUG_LOG("Track %d: no audio frames found", sweep.spans[i].track_index);
+            internal->current_track_index = queue_start + i;
+            record_track(internal, sweep.spans[i].track_index, SACD_RESULT_INVALID_TRACK,
+                         sacd_internal_clock_ns());
+        }
+    }
+    
+    free(buffer);
+    free(sweep.spans);
+}
+
+/* Whether the journal records every queued track as done (ranges aren't journaled) */
+static bool journal_all_done(const sacd_extractor_internal_t *internal) {
+    for (int i = 0; i < internal->track_queue_count; i++) {
+        int entry = internal->track_queue[i];
+        if (is_range(entry)) {
+            continue;
+        }
+        const sacd_journal_entry_t *recorded =
+            sacd_internal_journal_lookup(&internal->journal, queue_track(internal, entry)->number);
+        if (!recorded || recorded->state != SACD_JOURNAL_DONE) {
+            return false;
+        }
+    }
+    return true;
+}
+
 /* Extraction thread function */
 static void *extraction_thread(void *arg) {
     sacd_extractor_internal_t *internal = (sacd_extractor_internal_t*)arg;
     
+    /* Move to the chosen CPUs before allocating, so buffers are first-touched there */
+    place_threads(internal);
+    const sacd_cpuset_t *worker_cpus = internal->pin_workers ? &internal->worker_cpus : NULL;
+    
+    /* Background extractions give way to other users of the disks */
+    pthread_mutex_lock(&internal->state_mutex);
+    internal->io_tid = sacd_internal_thread_id();
+    sacd_internal_set_io_priority(internal->io_tid, internal->options.io_priority,
+                                  internal->options.io_priority_level);
+    pthread_mutex_unlock(&internal->state_mutex);
+    
     /* Record start time */
     struct timeval tv;
     gettimeofday(&tv, NULL);
     internal->extraction_start_time = tv.tv_sec + tv.tv_usec / 1000000.0;
     
-    /* Extract each track in the queue */
-    for (int i = 0; i < internal->track_queue_count && !internal->cancel_requested; i++) {
-        internal->current_track_index = i;
-        int track_num = internal->track_queue[i];
-        
-        sacd_result_t result = extract_track(internal, track_num);
-        if (result != SACD_RESULT_OK) {
-            /* TODO: Handle extraction errors */
-            SACD_DEBUG_LOG("Track %d extraction failed: %s", track_num, sacd_result_string(result));
+    /* Open the resume journal; extraction still runs if it can't be written */
+    if (internal->options.checkpoint_sectors > 0 && internal->options.sink_type == SACD_SINK_FILE) {
+        sacd_result_t journal_result = sacd_internal_journal_open(&internal->journal, internal->output_dir,
+                                                                  internal->area,
+                                                                  sacd_internal_disc_area_id(internal->disc_internal,
+                                                                                             internal->area),
+                                                                  internal->options.format,
+                                                                  internal->options.resume);
+        if (journal_result != SACD_RESULT_OK) {
+            SACD_DEBUG_LOG("Journal disabled: %s", sacd_result_string(journal_result));
+            sacd_internal_journal_close(&internal->journal);
         }
     }
     
-    /* Update final status */
+    open_checksum_manifest(internal);
+    
+    /* The callback runs on its own thread so a slow UI never stalls extraction */
+    internal->notifier_stop = false;
+    internal->notifier_running = internal->options.progress_callback &&
+                                 pthread_create(&internal->notifier_thread, NULL, notifier_thread, internal) == 0;
+    
+    /* PCM output runs the DSD stream through the converter (and encoder) */
+    if (internal->options.format == SACD_FORMAT_WAV || internal->options.format == SACD_FORMAT_W64 ||
+        internal->options.format == SACD_FORMAT_FLAC) {
+        bool flac = (internal->options.format == SACD_FORMAT_FLAC);
+        sacd_result_t pcm_result = sacd_internal_pcm_converter_create(&internal->pcm_converter,
+                                                                      internal->area->channel_count,
+                                                                      internal->options.pcm_sample_rate,
+                                                                      flac ? SACD_PCM_S24 :
+                                                                      internal->options.pcm_sample_format,
+                                                                      worker_cpus);
+        if (pcm_result == SACD_RESULT_OK && flac) {
+            pcm_result = sacd_internal_flac_encoder_create(&internal->flac_encoder,
+                                                           internal->area->channel_count,
+                                                           internal->options.pcm_sample_rate,
+                                                           internal->options.encoder_threads,
+                                                           worker_cpus);
+        }
+        if (pcm_result != SACD_RESULT_OK) {
+            internal->result = pcm_result;
+        }
+    }
+    
+    /* Extract the queued tracks: all in one pass over the disc, or each on its own */
+    bool ready = (internal->result == SACD_RESULT_OK);
+    if (ready && internal->options.area_sweep) {
+        /* A pass writes each frame once, so entries sharing frames (a range of a queued track) take another */
+        int start = 0;
+        while (start < internal->track_queue_count && !internal->cancel_requested) {
+            uint32_t first, end, next_first, next_end;
+            entry_frames(internal, internal->track_queue[start], &first, &end);
+            int next = start + 1;
+            for (; next < internal->track_queue_count; next++) {
+                entry_frames(internal, internal->track_queue[next], &next_first, &next_end);
+                if (next_first < end) {
+                    break;
+                }
+                end = next_end;
+            }
+            sweep_tracks(internal, start, next - start);
+            start = next;
+        }
+    } else {
+        for (int i = 0; ready && i < internal->track_queue_count && !internal->cancel_requested; i++) {
+            sweep_tracks(internal, i, 1);
+        }
+    }
+    
+    if (internal->cancel_requested) {
+        internal->result = SACD_RESULT_CANCELLED;
+    }
+    
+    /* Every track is in its file: don't leave the journal behind */
+    if (internal->result == SACD_RESULT_OK && journal_all_done(internal)) {
+        sacd_internal_journal_remove(&internal->journal);
+    }
+    sacd_internal_journal_close(&internal->journal);
+    
+    publish_stats(internal);
+    sacd_internal_flac_encoder_destroy(internal->flac_encoder);
+    internal->flac_encoder = NULL;
+    sacd_internal_pcm_converter_destroy(internal->pcm_converter);
+    internal->pcm_converter = NULL;
+    
+    /* Update final status; the snapshot goes first so !is_running implies it */
+    __atomic_store_n(&internal->finish_ns, sacd_internal_clock_ns(), __ATOMIC_RELEASE);
+    publish_progress(internal, false);
     pthread_mutex_lock(&internal->state_mutex);
-    internal->is_running = false;
+    __atomic_store_n(&internal->is_running, false, __ATOMIC_RELEASE);
+    internal->io_tid = 0;
     pthread_mutex_unlock(&internal->state_mutex);
     
+    if (internal->notifier_running) {
+        __atomic_store_n(&internal->notifier_stop, true, __ATOMIC_RELEASE);
+        pthread_join(internal->notifier_thread, NULL);
+        internal->notifier_running = false;
+    }
+    
     /* Final progress callback */
     if (internal->options.progress_callback) {
         const char *status = internal->cancel_requested ? 
@@ -411,9 +1602,42 @@ static void *extraction_thread(void *arg) {
                                           internal->options.callback_userdata);
     }
     
+    /* Notify the owner (e.g. batch scheduler) last, after all callbacks */
+    if (internal->finish_hook) {
+        internal->finish_hook(internal->finish_hook_data, internal->result);
+    }
+    
     return NULL;
 }
 
+/* Order the track queue by position in the area and drop repeated tracks */
+static void sort_track_queue(sacd_extractor_internal_t *internal) {
+    int *queue = internal->track_queue;
+    int count = 0;
+    
+    for (int i = 0; i < internal->track_queue_count; i++) {
+        int track = queue[i];
+        uint32_t first, end, other_first, other_end;
+        entry_frames(internal, track, &first, &end);
+        int j = count;
+        while (j > 0) {
+            entry_frames(internal, queue[j - 1], &other_first, &other_end);
+            if (other_first < first || (other_first == first && other_end <= end)) {
+                break;
+            }
+            j--;
+        }
+        if (j > 0 && queue[j - 1] == track) {
+            continue;
+        }
+        memmove(queue + j + 1, queue + j, (size_t)(count - j) * sizeof(int));
+        queue[j] = track;
+        count++;
+    }
+    
+    internal->track_queue_count = count;
+}
+
 /* Start extraction */
 sacd_result_t sacd_extractor_start(sacd_extractor_t *extractor) {
     if (!extractor) {
@@ -439,20 +1663,47 @@ sacd_result_t sacd_extractor_start(sacd_extractor_t *extractor) {
         return SACD_RESULT_ERROR;
     }
     
+    /* A sweep visits the tracks in disc order, each once */
+    if (internal->options.area_sweep) {
+        sort_track_queue(internal);
+    }
+    
     /* Reset state */
     internal->cancel_requested = false;
     internal->current_track_index = 0;
     internal->current_track_progress = 0;
     internal->total_bytes_written = 0;
+    internal->result = SACD_RESULT_OK;
+    
+    internal->bytes_written = 0;
+    
+    memset(&internal->stats, 0, sizeof(internal->stats));
+    internal->stats.tracks_queued = internal->track_queue_count;
+    internal->stats.tracks_pending = internal->track_queue_count;
+    sacd_internal_seqlock_write_begin(&internal->stats_lock);
+    internal->published_stats = internal->stats;
+    __atomic_store_n(&internal->start_ns, sacd_internal_clock_ns(), __ATOMIC_RELAXED);
+    __atomic_store_n(&internal->finish_ns, 0, __ATOMIC_RELAXED);
+    sacd_internal_seqlock_write_end(&internal->stats_lock);
+    publish_progress(internal, true);
+    
+    /* Reap a previous run that finished without being waited on */
+    if (internal->thread_joinable) {
+        pthread_join(internal->extraction_thread, NULL);
+        internal->thread_joinable = false;
+    }
     
     /* Start extraction thread */
-    internal->is_running = true;
+    __atomic_store_n(&internal->is_running, true, __ATOMIC_RELEASE);
     int result = pthread_create(&internal->extraction_thread, NULL, extraction_thread, internal);
     if (result != 0) {
-        internal->is_running = false;
+        internal->result = SACD_RESULT_ERROR;
+        publish_progress(internal, false);
+        __atomic_store_n(&internal->is_running, false, __ATOMIC_RELEASE);
         pthread_mutex_unlock(&internal->state_mutex);
         return SACD_RESULT_ERROR;
     }
+    internal->thread_joinable = true;
     
     pthread_mutex_unlock(&internal->state_mutex);
     return SACD_RESULT_OK;
@@ -485,13 +1736,86 @@ bool sacd_extractor_is_running(const sacd_extractor_t *extractor) {
         return false;
     }
     
-    /* Cast away const for mutex operations - this is safe because we're only reading state */
-    pthread_mutex_t *mutex = &((sacd_extractor_internal_t*)internal)->state_mutex;
-    pthread_mutex_lock(mutex);
-    bool running = internal->is_running;
-    pthread_mutex_unlock(mutex);
+    return __atomic_load_n(&internal->is_running, __ATOMIC_ACQUIRE);
+}
+
+/* Get extraction statistics */
+sacd_result_t sacd_extractor_get_stats(const sacd_extractor_t *extractor, sacd_extractor_stats_t *stats) {
+    if (!extractor || !stats) {
+        return SACD_RESULT_ERROR;
+    }
+    
+    sacd_extractor_internal_t *internal = (sacd_extractor_internal_t*)extractor->internal_data;
+    if (!internal) {
+        return SACD_RESULT_ERROR;
+    }
+    
+    sacd_internal_seqlock_read(&internal->stats_lock, stats, &internal->published_stats, sizeof(*stats));
+    uint64_t start = __atomic_load_n(&internal->start_ns, __ATOMIC_ACQUIRE);
+    uint64_t finish = __atomic_load_n(&internal->finish_ns, __ATOMIC_ACQUIRE);
+    if (start) {
+        stats->elapsed_ns = (finish ? finish : sacd_internal_clock_ns()) - start;
+    }
+    
+    return SACD_RESULT_OK;
+}
+
+/* Change the bandwidth limits */
+sacd_result_t sacd_extractor_set_bandwidth(sacd_extractor_t *extractor,
+                                           uint64_t read_bytes_per_sec,
+                                           uint64_t write_bytes_per_sec) {
+    if (!extractor) {
+        return SACD_RESULT_ERROR;
+    }
+    
+    sacd_extractor_internal_t *internal = (sacd_extractor_internal_t*)extractor->internal_data;
+    if (!internal) {
+        return SACD_RESULT_ERROR;
+    }
+    
+    sacd_internal_throttle_set_rate(&internal->read_throttle, read_bytes_per_sec);
+    sacd_internal_throttle_set_rate(&internal->write_throttle, write_bytes_per_sec);
+    return SACD_RESULT_OK;
+}
+
+/* Change the I/O scheduling class */
+sacd_result_t sacd_extractor_set_io_priority(sacd_extractor_t *extractor,
+                                             sacd_io_priority_t priority, int level) {
+    if (!extractor) {
+        return SACD_RESULT_ERROR;
+    }
+    
+    sacd_extractor_internal_t *internal = (sacd_extractor_internal_t*)extractor->internal_data;
+    if (!internal) {
+        return SACD_RESULT_ERROR;
+    }
+    
+    /* The thread id is only valid while the extraction thread runs */
+    pthread_mutex_lock(&internal->state_mutex);
+    internal->options.io_priority = priority;
+    internal->options.io_priority_level = level;
+    sacd_result_t result = SACD_RESULT_OK;
+    if (internal->io_tid) {
+        result = sacd_internal_set_io_priority(internal->io_tid, priority, level);
+    }
+    pthread_mutex_unlock(&internal->state_mutex);
     
-    return running;
+    return result;
+}
+
+/* Get extraction progress */
+sacd_result_t sacd_extractor_get_progress(const sacd_extractor_t *extractor, sacd_progress_t *progress) {
+    if (!extractor || !progress) {
+        return SACD_RESULT_ERROR;
+    }
+    
+    sacd_extractor_internal_t *internal = (sacd_extractor_internal_t*)extractor->internal_data;
+    if (!internal) {
+        return SACD_RESULT_ERROR;
+    }
+    
+    sacd_internal_seqlock_read(&internal->progress_lock, progress, &internal->progress, sizeof(*progress));
+    return SACD_RESULT_OK;
 }
 
 /* Wait for extraction to complete */
@@ -505,10 +1829,27 @@ sacd_result_t sacd_extractor_wait(sacd_extractor_t *extractor) {
         return SACD_RESULT_ERROR;
     }
     
-    if (!internal->is_running) {
+    /* Join even if the thread already finished, so its resources are released */
+    if (!internal->thread_joinable) {
         return SACD_RESULT_OK;
     }
     
     int result = pthread_join(internal->extraction_thread, NULL);
+    internal->thread_joinable = false;
     return (result == 0) ? SACD_RESULT_OK : SACD_RESULT_ERROR;
+}
+
+/* Register completion hook (internal) */
+void sacd_internal_extractor_set_finish_hook(
+    sacd_extractor_t *extractor,
+    void (*hook)(void *data, sacd_result_t result),
+    void *data) {
+    
+    if (!extractor || !extractor->internal_data) {
+        return;
+    }
+    
+    sacd_extractor_internal_t *internal = (sacd_extractor_internal_t*)extractor->internal_data;
+    internal->finish_hook = hook;
+    internal->finish_hook_data = data;
 }
\ No newline at end of file
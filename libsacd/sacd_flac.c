@@ -0,0 +1,824 @@
+/**
+ * SACD Library - FLAC Encoder
+ *
+ * Native FLAC encoder for converted PCM (24-bit). Each block is encoded as an
+ * independent frame with the best fixed predictor (order 0-4) and partitioned
+ * Rice coding, falling back to constant or verbatim subframes where smaller.
+ *
+ * Blocks are batched and encoded by a pool of worker threads, then written in
+ * order, so the output is a single valid stream. STREAMINFO (including the MD5
+ * of the unencoded samples) and the SEEKTABLE are written as placeholders and
+ * filled in when the track is finalized.
+ */
+
+#include "sacd_lib.h"
+#include "sacd_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#define FLAC_BLOCK_SIZE          4096
+#define FLAC_BITS_PER_SAMPLE     24
+#define FLAC_MAX_FIXED_ORDER     4
+#define FLAC_MAX_PARTITION_ORDER 8
+#define FLAC_BLOCKS_PER_THREAD   4
+#define FLAC_SEEK_INTERVAL       10      /* Seconds between seek points */
+#define FLAC_STREAMINFO_OFFSET   4       /* After "fLaC" */
+
+typedef struct {
+    uint64_t sample;
+    uint64_t offset;
+    uint16_t frame_samples;
+    bool used;
+} flac_seekpoint_t;
+
+typedef struct {
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+    uint64_t acc;
+    int bits;
+} flac_bitwriter_t;
+
+/* Per-block work item */
+typedef struct {
+    const int32_t *samples;  /* Interleaved input */
+    uint32_t frame_count;
+    uint64_t frame_number;
+    flac_bitwriter_t out;
+} flac_block_t;
+
+/* Per-worker scratch */
+typedef struct {
+    struct sacd_flac_encoder *encoder;
+    int32_t *channel;        /* De-interleaved channel samples */
+    int32_t *residual[FLAC_MAX_FIXED_ORDER + 1];
+} flac_scratch_t;
+
+struct sacd_flac_encoder {
+    int channel_count;
+    uint32_t sample_rate;
+
+    /* Batching */
+    int32_t *samples;        /* Interleaved batch */
+    size_t batch_frames;     /* Capacity in frames */
+    size_t buffered_frames;
+    flac_block_t *blocks;
+    int block_count;
+    uint8_t *output;
+    size_t output_capacity;
+
+    /* Stream state */
+    uint64_t next_frame_number;
+    uint64_t total_samples;
+    uint64_t frames_bytes;   /* Bytes of frame data written so far */
+    uint32_t min_frame_size;
+    uint32_t max_frame_size;
+    sacd_md5_state_t md5;
+    flac_seekpoint_t *seekpoints;
+    int seekpoint_count;
+
+    /* Worker pool */
+    pthread_t *threads;
+    flac_scratch_t *scratch;
+    int thread_count;
+    int threads_started;
+    int batch_blocks;        /* Blocks in the current batch */
+    int next_block;          /* Next block to claim */
+    int pending;
+    unsigned int generation;
+    bool shutdown;
+    uint64_t stalls;         /* Waits for a batch to finish */
+    pthread_mutex_t mutex;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+};
+
+/* CRC-8 (poly 0x07) and CRC-16 (poly 0x8005) as used by FLAC frames */
+static uint8_t crc8(const uint8_t *data, size_t len) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0x07) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+static uint16_t crc16(const uint8_t *data, size_t len) {
+    uint16_t crc = 0;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= (uint16_t)data[i] << 8;
+        for (int b = 0; b < 8; b++) {
+            crc = (crc & 0x8000) ? (uint16_t)((crc << 1) ^ 0x8005) : (uint16_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/* Bit writer (MSB first); capacity is reserved up front for a whole frame */
+static void bw_reset(flac_bitwriter_t *bw) {
+    bw->size = 0;
+    bw->acc = 0;
+    bw->bits = 0;
+}
+
+static void bw_put(flac_bitwriter_t *bw, uint32_t value, int bits) {
+    while (bits > 0) {
+        int take = bits > 24 ? 24 : bits;
+        bits -= take;
+        uint32_t part = (value >> bits) & ((1u << take) - 1);
+        bw->acc = (bw->acc << take) | part;
+        bw->bits += take;
+        while (bw->bits >= 8) {
+            bw->bits -= 8;
+            bw->data[bw->size++] = (uint8_t)(bw->acc >> bw->bits);
+        }
+    }
+}
+
+static void bw_put_signed(flac_bitwriter_t *bw, int32_t value, int bits) {
+    bw_put(bw, (uint32_t)value & (bits == 32 ? 0xFFFFFFFFu : ((1u << bits) - 1)), bits);
+}
+
+static void bw_put_unary_zeros(flac_bitwriter_t *bw, uint32_t zeros) {
+    while (zeros >= 24) {
+        bw_put(bw, 0, 24);
+        zeros -= 24;
+    }
+    bw_put(bw, 1, (int)zeros + 1);
+}
+
+static void bw_align(flac_bitwriter_t *bw) {
+    if (bw->bits > 0) {
+        bw_put(bw, 0, 8 - bw->bits);
+    }
+}
+
+/* Compute fixed-predictor residuals of the given order */
+static void fixed_residual(const int32_t *x, uint32_t n, int order, int32_t *r) {
+    switch (order) {
+        case 0:
+            for (uint32_t i = 0; i < n; i++) r[i] = x[i];
+            break;
+        case 1:
+            for (uint32_t i = 1; i < n; i++) r[i] = x[i] - x[i - 1];
+            break;
+        case 2:
+            for (uint32_t i = 2; i < n; i++) r[i] = x[i] - 2 * x[i - 1] + x[i - 2];
+            break;
+        case 3:
+            for (uint32_t i = 3; i < n; i++) r[i] = x[i] - 3 * x[i - 1] + 3 * x[i - 2] - x[i - 3];
+            break;
+        case 4:
+            for (uint32_t i = 4; i < n; i++) r[i] = x[i] - 4 * x[i - 1] + 6 * x[i - 2] - 4 * x[i - 3] + x[i - 4];
+            break;
+    }
+}
+
+static inline uint32_t fold(int32_t r) {
+    return ((uint32_t)r << 1) ^ (uint32_t)(r >> 31);
+}
+
+/* Best Rice parameter for a partition with the given folded sum */
+static int rice_parameter(uint64_t sum, uint32_t count, uint64_t *bits) {
+    int best = 0;
+    uint64_t best_bits = UINT64_MAX;
+    for (int k = 0; k <= 30; k++) {
+        uint64_t b = (uint64_t)count * (k + 1) + (sum >> k);
+        if (b < best_bits) {
+            best_bits = b;
+            best = k;
+        }
+        if ((sum >> k) == 0) {
+            break;
+        }
+    }
+    *bits = best_bits;
+    return best;
+}
+
+/* Choose the partition order; returns estimated residual bits */
+static uint64_t plan_residual(const int32_t *r, uint32_t n, int order,
+                              int *best_porder, int params[1 << FLAC_MAX_PARTITION_ORDER]) {
+    uint64_t sums[1 << FLAC_MAX_PARTITION_ORDER];
+    int max_porder = 0;
+    while (max_porder < FLAC_MAX_PARTITION_ORDER &&
+           (n % (1u << (max_porder + 1))) == 0 &&
+           (n >> (max_porder + 1)) > (uint32_t)order) {
+        max_porder++;
+    }
+
+    /* Partition sums at the finest order, merged for coarser orders */
+    uint32_t parts = 1u << max_porder;
+    uint32_t psize = n >> max_porder;
+    for (uint32_t p = 0; p < parts; p++) {
+        uint32_t start = (p == 0) ? (uint32_t)order : p * psize;
+        uint64_t sum = 0;
+        for (uint32_t i = start; i < (p + 1) * psize; i++) {
+            sum += fold(r[i]);
+        }
+        sums[p] = sum;
+    }
+
+    uint64_t best_bits = UINT64_MAX;
+    int tmp_params[1 << FLAC_MAX_PARTITION_ORDER];
+
+    for (int porder = max_porder; porder >= 0; porder--) {
+        parts = 1u << porder;
+        psize = n >> porder;
+        uint64_t total = 0;
+        int max_param = 0;
+        for (uint32_t p = 0; p < parts; p++) {
+            uint32_t count = psize - (p == 0 ? (uint32_t)order : 0);
+            uint64_t bits;
+            tmp_params[p] = rice_parameter(sums[p], count, &bits);
+            if (tmp_params[p] > max_param) {
+                max_param = tmp_params[p];
+            }
+            total += bits;
+        }
+        total += parts * (max_param > 14 ? 5 : 4);
+
+        if (total < best_bits) {
+            best_bits = total;
+            *best_porder = porder;
+            memcpy(params, tmp_params, parts * sizeof(int));
+        }
+
+        /* Merge pairs for the next coarser order */
+        for (uint32_t p = 0; p < parts / 2; p++) {
+            sums[p] = sums[2 * p] + sums[2 * p + 1];
+        }
+    }
+
+    return best_bits + 6;
+}
+
+static void write_residual(flac_bitwriter_t *bw, const int32_t *r, uint32_t n, int order,
+                           int porder, const int *params) {
+    uint32_t parts = 1u << porder;
+    int max_param = 0;
+    for (uint32_t p = 0; p < parts; p++) {
+        if (params[p] > max_param) {
+            max_param = params[p];
+        }
+    }
+
+    bool rice2 = max_param > 14;
+    bw_put(bw, rice2 ? 1 : 0, 2);
+    bw_put(bw, (uint32_t)porder, 4);
+
+    uint32_t psize = n >> porder;
+    for (uint32_t p = 0; p < parts; p++) {
+        int k = params[p];
+        bw_put(bw, (uint32_t)k, rice2 ? 5 : 4);
+        uint32_t start = (p == 0) ? (uint32_t)order : p * psize;
+        for (uint32_t i = start; i < (p + 1) * psize; i++) {
+            uint32_t u = fold(r[i]);
+            bw_put_unary_zeros(bw, u >> k);
+            if (k > 0) {
+                bw_put(bw, u & ((1u << k) - 1), k);
+            }
+        }
+    }
+}
+
+/* Encode one channel of a block as the smallest subframe */
+static void encode_subframe(flac_bitwriter_t *bw, flac_scratch_t *scratch, uint32_t n) {
+    const int32_t *x = scratch->channel;
+
+    bool constant = true;
+    for (uint32_t i = 1; i < n && constant; i++) {
+        constant = (x[i] == x[0]);
+    }
+    if (constant) {
+        bw_put(bw, 0x00, 8);            /* Constant, no wasted bits */
+        bw_put_signed(bw, x[0], FLAC_BITS_PER_SAMPLE);
+        return;
+    }
+
+    uint64_t best_bits = (uint64_t)n * FLAC_BITS_PER_SAMPLE; /* Verbatim */
+    int best_order = -1;
+    int best_porder = 0;
+    int best_params[1 << FLAC_MAX_PARTITION_ORDER];
+
+    for (int order = 0; order <= FLAC_MAX_FIXED_ORDER && (uint32_t)order < n; order++) {
+        int porder = 0;
+        int params[1 << FLAC_MAX_PARTITION_ORDER];
+        fixed_residual(x, n, order, scratch->residual[order]);
+        uint64_t bits = plan_residual(scratch->residual[order], n, order, &porder, params) +
+                        (uint64_t)order * FLAC_BITS_PER_SAMPLE;
+        if (bits < best_bits) {
+            best_bits = bits;
+            best_order = order;
+            best_porder = porder;
+            memcpy(best_params, params, (1u << porder) * sizeof(int));
+        }
+    }
+
+    if (best_order < 0) {
+        bw_put(bw, 0x02, 8);            /* Verbatim */
+        for (uint32_t i = 0; i < n; i++) {
+            bw_put_signed(bw, x[i], FLAC_BITS_PER_SAMPLE);
+        }
+        return;
+    }
+
+    bw_put(bw, (uint32_t)(0x08 | best_order) << 1, 8);   /* Fixed, order */
+    for (int i = 0; i < best_order; i++) {
+        bw_put_signed(bw, x[i], FLAC_BITS_PER_SAMPLE);
+    }
+    write_residual(bw, scratch->residual[best_order], n, best_order, best_porder, best_params);
+}
+
+/* UTF-8 style coded frame number */
+static void write_coded_number(flac_bitwriter_t *bw, uint64_t value) {
+    if (value < 0x80) {
+        bw_put(bw, (uint32_t)value, 8);
+        return;
+    }
+
+    int extra = 1;
+    while (extra < 6 && value >= (1ULL << (5 * extra + 6))) {
+        extra++;
+    }
+    uint32_t lead = (0xFF00u >> (extra + 1)) & 0xFF;
+    bw_put(bw, lead | (uint32_t)(value >> (6 * extra)), 8);
+    for (int i = extra - 1; i >= 0; i--) {
+        bw_put(bw, 0x80 | (uint32_t)((value >> (6 * i)) & 0x3F), 8);
+    }
+}
+
+/* Encode a block into a complete frame */
+static void encode_block(const sacd_flac_encoder_t *encoder, flac_block_t *block,
+                         flac_scratch_t *scratch) {
+    flac_bitwriter_t *bw = &block->out;
+    uint32_t n = block->frame_count;
+    bw_reset(bw);
+
+    /* Frame header */
+    bw_put(bw, 0x3FFE, 14);                                 /* Sync */
+    bw_put(bw, 0, 1);                                       /* Reserved */
+    bw_put(bw, 0, 1);                                       /* Fixed block size */
+    bw_put(bw, (n == FLAC_BLOCK_SIZE) ? 12 : 7, 4);         /* 4096, or 16-bit size follows */
+    bw_put(bw, (encoder->sample_rate == 88200) ? 1 : 2, 4); /* 88.2 / 176.4 kHz */
+    bw_put(bw, (uint32_t)(encoder->channel_count - 1), 4);  /* Independent channels */
+    bw_put(bw, 6, 3);                                       /* 24 bits per sample */
+    bw_put(bw, 0, 1);                                       /* Reserved */
+    write_coded_number(bw, block->frame_number);
+    if (n != FLAC_BLOCK_SIZE) {
+        bw_put(bw, n - 1, 16);
+    }
+    bw_put(bw, crc8(bw->data, bw->size), 8);
+
+    for (int c = 0; c < encoder->channel_count; c++) {
+        for (uint32_t i = 0; i < n; i++) {
+            scratch->channel[i] = block->samples[i * encoder->channel_count + c];
+        }
+        encode_subframe(bw, scratch, n);
+    }
+
+    bw_align(bw);
+    uint16_t crc = crc16(bw->data, bw->size);
+    bw_put(bw, crc, 16);
+}
+
+static void *encoder_thread(void *arg) {
+    flac_scratch_t *scratch = (flac_scratch_t*)arg;
+    sacd_flac_encoder_t *encoder = scratch->encoder;
+
+    unsigned int seen = 0;
+    pthread_mutex_lock(&encoder->mutex);
+    for (;;) {
+        while (!encoder->shutdown && encoder->generation == seen) {
+            pthread_cond_wait(&encoder->work_cond, &encoder->mutex);
+        }
+        if (encoder->shutdown) {
+            break;
+        }
+        seen = encoder->generation;
+
+        /* Claim blocks until the batch is exhausted */
+        while (encoder->next_block < encoder->batch_blocks) {
+            int index = encoder->next_block++;
+            pthread_mutex_unlock(&encoder->mutex);
+            encode_block(encoder, &encoder->blocks[index], scratch);
+            pthread_mutex_lock(&encoder->mutex);
+        }
+
+        if (--encoder->pending == 0) {
+            pthread_cond_signal(&encoder->done_cond);
+        }
+    }
+    pthread_mutex_unlock(&encoder->mutex);
+
+    return NULL;
+}
+
+/* Make room for one more batch of frames after 'used' bytes */
+static sacd_result_t reserve_output(sacd_flac_encoder_t *encoder, size_t used) {
+    size_t batch_max = encoder->block_count * encoder->blocks[0].out.capacity;
+    if (used + batch_max <= encoder->output_capacity) {
+        return SACD_RESULT_OK;
+    }
+
+    uint8_t *output = realloc(encoder->output, used + batch_max);
+    if (!output) {
+        return SACD_RESULT_OUT_OF_MEMORY;
+    }
+    encoder->output = output;
+    encoder->output_capacity = used + batch_max;
+    return SACD_RESULT_OK;
+}
+
+/* Encode the buffered batch and append the frames to the output buffer */
+static sacd_result_t encode_batch(sacd_flac_encoder_t *encoder, size_t *out_size) {
+    if (encoder->buffered_frames == 0) {
+        return SACD_RESULT_OK;
+    }
+
+    int blocks = (int)((encoder->buffered_frames + FLAC_BLOCK_SIZE - 1) / FLAC_BLOCK_SIZE);
+    for (int b = 0; b < blocks; b++) {
+        size_t first = (size_t)b * FLAC_BLOCK_SIZE;
+        size_t remaining = encoder->buffered_frames - first;
+        encoder->blocks[b].samples = encoder->samples + first * encoder->channel_count;
+        encoder->blocks[b].frame_count = remaining < FLAC_BLOCK_SIZE ? (uint32_t)remaining : FLAC_BLOCK_SIZE;
+        encoder->blocks[b].frame_number = encoder->next_frame_number + b;
+    }
+
+    pthread_mutex_lock(&encoder->mutex);
+    encoder->batch_blocks = blocks;
+    encoder->next_block = 0;
+    encoder->pending = encoder->threads_started;
+    encoder->generation++;
+    pthread_cond_broadcast(&encoder->work_cond);
+    while (encoder->pending > 0) {
+        encoder->stalls++;
+        pthread_cond_wait(&encoder->done_cond, &encoder->mutex);
+    }
+    pthread_mutex_unlock(&encoder->mutex);
+
+    /* Stitch frames in order, recording sizes and seek points */
+    uint64_t seek_interval = (uint64_t)encoder->sample_rate * FLAC_SEEK_INTERVAL;
+    for (int b = 0; b < blocks; b++) {
+        flac_block_t *block = &encoder->blocks[b];
+        uint64_t first_sample = encoder->total_samples;
+
+        int point = (int)(first_sample / seek_interval);
+        if (point < encoder->seekpoint_count && !encoder->seekpoints[point].used) {
+            encoder->seekpoints[point].sample = first_sample;
+            encoder->seekpoints[point].offset = encoder->frames_bytes;
+            encoder->seekpoints[point].frame_samples = (uint16_t)block->frame_count;
+            encoder->seekpoints[point].used = true;
+        }
+
+        memcpy(encoder->output + *out_size, block->out.data, block->out.size);
+        *out_size += block->out.size;
+
+        uint32_t size = (uint32_t)block->out.size;
+        if (encoder->min_frame_size == 0 || size < encoder->min_frame_size) {
+            encoder->min_frame_size = size;
+        }
+        if (size > encoder->max_frame_size) {
+            encoder->max_frame_size = size;
+        }
+        encoder->frames_bytes += size;
+        encoder->total_samples += block->frame_count;
+    }
+
+    encoder->next_frame_number += blocks;
+    encoder->buffered_frames = 0;
+    return SACD_RESULT_OK;
+}
+
+/* Create an encoder */
+sacd_result_t sacd_internal_flac_encoder_create(
+    sacd_flac_encoder_t **encoder,
+    int channel_count,
+    uint32_t sample_rate,
+    int thread_count,
+    const sacd_cpuset_t *cpus) {
+
+    if (!encoder || channel_count < 1 || channel_count > 8 ||
+        (sample_rate != 88200 && sample_rate != 176400)) {
+        return SACD_RESULT_ERROR;
+    }
+
+    *encoder = NULL;
+
+    if (thread_count <= 0 && cpus) {
+        thread_count = sacd_internal_cpuset_count(cpus);
+    }
+    if (thread_count <= 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        thread_count = (online > 0) ? (int)online : 1;
+    }
+
+    sacd_flac_encoder_t *enc = calloc(1, sizeof(sacd_flac_encoder_t));
+    if (!enc) {
+        return SACD_RESULT_OUT_OF_MEMORY;
+    }
+
+    enc->channel_count = channel_count;
+    enc->sample_rate = sample_rate;
+    enc->thread_count = thread_count;
+    enc->block_count = thread_count * FLAC_BLOCKS_PER_THREAD;
+    enc->batch_frames = (size_t)enc->block_count * FLAC_BLOCK_SIZE;
+
+    /* Worst case frame: header, verbatim subframes, CRC */
+    size_t frame_capacity = 32 + (size_t)channel_count * (1 + FLAC_BLOCK_SIZE * 4);
+
+    enc->samples = malloc(enc->batch_frames * channel_count * sizeof(int32_t));
+    enc->blocks = calloc(enc->block_count, sizeof(flac_block_t));
+    enc->output_capacity = frame_capacity * enc->block_count;
+    enc->output = malloc(enc->output_capacity);
+    enc->threads = calloc(thread_count, sizeof(pthread_t));
+    enc->scratch = calloc(thread_count, sizeof(flac_scratch_t));
+    if (!enc->samples || !enc->blocks || !enc->output || !enc->threads || !enc->scratch) {
+        sacd_internal_flac_encoder_destroy(enc);
+        return SACD_RESULT_OUT_OF_MEMORY;
+    }
+
+    for (int b = 0; b < enc->block_count; b++) {
+        enc->blocks[b].out.data = malloc(frame_capacity);
+        enc->blocks[b].out.capacity = frame_capacity;
+        if (!enc->blocks[b].out.data) {
+            sacd_internal_flac_encoder_destroy(enc);
+            return SACD_RESULT_OUT_OF_MEMORY;
+        }
+    }
+
+    for (int t = 0; t < thread_count; t++) {
+        enc->scratch[t].channel = malloc(FLAC_BLOCK_SIZE * sizeof(int32_t));
+        if (!enc->scratch[t].channel) {
+            sacd_internal_flac_encoder_destroy(enc);
+            return SACD_RESULT_OUT_OF_MEMORY;
+        }
+        for (int o = 0; o <= FLAC_MAX_FIXED_ORDER; o++) {
+            enc->scratch[t].residual[o] = malloc(FLAC_BLOCK_SIZE * sizeof(int32_t));
+            if (!enc->scratch[t].residual[o]) {
+                sacd_internal_flac_encoder_destroy(enc);
+                return SACD_RESULT_OUT_OF_MEMORY;
+            }
+        }
+    }
+
+    if (pthread_mutex_init(&enc->mutex, NULL) != 0) {
+        sacd_internal_flac_encoder_destroy(enc);
+        return SACD_RESULT_ERROR;
+    }
+    pthread_cond_init(&enc->work_cond, NULL);
+    pthread_cond_init(&enc->done_cond, NULL);
+
+    for (int t = 0; t < thread_count; t++) {
+        enc->scratch[t].encoder = enc;
+        if (sacd_internal_thread_create(&enc->threads[t], cpus, encoder_thread, &enc->scratch[t]) != 0) {
+            sacd_internal_flac_encoder_destroy(enc);
+            return SACD_RESULT_ERROR;
+        }
+        enc->threads_started++;
+    }
+
+    *encoder = enc;
+    return SACD_RESULT_OK;
+}
+
+/* Destroy an encoder */
+void sacd_internal_flac_encoder_destroy(sacd_flac_encoder_t *encoder) {
+    if (!encoder) {
+        return;
+    }
+
+    if (encoder->threads_started > 0) {
+        pthread_mutex_lock(&encoder->mutex);
+        encoder->shutdown = true;
+        pthread_cond_broadcast(&encoder->work_cond);
+        pthread_mutex_unlock(&encoder->mutex);
+
+        for (int t = 0; t < encoder->threads_started; t++) {
+            pthread_join(encoder->threads[t], NULL);
+        }
+
+        pthread_cond_destroy(&encoder->work_cond);
+        pthread_cond_destroy(&encoder->done_cond);
+        pthread_mutex_destroy(&encoder->mutex);
+    }
+
+    if (encoder->blocks) {
+        for (int b = 0; b < encoder->block_count; b++) {
+            free(encoder->blocks[b].out.data);
+        }
+    }
+    if (encoder->scratch) {
+        for (int t = 0; t < encoder->thread_count; t++) {
+            free(encoder->scratch[t].channel);
+            for (int o = 0; o <= FLAC_MAX_FIXED_ORDER; o++) {
+                free(encoder->scratch[t].residual[o]);
+            }
+        }
+    }
+
+    free(encoder->samples);
+    free(encoder->blocks);
+    free(encoder->output);
+    free(encoder->threads);
+    free(encoder->scratch);
+    free(encoder->seekpoints);
+    free(encoder);
+}
+
+/* Times the caller waited for the worker threads */
+uint64_t sacd_internal_flac_encoder_stalls(const sacd_flac_encoder_t *encoder) {
+    return encoder ? encoder->stalls : 0;
+}
+
+/* Write STREAMINFO (and SEEKTABLE when present); 'rewrite' patches them in
+ * place with the final totals, otherwise they are appended */
+static sacd_result_t write_metadata(sacd_flac_encoder_t *encoder, sacd_sink_t *sink,
+                                    uint64_t total_samples, bool rewrite) {
+    size_t size = 4 + 34 + (encoder->seekpoint_count ? 4 + (size_t)encoder->seekpoint_count * 18 : 0);
+    uint8_t *info = malloc(size);
+    if (!info) {
+        return SACD_RESULT_OUT_OF_MEMORY;
+    }
+    bool last = (encoder->seekpoint_count == 0);
+
+    info[0] = (last ? 0x80 : 0x00) | 0;     /* STREAMINFO */
+    info[1] = 0;
+    info[2] = 0;
+    info[3] = 34;
+
+    uint8_t *p = info + 4;
+    p[0] = FLAC_BLOCK_SIZE >> 8;
+    p[1] = FLAC_BLOCK_SIZE & 0xFF;
+    p[2] = FLAC_BLOCK_SIZE >> 8;
+    p[3] = FLAC_BLOCK_SIZE & 0xFF;
+    p[4] = (encoder->min_frame_size >> 16) & 0xFF;
+    p[5] = (encoder->min_frame_size >> 8) & 0xFF;
+    p[6] = encoder->min_frame_size & 0xFF;
+    p[7] = (encoder->max_frame_size >> 16) & 0xFF;
+    p[8] = (encoder->max_frame_size >> 8) & 0xFF;
+    p[9] = encoder->max_frame_size & 0xFF;
+
+    /* 20-bit rate, 3-bit channels-1, 5-bit bps-1, 36-bit total samples */
+    uint64_t packed = ((uint64_t)encoder->sample_rate << 44) |
+                      ((uint64_t)(encoder->channel_count - 1) << 41) |
+                      ((uint64_t)(FLAC_BITS_PER_SAMPLE - 1) << 36) |
+                      (total_samples & 0xFFFFFFFFFULL);
+    for (int i = 0; i < 8; i++) {
+        p[10 + i] = (uint8_t)(packed >> (56 - 8 * i));
+    }
+
+    /* MD5 of the samples so far (a copy, so encoding can continue); zero = unknown */
+    if (rewrite && encoder->total_samples > 0) {
+        sacd_md5_state_t md5 = encoder->md5;
+        sacd_internal_md5_final(&md5, p + 18);
+    } else {
+        memset(p + 18, 0, 16);
+    }
+
+    if (encoder->seekpoint_count > 0) {
+        uint32_t length = (uint32_t)encoder->seekpoint_count * 18;
+        uint8_t *header = info + 4 + 34;
+        header[0] = 0x80 | 3;
+        header[1] = (length >> 16) & 0xFF;
+        header[2] = (length >> 8) & 0xFF;
+        header[3] = length & 0xFF;
+
+        for (int i = 0; i < encoder->seekpoint_count; i++) {
+            const flac_seekpoint_t *sp = &encoder->seekpoints[i];
+            uint8_t *point = header + 4 + i * 18;
+            /* Unused points are placeholders (sample number all ones) */
+            uint64_t sample = sp->used ? sp->sample : UINT64_MAX;
+            uint64_t offset = sp->used ? sp->offset : 0;
+            for (int b = 0; b < 8; b++) {
+                point[b] = (uint8_t)(sample >> (56 - 8 * b));
+                point[8 + b] = (uint8_t)(offset >> (56 - 8 * b));
+            }
+            point[16] = sp->frame_samples >> 8;
+            point[17] = sp->frame_samples & 0xFF;
+        }
+    }
+
+    sacd_result_t result = rewrite ? sink->pwrite(sink, info, size, FLAC_STREAMINFO_OFFSET)
+                                   : sink->write(sink, info, size);
+    free(info);
+    return result;
+}
+
+/* Start a new stream: reset state and write the metadata placeholders */
+sacd_result_t sacd_internal_flac_write_header(
+    sacd_flac_encoder_t *encoder,
+    sacd_sink_t *sink,
+    uint64_t estimated_samples) {
+
+    if (!encoder || !sink) {
+        return SACD_RESULT_ERROR;
+    }
+
+    encoder->buffered_frames = 0;
+    encoder->next_frame_number = 0;
+    encoder->total_samples = 0;
+    encoder->frames_bytes = 0;
+    encoder->min_frame_size = 0;
+    encoder->max_frame_size = 0;
+    sacd_internal_md5_init(&encoder->md5);
+
+    free(encoder->seekpoints);
+    encoder->seekpoints = NULL;
+    encoder->seekpoint_count = 0;
+
+    /* Reserve one seek point per interval of the estimated duration; a stream
+     * that can't be patched later gets no SEEKTABLE and its exact length now */
+    if (sink->pwrite) {
+        int count = (int)(estimated_samples / ((uint64_t)encoder->sample_rate * FLAC_SEEK_INTERVAL)) + 1;
+        encoder->seekpoints = calloc(count, sizeof(flac_seekpoint_t));
+        if (!encoder->seekpoints) {
+            return SACD_RESULT_OUT_OF_MEMORY;
+        }
+        encoder->seekpoint_count = count;
+    }
+
+    if (sink->write(sink, "fLaC", 4) != SACD_RESULT_OK) {
+        return SACD_RESULT_IO_ERROR;
+    }
+    return write_metadata(encoder, sink, sink->pwrite ? 0 : estimated_samples, false);
+}
+
+/* Feed interleaved 24-bit little-endian PCM; returns encoded frames */
+sacd_result_t sacd_internal_flac_encode(
+    sacd_flac_encoder_t *encoder,
+    const uint8_t *pcm,
+    size_t pcm_size,
+    const uint8_t **flac,
+    size_t *flac_size) {
+
+    if (!encoder || (!pcm && pcm_size) || !flac || !flac_size) {
+        return SACD_RESULT_ERROR;
+    }
+
+    *flac = encoder->output;
+    *flac_size = 0;
+
+    /* STREAMINFO's MD5 covers the unencoded samples as given */
+    sacd_internal_md5_update(&encoder->md5, pcm, pcm_size);
+
+    size_t frame_bytes = (size_t)encoder->channel_count * 3;
+    size_t frames = pcm_size / frame_bytes;
+
+    while (frames > 0) {
+        size_t space = encoder->batch_frames - encoder->buffered_frames;
+        size_t take = frames < space ? frames : space;
+        int32_t *dst = encoder->samples + encoder->buffered_frames * encoder->channel_count;
+
+        for (size_t i = 0; i < take * encoder->channel_count; i++) {
+            int32_t v = (int32_t)((uint32_t)pcm[0] | (uint32_t)pcm[1] << 8 | (uint32_t)(int8_t)pcm[2] << 16);
+            dst[i] = v;
+            pcm += 3;
+        }
+
+        encoder->buffered_frames += take;
+        frames -= take;
+
+        if (encoder->buffered_frames == encoder->batch_frames) {
+            SACD_CHECK_RESULT(reserve_output(encoder, *flac_size));
+            *flac = encoder->output;
+            SACD_CHECK_RESULT(encode_batch(encoder, flac_size));
+        }
+    }
+
+    return SACD_RESULT_OK;
+}
+
+/* Encode whatever is buffered (end of stream) */
+sacd_result_t sacd_internal_flac_flush(
+    sacd_flac_encoder_t *encoder,
+    const uint8_t **flac,
+    size_t *flac_size) {
+
+    if (!encoder || !flac || !flac_size) {
+        return SACD_RESULT_ERROR;
+    }
+
+    *flac = encoder->output;
+    *flac_size = 0;
+    return encode_batch(encoder, flac_size);
+}
+
+/* Rewrite STREAMINFO and SEEKTABLE with the final values */
+sacd_result_t sacd_internal_flac_finalize(sacd_flac_encoder_t *encoder, sacd_sink_t *sink) {
+    if (!encoder || !sink) {
+        return SACD_RESULT_ERROR;
+    }
+
+    /* Without seeking, the header already holds the exact length */
+    if (!sink->pwrite) {
+        return SACD_RESULT_OK;
+    }
+
+    return write_metadata(encoder, sink, encoder->total_samples, true);
+}
@@ -1,7 +1,8 @@
 /**
  * SACD Library - Output Format Writers
  * 
- * Functions for writing DSF and DSDIFF format files with proper headers.
+ * Functions for writing DSF, DSDIFF (DSD or DST), WAV/RF64 and Wave64 format files
+ * with proper headers.
  */
 
 #include "sacd_lib.h"
@@ -10,6 +11,7 @@
 #include <string.h>
 #include <stdio.h>
 #include <time.h>
+#include <sys/types.h>
 
 /* DSF format structures */
 typedef struct {
@@ -38,41 +40,6 @@ typedef struct {
     uint64_t chunk_size;      /* Size of data chunk */
 } __attribute__((packed)) dsf_data_chunk_t;
 
-/* DSDIFF format structures */
-typedef struct {
-    char signature[4];        /* "FRM8" */
-    uint64_t chunk_size;      /* Size of form chunk */
-    char form_type[4];        /* "DSD " */
-} __attribute__((packed)) dsdiff_header_t;
-
-typedef struct {
-    char signature[4];        /* "FVER" */
-    uint64_t chunk_size;      /* Size of version chunk (4) */
-    uint32_t version;         /* Version number */
-} __attribute__((packed)) dsdiff_fver_chunk_t;
-
-typedef struct {
-    char signature[4];        /* "PROP" */
-    uint64_t chunk_size;      /* Size of property chunk */
-    char prop_type[4];        /* "SND " */
-} __attribute__((packed)) dsdiff_prop_chunk_t;
-
-typedef struct {
-    char signature[4];        /* "FS  " */
-    uint64_t chunk_size;      /* Size of sample rate chunk (4) */
-    uint32_t sample_rate;     /* Sample rate */
-} __attribute__((packed)) dsdiff_fs_chunk_t;
-
-typedef struct {
-    char signature[4];        /* "CHNL" */
-    uint64_t chunk_size;      /* Size of channels chunk */
-} __attribute__((packed)) dsdiff_chnl_chunk_t;
-
-typedef struct {
-    char signature[4];        /* "DSD " */
-    uint64_t chunk_size;      /* Size of DSD data chunk */
-} __attribute__((packed)) dsdiff_dsd_chunk_t;
-
 /* Helper functions for endian conversion */
 static void write_le32(uint8_t *data, uint32_t value) {
     data[0] = value & 0xFF;
@@ -81,6 +48,11 @@ static void write_le32(uint8_t *data, uint32_t value) {
     data[3] = (value >> 24) & 0xFF;
 }
 
+static void write_le16(uint8_t *data, uint16_t value) {
+    data[0] = value & 0xFF;
+    data[1] = (value >> 8) & 0xFF;
+}
+
 static void write_le64(uint8_t *data, uint64_t value) {
     data[0] = value & 0xFF;
     data[1] = (value >> 8) & 0xFF;
@@ -92,6 +64,18 @@ static void write_le64(uint8_t *data, uint64_t value) {
     data[7] = (value >> 56) & 0xFF;
 }
 
+static void write_be16(uint8_t *data, uint16_t value) {
+    data[0] = (value >> 8) & 0xFF;
+    data[1] = value & 0xFF;
+}
+
+static void write_be32(uint8_t *data, uint32_t value) {
+    data[0] = (value >> 24) & 0xFF;
+    data[1] = (value >> 16) & 0xFF;
+    data[2] = (value >> 8) & 0xFF;
+    data[3] = value & 0xFF;
+}
+
 static void write_be64(uint8_t *data, uint64_t value) {
     data[0] = (value >> 56) & 0xFF;
     data[1] = (value >> 48) & 0xFF;
@@ -105,12 +89,12 @@ static void write_be64(uint8_t *data, uint64_t value) {
 
 /* Write DSF file header */
 sacd_result_t sacd_internal_write_dsf_header(
-    FILE *file,
+    sacd_sink_t *sink,
     const sacd_track_t *track,
     const sacd_area_t *area,
     size_t audio_data_size) {
     
-    if (!file || !track || !area) {
+    if (!sink || !track || !area) {
         return SACD_RESULT_ERROR;
     }
     
@@ -118,8 +102,9 @@ sacd_result_t sacd_internal_write_dsf_header(
     size_t header_size = sizeof(dsf_header_t) + sizeof(dsf_fmt_chunk_t) + sizeof(dsf_data_chunk_t);
     size_t total_file_size = header_size + audio_data_size;
     
-    /* Calculate sample count */
-    uint64_t sample_count = sacd_track_duration_samples(track);
+    /* Samples per channel of the data as written: one bit each, channels byte-interleaved */
+    uint64_t sample_count = track->channel_count ?
+                            (uint64_t)audio_data_size / track->channel_count * 8 : 0;
     
     /* Write DSD header */
     dsf_header_t dsd_header;
@@ -135,7 +120,7 @@ sacd_result_t sacd_internal_write_dsf_header(
     write_le64(header_buf + 12, dsd_header.file_size);
     write_le64(header_buf + 20, dsd_header.id3_offset);
     
-    if (fwrite(header_buf, 1, 28, file) != 28) {
+    if (sink->write(sink, header_buf, 28) != SACD_RESULT_OK) {
         return SACD_RESULT_IO_ERROR;
     }
     
@@ -167,7 +152,7 @@ sacd_result_t sacd_internal_write_dsf_header(
     write_le32(fmt_buf + 44, fmt_chunk.block_size);
     write_le32(fmt_buf + 48, fmt_chunk.reserved);
     
-    if (fwrite(fmt_buf, 1, 52, file) != 52) {
+    if (sink->write(sink, fmt_buf, 52) != SACD_RESULT_OK) {
         return SACD_RESULT_IO_ERROR;
     }
     
@@ -180,7 +165,110 @@ sacd_result_t sacd_internal_write_dsf_header(
     memcpy(data_buf, data_chunk.signature, 4);
     write_le64(data_buf + 4, data_chunk.chunk_size);
     
-    if (fwrite(data_buf, 1, 12, file) != 12) {
+    if (sink->write(sink, data_buf, 12) != SACD_RESULT_OK) {
+        return SACD_RESULT_IO_ERROR;
+    }
+    
+    return SACD_RESULT_OK;
+}
+
+/*
+ * DSDIFF, with plain DSD or DST-compressed sound data:
+ *
+ *   FRM8 "DSD "
+ *     FVER                     1.5.0.0
+ *     PROP "SND "
+ *       FS                     2822400
+ *       CHNL                   channel count + IDs
+ *       CMPR                   "DSD " "not compressed" or "DST " "DST Encoded"
+ *     DSD                      interleaved DSD bytes
+ *   or
+ *     DST                      container
+ *       FRTE                   frame count, 75 frames/s
+ *       DSTF ...               one per frame, padded to even length
+ *     DSTI                     offset/length of every DSTF payload
+ *
+ * All fields are big-endian. DSTC (frame CRC) chunks are optional and are not
+ * written: their CRC covers the decoded DSD, which passthrough never produces.
+ */
+#define DSD_CMPR_NAME "not compressed"
+#define DST_CMPR_NAME "DST Encoded"
+
+/* Write a chunk header with a 64-bit big-endian size */
+static sacd_result_t write_chunk_header(sacd_sink_t *sink, const char *id, uint64_t size) {
+    uint8_t buf[12];
+    memcpy(buf, id, 4);
+    write_be64(buf + 4, size);
+    return sink->write(sink, buf, 12);
+}
+
+/* Size of a CMPR chunk's payload: type, counted name, pad byte */
+static size_t cmpr_chunk_size(const char *name) {
+    size_t name_len = strlen(name);
+    return 4 + 1 + name_len + ((1 + name_len) & 1);
+}
+
+/* Size of the PROP chunk's payload */
+static size_t prop_chunk_size(int channel_count, const char *cmpr_name) {
+    size_t chnl_size = 2 + 4 * (size_t)channel_count;
+    return 4 + (12 + 4) + (12 + chnl_size) + (12 + cmpr_chunk_size(cmpr_name));
+}
+
+/* Write FRM8, FVER and the PROP chunk, everything before the sound data */
+static sacd_result_t write_dsdiff_properties(
+    sacd_sink_t *sink,
+    const sacd_track_t *track,
+    const sacd_area_t *area,
+    uint64_t form_size,
+    const char *cmpr_type,
+    const char *cmpr_name) {
+    
+    static const char *channel_ids[] = { "SLFT", "SRGT", "C   ", "LFE ", "LS  ", "RS  " };
+    static const char *mch_channel_ids[] = { "MLFT", "MRGT", "C   ", "LFE ", "LS  ", "RS  " };
+    const char **ids = (track->channel_count > 2) ? mch_channel_ids : channel_ids;
+    
+    size_t name_len = strlen(cmpr_name);
+    size_t cmpr_size = cmpr_chunk_size(cmpr_name);
+    size_t chnl_size = 2 + 4 * track->channel_count;
+    
+    SACD_CHECK_RESULT(write_chunk_header(sink, "FRM8", form_size));
+    if (sink->write(sink, "DSD ", 4) != SACD_RESULT_OK) {
+        return SACD_RESULT_IO_ERROR;
+    }
+    
+    uint8_t buf[64];
+    SACD_CHECK_RESULT(write_chunk_header(sink, "FVER", 4));
+    write_be32(buf, 0x01050000);
+    if (sink->write(sink, buf, 4) != SACD_RESULT_OK) {
+        return SACD_RESULT_IO_ERROR;
+    }
+    
+    SACD_CHECK_RESULT(write_chunk_header(sink, "PROP", prop_chunk_size(track->channel_count, cmpr_name)));
+    if (sink->write(sink, "SND ", 4) != SACD_RESULT_OK) {
+        return SACD_RESULT_IO_ERROR;
+    }
+    
+    SACD_CHECK_RESULT(write_chunk_header(sink, "FS  ", 4));
+    write_be32(buf, area->sample_frequency);
+    if (sink->write(sink, buf, 4) != SACD_RESULT_OK) {
+        return SACD_RESULT_IO_ERROR;
+    }
+    
+    SACD_CHECK_RESULT(write_chunk_header(sink, "CHNL", chnl_size));
+    write_be16(buf, (uint16_t)track->channel_count);
+    for (int i = 0; i < track->channel_count; i++) {
+        memcpy(buf + 2 + 4 * i, ids[i], 4);
+    }
+    if (sink->write(sink, buf, chnl_size) != SACD_RESULT_OK) {
+        return SACD_RESULT_IO_ERROR;
+    }
+    
+    SACD_CHECK_RESULT(write_chunk_header(sink, "CMPR", cmpr_size));
+    memset(buf, 0, sizeof(buf));
+    memcpy(buf, cmpr_type, 4);
+    buf[4] = (uint8_t)name_len;
+    memcpy(buf + 5, cmpr_name, name_len);
+    if (sink->write(sink, buf, cmpr_size) != SACD_RESULT_OK) {
         return SACD_RESULT_IO_ERROR;
     }
     
@@ -189,177 +277,392 @@ sacd_result_t sacd_internal_write_dsf_header(
 
 /* Write DSDIFF file header */
 sacd_result_t sacd_internal_write_dsdiff_header(
-    FILE *file,
+    sacd_sink_t *sink,
     const sacd_track_t *track,
     const sacd_area_t *area,
     size_t audio_data_size) {
     
-    if (!file || !track || !area) {
+    if (!sink || !track || !area || track->channel_count <= 0 || track->channel_count > 6) {
         return SACD_RESULT_ERROR;
     }
     
-    /* Calculate chunk sizes */
-    size_t chnl_chunk_size = 8 + (track->channel_count * 4); /* 4 bytes per channel ID */
-    size_t prop_chunk_size = 4 + 16 + chnl_chunk_size; /* "SND " + FS + CHNL */
-    size_t form_chunk_size = 4 + 12 + prop_chunk_size + 16 + audio_data_size; /* DSD + FVER + PROP + DSD data */
+    /* "DSD " + FVER + PROP + DSD data; exact for sinks that can't seek, patched at finalize otherwise */
+    uint64_t form_size = 4 + (12 + 4) + (12 + prop_chunk_size(track->channel_count, DSD_CMPR_NAME)) +
+                         12 + (uint64_t)audio_data_size;
     
-    /* Write FORM header */
-    dsdiff_header_t form_header;
-    memcpy(form_header.signature, "FRM8", 4);
-    form_header.chunk_size = form_chunk_size;
-    memcpy(form_header.form_type, "DSD ", 4);
+    SACD_CHECK_RESULT(write_dsdiff_properties(sink, track, area, form_size, "DSD ", DSD_CMPR_NAME));
     
-    uint8_t form_buf[16];
-    memcpy(form_buf, form_header.signature, 4);
-    write_be64(form_buf + 4, form_header.chunk_size);
-    memcpy(form_buf + 12, form_header.form_type, 4);
+    /* Sound data chunk header; the audio follows */
+    return write_chunk_header(sink, "DSD ", audio_data_size);
+}
+
+/* Write DSDIFF header for DST passthrough */
+sacd_result_t sacd_internal_write_dsdiff_dst_header(
+    sacd_sink_t *sink,
+    const sacd_track_t *track,
+    const sacd_area_t *area,
+    sacd_dst_index_t *index) {
     
-    if (fwrite(form_buf, 1, 16, file) != 16) {
-        return SACD_RESULT_IO_ERROR;
+    if (!sink || !track || !area || !index || track->channel_count <= 0 || track->channel_count > 6) {
+        return SACD_RESULT_ERROR;
     }
     
-    /* Write FVER chunk */
-    dsdiff_fver_chunk_t fver_chunk;
-    memcpy(fver_chunk.signature, "FVER", 4);
-    fver_chunk.chunk_size = 4;
-    fver_chunk.version = 0x01050000; /* Version 1.5.0.0 */
+    memset(index, 0, sizeof(sacd_dst_index_t));
     
-    uint8_t fver_buf[12];
-    memcpy(fver_buf, fver_chunk.signature, 4);
-    write_be64(fver_buf + 4, fver_chunk.chunk_size);
-    write_le32(fver_buf + 8, fver_chunk.version); /* Version is little endian */
+    /* FORM size is patched at finalize */
+    SACD_CHECK_RESULT(write_dsdiff_properties(sink, track, area, 0, "DST ", DST_CMPR_NAME));
     
-    /* Pad to even size */
-    if (fwrite(fver_buf, 1, 12, file) != 12) {
+    /* "DST " container; its size and the FRTE frame count are patched at finalize */
+    index->dst_chunk_offset = sink->position;
+    
+    SACD_CHECK_RESULT(write_chunk_header(sink, "DST ", 0));
+    SACD_CHECK_RESULT(write_chunk_header(sink, "FRTE", 6));
+    uint8_t buf[6];
+    write_be32(buf, 0);
+    write_be16(buf + 4, SACD_FRAME_RATE);
+    if (sink->write(sink, buf, 6) != SACD_RESULT_OK) {
         return SACD_RESULT_IO_ERROR;
     }
     
-    /* Write PROP chunk header */
-    dsdiff_prop_chunk_t prop_chunk;
-    memcpy(prop_chunk.signature, "PROP", 4);
-    prop_chunk.chunk_size = prop_chunk_size;
-    memcpy(prop_chunk.prop_type, "SND ", 4);
+    return SACD_RESULT_OK;
+}
+
+/* Write one DST frame as a DSTF chunk */
+sacd_result_t sacd_internal_write_dst_frame(
+    sacd_sink_t *sink,
+    sacd_dst_index_t *index,
+    const uint8_t *frame,
+    size_t frame_size) {
+    
+    if (!sink || !index || (!frame && frame_size)) {
+        return SACD_RESULT_ERROR;
+    }
+    
+    if (index->frame_count == index->frame_capacity) {
+        uint32_t capacity = index->frame_capacity ? index->frame_capacity * 2 : 4096;
+        uint64_t *offsets = realloc(index->frame_offsets, capacity * sizeof(uint64_t));
+        if (!offsets) {
+            return SACD_RESULT_OUT_OF_MEMORY;
+        }
+        index->frame_offsets = offsets;
+        uint32_t *lengths = realloc(index->frame_lengths, capacity * sizeof(uint32_t));
+        if (!lengths) {
+            return SACD_RESULT_OUT_OF_MEMORY;
+        }
+        index->frame_lengths = lengths;
+        index->frame_capacity = capacity;
+    }
+    
+    SACD_CHECK_RESULT(write_chunk_header(sink, "DSTF", frame_size));
     
-    uint8_t prop_buf[16];
-    memcpy(prop_buf, prop_chunk.signature, 4);
-    write_be64(prop_buf + 4, prop_chunk.chunk_size);
-    memcpy(prop_buf + 12, prop_chunk.prop_type, 4);
+    uint64_t data_offset = sink->position;
     
-    if (fwrite(prop_buf, 1, 16, file) != 16) {
+    if (sink->write(sink, frame, frame_size) != SACD_RESULT_OK) {
+        return SACD_RESULT_IO_ERROR;
+    }
+    if ((frame_size & 1) && sink->write(sink, "", 1) != SACD_RESULT_OK) {
         return SACD_RESULT_IO_ERROR;
     }
     
-    /* Write FS chunk */
-    dsdiff_fs_chunk_t fs_chunk;
-    memcpy(fs_chunk.signature, "FS  ", 4);
-    fs_chunk.chunk_size = 4;
-    fs_chunk.sample_rate = area->sample_frequency;
+    index->frame_offsets[index->frame_count] = data_offset;
+    index->frame_lengths[index->frame_count] = (uint32_t)frame_size;
+    index->frame_count++;
     
-    uint8_t fs_buf[12];
-    memcpy(fs_buf, fs_chunk.signature, 4);
-    write_be64(fs_buf + 4, fs_chunk.chunk_size);
-    write_le32(fs_buf + 8, fs_chunk.sample_rate); /* Sample rate is little endian */
+    return SACD_RESULT_OK;
+}
+
+/* Append DSTI and patch sizes */
+sacd_result_t sacd_internal_finalize_dsdiff_dst(sacd_sink_t *sink, sacd_dst_index_t *index) {
+    if (!sink || !index || !sink->pwrite) {
+        return SACD_RESULT_ERROR;
+    }
     
-    if (fwrite(fs_buf, 1, 12, file) != 12) {
-        return SACD_RESULT_IO_ERROR;
+    uint64_t dst_end = sink->position;
+    
+    SACD_CHECK_RESULT(write_chunk_header(sink, "DSTI", (uint64_t)index->frame_count * 12));
+    for (uint32_t i = 0; i < index->frame_count; i++) {
+        uint8_t entry[12];
+        write_be64(entry, index->frame_offsets[i]);
+        write_be32(entry + 8, index->frame_lengths[i]);
+        if (sink->write(sink, entry, 12) != SACD_RESULT_OK) {
+            return SACD_RESULT_IO_ERROR;
+        }
     }
     
-    /* Write CHNL chunk */
-    dsdiff_chnl_chunk_t chnl_chunk;
-    memcpy(chnl_chunk.signature, "CHNL", 4);
-    chnl_chunk.chunk_size = track->channel_count * 4;
+    uint8_t buf[8];
     
-    uint8_t chnl_buf[8];
-    memcpy(chnl_buf, chnl_chunk.signature, 4);
-    write_be64(chnl_buf + 4, chnl_chunk.chunk_size);
+    write_be64(buf, sink->position - 12);
+    SACD_CHECK_RESULT(sink->pwrite(sink, buf, 8, 4));
     
-    if (fwrite(chnl_buf, 1, 8, file) != 8) {
-        return SACD_RESULT_IO_ERROR;
+    write_be64(buf, dst_end - index->dst_chunk_offset - 12);
+    SACD_CHECK_RESULT(sink->pwrite(sink, buf, 8, index->dst_chunk_offset + 4));
+    
+    /* FRTE follows the DST chunk header directly */
+    write_be32(buf, index->frame_count);
+    return sink->pwrite(sink, buf, 4, index->dst_chunk_offset + 12 + 12);
+}
+
+/* Free a DST frame index */
+void sacd_internal_dst_index_free(sacd_dst_index_t *index) {
+    if (!index) {
+        return;
     }
     
-    /* Write channel IDs */
-    const char *channel_ids[] = { "SLFT", "SRGT", "C   ", "LFE ", "LS  ", "RS  " };
-    for (int i = 0; i < track->channel_count && i < 6; i++) {
-        if (fwrite(channel_ids[i], 1, 4, file) != 4) {
-            return SACD_RESULT_IO_ERROR;
+    free(index->frame_offsets);
+    free(index->frame_lengths);
+    memset(index, 0, sizeof(sacd_dst_index_t));
+}
+
+/*
+ * WAV layout: RIFF header, a 28-byte JUNK chunk reserved for ds64, the 40-byte
+ * WAVE_FORMAT_EXTENSIBLE fmt chunk and the data header. If the finished file
+ * outgrows 32-bit sizes, RIFF/JUNK become RF64/ds64 in place (EBU Tech 3306),
+ * so the audio is still written in a single pass.
+ */
+#define WAV_HEADER_SIZE      104
+#define WAV_DS64_OFFSET      12
+#define WAV_FMT_OFFSET       48
+#define WAV_DATA_SIZE_OFFSET 100
+
+/* Sony Wave64: GUID chunk IDs and 64-bit sizes; chunks are 8-byte aligned */
+#define W64_HEADER_SIZE      128
+#define W64_DATA_SIZE_OFFSET 120
+
+static const uint8_t w64_guid_riff[16] = {
+    'r', 'i', 'f', 'f', 0x2E, 0x91, 0xCF, 0x11, 0xA5, 0xD6, 0x28, 0xDB, 0x04, 0xC1, 0x00, 0x00
+};
+static const uint8_t w64_guid_wave[16] = {
+    'w', 'a', 'v', 'e', 0xF3, 0xAC, 0xD3, 0x11, 0x8C, 0xD1, 0x00, 0xC0, 0x4F, 0x8E, 0xDB, 0x8A
+};
+static const uint8_t w64_guid_fmt[16] = {
+    'f', 'm', 't', ' ', 0xF3, 0xAC, 0xD3, 0x11, 0x8C, 0xD1, 0x00, 0xC0, 0x4F, 0x8E, 0xDB, 0x8A
+};
+static const uint8_t w64_guid_data[16] = {
+    'd', 'a', 't', 'a', 0xF3, 0xAC, 0xD3, 0x11, 0x8C, 0xD1, 0x00, 0xC0, 0x4F, 0x8E, 0xDB, 0x8A
+};
+
+/* KSDATAFORMAT_SUBTYPE_PCM / _IEEE_FLOAT share all but the first two bytes */
+static const uint8_t wav_subformat_tail[14] = {
+    0x00, 0x00, 0x00, 0x00, 0x10, 0x00, 0x80, 0x00,
+    0x00, 0xAA, 0x00, 0x38, 0x9B, 0x71
+};
+
+/* Speaker mask in SACD channel order (L, R, C, LFE, LS, RS) */
+static uint32_t wav_channel_mask(int channel_count) {
+    switch (channel_count) {
+        case 1:  return 0x4;   /* C */
+        case 2:  return 0x3;   /* L R */
+        case 3:  return 0x7;   /* L R C */
+        case 4:  return 0x33;  /* L R LS RS */
+        case 5:  return 0x37;  /* L R C LS RS */
+        case 6:  return 0x3F;  /* L R C LFE LS RS */
+        default: return 0;
+    }
+}
+
+/* WAVE_FORMAT_EXTENSIBLE body, shared by RIFF/RF64 and Wave64 */
+static void write_wav_fmt(uint8_t fmt[40], int channel_count, uint32_t sample_rate,
+                          sacd_pcm_sample_format_t sample_format) {
+    uint16_t channels = (uint16_t)channel_count;
+    uint16_t bits = (sample_format == SACD_PCM_F32) ? 32 : 24;
+    uint16_t block_align = channels * (bits / 8);
+
+    write_le16(fmt, 0xFFFE);                         /* WAVE_FORMAT_EXTENSIBLE */
+    write_le16(fmt + 2, channels);
+    write_le32(fmt + 4, sample_rate);
+    write_le32(fmt + 8, sample_rate * block_align);  /* Byte rate */
+    write_le16(fmt + 12, block_align);
+    write_le16(fmt + 14, bits);
+    write_le16(fmt + 16, 22);                        /* Extension size */
+    write_le16(fmt + 18, bits);                      /* Valid bits */
+    write_le32(fmt + 20, wav_channel_mask(channels));
+    write_le16(fmt + 24, (sample_format == SACD_PCM_F32) ? 3 : 1);
+    memcpy(fmt + 26, wav_subformat_tail, sizeof(wav_subformat_tail));
+}
+
+/* Write WAV or Wave64 file header */
+sacd_result_t sacd_internal_write_pcm_header(
+    sacd_sink_t *sink,
+    sacd_output_format_t format,
+    const sacd_track_t *track,
+    uint32_t sample_rate,
+    sacd_pcm_sample_format_t sample_format,
+    uint64_t audio_data_size) {
+    
+    if (!sink || !track || track->channel_count <= 0) {
+        return SACD_RESULT_ERROR;
+    }
+    
+    uint8_t header[W64_HEADER_SIZE];
+    size_t header_size;
+    memset(header, 0, sizeof(header));
+    
+    if (format == SACD_FORMAT_W64) {
+        header_size = W64_HEADER_SIZE;
+        memcpy(header, w64_guid_riff, 16);
+        write_le64(header + 16, W64_HEADER_SIZE + ((audio_data_size + 7) & ~(uint64_t)7));
+        memcpy(header + 24, w64_guid_wave, 16);
+        memcpy(header + 40, w64_guid_fmt, 16);
+        write_le64(header + 56, 24 + 40);
+        write_wav_fmt(header + 64, track->channel_count, sample_rate, sample_format);
+        memcpy(header + 104, w64_guid_data, 16);
+        write_le64(header + W64_DATA_SIZE_OFFSET, 24 + audio_data_size);
+    } else {
+        uint64_t riff_size = (WAV_HEADER_SIZE - 8) + audio_data_size + (audio_data_size & 1);
+        header_size = WAV_HEADER_SIZE;
+        memcpy(header + 8, "WAVE", 4);
+        memcpy(header + WAV_FMT_OFFSET, "fmt ", 4);
+        write_le32(header + WAV_FMT_OFFSET + 4, 40);
+        write_wav_fmt(header + WAV_FMT_OFFSET + 8, track->channel_count, sample_rate, sample_format);
+        memcpy(header + 96, "data", 4);
+        
+        if (!sink->pwrite && riff_size > 0xFFFFFFFFu) {
+            /* Can't promote later, so this stream is RF64 from the start */
+            int block_align = track->channel_count * ((sample_format == SACD_PCM_F32) ? 4 : 3);
+            memcpy(header, "RF64", 4);
+            write_le32(header + 4, 0xFFFFFFFFu);
+            memcpy(header + WAV_DS64_OFFSET, "ds64", 4);
+            write_le32(header + WAV_DS64_OFFSET + 4, 28);
+            write_le64(header + WAV_DS64_OFFSET + 8, riff_size);
+            write_le64(header + WAV_DS64_OFFSET + 16, audio_data_size);
+            write_le64(header + WAV_DS64_OFFSET + 24, audio_data_size / block_align);
+            write_le32(header + WAV_FMT_OFFSET - 4, 0);
+            write_le32(header + WAV_DATA_SIZE_OFFSET, 0xFFFFFFFFu);
+        } else {
+            /* Sizes that don't fit yet are fixed up (or promoted) at finalize */
+            memcpy(header, "RIFF", 4);
+            write_le32(header + 4, riff_size > 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)riff_size);
+            memcpy(header + WAV_DS64_OFFSET, "JUNK", 4);
+            write_le32(header + WAV_DS64_OFFSET + 4, 28);
+            write_le32(header + WAV_DATA_SIZE_OFFSET,
+                       audio_data_size > 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)audio_data_size);
         }
     }
     
-    /* Write DSD data chunk header */
-    dsdiff_dsd_chunk_t dsd_chunk;
-    memcpy(dsd_chunk.signature, "DSD ", 4);
-    dsd_chunk.chunk_size = audio_data_size;
+    if (sink->write(sink, header, header_size) != SACD_RESULT_OK) {
+        return SACD_RESULT_IO_ERROR;
+    }
     
-    uint8_t dsd_buf[12];
-    memcpy(dsd_buf, dsd_chunk.signature, 4);
-    write_be64(dsd_buf + 4, dsd_chunk.chunk_size);
+    return SACD_RESULT_OK;
+}
+
+/* Patch WAV/Wave64 sizes at the end of the stream, promoting WAV to RF64 if needed */
+sacd_result_t sacd_internal_finalize_pcm_header(
+    sacd_sink_t *sink,
+    sacd_output_format_t format,
+    uint64_t audio_data_size,
+    int block_align) {
+    
+    if (!sink || block_align <= 0) {
+        return SACD_RESULT_ERROR;
+    }
     
-    if (fwrite(dsd_buf, 1, 12, file) != 12) {
+    /* Pad the data chunk: Wave64 chunks are 8-byte aligned, RIFF chunks word aligned */
+    static const uint8_t pad[8] = { 0 };
+    size_t padding = (format == SACD_FORMAT_W64) ? (size_t)((8 - (sink->position & 7)) & 7)
+                                                 : (size_t)(audio_data_size & 1);
+    if (padding > 0 && sink->write(sink, pad, padding) != SACD_RESULT_OK) {
         return SACD_RESULT_IO_ERROR;
     }
     
+    /* Without seeking, the header was written with the final sizes */
+    if (!sink->pwrite) {
+        return SACD_RESULT_OK;
+    }
+    
+    uint64_t file_size = sink->position;
+    uint8_t buf[36];
+    
+    if (format == SACD_FORMAT_W64) {
+        write_le64(buf, file_size);
+        SACD_CHECK_RESULT(sink->pwrite(sink, buf, 8, 16));
+        write_le64(buf, 24 + audio_data_size);
+        SACD_CHECK_RESULT(sink->pwrite(sink, buf, 8, W64_DATA_SIZE_OFFSET));
+    } else if (file_size - 8 > 0xFFFFFFFFu || audio_data_size > 0xFFFFFFFFu) {
+        /* RF64: 32-bit sizes are -1, real sizes live in ds64 */
+        memcpy(buf, "RF64", 4);
+        write_le32(buf + 4, 0xFFFFFFFFu);
+        SACD_CHECK_RESULT(sink->pwrite(sink, buf, 8, 0));
+        
+        memcpy(buf, "ds64", 4);
+        write_le32(buf + 4, 28);
+        write_le64(buf + 8, file_size - 8);                      /* RIFF size */
+        write_le64(buf + 16, audio_data_size);                   /* data size */
+        write_le64(buf + 24, audio_data_size / block_align);     /* Sample frames */
+        write_le32(buf + 32, 0);                                 /* No table entries */
+        SACD_CHECK_RESULT(sink->pwrite(sink, buf, 36, WAV_DS64_OFFSET));
+        
+        write_le32(buf, 0xFFFFFFFFu);
+        SACD_CHECK_RESULT(sink->pwrite(sink, buf, 4, WAV_DATA_SIZE_OFFSET));
+    } else {
+        write_le32(buf, (uint32_t)(file_size - 8));
+        SACD_CHECK_RESULT(sink->pwrite(sink, buf, 4, 4));
+        write_le32(buf, (uint32_t)audio_data_size);
+        SACD_CHECK_RESULT(sink->pwrite(sink, buf, 4, WAV_DATA_SIZE_OFFSET));
+    }
+    
     return SACD_RESULT_OK;
 }
 
 /* Finalize file headers with actual sizes */
 sacd_result_t sacd_internal_finalize_file_headers(
-    FILE *file,
+    sacd_sink_t *sink,
     sacd_output_format_t format,
-    size_t audio_data_size) {
+    size_t audio_data_size,
+    int channel_count) {
     
-    if (!file) {
+    if (!sink) {
         return SACD_RESULT_ERROR;
     }
     
-    /* Get current position */
-    long current_pos = ftell(file);
-    if (current_pos < 0) {
-        return SACD_RESULT_IO_ERROR;
+    /* Without seeking, the header was written with the final sizes */
+    if (!sink->pwrite) {
+        return SACD_RESULT_OK;
     }
     
+    uint64_t current_pos = sink->position;
+    
     if (format == SACD_FORMAT_DSF) {
         /* Update DSF file size in header */
-        if (fseek(file, 12, SEEK_SET) != 0) {
-            return SACD_RESULT_IO_ERROR;
-        }
-        
         uint64_t file_size = current_pos;
         uint8_t size_buf[8];
         write_le64(size_buf, file_size);
         
-        if (fwrite(size_buf, 1, 8, file) != 8) {
+        if (sink->pwrite(sink, size_buf, 8, 12) != SACD_RESULT_OK) {
             return SACD_RESULT_IO_ERROR;
         }
         
         /* Update data chunk size */
-        if (fseek(file, 80 + 4, SEEK_SET) != 0) {
+        uint64_t data_chunk_size = 12 + audio_data_size;
+        write_le64(size_buf, data_chunk_size);
+        
+        if (sink->pwrite(sink, size_buf, 8, 80 + 4) != SACD_RESULT_OK) {
             return SACD_RESULT_IO_ERROR;
         }
         
-        uint64_t data_chunk_size = 12 + audio_data_size;
-        write_le64(size_buf, data_chunk_size);
+        /* Update the fmt chunk's sample count: pauses, ranges and trimming change it */
+        uint64_t sample_count = channel_count > 0 ? (uint64_t)audio_data_size / channel_count * 8 : 0;
+        write_le64(size_buf, sample_count);
         
-        if (fwrite(size_buf, 1, 8, file) != 8) {
+        if (sink->pwrite(sink, size_buf, 8, 28 + 36) != SACD_RESULT_OK) {
             return SACD_RESULT_IO_ERROR;
         }
     } else if (format == SACD_FORMAT_DSDIFF || format == SACD_FORMAT_DSDIFF_EM) {
         /* Update DSDIFF form chunk size */
-        if (fseek(file, 4, SEEK_SET) != 0) {
-            return SACD_RESULT_IO_ERROR;
-        }
-        
         uint64_t form_size = current_pos - 12; /* Exclude FORM header itself */
         uint8_t size_buf[8];
         write_be64(size_buf, form_size);
         
-        if (fwrite(size_buf, 1, 8, file) != 8) {
+        if (sink->pwrite(sink, size_buf, 8, 4) != SACD_RESULT_OK) {
+            return SACD_RESULT_IO_ERROR;
+        }
+        
+        /* Update DSD sound data chunk size; the audio ends the file */
+        write_be64(size_buf, audio_data_size);
+        
+        if (sink->pwrite(sink, size_buf, 8, current_pos - audio_data_size - 8) != SACD_RESULT_OK) {
             return SACD_RESULT_IO_ERROR;
         }
-    }
-    
-    /* Restore file position */
-    if (fseek(file, current_pos, SEEK_SET) != 0) {
-        return SACD_RESULT_IO_ERROR;
     }
     
     return SACD_RESULT_OK;
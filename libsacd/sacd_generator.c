@@ -0,0 +1,677 @@
+/**
+ * SACD Library - Synthetic Disc Images
+ *
+ * Image layout (LSNs):
+ *
+ *   0 - 509     empty (file system / lead-in on a real disc)
+ *   510 - 519   Master TOC: SACDMTOC, SACDText (one text channel), SACD_Man
+ *   520 - 539   two copies of the Master TOC
+ *   540 -       per area: Area TOC-1, audio sectors, Area TOC-2
+ *
+ * Area TOC: header, SACDTRL1 (track LSNs), SACDTRL2 (track times),
+ * SACD_IGL (ISRCs and genres, 2 sectors), SACDTTxt (track text).
+ *
+ * Audio sectors carry a header byte, packet info, frame info and packet
+ * payloads. Plain DSD frames (4704 bytes per channel, byte interleaved) are
+ * laid out three to a group of 14 or 16 sectors; DST frames are packed back
+ * to back and stored as uncompressed DST frames (a zero header byte followed
+ * by the DSD), which any DST decoder accepts.
+ */
+
+#include "sacd_generator.h"
+#include "sacd_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+
+#define GEN_MASTER_TOC_LSN     510
+#define GEN_MASTER_TOC_SIZE    10
+#define GEN_MASTER_TOC_COPIES  3
+#define GEN_AREA_START_LSN     (GEN_MASTER_TOC_LSN + GEN_MASTER_TOC_SIZE * GEN_MASTER_TOC_COPIES)
+#define GEN_FRAME_BYTES        (SACD_SAMPLING_FREQ / SACD_FRAME_RATE / 8)  /* Per channel */
+#define GEN_MAX_PACKETS        7
+#define GEN_MAX_PACKET_LENGTH  2047
+#define GEN_DSD_GROUP_FRAMES   3
+#define GEN_IGL_SECTORS        2
+#define GEN_DSD_SILENCE        0x69
+
+/* ---- Deterministic random numbers (splitmix64) ---- */
+
+static uint64_t next_random(uint64_t *state) {
+    uint64_t z = (*state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static void put_be16(uint8_t *data, uint16_t value) {
+    data[0] = (value >> 8) & 0xFF;
+    data[1] = value & 0xFF;
+}
+
+static void put_be32(uint8_t *data, uint32_t value) {
+    data[0] = (value >> 24) & 0xFF;
+    data[1] = (value >> 16) & 0xFF;
+    data[2] = (value >> 8) & 0xFF;
+    data[3] = value & 0xFF;
+}
+
+/* Frame count as minutes/seconds/frames */
+static void put_time(uint8_t *data, uint32_t frames) {
+    data[0] = (uint8_t)(frames / (SACD_FRAME_RATE * 60));
+    data[1] = (uint8_t)((frames / SACD_FRAME_RATE) % 60);
+    data[2] = (uint8_t)(frames % SACD_FRAME_RATE);
+}
+
+/* Append a NUL-terminated string to a text sector; returns its position (0 = none) */
+static uint16_t put_text(uint8_t *data, size_t capacity, size_t *used, const char *text) {
+    if (!text || !*text) {
+        return 0;
+    }
+    size_t length = strlen(text) + 1;
+    if (*used + length > capacity) {
+        return 0;
+    }
+    uint16_t position = (uint16_t)*used;
+    memcpy(data + *used, text, length);
+    *used += length;
+    return position;
+}
+
+/* ---- Image output ---- */
+
+typedef struct {
+    FILE *file;
+    uint8_t *buffer;
+    uint32_t lsn;            /* Next sector written sequentially */
+    bool failed;
+} image_t;
+
+static void write_sector(image_t *image, const uint8_t *sector) {
+    if (!image->failed && fwrite(sector, 1, SACD_LSN_SIZE, image->file) != SACD_LSN_SIZE) {
+        image->failed = true;
+    }
+    image->lsn++;
+}
+
+/* Write sectors somewhere already reserved, then continue where we were */
+static void write_sectors_at(image_t *image, uint32_t lsn, const uint8_t *data, uint32_t count) {
+    off_t resume = (off_t)image->lsn * SACD_LSN_SIZE;
+    if (image->failed ||
+        fseeko(image->file, (off_t)lsn * SACD_LSN_SIZE, SEEK_SET) != 0 ||
+        fwrite(data, SACD_LSN_SIZE, count, image->file) != count ||
+        fseeko(image->file, resume, SEEK_SET) != 0) {
+        image->failed = true;
+    }
+}
+
+/* ---- Audio sector packing ---- */
+
+typedef struct {
+    bool dst;
+    uint8_t packet_info[GEN_MAX_PACKETS][2];
+    int packet_count;
+    uint8_t frame_info[GEN_MAX_PACKETS][4];
+    int frame_count;
+    uint8_t payload[SACD_LSN_SIZE];
+    size_t payload_size;
+    uint32_t sectors;        /* Sectors emitted so far */
+    image_t *image;          /* NULL when only measuring */
+} packer_t;
+
+static size_t packer_used(const packer_t *packer) {
+    return 1 + 2 * (size_t)packer->packet_count +
+           (packer->dst ? 4 : 3) * (size_t)packer->frame_count + packer->payload_size;
+}
+
+static void packer_add_packet(packer_t *packer, bool frame_start, sacd_packet_type_t type,
+                              const uint8_t *data, size_t length) {
+    uint8_t *info = packer->packet_info[packer->packet_count++];
+    info[0] = (uint8_t)((frame_start ? 0x80 : 0) | (type << 3) | ((length >> 8) & 0x07));
+    info[1] = length & 0xFF;
+    if (data) {
+        memcpy(packer->payload + packer->payload_size, data, length);
+    } else if (type == SACD_PACKET_PADDING) {
+        memset(packer->payload + packer->payload_size, 0, length);
+    }
+    packer->payload_size += length;
+}
+
+/* Close the current sector, padding it out, and write it */
+static void packer_emit(packer_t *packer) {
+    size_t space = SACD_LSN_SIZE - packer_used(packer);
+    if (packer->packet_count < GEN_MAX_PACKETS && space > 2) {
+        size_t length = space - 2;
+        packer_add_packet(packer, false, SACD_PACKET_PADDING, NULL,
+                          length > GEN_MAX_PACKET_LENGTH ? GEN_MAX_PACKET_LENGTH : length);
+    }
+
+    if (packer->image) {
+        uint8_t sector[SACD_LSN_SIZE];
+        memset(sector, 0, sizeof(sector));
+        sector[0] = (uint8_t)((packer->packet_count << 5) | (packer->frame_count << 2) | (packer->dst ? 1 : 0));
+        size_t offset = 1;
+        for (int i = 0; i < packer->packet_count; i++) {
+            memcpy(sector + offset, packer->packet_info[i], 2);
+            offset += 2;
+        }
+        for (int i = 0; i < packer->frame_count; i++) {
+            memcpy(sector + offset, packer->frame_info[i], packer->dst ? 4 : 3);
+            offset += packer->dst ? 4 : 3;
+        }
+        memcpy(sector + offset, packer->payload, packer->payload_size);
+        write_sector(packer->image, sector);
+    }
+
+    packer->packet_count = 0;
+    packer->frame_count = 0;
+    packer->payload_size = 0;
+    packer->sectors++;
+}
+
+/* Split a frame into packets; returns the number of sectors it touches */
+static uint32_t packer_add_frame(packer_t *packer, const uint8_t *frame, size_t size,
+                                 uint32_t timecode, uint32_t sector_count) {
+    size_t frame_info_size = packer->dst ? 4 : 3;
+    uint32_t first_sector = 0;
+    size_t offset = 0;
+
+    while (offset < size) {
+        bool start = (offset == 0);
+        size_t overhead = 2 + (start ? frame_info_size : 0);
+        size_t used = packer_used(packer);
+
+        if (packer->packet_count == GEN_MAX_PACKETS ||
+            (start && packer->frame_count == GEN_MAX_PACKETS) ||
+            used + overhead >= SACD_LSN_SIZE) {
+            packer_emit(packer);
+            used = packer_used(packer);
+        }
+
+        size_t length = SACD_LSN_SIZE - used - overhead;
+        if (length > size - offset) {
+            length = size - offset;
+        }
+        if (length > GEN_MAX_PACKET_LENGTH) {
+            length = GEN_MAX_PACKET_LENGTH;
+        }
+
+        if (start) {
+            first_sector = packer->sectors;
+            uint8_t *info = packer->frame_info[packer->frame_count++];
+            put_time(info, timecode);
+            info[3] = (uint8_t)((sector_count & 0x1F) << 2);
+        }
+        packer_add_packet(packer, start, SACD_PACKET_AUDIO, frame ? frame + offset : NULL, length);
+        offset += length;
+    }
+
+    return packer->sectors - first_sector + 1;
+}
+
+/* ---- Audio content ---- */
+
+typedef struct {
+    double c, s;             /* Oscillator state (cos, sin) */
+    double cd, sd;           /* Rotation per sample */
+    double v1, v2;           /* Sigma-delta integrators */
+    double y;                /* Last output (+1 / -1) */
+    uint64_t random;
+} channel_generator_t;
+
+static void channel_generator_init(channel_generator_t *gen, uint64_t *seed) {
+    memset(gen, 0, sizeof(channel_generator_t));
+    gen->random = next_random(seed);
+
+    /* A note between A2 and A6, starting at a random phase */
+    double frequency = 110.0 * pow(2.0, (double)(next_random(seed) % 48) / 12.0);
+    double step = 2.0 * M_PI * frequency / SACD_SAMPLING_FREQ;
+    double phase = 2.0 * M_PI * (double)(next_random(seed) % 1024) / 1024.0;
+    gen->c = cos(phase);
+    gen->s = sin(phase);
+    gen->cd = cos(step);
+    gen->sd = sin(step);
+    gen->y = 1.0;
+}
+
+/* One channel's DSD for one frame, written every 'stride' bytes */
+static void generate_channel(channel_generator_t *gen, sacd_generator_content_t content,
+                             uint8_t *out, int stride) {
+    if (content == SACD_GENERATOR_SILENCE) {
+        for (int i = 0; i < GEN_FRAME_BYTES; i++) {
+            out[i * stride] = GEN_DSD_SILENCE;
+        }
+        return;
+    }
+
+    if (content == SACD_GENERATOR_NOISE) {
+        for (int i = 0; i < GEN_FRAME_BYTES; i += 8) {
+            uint64_t bits = next_random(&gen->random);
+            for (int b = 0; b < 8 && i + b < GEN_FRAME_BYTES; b++) {
+                out[(i + b) * stride] = (uint8_t)(bits >> (8 * b));
+            }
+        }
+        return;
+    }
+
+    /* Second-order sigma-delta of a -6 dB tone, MSB first */
+    for (int i = 0; i < GEN_FRAME_BYTES; i++) {
+        uint8_t byte = 0;
+        for (int b = 0; b < 8; b++) {
+            double x = 0.5 * gen->s;
+            double s = gen->s * gen->cd + gen->c * gen->sd;
+            gen->c = gen->c * gen->cd - gen->s * gen->sd;
+            gen->s = s;
+
+            gen->v1 += x - gen->y;
+            gen->v2 += gen->v1 - gen->y;
+            gen->y = (gen->v2 >= 0.0) ? 1.0 : -1.0;
+            byte = (uint8_t)((byte << 1) | (gen->y > 0.0));
+        }
+        out[i * stride] = byte;
+    }
+
+    /* Keep the oscillator on the unit circle */
+    double norm = 1.0 / sqrt(gen->c * gen->c + gen->s * gen->s);
+    gen->c *= norm;
+    gen->s *= norm;
+}
+
+/* ---- Disc structure ---- */
+
+typedef struct {
+    uint32_t toc1_lsn;
+    uint32_t toc2_lsn;
+    uint16_t toc_size;
+    uint16_t text_sectors;
+    uint32_t track_start[SACD_MAX_TRACKS];
+    uint32_t track_length[SACD_MAX_TRACKS];
+    uint32_t track_frames;   /* Per track, after rounding to whole DSD groups */
+    uint32_t pause_frames;   /* Before each track but the first, likewise rounded */
+    uint32_t audio_start;
+    uint32_t audio_end;      /* Last audio sector */
+} area_layout_t;
+
+static const char *track_title(const sacd_generator_options_t *options, int track, char *buffer, size_t size) {
+    if (options->track_titles && options->track_titles[track]) {
+        return options->track_titles[track];
+    }
+    snprintf(buffer, size, "Track %02d", track + 1);
+    return buffer;
+}
+
+/* SACDTTxt: per-track positions, then count/reserved and (type, 0x20, string) items */
+static size_t build_track_text(const sacd_generator_options_t *options, const sacd_generator_area_t *area,
+                               uint8_t *text, size_t capacity) {
+    memcpy(text, "SACDTTxt", 8);
+    size_t used = 8 + 2 * SACD_MAX_TRACKS;
+
+    for (int t = 0; t < area->track_count; t++) {
+        char buffer[32];
+        const char *items[2] = { track_title(options, t, buffer, sizeof(buffer)), options->album_artist };
+        int item_count = (items[1] && *items[1]) ? 2 : 1;
+
+        used = (used + 3) & ~(size_t)3;
+        size_t needed = 4;
+        for (int i = 0; i < item_count; i++) {
+            needed += 2 + strlen(items[i]) + 1;
+        }
+        if (used + needed > capacity) {
+            break;
+        }
+
+        put_be16(text + 8 + 2 * t, (uint16_t)used);
+        text[used] = (uint8_t)item_count;
+        used += 4;
+        for (int i = 0; i < item_count; i++) {
+            text[used++] = (uint8_t)(i + 1);   /* 1 = title, 2 = performer */
+            text[used++] = 0x20;
+            size_t length = strlen(items[i]) + 1;
+            memcpy(text + used, items[i], length);
+            used += length;
+        }
+    }
+
+    return used;
+}
+
+/* Area TOC sectors: header, track lists, ISRC/genre list, track text */
+static void build_area_toc(const sacd_generator_options_t *options, const sacd_generator_area_t *area,
+                           const area_layout_t *layout, uint64_t seed, uint8_t *toc) {
+    memset(toc, 0, (size_t)layout->toc_size * SACD_LSN_SIZE);
+
+    uint8_t *header = toc;
+    memcpy(header, area->channel_count > 2 ? "MULCHTOC" : "TWOCHTOC", 8);
+    header[8] = 1;                                         /* Version 1.20 */
+    header[9] = 20;
+    put_be16(header + 10, layout->toc_size);
+    put_be32(header + 16, (uint32_t)area->channel_count * (SACD_SAMPLING_FREQ / 8));  /* Max byte rate */
+    header[20] = 4;                                        /* 64 x 44.1 kHz */
+    header[21] = (area->frame_format == SACD_FRAME_DST) ? 0 :
+                 (area->frame_format == SACD_FRAME_DSD_3_IN_14) ? 2 : 3;
+    header[32] = (uint8_t)area->channel_count;
+    header[33] = (uint8_t)((area->channel_count == 5 ? 3 : area->channel_count == 6 ? 4 : 0) << 3);
+    header[34] = (uint8_t)area->channel_count;
+    put_time(header + 64, layout->track_frames * area->track_count +
+                          layout->pause_frames * (area->track_count - 1));  /* Total play time */
+    header[68] = 0;                                        /* Track offset */
+    header[69] = (uint8_t)area->track_count;
+    put_be32(header + 72, layout->audio_start);
+    put_be32(header + 76, layout->audio_end);
+    header[80] = 1;                                        /* Text channels */
+    memcpy(header + 88, "en", 2);
+    header[90] = SACD_CHARSET_ISO646;
+    put_be16(header + 128, (uint16_t)(3 + GEN_IGL_SECTORS));  /* Track text, in sectors */
+
+    uint8_t *trl1 = toc + SACD_LSN_SIZE;
+    memcpy(trl1, "SACDTRL1", 8);
+    for (int t = 0; t < area->track_count; t++) {
+        put_be32(trl1 + 8 + t * 4, layout->track_start[t]);
+        put_be32(trl1 + 8 + (SACD_MAX_TRACKS + t) * 4, layout->track_length[t]);
+    }
+
+    uint8_t *trl2 = toc + 2 * SACD_LSN_SIZE;
+    memcpy(trl2, "SACDTRL2", 8);
+    for (int t = 0; t < area->track_count; t++) {
+        put_time(trl2 + 8 + t * 4, (layout->track_frames + layout->pause_frames) * t);
+        put_time(trl2 + 8 + (SACD_MAX_TRACKS + t) * 4, layout->track_frames);
+    }
+
+    /* ISRC: country, owner, year, designation */
+    uint8_t *igl = toc + 3 * SACD_LSN_SIZE;
+    memcpy(igl, "SACD_IGL", 8);
+    uint32_t designation = (uint32_t)(seed % 900) * 100;
+    for (int t = 0; t < area->track_count; t++) {
+        char isrc[13];
+        snprintf(isrc, sizeof(isrc), "ZZSYN%02u%05u", options->year % 100u, (designation + t) % 100000u);
+        memcpy(igl + 8 + t * 12, isrc, 12);
+    }
+
+    build_track_text(options, area, toc + (3 + GEN_IGL_SECTORS) * SACD_LSN_SIZE,
+                     (size_t)layout->text_sectors * SACD_LSN_SIZE);
+}
+
+/* Master TOC: SACDMTOC, SACDText and SACD_Man */
+static void build_master_toc(const sacd_generator_options_t *options, const area_layout_t *layouts,
+                             uint8_t *toc) {
+    memset(toc, 0, GEN_MASTER_TOC_SIZE * SACD_LSN_SIZE);
+
+    uint8_t *mtoc = toc;
+    memcpy(mtoc, "SACDMTOC", 8);
+    mtoc[8] = 1;                                           /* Version 1.20 */
+    mtoc[9] = 20;
+    put_be16(mtoc + 16, 1);                                /* Album set size */
+    put_be16(mtoc + 18, 1);                                /* Sequence number */
+    if (options->catalog_number && *options->catalog_number) {
+        char catalog[17];
+        snprintf(catalog, sizeof(catalog), "%-16s", options->catalog_number);
+        memcpy(mtoc + 24, catalog, 16);                    /* Album */
+        memcpy(mtoc + 88, catalog, 16);                    /* Disc */
+    }
+    for (int a = 0; a < SACD_MAX_AREAS; a++) {
+        if (!options->areas[a].present) {
+            continue;
+        }
+        put_be32(mtoc + 64 + a * 8, layouts[a].toc1_lsn);
+        put_be32(mtoc + 68 + a * 8, layouts[a].toc2_lsn);
+        put_be16(mtoc + 84 + a * 2, layouts[a].toc_size);
+    }
+    mtoc[80] = options->hybrid ? 0x80 : 0x00;
+    put_be16(mtoc + 120, options->year);
+    mtoc[122] = options->month;
+    mtoc[123] = options->day;
+    mtoc[128] = 1;                                         /* Text channels */
+    memcpy(mtoc + 136, "en", 2);
+    mtoc[138] = SACD_CHARSET_ISO646;
+
+    /* Text positions are offsets within the sector; 0 means absent */
+    uint8_t *text = toc + SACD_LSN_SIZE;
+    size_t used = 64;
+    memcpy(text, "SACDText", 8);
+    put_be16(text + 16, put_text(text, SACD_LSN_SIZE, &used, options->album_title));
+    put_be16(text + 18, put_text(text, SACD_LSN_SIZE, &used, options->album_artist));
+    put_be16(text + 20, put_text(text, SACD_LSN_SIZE, &used, options->album_publisher));
+    put_be16(text + 22, put_text(text, SACD_LSN_SIZE, &used, options->album_copyright));
+    memcpy(text + 32, text + 16, 8);                       /* Disc text = album text */
+
+    memcpy(toc + (GEN_MASTER_TOC_SIZE - 1) * SACD_LSN_SIZE, "SACD_Man", 8);
+}
+
+/* Lay out an area's TOC; track positions are filled in as audio is written */
+static void plan_area(const sacd_generator_options_t *options, const sacd_generator_area_t *area,
+                      uint32_t start_lsn, area_layout_t *layout) {
+    memset(layout, 0, sizeof(area_layout_t));
+
+    uint8_t *text = calloc(1, 64 * SACD_LSN_SIZE);
+    size_t text_size = text ? build_track_text(options, area, text, 64 * SACD_LSN_SIZE) : SACD_LSN_SIZE;
+    free(text);
+
+    layout->text_sectors = (uint16_t)((text_size + SACD_LSN_SIZE - 1) / SACD_LSN_SIZE);
+    layout->toc_size = (uint16_t)(3 + GEN_IGL_SECTORS + layout->text_sectors);
+    layout->toc1_lsn = start_lsn;
+    layout->audio_start = start_lsn + layout->toc_size;
+
+    /* Plain DSD tracks and pauses hold whole groups of three frames */
+    layout->track_frames = area->track_frames;
+    layout->pause_frames = area->pause_frames;
+    if (area->frame_format != SACD_FRAME_DST) {
+        layout->track_frames = (layout->track_frames + GEN_DSD_GROUP_FRAMES - 1) /
+                               GEN_DSD_GROUP_FRAMES * GEN_DSD_GROUP_FRAMES;
+        layout->pause_frames = (layout->pause_frames + GEN_DSD_GROUP_FRAMES - 1) /
+                               GEN_DSD_GROUP_FRAMES * GEN_DSD_GROUP_FRAMES;
+    }
+}
+
+/* Write an area's audio sectors and record where each track landed */
+static sacd_result_t write_area_audio(const sacd_generator_options_t *options, const sacd_generator_area_t *area,
+                                      int area_index, area_layout_t *layout, image_t *image) {
+    int channels = area->channel_count;
+    bool dst = (area->frame_format == SACD_FRAME_DST);
+    uint32_t group_sectors = (area->frame_format == SACD_FRAME_DSD_3_IN_14) ? 14 : 16;
+    size_t frame_size = (size_t)GEN_FRAME_BYTES * channels + (dst ? 1 : 0);
+
+    uint8_t *frame = malloc(frame_size);
+    packer_t *packer = calloc(1, sizeof(packer_t));
+    packer_t *probe = malloc(sizeof(packer_t));
+    channel_generator_t generators[SACD_PCM_MAX_CHANNELS];
+    if (!frame || !packer || !probe) {
+        free(frame);
+        free(packer);
+        free(probe);
+        return SACD_RESULT_OUT_OF_MEMORY;
+    }
+
+    /* Uncompressed DST frame: header byte 0, then the DSD */
+    uint8_t *audio = frame + (dst ? 1 : 0);
+    frame[0] = 0;
+
+    packer->dst = dst;
+    packer->image = image;
+    uint32_t timecode = 0;
+
+    for (int t = 0; t < area->track_count; t++) {
+        uint64_t seed = options->seed ^ ((uint64_t)(area_index + 1) << 56) ^ ((uint64_t)(t + 1) << 40);
+        for (int c = 0; c < channels; c++) {
+            channel_generator_init(&generators[c], &seed);
+        }
+
+        uint32_t group_start = packer->sectors;
+
+        /* A pause of silence runs straight into the track, sharing sectors with it */
+        uint32_t pause = (t > 0) ? layout->pause_frames : 0;
+        for (uint32_t f = 0; f < pause + layout->track_frames; f++) {
+            for (int c = 0; c < channels; c++) {
+                generate_channel(&generators[c], f < pause ? SACD_GENERATOR_SILENCE : options->content,
+                                 audio + c, channels);
+            }
+
+            uint32_t sector_count = 0;
+            if (dst) {
+                *probe = *packer;
+                probe->image = NULL;
+                sector_count = packer_add_frame(probe, NULL, frame_size, timecode, 0);
+            }
+            uint32_t sectors = packer->sectors;
+            uint32_t lsn = image->lsn;
+            uint32_t touched = packer_add_frame(packer, frame, frame_size, timecode, sector_count);
+            if (f == pause) {
+                /* The track starts in the sector holding its first frame's start */
+                layout->track_start[t] = lsn + (packer->sectors - touched + 1 - sectors);
+            }
+            timecode++;
+
+            /* Each group of DSD frames fills exactly its sectors */
+            if (!dst && (f + 1) % GEN_DSD_GROUP_FRAMES == 0) {
+                packer_emit(packer);
+                while (packer->sectors - group_start < group_sectors) {
+                    packer_emit(packer);
+                }
+                group_start = packer->sectors;
+            }
+        }
+
+        if (packer->packet_count > 0) {
+            packer_emit(packer);
+        }
+        layout->track_length[t] = image->lsn - layout->track_start[t];
+    }
+
+    layout->audio_end = image->lsn - 1;
+
+    free(frame);
+    free(packer);
+    free(probe);
+    return image->failed ? SACD_RESULT_IO_ERROR : SACD_RESULT_OK;
+}
+
+/* Initialize default generator options */
+void sacd_generator_options_init(sacd_generator_options_t *options) {
+    if (!options) {
+        return;
+    }
+
+    memset(options, 0, sizeof(sacd_generator_options_t));
+    options->seed = 1;
+    options->content = SACD_GENERATOR_SINE;
+    options->areas[0].present = true;
+    options->areas[0].channel_count = 2;
+    options->areas[0].frame_format = SACD_FRAME_DSD_3_IN_14;
+    options->areas[0].track_count = 2;
+    options->areas[0].track_frames = 10 * SACD_FRAME_RATE;
+    options->areas[1].channel_count = 6;
+    options->areas[1].frame_format = SACD_FRAME_DST;
+    options->areas[1].track_count = 2;
+    options->areas[1].track_frames = 10 * SACD_FRAME_RATE;
+    options->album_title = "Synthetic Album";
+    options->album_artist = "libsacd";
+    options->year = 2024;
+    options->month = 1;
+    options->day = 1;
+}
+
+/* Write a synthetic SACD image */
+sacd_result_t sacd_generator_write_iso(const char *path, const sacd_generator_options_t *options) {
+    if (!path || !options) {
+        return SACD_RESULT_ERROR;
+    }
+
+    bool any_area = false;
+    for (int a = 0; a < SACD_MAX_AREAS; a++) {
+        const sacd_generator_area_t *area = &options->areas[a];
+        if (!area->present) {
+            continue;
+        }
+        any_area = true;
+        if (area->track_count < 1 || area->track_count > SACD_MAX_TRACKS || area->track_frames == 0 ||
+            area->channel_count < 1 || area->channel_count > SACD_PCM_MAX_CHANNELS ||
+            (area->frame_format != SACD_FRAME_DST && area->channel_count != 2)) {
+            return SACD_RESULT_INVALID_AREA;
+        }
+    }
+    if (!any_area) {
+        return SACD_RESULT_INVALID_AREA;
+    }
+
+    image_t image;
+    memset(&image, 0, sizeof(image));
+    image.file = fopen(path, "wb");
+    if (!image.file) {
+        return SACD_RESULT_IO_ERROR;
+    }
+    if (posix_memalign((void**)&image.buffer, 4096, SACD_OUTPUT_BUFFER_SIZE) == 0) {
+        setvbuf(image.file, (char*)image.buffer, _IOFBF, SACD_OUTPUT_BUFFER_SIZE);
+    } else {
+        image.buffer = NULL;
+    }
+
+    sacd_result_t result = SACD_RESULT_OK;
+    area_layout_t layouts[SACD_MAX_AREAS];
+    memset(layouts, 0, sizeof(layouts));
+    uint8_t *toc = NULL;
+
+    /* Everything before the first area TOC is written at the end */
+    image.lsn = GEN_AREA_START_LSN;
+    if (fseeko(image.file, (off_t)image.lsn * SACD_LSN_SIZE, SEEK_SET) != 0) {
+        result = SACD_RESULT_IO_ERROR;
+    }
+
+    for (int a = 0; a < SACD_MAX_AREAS && result == SACD_RESULT_OK; a++) {
+        const sacd_generator_area_t *area = &options->areas[a];
+        if (!area->present) {
+            continue;
+        }
+
+        area_layout_t *layout = &layouts[a];
+        plan_area(options, area, image.lsn, layout);
+
+        free(toc);
+        toc = malloc((size_t)layout->toc_size * SACD_LSN_SIZE);
+        if (!toc) {
+            result = SACD_RESULT_OUT_OF_MEMORY;
+            break;
+        }
+
+        /* TOC-1 space is reserved ahead of the audio and filled in afterwards */
+        image.lsn = layout->audio_start;
+        if (fseeko(image.file, (off_t)image.lsn * SACD_LSN_SIZE, SEEK_SET) != 0) {
+            result = SACD_RESULT_IO_ERROR;
+            break;
+        }
+
+        result = write_area_audio(options, area, a, layout, &image);
+        if (result != SACD_RESULT_OK) {
+            break;
+        }
+
+        layout->toc2_lsn = image.lsn;
+        build_area_toc(options, area, layout, options->seed, toc);
+        write_sectors_at(&image, layout->toc1_lsn, toc, layout->toc_size);
+        for (uint16_t i = 0; i < layout->toc_size; i++) {
+            write_sector(&image, toc + (size_t)i * SACD_LSN_SIZE);
+        }
+    }
+
+    if (result == SACD_RESULT_OK) {
+        free(toc);
+        toc = malloc(GEN_MASTER_TOC_SIZE * SACD_LSN_SIZE);
+        if (toc) {
+            build_master_toc(options, layouts, toc);
+            for (int copy = 0; copy < GEN_MASTER_TOC_COPIES; copy++) {
+                write_sectors_at(&image, GEN_MASTER_TOC_LSN + copy * GEN_MASTER_TOC_SIZE,
+                                 toc, GEN_MASTER_TOC_SIZE);
+            }
+        } else {
+            result = SACD_RESULT_OUT_OF_MEMORY;
+        }
+    }
+
+    free(toc);
+    if (fclose(image.file) != 0 || image.failed) {
+        if (result == SACD_RESULT_OK) {
+            result = SACD_RESULT_IO_ERROR;
+        }
+    }
+    free(image.buffer);
+    return result;
+}
@@ -0,0 +1,81 @@
+/**
+ * SACD Library - Synthetic Disc Images
+ *
+ * Writes SACD ISO images laid out as on a real disc (Scarlet Book master
+ * TOC, area TOCs, text, and audio sectors with packet and frame info), so
+ * the library can be exercised in tests and benchmarks without a commercial
+ * disc. The image is fully determined by the options, including the seed.
+ *
+ * Copyright (c) 2024
+ * Licensed under MIT License
+ */
+
+#ifndef SACD_GENERATOR_H
+#define SACD_GENERATOR_H
+
+#include "sacd_lib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Audio written into the generated tracks */
+typedef enum {
+    SACD_GENERATOR_SINE = 0,     /* Sigma-delta modulated tones (meaningful after PCM conversion) */
+    SACD_GENERATOR_NOISE,        /* Random bits (fastest to generate) */
+    SACD_GENERATOR_SILENCE       /* DSD idle pattern */
+} sacd_generator_content_t;
+
+/* One audio area */
+typedef struct {
+    bool present;                  /* Write this area */
+    int channel_count;             /* 2 for the stereo area, 5 or 6 for multichannel */
+    sacd_frame_format_t frame_format; /* Plain DSD (stereo only) or DST */
+    int track_count;               /* 1..SACD_MAX_TRACKS */
+    uint32_t track_frames;         /* Length of each track in frames (1/75 s) */
+    uint32_t pause_frames;         /* Silence before each track but the first, in frames */
+} sacd_generator_area_t;
+
+/* Generator options */
+typedef struct {
+    uint64_t seed;                 /* Determines tones, noise and ISRCs */
+    sacd_generator_content_t content;
+    sacd_generator_area_t areas[SACD_MAX_AREAS]; /* [0] stereo, [1] multichannel */
+    bool hybrid;                   /* Flag the disc as hybrid (CD layer) */
+
+    /* Text (ISO 646) */
+    const char *album_title;
+    const char *album_artist;
+    const char *album_publisher;
+    const char *album_copyright;
+    const char *catalog_number;    /* Up to 16 characters */
+    const char *const *track_titles; /* Per track, or NULL for "Track NN" */
+
+    uint16_t year;                 /* Disc date */
+    uint8_t month;
+    uint8_t day;
+} sacd_generator_options_t;
+
+/**
+ * Initialize default generator options: one stereo DSD 3-in-14 area with
+ * two 10-second tracks of tones, seed 1
+ *
+ * @param options Pointer to options structure to initialize
+ */
+void sacd_generator_options_init(sacd_generator_options_t *options);
+
+/**
+ * Write a synthetic SACD image
+ *
+ * @param path ISO file to create (truncated if it exists)
+ * @param options Generator options
+ * @return SACD_RESULT_OK on success, SACD_RESULT_INVALID_AREA if an area
+ *         can't be represented (e.g. plain DSD with more than 2 channels)
+ */
+sacd_result_t sacd_generator_write_iso(const char *path, const sacd_generator_options_t *options);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* SACD_GENERATOR_H */
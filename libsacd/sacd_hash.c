@@ -0,0 +1,625 @@
+/**
+ * SACD Library - Streaming Checksums
+ *
+ * Self-contained streaming implementations of XXH3-64 (default secret,
+ * seed 0), MD5 and SHA-256. The extractor feeds audio payload through these
+ * as it is written, so verifying a rip costs no extra I/O.
+ */
+
+#include "sacd_lib.h"
+#include "sacd_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+/* ---------------------------------------------------------------------- */
+/* Shared helpers                                                          */
+/* ---------------------------------------------------------------------- */
+
+static uint32_t read_le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t read_le64(const uint8_t *p) {
+    return (uint64_t)read_le32(p) | ((uint64_t)read_le32(p + 4) << 32);
+}
+
+static uint32_t read_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static uint32_t rotl32(uint32_t x, int r) {
+    return (x << r) | (x >> (32 - r));
+}
+
+static uint32_t rotr32(uint32_t x, int r) {
+    return (x >> r) | (x << (32 - r));
+}
+
+static uint64_t rotl64(uint64_t x, int r) {
+    return (x << r) | (x >> (64 - r));
+}
+
+/* ---------------------------------------------------------------------- */
+/* XXH3-64                                                                 */
+/* ---------------------------------------------------------------------- */
+
+#define XXH_PRIME32_1  0x9E3779B1U
+#define XXH_PRIME32_2  0x85EBCA77U
+#define XXH_PRIME32_3  0xC2B2AE3DU
+#define XXH_PRIME64_1  0x9E3779B185EBCA87ULL
+#define XXH_PRIME64_2  0xC2B2AE3D27D4EB4FULL
+#define XXH_PRIME64_3  0x165667B19E3779F9ULL
+#define XXH_PRIME64_4  0x85EBCA77C2B2AE63ULL
+#define XXH_PRIME64_5  0x27D4EB2F165667C5ULL
+#define XXH_PRIME_MX1  0x165667919E3779F9ULL
+#define XXH_PRIME_MX2  0x9FB21C651E98DF25ULL
+
+#define XXH_STRIPE_LEN           64
+#define XXH_SECRET_SIZE          192
+#define XXH_SECRET_CONSUME_RATE  8
+#define XXH_SECRET_LIMIT         (XXH_SECRET_SIZE - XXH_STRIPE_LEN)
+#define XXH_STRIPES_PER_BLOCK    (XXH_SECRET_LIMIT / XXH_SECRET_CONSUME_RATE)
+#define XXH_BUFFER_SIZE          256
+#define XXH_BUFFER_STRIPES       (XXH_BUFFER_SIZE / XXH_STRIPE_LEN)
+#define XXH_MIDSIZE_MAX          240
+
+static const uint8_t xxh3_secret[XXH_SECRET_SIZE] = {
+    0xb8, 0xfe, 0x6c, 0x39, 0x23, 0xa4, 0x4b, 0xbe, 0x7c, 0x01, 0x81, 0x2c, 0xf7, 0x21, 0xad, 0x1c,
+    0xde, 0xd4, 0x6d, 0xe9, 0x83, 0x90, 0x97, 0xdb, 0x72, 0x40, 0xa4, 0xa4, 0xb7, 0xb3, 0x67, 0x1f,
+    0xcb, 0x79, 0xe6, 0x4e, 0xcc, 0xc0, 0xe5, 0x78, 0x82, 0x5a, 0xd0, 0x7d, 0xcc, 0xff, 0x72, 0x21,
+    0xb8, 0x08, 0x46, 0x74, 0xf7, 0x43, 0x24, 0x8e, 0xe0, 0x35, 0x90, 0xe6, 0x81, 0x3a, 0x26, 0x4c,
+    0x3c, 0x28, 0x52, 0xbb, 0x91, 0xc3, 0x00, 0xcb, 0x88, 0xd0, 0x65, 0x8b, 0x1b, 0x53, 0x2e, 0xa3,
+    0x71, 0x64, 0x48, 0x97, 0xa2, 0x0d, 0xf9, 0x4e, 0x38, 0x19, 0xef, 0x46, 0xa9, 0xde, 0xac, 0xd8,
+    0xa8, 0xfa, 0x76, 0x3f, 0xe3, 0x9c, 0x34, 0x3f, 0xf9, 0xdc, 0xbb, 0xc7, 0xc7, 0x0b, 0x4f, 0x1d,
+    0x8a, 0x51, 0xe0, 0x4b, 0xcd, 0xb4, 0x59, 0x31, 0xc8, 0x9f, 0x7e, 0xc9, 0xd9, 0x78, 0x73, 0x64,
+    0xea, 0xc5, 0xac, 0x83, 0x34, 0xd3, 0xeb, 0xc3, 0xc5, 0x81, 0xa0, 0xff, 0xfa, 0x13, 0x63, 0xeb,
+    0x17, 0x0d, 0xdd, 0x51, 0xb7, 0xf0, 0xda, 0x49, 0xd3, 0x16, 0x55, 0x26, 0x29, 0xd4, 0x68, 0x9e,
+    0x2b, 0x16, 0xbe, 0x58, 0x7d, 0x47, 0xa1, 0xfc, 0x8f, 0xf8, 0xb8, 0xd1, 0x7a, 0xd0, 0x31, 0xce,
+    0x45, 0xcb, 0x3a, 0x8f, 0x95, 0x16, 0x04, 0x28, 0xaf, 0xd7, 0xfb, 0xca, 0xbb, 0x4b, 0x40, 0x7e,
+};
+
+static uint64_t xxh_mul128_fold64(uint64_t a, uint64_t b) {
+    __uint128_t product = (__uint128_t)a * b;
+    return (uint64_t)product ^ (uint64_t)(product >> 64);
+}
+
+static uint64_t xxh64_avalanche(uint64_t h) {
+    h ^= h >> 33;
+    h *= XXH_PRIME64_2;
+    h ^= h >> 29;
+    h *= XXH_PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+static uint64_t xxh3_avalanche(uint64_t h) {
+    h ^= h >> 37;
+    h *= XXH_PRIME_MX1;
+    h ^= h >> 32;
+    return h;
+}
+
+static uint64_t xxh3_rrmxmx(uint64_t h, uint64_t len) {
+    h ^= rotl64(h, 49) ^ rotl64(h, 24);
+    h *= XXH_PRIME_MX2;
+    h ^= (h >> 35) + len;
+    h *= XXH_PRIME_MX2;
+    return h ^ (h >> 28);
+}
+
+static uint64_t xxh3_mix16(const uint8_t *input, const uint8_t *secret) {
+    return xxh_mul128_fold64(read_le64(input) ^ read_le64(secret),
+                             read_le64(input + 8) ^ read_le64(secret + 8));
+}
+
+/* One-shot hash for inputs up to XXH_MIDSIZE_MAX bytes */
+static uint64_t xxh3_short(const uint8_t *input, size_t len) {
+    const uint8_t *secret = xxh3_secret;
+
+    if (len == 0) {
+        return xxh64_avalanche(read_le64(secret + 56) ^ read_le64(secret + 64));
+    }
+
+    if (len <= 3) {
+        uint32_t combined = ((uint32_t)input[0] << 16) | ((uint32_t)input[len >> 1] << 24) |
+                            (uint32_t)input[len - 1] | ((uint32_t)len << 8);
+        uint64_t bitflip = read_le32(secret) ^ read_le32(secret + 4);
+        return xxh64_avalanche((uint64_t)combined ^ bitflip);
+    }
+
+    if (len <= 8) {
+        uint64_t bitflip = read_le64(secret + 8) ^ read_le64(secret + 16);
+        uint64_t input64 = read_le32(input + len - 4) + ((uint64_t)read_le32(input) << 32);
+        return xxh3_rrmxmx(input64 ^ bitflip, len);
+    }
+
+    if (len <= 16) {
+        uint64_t bitflip1 = read_le64(secret + 24) ^ read_le64(secret + 32);
+        uint64_t bitflip2 = read_le64(secret + 40) ^ read_le64(secret + 48);
+        uint64_t lo = read_le64(input) ^ bitflip1;
+        uint64_t hi = read_le64(input + len - 8) ^ bitflip2;
+        uint64_t acc = len + __builtin_bswap64(lo) + hi + xxh_mul128_fold64(lo, hi);
+        return xxh3_avalanche(acc);
+    }
+
+    uint64_t acc = len * XXH_PRIME64_1;
+
+    if (len <= 128) {
+        if (len > 32) {
+            if (len > 64) {
+                if (len > 96) {
+                    acc += xxh3_mix16(input + 48, secret + 96);
+                    acc += xxh3_mix16(input + len - 64, secret + 112);
+                }
+                acc += xxh3_mix16(input + 32, secret + 64);
+                acc += xxh3_mix16(input + len - 48, secret + 80);
+            }
+            acc += xxh3_mix16(input + 16, secret + 32);
+            acc += xxh3_mix16(input + len - 32, secret + 48);
+        }
+        acc += xxh3_mix16(input, secret);
+        acc += xxh3_mix16(input + len - 16, secret + 16);
+        return xxh3_avalanche(acc);
+    }
+
+    /* 129..240 bytes */
+    int rounds = (int)len / 16;
+    for (int i = 0; i < 8; i++) {
+        acc += xxh3_mix16(input + 16 * i, secret + 16 * i);
+    }
+    acc = xxh3_avalanche(acc);
+    for (int i = 8; i < rounds; i++) {
+        acc += xxh3_mix16(input + 16 * i, secret + 16 * (i - 8) + 3);
+    }
+    acc += xxh3_mix16(input + len - 16, secret + 136 - 17);
+    return xxh3_avalanche(acc);
+}
+
+/* Accumulate one 64-byte stripe; written so the compiler can vectorize it */
+static void xxh3_accumulate_512(uint64_t *acc, const uint8_t *input, const uint8_t *secret) {
+    for (int i = 0; i < 8; i++) {
+        uint64_t data_val = read_le64(input + 8 * i);
+        uint64_t data_key = data_val ^ read_le64(secret + 8 * i);
+        acc[i ^ 1] += data_val;
+        acc[i] += (uint64_t)(uint32_t)data_key * (data_key >> 32);
+    }
+}
+
+static void xxh3_scramble(uint64_t *acc, const uint8_t *secret) {
+    for (int i = 0; i < 8; i++) {
+        uint64_t a = acc[i];
+        a ^= a >> 47;
+        a ^= read_le64(secret + 8 * i);
+        a *= XXH_PRIME32_1;
+        acc[i] = a;
+    }
+}
+
+static void xxh3_accumulate(uint64_t *acc, const uint8_t *input, const uint8_t *secret, size_t stripes) {
+    for (size_t n = 0; n < stripes; n++) {
+        xxh3_accumulate_512(acc, input + n * XXH_STRIPE_LEN, secret + n * XXH_SECRET_CONSUME_RATE);
+    }
+}
+
+static void xxh3_consume_stripes(uint64_t *acc, size_t *stripes_so_far,
+                                 const uint8_t *input, size_t stripes) {
+    if (XXH_STRIPES_PER_BLOCK - *stripes_so_far <= stripes) {
+        size_t to_end = XXH_STRIPES_PER_BLOCK - *stripes_so_far;
+        size_t after = stripes - to_end;
+        xxh3_accumulate(acc, input, xxh3_secret + *stripes_so_far * XXH_SECRET_CONSUME_RATE, to_end);
+        xxh3_scramble(acc, xxh3_secret + XXH_SECRET_LIMIT);
+        xxh3_accumulate(acc, input + to_end * XXH_STRIPE_LEN, xxh3_secret, after);
+        *stripes_so_far = after;
+    } else {
+        xxh3_accumulate(acc, input, xxh3_secret + *stripes_so_far * XXH_SECRET_CONSUME_RATE, stripes);
+        *stripes_so_far += stripes;
+    }
+}
+
+void sacd_internal_xxh3_init(sacd_xxh3_state_t *state) {
+    memset(state, 0, sizeof(sacd_xxh3_state_t));
+    state->acc[0] = XXH_PRIME32_3;
+    state->acc[1] = XXH_PRIME64_1;
+    state->acc[2] = XXH_PRIME64_2;
+    state->acc[3] = XXH_PRIME64_3;
+    state->acc[4] = XXH_PRIME64_4;
+    state->acc[5] = XXH_PRIME32_2;
+    state->acc[6] = XXH_PRIME64_5;
+    state->acc[7] = XXH_PRIME32_1;
+}
+
+void sacd_internal_xxh3_update(sacd_xxh3_state_t *state, const uint8_t *input, size_t len) {
+    const uint8_t *end = input + len;
+    state->total_len += len;
+
+    if (state->buffered + len <= XXH_BUFFER_SIZE) {
+        memcpy(state->buffer + state->buffered, input, len);
+        state->buffered += len;
+        return;
+    }
+
+    /* Complete and consume the internal buffer */
+    if (state->buffered) {
+        size_t load = XXH_BUFFER_SIZE - state->buffered;
+        memcpy(state->buffer + state->buffered, input, load);
+        input += load;
+        xxh3_consume_stripes(state->acc, &state->stripes_so_far, state->buffer, XXH_BUFFER_STRIPES);
+        state->buffered = 0;
+    }
+
+    /* Consume large input directly, always keeping the tail for the digest */
+    if (input + XXH_BUFFER_SIZE < end) {
+        const uint8_t *limit = end - XXH_BUFFER_SIZE;
+        do {
+            xxh3_consume_stripes(state->acc, &state->stripes_so_far, input, XXH_BUFFER_STRIPES);
+            input += XXH_BUFFER_SIZE;
+        } while (input < limit);
+        /* Keep the last consumed stripe for a short final stripe */
+        memcpy(state->buffer + XXH_BUFFER_SIZE - XXH_STRIPE_LEN, input - XXH_STRIPE_LEN, XXH_STRIPE_LEN);
+    }
+
+    if (input < end) {
+        memcpy(state->buffer, input, end - input);
+        state->buffered = end - input;
+    }
+}
+
+uint64_t sacd_internal_xxh3_digest(const sacd_xxh3_state_t *state) {
+    if (state->total_len <= XXH_MIDSIZE_MAX) {
+        return xxh3_short(state->buffer, (size_t)state->total_len);
+    }
+
+    uint64_t acc[8];
+    memcpy(acc, state->acc, sizeof(acc));
+
+    if (state->buffered >= XXH_STRIPE_LEN) {
+        size_t stripes = (state->buffered - 1) / XXH_STRIPE_LEN;
+        size_t stripes_so_far = state->stripes_so_far;
+        xxh3_consume_stripes(acc, &stripes_so_far, state->buffer, stripes);
+        xxh3_accumulate_512(acc, state->buffer + state->buffered - XXH_STRIPE_LEN,
+                            xxh3_secret + XXH_SECRET_LIMIT - 7);
+    } else {
+        uint8_t last_stripe[XXH_STRIPE_LEN];
+        size_t catchup = XXH_STRIPE_LEN - state->buffered;
+        memcpy(last_stripe, state->buffer + XXH_BUFFER_SIZE - catchup, catchup);
+        memcpy(last_stripe + catchup, state->buffer, state->buffered);
+        xxh3_accumulate_512(acc, last_stripe, xxh3_secret + XXH_SECRET_LIMIT - 7);
+    }
+
+    /* Merge accumulators */
+    uint64_t result = state->total_len * XXH_PRIME64_1;
+    for (int i = 0; i < 4; i++) {
+        result += xxh_mul128_fold64(acc[2 * i] ^ read_le64(xxh3_secret + 11 + 16 * i),
+                                    acc[2 * i + 1] ^ read_le64(xxh3_secret + 11 + 16 * i + 8));
+    }
+    return xxh3_avalanche(result);
+}
+
+/* ---------------------------------------------------------------------- */
+/* MD5 (RFC 1321)                                                          */
+/* ---------------------------------------------------------------------- */
+
+static const uint32_t md5_k[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+};
+
+static const uint8_t md5_r[64] = {
+    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+    5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20,
+    4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+    6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21,
+};
+
+static void md5_block(uint32_t *state, const uint8_t *block) {
+    uint32_t m[16];
+    for (int i = 0; i < 16; i++) {
+        m[i] = read_le32(block + 4 * i);
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+
+    for (int i = 0; i < 64; i++) {
+        uint32_t f;
+        int g;
+        if (i < 16) {
+            f = (b & c) | (~b & d);
+            g = i;
+        } else if (i < 32) {
+            f = (d & b) | (~d & c);
+            g = (5 * i + 1) & 15;
+        } else if (i < 48) {
+            f = b ^ c ^ d;
+            g = (3 * i + 5) & 15;
+        } else {
+            f = c ^ (b | ~d);
+            g = (7 * i) & 15;
+        }
+
+        uint32_t tmp = d;
+        d = c;
+        c = b;
+        b = b + rotl32(a + f + md5_k[i] + m[g], md5_r[i]);
+        a = tmp;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+}
+
+void sacd_internal_md5_init(sacd_md5_state_t *state) {
+    memset(state, 0, sizeof(sacd_md5_state_t));
+    state->state[0] = 0x67452301;
+    state->state[1] = 0xefcdab89;
+    state->state[2] = 0x98badcfe;
+    state->state[3] = 0x10325476;
+}
+
+void sacd_internal_md5_update(sacd_md5_state_t *state, const uint8_t *data, size_t len) {
+    size_t used = state->length & 63;
+    state->length += len;
+
+    if (used) {
+        size_t fill = 64 - used;
+        if (len < fill) {
+            memcpy(state->buffer + used, data, len);
+            return;
+        }
+        memcpy(state->buffer + used, data, fill);
+        md5_block(state->state, state->buffer);
+        data += fill;
+        len -= fill;
+    }
+
+    while (len >= 64) {
+        md5_block(state->state, data);
+        data += 64;
+        len -= 64;
+    }
+
+    memcpy(state->buffer, data, len);
+}
+
+void sacd_internal_md5_final(sacd_md5_state_t *state, uint8_t digest[16]) {
+    uint64_t bit_length = state->length * 8;
+    uint8_t pad[72] = { 0x80 };
+    size_t used = state->length & 63;
+    size_t pad_len = (used < 56) ? 56 - used : 120 - used;
+
+    for (int i = 0; i < 8; i++) {
+        pad[pad_len + i] = (uint8_t)(bit_length >> (8 * i));
+    }
+    sacd_internal_md5_update(state, pad, pad_len + 8);
+
+    for (int i = 0; i < 4; i++) {
+        digest[4 * i + 0] = (uint8_t)(state->state[i]);
+        digest[4 * i + 1] = (uint8_t)(state->state[i] >> 8);
+        digest[4 * i + 2] = (uint8_t)(state->state[i] >> 16);
+        digest[4 * i + 3] = (uint8_t)(state->state[i] >> 24);
+    }
+}
+
+/* ---------------------------------------------------------------------- */
+/* SHA-256 (FIPS 180-4)                                                    */
+/* ---------------------------------------------------------------------- */
+
+static const uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static void sha256_block(uint32_t *state, const uint8_t *block) {
+    uint32_t w[64];
+    for (int i = 0; i < 16; i++) {
+        w[i] = read_be32(block + 4 * i);
+    }
+    for (int i = 16; i < 64; i++) {
+        uint32_t s0 = rotr32(w[i - 15], 7) ^ rotr32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = rotr32(w[i - 2], 17) ^ rotr32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+
+    for (int i = 0; i < 64; i++) {
+        uint32_t s1 = rotr32(e, 6) ^ rotr32(e, 11) ^ rotr32(e, 25);
+        uint32_t ch = (e & f) ^ (~e & g);
+        uint32_t t1 = h + s1 + ch + sha256_k[i] + w[i];
+        uint32_t s0 = rotr32(a, 2) ^ rotr32(a, 13) ^ rotr32(a, 22);
+        uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t t2 = s0 + maj;
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    state[5] += f;
+    state[6] += g;
+    state[7] += h;
+}
+
+void sacd_internal_sha256_init(sacd_sha256_state_t *state) {
+    static const uint32_t initial[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+
+    memset(state, 0, sizeof(sacd_sha256_state_t));
+    memcpy(state->state, initial, sizeof(initial));
+}
+
+void sacd_internal_sha256_update(sacd_sha256_state_t *state, const uint8_t *data, size_t len) {
+    size_t used = state->length & 63;
+    state->length += len;
+
+    if (used) {
+        size_t fill = 64 - used;
+        if (len < fill) {
+            memcpy(state->buffer + used, data, len);
+            return;
+        }
+        memcpy(state->buffer + used, data, fill);
+        sha256_block(state->state, state->buffer);
+        data += fill;
+        len -= fill;
+    }
+
+    while (len >= 64) {
+        sha256_block(state->state, data);
+        data += 64;
+        len -= 64;
+    }
+
+    memcpy(state->buffer, data, len);
+}
+
+void sacd_internal_sha256_final(sacd_sha256_state_t *state, uint8_t digest[32]) {
+    uint64_t bit_length = state->length * 8;
+    uint8_t pad[72] = { 0x80 };
+    size_t used = state->length & 63;
+    size_t pad_len = (used < 56) ? 56 - used : 120 - used;
+
+    for (int i = 0; i < 8; i++) {
+        pad[pad_len + i] = (uint8_t)(bit_length >> (56 - 8 * i));
+    }
+    sacd_internal_sha256_update(state, pad, pad_len + 8);
+
+    for (int i = 0; i < 8; i++) {
+        digest[4 * i + 0] = (uint8_t)(state->state[i] >> 24);
+        digest[4 * i + 1] = (uint8_t)(state->state[i] >> 16);
+        digest[4 * i + 2] = (uint8_t)(state->state[i] >> 8);
+        digest[4 * i + 3] = (uint8_t)(state->state[i]);
+    }
+}
+
+/* ---------------------------------------------------------------------- */
+/* Combined checksum context                                               */
+/* ---------------------------------------------------------------------- */
+
+void sacd_internal_checksum_init(sacd_checksum_t *checksum, unsigned int types) {
+    memset(checksum, 0, sizeof(sacd_checksum_t));
+    checksum->types = types;
+
+    if (types & SACD_CHECKSUM_XXH3) {
+        sacd_internal_xxh3_init(&checksum->xxh3);
+    }
+    if (types & SACD_CHECKSUM_MD5) {
+        sacd_internal_md5_init(&checksum->md5);
+    }
+    if (types & SACD_CHECKSUM_SHA256) {
+        sacd_internal_sha256_init(&checksum->sha256);
+    }
+}
+
+void sacd_internal_checksum_update(sacd_checksum_t *checksum, const uint8_t *data, size_t len) {
+    if (checksum->types & SACD_CHECKSUM_XXH3) {
+        sacd_internal_xxh3_update(&checksum->xxh3, data, len);
+    }
+    if (checksum->types & SACD_CHECKSUM_MD5) {
+        sacd_internal_md5_update(&checksum->md5, data, len);
+    }
+    if (checksum->types & SACD_CHECKSUM_SHA256) {
+        sacd_internal_sha256_update(&checksum->sha256, data, len);
+    }
+}
+
+void sacd_internal_checksum_final(sacd_checksum_t *checksum, sacd_track_report_t *report) {
+    report->checksum_types = checksum->types;
+
+    if (checksum->types & SACD_CHECKSUM_XXH3) {
+        report->xxh3 = sacd_internal_xxh3_digest(&checksum->xxh3);
+    }
+    if (checksum->types & SACD_CHECKSUM_MD5) {
+        sacd_internal_md5_final(&checksum->md5, report->md5);
+    }
+    if (checksum->types & SACD_CHECKSUM_SHA256) {
+        sacd_internal_sha256_final(&checksum->sha256, report->sha256);
+    }
+}
+
+/* ---------------------------------------------------------------------- */
+/* Public helpers                                                          */
+/* ---------------------------------------------------------------------- */
+
+/* Get checksum algorithm name */
+const char *sacd_checksum_name(sacd_checksum_type_t type) {
+    switch (type) {
+        case SACD_CHECKSUM_XXH3:
+            return "XXH3";
+        case SACD_CHECKSUM_MD5:
+            return "MD5";
+        case SACD_CHECKSUM_SHA256:
+            return "SHA256";
+        default:
+            return "Unknown";
+    }
+}
+
+/* Format a reported checksum as lowercase hex */
+bool sacd_checksum_format(const sacd_track_report_t *report, sacd_checksum_type_t type,
+                          char *buffer, size_t buffer_size) {
+    if (!report || !buffer || !(report->checksum_types & type)) {
+        return false;
+    }
+
+    const uint8_t *bytes;
+    size_t length;
+    uint8_t xxh3_bytes[8];
+
+    switch (type) {
+        case SACD_CHECKSUM_XXH3:
+            /* Canonical big-endian form, as printed by xxhsum */
+            for (int i = 0; i < 8; i++) {
+                xxh3_bytes[i] = (uint8_t)(report->xxh3 >> (56 - 8 * i));
+            }
+            bytes = xxh3_bytes;
+            length = 8;
+            break;
+        case SACD_CHECKSUM_MD5:
+            bytes = report->md5;
+            length = 16;
+            break;
+        case SACD_CHECKSUM_SHA256:
+            bytes = report->sha256;
+            length = 32;
+            break;
+        default:
+            return false;
+    }
+
+    if (buffer_size < length * 2 + 1) {
+        return false;
+    }
+
+    for (size_t i = 0; i < length; i++) {
+        snprintf(buffer + i * 2, 3, "%02x", bytes[i]);
+    }
+    return true;
+}
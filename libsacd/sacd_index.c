@@ -0,0 +1,304 @@
+/**
+ * SACD Library - Audio Frame Index
+ *
+ * Maps an area's frame timecodes to the sectors the frames start in, so a
+ * time can be turned into a read position without scanning from a track
+ * start. The index is built by running the area's sectors through the
+ * demultiplexer once.
+ *
+ * Each block of SACD_FRAME_INDEX_INTERVAL frames stores the full LSN of its
+ * first frame; every frame then stores its distance in sectors from that
+ * LSN in 16 bits. A lookup is one array access into each, and an hour of
+ * audio costs about 600 KB.
+ *
+ * An index can be saved to a file and loaded back for the same disc, so a
+ * disc is scanned at most once. The file records the area's layout and a
+ * hash of the disc's TOC headers; a file for any other disc is rejected.
+ */
+
+#include "sacd_lib.h"
+#include "sacd_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+
+#define INDEX_MAGIC      "SACDFIDX"
+#define INDEX_VERSION    2
+
+/* Sectors the index covers: from the first track to the end of the last */
+static void area_extent(const sacd_area_t *area, uint32_t *start_lsn, uint32_t *end_lsn) {
+    const sacd_track_t *last = &area->tracks[area->track_count - 1];
+    *start_lsn = area->tracks[0].start_lsn;
+    *end_lsn = last->start_lsn + last->length_lsn;
+}
+
+/* Make room for 'count' frames */
+static sacd_result_t reserve(sacd_frame_index_t *index, uint32_t count) {
+    if (count <= index->capacity) {
+        return SACD_RESULT_OK;
+    }
+
+    uint32_t capacity = index->capacity ? index->capacity : 64 * SACD_FRAME_INDEX_INTERVAL;
+    while (capacity < count) {
+        capacity *= 2;
+    }
+    uint32_t key_count = (capacity + SACD_FRAME_INDEX_INTERVAL - 1) / SACD_FRAME_INDEX_INTERVAL;
+
+    uint32_t *keys = realloc(index->keys, key_count * sizeof(uint32_t));
+    if (!keys) {
+        return SACD_RESULT_OUT_OF_MEMORY;
+    }
+    index->keys = keys;
+    uint16_t *offsets = realloc(index->offsets, capacity * sizeof(uint16_t));
+    if (!offsets) {
+        return SACD_RESULT_OUT_OF_MEMORY;
+    }
+    index->offsets = offsets;
+    index->capacity = capacity;
+    return SACD_RESULT_OK;
+}
+
+/* Record that frame number 'frame' starts in sector 'lsn' */
+static sacd_result_t add_frame(sacd_frame_index_t *index, uint32_t frame, uint32_t lsn) {
+    if (index->frame_count == 0) {
+        index->first_frame = frame;
+    }
+
+    /* A repeated or out of order timecode adds nothing */
+    if (frame < index->first_frame + index->frame_count) {
+        return SACD_RESULT_OK;
+    }
+
+    /* Frames missing from the stream start where the next one found does */
+    uint32_t count = frame - index->first_frame + 1;
+    SACD_CHECK_RESULT(reserve(index, count));
+    for (uint32_t i = index->frame_count; i < count; i++) {
+        uint32_t block = i / SACD_FRAME_INDEX_INTERVAL;
+        if (i % SACD_FRAME_INDEX_INTERVAL == 0) {
+            index->keys[block] = lsn;
+        }
+        uint32_t offset = lsn - index->keys[block];
+        if (offset > UINT16_MAX) {
+            return SACD_RESULT_ERROR;
+        }
+        index->offsets[i] = (uint16_t)offset;
+    }
+    index->frame_count = count;
+    return SACD_RESULT_OK;
+}
+
+static sacd_result_t index_frame(const sacd_audio_frame_t *frame, void *userdata) {
+    return add_frame((sacd_frame_index_t*)userdata, sacd_internal_time_to_frames(&frame->timecode),
+                     frame->start_lsn);
+}
+
+/* Scan an area and index every frame in it */
+sacd_result_t sacd_internal_frame_index_build(sacd_disc_internal_t *disc, const sacd_area_t *area,
+                                              sacd_frame_index_t *index) {
+    if (!disc || !area || !index || area->track_count == 0) {
+        return SACD_RESULT_ERROR;
+    }
+
+    memset(index, 0, sizeof(sacd_frame_index_t));
+    area_extent(area, &index->start_lsn, &index->end_lsn);
+
+    uint8_t *buffer = malloc((size_t)SACD_SWEEP_READ_SECTORS * SACD_LSN_SIZE);
+    if (!buffer) {
+        return SACD_RESULT_OUT_OF_MEMORY;
+    }
+
+    sacd_demux_t demux;
+    sacd_internal_demux_init(&demux, area->channel_count);
+
+    sacd_result_t result = SACD_RESULT_OK;
+    uint32_t lsn = index->start_lsn;
+    while (result == SACD_RESULT_OK && lsn < index->end_lsn) {
+        uint32_t count = index->end_lsn - lsn;
+        if (count > SACD_SWEEP_READ_SECTORS) {
+            count = SACD_SWEEP_READ_SECTORS;
+        }
+        result = sacd_internal_read_sectors(disc, lsn, count, buffer);
+        for (uint32_t i = 0; result == SACD_RESULT_OK && i < count; i++) {
+            result = sacd_internal_demux_sector(&demux, lsn + i, buffer + (size_t)i * SACD_LSN_SIZE,
+                                                index_frame, index);
+            if (result != SACD_RESULT_OK && result != SACD_RESULT_OUT_OF_MEMORY) {
+                /* A malformed sector only loses the frames it carries */
+                SACD_DEBUG_LOG("Sector %u: malformed audio sector, not indexed", lsn + i);
+                result = SACD_RESULT_OK;
+            }
+        }
+        lsn += count;
+    }
+    if (result == SACD_RESULT_OK) {
+        result = sacd_internal_demux_flush(&demux, index_frame, index);
+    }
+    sacd_internal_demux_free(&demux);
+    free(buffer);
+
+    if (result == SACD_RESULT_OK && index->frame_count == 0) {
+        result = SACD_RESULT_INVALID_AREA;
+    }
+    if (result != SACD_RESULT_OK) {
+        sacd_internal_frame_index_free(index);
+        return result;
+    }
+
+    SACD_DEBUG_LOG("Indexed %u frames from %u, LSN %u to %u", index->frame_count,
+                   index->first_frame, index->start_lsn, index->end_lsn - 1);
+    return SACD_RESULT_OK;
+}
+
+/* Sector frame number 'frame' starts in */
+sacd_result_t sacd_internal_frame_index_lookup(const sacd_frame_index_t *index, uint32_t frame, uint32_t *lsn) {
+    if (!index || !lsn || frame < index->first_frame || frame - index->first_frame >= index->frame_count) {
+        return SACD_RESULT_ERROR;
+    }
+
+    uint32_t i = frame - index->first_frame;
+    *lsn = index->keys[i / SACD_FRAME_INDEX_INTERVAL] + index->offsets[i];
+    return SACD_RESULT_OK;
+}
+
+void sacd_internal_frame_index_free(sacd_frame_index_t *index) {
+    if (!index) {
+        return;
+    }
+    free(index->keys);
+    free(index->offsets);
+    memset(index, 0, sizeof(sacd_frame_index_t));
+}
+
+/* ---- Index files (little endian) ---- */
+
+static bool put32(FILE *f, uint32_t value) {
+    uint8_t bytes[4] = { value & 0xff, (value >> 8) & 0xff, (value >> 16) & 0xff, value >> 24 };
+    return fwrite(bytes, 1, 4, f) == 4;
+}
+
+static bool get32(FILE *f, uint32_t *value) {
+    uint8_t bytes[4];
+    if (fread(bytes, 1, 4, f) != 4) {
+        return false;
+    }
+    *value = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+    return true;
+}
+
+static bool put16(FILE *f, uint16_t value) {
+    uint8_t bytes[2] = { value & 0xff, value >> 8 };
+    return fwrite(bytes, 1, 2, f) == 2;
+}
+
+static bool get16(FILE *f, uint16_t *value) {
+    uint8_t bytes[2];
+    if (fread(bytes, 1, 2, f) != 2) {
+        return false;
+    }
+    *value = (uint16_t)(bytes[0] | (bytes[1] << 8));
+    return true;
+}
+
+/* Save an index; the file is replaced atomically */
+sacd_result_t sacd_internal_frame_index_save(const sacd_frame_index_t *index, const sacd_area_t *area,
+                                             uint64_t disc_id, const char *path) {
+    if (!index || !area || !path || index->frame_count == 0) {
+        return SACD_RESULT_ERROR;
+    }
+
+    size_t tmp_len = strlen(path) + 5;
+    char *tmp_path = malloc(tmp_len);
+    if (!tmp_path) {
+        return SACD_RESULT_OUT_OF_MEMORY;
+    }
+    snprintf(tmp_path, tmp_len, "%s.tmp", path);
+
+    FILE *f = fopen(tmp_path, "wb");
+    if (!f) {
+        free(tmp_path);
+        return SACD_RESULT_IO_ERROR;
+    }
+
+    /* The TOC hash and the area's layout identify the disc the index belongs to */
+    bool ok = fwrite(INDEX_MAGIC, 1, 8, f) == 8 && put32(f, INDEX_VERSION) &&
+              put32(f, (uint32_t)disc_id) && put32(f, (uint32_t)(disc_id >> 32)) &&
+              put32(f, area->start_lsn) && put32(f, area->end_lsn) && put32(f, (uint32_t)area->track_count) &&
+              put32(f, index->start_lsn) && put32(f, index->end_lsn) &&
+              put32(f, SACD_FRAME_INDEX_INTERVAL) && put32(f, index->first_frame) && put32(f, index->frame_count);
+
+    uint32_t key_count = (index->frame_count + SACD_FRAME_INDEX_INTERVAL - 1) / SACD_FRAME_INDEX_INTERVAL;
+    for (uint32_t i = 0; ok && i < key_count; i++) {
+        ok = put32(f, index->keys[i]);
+    }
+    for (uint32_t i = 0; ok && i < index->frame_count; i++) {
+        ok = put16(f, index->offsets[i]);
+    }
+
+    ok = fflush(f) == 0 && fsync(fileno(f)) == 0 && ok;
+    ok = (fclose(f) == 0) && ok;
+
+    if (!ok || rename(tmp_path, path) != 0) {
+        unlink(tmp_path);
+        free(tmp_path);
+        return SACD_RESULT_IO_ERROR;
+    }
+
+    free(tmp_path);
+    return SACD_RESULT_OK;
+}
+
+/* Load an index saved for this area; a file for another disc is rejected */
+sacd_result_t sacd_internal_frame_index_load(sacd_frame_index_t *index, const sacd_area_t *area,
+                                             uint64_t disc_id, const char *path) {
+    if (!index || !area || !path || area->track_count == 0) {
+        return SACD_RESULT_ERROR;
+    }
+
+    memset(index, 0, sizeof(sacd_frame_index_t));
+
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return SACD_RESULT_INVALID_FILE;
+    }
+
+    char magic[8];
+    uint32_t version, id_low, id_high, area_start, area_end, track_count, interval;
+    uint32_t start_lsn, end_lsn;
+    area_extent(area, &start_lsn, &end_lsn);
+
+    bool ok = fread(magic, 1, 8, f) == 8 && memcmp(magic, INDEX_MAGIC, 8) == 0 &&
+              get32(f, &version) && version == INDEX_VERSION &&
+              get32(f, &id_low) && get32(f, &id_high) &&
+              get32(f, &area_start) && get32(f, &area_end) && get32(f, &track_count) &&
+              get32(f, &index->start_lsn) && get32(f, &index->end_lsn) &&
+              get32(f, &interval) && get32(f, &index->first_frame) && get32(f, &index->frame_count);
+    ok = ok && ((uint64_t)id_high << 32 | id_low) == disc_id && area_start == area->start_lsn && area_end == area->end_lsn &&
+         track_count == (uint32_t)area->track_count && index->start_lsn == start_lsn &&
+         index->end_lsn == end_lsn && interval == SACD_FRAME_INDEX_INTERVAL &&
+         index->frame_count > 0 && index->frame_count <= (uint64_t)(end_lsn - start_lsn) * SACD_LSN_SIZE;
+    if (!ok) {
+        fclose(f);
+        memset(index, 0, sizeof(sacd_frame_index_t));
+        return SACD_RESULT_INVALID_FILE;
+    }
+
+    sacd_result_t result = reserve(index, index->frame_count);
+    uint32_t key_count = (index->frame_count + SACD_FRAME_INDEX_INTERVAL - 1) / SACD_FRAME_INDEX_INTERVAL;
+    for (uint32_t i = 0; result == SACD_RESULT_OK && i < key_count; i++) {
+        if (!get32(f, &index->keys[i]) || index->keys[i] < start_lsn || index->keys[i] >= end_lsn) {
+            result = SACD_RESULT_INVALID_FILE;
+        }
+    }
+    for (uint32_t i = 0; result == SACD_RESULT_OK && i < index->frame_count; i++) {
+        if (!get16(f, &index->offsets[i]) ||
+            index->keys[i / SACD_FRAME_INDEX_INTERVAL] + index->offsets[i] >= end_lsn) {
+            result = SACD_RESULT_INVALID_FILE;
+        }
+    }
+    fclose(f);
+
+    if (result != SACD_RESULT_OK) {
+        sacd_internal_frame_index_free(index);
+    }
+    return result;
+}
@@ -16,6 +16,22 @@
 /* Forward declarations for internal structures */
 typedef struct sacd_disc_internal sacd_disc_internal_t;
 typedef struct sacd_extractor_internal sacd_extractor_internal_t;
+typedef struct sacd_pcm_converter sacd_pcm_converter_t;
+typedef struct sacd_flac_encoder sacd_flac_encoder_t;
+
+/* SACD constants from the specification */
+#define SACD_MASTER_TOC_START_LSN  510
+#define SACD_MASTER_TOC_LENGTH     10
+
+/* SACD signature markers */
+#define SACD_SIGNATURE             "SACDMTOC"
+#define SACD_TEXT_SIGNATURE        "SACDText"
+
+/* Output file buffer: writes reach the kernel in chunks of this size */
+#define SACD_OUTPUT_BUFFER_SIZE (1024 * 1024)
+
+/* Maximum channels handled by the PCM converter */
+#define SACD_PCM_MAX_CHANNELS 6
 
 /* DST decompression structure (simplified) */
 typedef struct {
@@ -34,8 +50,177 @@ typedef struct {
     int channel_count;                /* Number of channels */
     bool dst_encoded;                 /* True if DST compressed */
     sacd_time_t timecode;             /* Frame timecode */
+    uint32_t start_lsn;               /* Sector the frame starts in */
 } sacd_audio_frame_t;
 
+/* Audio sector layout (header, packet infos, frame infos, packet data) */
+#define SACD_MAX_SECTOR_PACKETS 7
+#define SACD_MAX_SECTOR_FRAMES  7
+
+typedef enum {
+    SACD_PACKET_AUDIO = 2,            /* DSD or DST audio */
+    SACD_PACKET_SUPPLEMENTARY = 3,    /* Supplementary data */
+    SACD_PACKET_PADDING = 7           /* Padding */
+} sacd_packet_type_t;
+
+typedef struct {
+    bool frame_start;                 /* Packet begins a new audio frame */
+    uint8_t data_type;                /* sacd_packet_type_t */
+    uint16_t length;                  /* Payload length in bytes */
+    const uint8_t *data;              /* Payload within the sector */
+} sacd_audio_packet_t;
+
+typedef struct {
+    bool dst_encoded;                 /* Frames in this sector are DST */
+    int packet_count;
+    sacd_audio_packet_t packets[SACD_MAX_SECTOR_PACKETS];
+    int frame_count;                  /* Frames starting in this sector */
+    sacd_time_t frame_timecodes[SACD_MAX_SECTOR_FRAMES];
+    int frame_sector_counts[SACD_MAX_SECTOR_FRAMES]; /* DST only */
+} sacd_audio_sector_t;
+
+/* Audio frames reassembled from a run of consecutive audio sectors */
+typedef struct {
+    sacd_audio_frame_t frame;         /* Frame being assembled; data is reused for every frame */
+    size_t capacity;                  /* Allocated size of frame.data */
+    bool open;                        /* A frame start has been seen and the frame not yet emitted */
+    uint64_t frames_emitted;
+} sacd_demux_t;
+
+/* Receives each completed frame; frame->data is only valid during the call */
+typedef sacd_result_t (*sacd_frame_callback_t)(const sacd_audio_frame_t *frame, void *userdata);
+
+/* Bytes of each channel in a level meter window */
+#define SACD_LEVEL_WINDOW_BYTES 32
+
+/* DSD level meter (see sacd_level.c) */
+typedef struct {
+    int channel_count;                /* 0 = not measuring */
+    uint32_t first_frame;             /* Frames the overview spreads over */
+    uint32_t frame_count;
+    uint64_t lane_masks[SACD_PCM_MAX_CHANNELS][SACD_PCM_MAX_CHANNELS];  /* [word % period][channel] */
+    sacd_level_report_t report;
+} sacd_level_meter_t;
+
+/* Consecutive identical silent frames held back by the silence trimmer */
+typedef struct {
+    uint32_t frame;                   /* Timecode of the first, in frames */
+    uint32_t count;
+    size_t offset;                    /* Frame data in sacd_silence_t.held */
+    size_t size;
+} sacd_silence_run_t;
+
+/* Silence detector and trimmer (see sacd_silence.c) */
+typedef struct {
+    bool enabled;                     /* Frames are being checked */
+    bool trim;                        /* Leading silence is dropped and trailing silence held back */
+    bool audible;                     /* An audible frame has been seen */
+    uint32_t run;                     /* Silent frames since the last audible one */
+    sacd_silence_run_t *runs;         /* Held back since the last audible frame */
+    int run_count;
+    int run_capacity;
+    uint8_t *held;
+    size_t held_size;
+    size_t held_capacity;
+    sacd_silence_report_t report;
+} sacd_silence_t;
+
+/* Frames per full LSN in a frame index */
+#define SACD_FRAME_INDEX_INTERVAL 64
+
+/* Sector each frame of an area starts in (see sacd_index.c) */
+typedef struct {
+    uint32_t start_lsn;               /* Sectors indexed */
+    uint32_t end_lsn;
+    uint32_t first_frame;             /* Timecode of the first frame, in frames */
+    uint32_t frame_count;
+    uint32_t *keys;                   /* LSN of every SACD_FRAME_INDEX_INTERVAL-th frame */
+    uint16_t *offsets;                /* Each frame's LSN less its block's key */
+    uint32_t capacity;                /* Frames allocated */
+} sacd_frame_index_t;
+
+/* DSDIFF "DST " chunk state: where the chunk starts and the DSTI frame index */
+typedef struct {
+    uint64_t dst_chunk_offset;        /* File offset of the "DST " chunk header */
+    uint64_t *frame_offsets;          /* File offset of each frame's data */
+    uint32_t *frame_lengths;          /* Length of each frame's data */
+    uint32_t frame_count;
+    uint32_t frame_capacity;
+} sacd_dst_index_t;
+
+/* Streaming checksum states */
+typedef struct {
+    uint64_t acc[8];
+    uint8_t buffer[256];
+    size_t buffered;
+    size_t stripes_so_far;
+    uint64_t total_len;
+} sacd_xxh3_state_t;
+
+typedef struct {
+    uint32_t state[4];
+    uint64_t length;
+    uint8_t buffer[64];
+} sacd_md5_state_t;
+
+typedef struct {
+    uint32_t state[8];
+    uint64_t length;
+    uint8_t buffer[64];
+} sacd_sha256_state_t;
+
+typedef struct {
+    unsigned int types;               /* SACD_CHECKSUM_* flags in use */
+    sacd_xxh3_state_t xxh3;
+    sacd_md5_state_t md5;
+    sacd_sha256_state_t sha256;
+} sacd_checksum_t;
+
+/* Extraction journal (crash-safe resume) */
+typedef enum {
+    SACD_JOURNAL_NONE = 0,            /* Nothing recorded */
+    SACD_JOURNAL_PARTIAL,             /* Track in progress, checkpoint valid */
+    SACD_JOURNAL_DONE                 /* Track completed */
+} sacd_journal_state_t;
+
+typedef struct {
+    sacd_journal_state_t state;
+    char *filename;                   /* Output file */
+    uint32_t next_lsn;                /* First LSN not yet durably written */
+    uint32_t next_frame;              /* Timecode of the first frame not yet written, in frames */
+    uint64_t bytes_written;           /* Audio bytes durably written */
+    uint64_t file_offset;             /* Durable file length at the checkpoint */
+} sacd_journal_entry_t;
+
+typedef struct {
+    char *path;                       /* Journal file path (NULL = disabled) */
+    uint64_t disc_id;                 /* Disc and area identity, to reject foreign journals */
+    uint32_t area_start_lsn;
+    uint32_t area_end_lsn;
+    int track_count;
+    sacd_output_format_t format;
+    sacd_journal_entry_t entries[SACD_MAX_TRACKS];
+} sacd_journal_t;
+
+/* Sequence counter, odd while an update is in progress */
+typedef struct {
+    unsigned int sequence;
+} sacd_seqlock_t;
+
+/* Set of CPUs */
+#define SACD_MAX_CPUS 1024
+
+typedef struct {
+    uint64_t bits[SACD_MAX_CPUS / 64];
+} sacd_cpuset_t;
+
+/* Token bucket limiting a byte rate */
+typedef struct {
+    uint64_t rate;                    /* Bytes per second, 0 = unlimited (atomic) */
+    double tokens;                    /* Bytes available; negative while in debt */
+    uint64_t last_ns;                 /* Time of the last refill, 0 = bucket not started */
+} sacd_throttle_t;
+
 /* Internal extraction context */
 struct sacd_extractor_internal {
     sacd_extractor_t public;          /* Public interface */
@@ -53,32 +238,177 @@ struct sacd_extractor_internal {
     int *track_queue;                 /* Array of track numbers to extract */
     int track_queue_count;            /* Number of tracks in queue */
     int track_queue_capacity;         /* Capacity of track queue */
+    sacd_track_t *ranges;             /* Time ranges, queued as SACD_MAX_TRACKS + index */
+    int range_count;
+    int range_capacity;
     
     /* Extraction state */
-    bool is_running;                  /* True if extraction is active */
+    bool is_running;                  /* True if extraction is active (atomic) */
     bool cancel_requested;            /* True if cancellation requested */
     int current_track_index;          /* Current track being extracted */
     int current_track_progress;       /* Progress within current track */
     
     /* Threading */
     pthread_t extraction_thread;      /* Extraction thread */
+    bool thread_joinable;             /* True until the thread has been joined */
     pthread_mutex_t state_mutex;      /* State protection mutex */
     
+    /* Completion notification (used by the batch scheduler) */
+    void (*finish_hook)(void *data, sacd_result_t result);
+    void *finish_hook_data;
+    sacd_result_t result;             /* Overall extraction result */
+    
     /* Audio processing */
-    sacd_audio_frame_t current_frame; /* Current audio frame */
+    sacd_demux_t demux;               /* Frames of the sectors being read */
     sacd_dst_decoder_t dst_decoder;   /* DST decoder state */
+    sacd_level_meter_t level_meter;   /* Levels of the current track */
+    sacd_silence_t silence;           /* Silence of the current track */
+    sacd_pcm_converter_t *pcm_converter; /* DSD to PCM (WAV and FLAC output) */
+    sacd_flac_encoder_t *flac_encoder; /* PCM to FLAC (FLAC output) */
+    
+    /* DST passthrough (DSDIFF output, convert_dst off) */
+    bool dst_passthrough;             /* Current track's DST frames are written verbatim */
+    sacd_dst_index_t dst_index;       /* DSTI entries for the current track */
     
-    /* Output file */
-    FILE *current_output_file;        /* Current output file */
+    /* Output */
+    sacd_sink_t *current_output;      /* Sink for the current track */
     size_t bytes_written;             /* Bytes written to current file */
     
+    /* Resume journal */
+    sacd_journal_t journal;           /* Completed tracks and checkpoints */
+    
+    /* Inline verification */
+    sacd_checksum_t checksum;         /* Audio payload hashes for current track */
+    
     /* Statistics */
     size_t total_bytes_written;       /* Total bytes written */
     double extraction_start_time;     /* Extraction start time */
+    sacd_extractor_stats_t stats;     /* Live counters (extraction thread only) */
+    sacd_extractor_stats_t published_stats; /* Snapshot for readers (stats_lock) */
+    sacd_seqlock_t stats_lock;
+    sacd_progress_t progress;         /* Snapshot for readers (progress_lock) */
+    sacd_seqlock_t progress_lock;
+    pthread_t notifier_thread;        /* Delivers progress_callback */
+    bool notifier_running;            /* notifier_thread was started */
+    bool notifier_stop;               /* Tells the notifier to exit (atomic) */
+    uint64_t output_base;             /* Sink position when the current track's output was opened */
+    
+    /* I/O pacing */
+    sacd_throttle_t read_throttle;    /* Disc reads */
+    sacd_throttle_t write_throttle;   /* Output writes */
+    uint64_t throttle_mark;           /* Sink position already charged to write_throttle */
+    int io_tid;                       /* Kernel thread id of the running extraction thread (atomic) */
+    
+    /* CPU placement (manual sets parsed at creation, automatic ones at start) */
+    sacd_cpuset_t extraction_cpus;
+    sacd_cpuset_t worker_cpus;
+    bool pin_extraction;              /* extraction_cpus applies */
+    bool pin_workers;                 /* worker_cpus applies */
+    uint64_t start_ns;                /* sacd_internal_clock_ns() at start (atomic) */
+    uint64_t finish_ns;               /* ... when the run finished, 0 while running (atomic) */
 };
 
+/* Operations slower than this count as stalls in the extraction statistics */
+#define SACD_STATS_STALL_NS   1000000ULL
+
+/* Sectors between publications of the extraction statistics */
+#define SACD_STATS_PUBLISH_SECTORS 256
+
+/* How often the notifier thread checks for progress to report */
+#define SACD_PROGRESS_NOTIFY_MS 50
+
+/* Sectors per disc read while extracting (512 KB) */
+#define SACD_SWEEP_READ_SECTORS 256
+
+/* Bandwidth limits allow bursts of this long at the full rate */
+#define SACD_THROTTLE_BURST_NS 100000000ULL
+
+/* Longest single sleep while throttled */
+#define SACD_THROTTLE_SLICE_NS 20000000ULL
+
 /* Internal utility functions */
 
+/**
+ * Monotonic clock in nanoseconds
+ */
+uint64_t sacd_internal_clock_ns(void);
+
+/**
+ * SACD time as a number of frames (1/75 s), and back
+ */
+uint32_t sacd_internal_time_to_frames(const sacd_time_t *time);
+void sacd_internal_frames_to_time(uint32_t frames, sacd_time_t *time);
+
+/**
+ * Seqlock publishing a structure from one writer to any number of readers.
+ * Readers never block the writer; they retry if they raced with an update.
+ */
+void sacd_internal_seqlock_write_begin(sacd_seqlock_t *lock);
+void sacd_internal_seqlock_write_end(sacd_seqlock_t *lock);
+
+/**
+ * Copy a consistent snapshot of 'size' bytes at 'src', guarded by 'lock'
+ */
+void sacd_internal_seqlock_read(const sacd_seqlock_t *lock, void *dest, const void *src, size_t size);
+
+/**
+ * Set a token bucket's rate in bytes per second (0 = unlimited), from any thread
+ */
+void sacd_internal_throttle_set_rate(sacd_throttle_t *throttle, uint64_t bytes_per_second);
+
+/**
+ * Charge 'bytes' to a token bucket, sleeping until they're within its rate.
+ * Returns early once *cancel becomes true.
+ * 
+ * @return Nanoseconds spent waiting
+ */
+uint64_t sacd_internal_throttle(sacd_throttle_t *throttle, uint64_t bytes, const bool *cancel);
+
+/**
+ * Apply an I/O scheduling class to a thread (see sacd_internal_thread_id)
+ */
+sacd_result_t sacd_internal_set_io_priority(int tid, sacd_io_priority_t priority, int level);
+
+/**
+ * Kernel thread id of the calling thread
+ */
+int sacd_internal_thread_id(void);
+
+/**
+ * CPU sets and NUMA topology. Node numbers are 0..count-1; a machine
+ * without NUMA information is one node.
+ */
+void sacd_internal_cpuset_clear(sacd_cpuset_t *set);
+void sacd_internal_cpuset_add(sacd_cpuset_t *set, int cpu);
+bool sacd_internal_cpuset_has(const sacd_cpuset_t *set, int cpu);
+int sacd_internal_cpuset_count(const sacd_cpuset_t *set);
+sacd_result_t sacd_internal_cpuset_parse(const char *list, sacd_cpuset_t *set);
+int sacd_internal_numa_node_count(void);
+sacd_result_t sacd_internal_numa_node_cpus(int node, sacd_cpuset_t *set);
+int sacd_internal_numa_node_of_cpu(int cpu);
+int sacd_internal_current_numa_node(void);
+
+/**
+ * Restrict the calling thread to a set of CPUs
+ */
+sacd_result_t sacd_internal_pin_thread(const sacd_cpuset_t *set);
+
+/**
+ * pthread_create() for a thread that only runs on 'cpus' (NULL = anywhere)
+ */
+int sacd_internal_thread_create(pthread_t *thread, const sacd_cpuset_t *cpus,
+                                void *(*start)(void *), void *arg);
+
+/**
+ * Register a hook invoked on the extraction thread once all queued tracks
+ * have been processed. The hook must not destroy the extractor itself.
+ */
+void sacd_internal_extractor_set_finish_hook(
+    sacd_extractor_t *extractor,
+    void (*hook)(void *data, sacd_result_t result),
+    void *data
+);
+
 /**
  * Read raw sectors from the disc
  */
@@ -129,13 +459,86 @@ sacd_result_t sacd_internal_read_sector(
 );
 
 /**
- * Extract DSD audio data from a sector
+ * Parse the packet and frame layout of an audio sector
+ */
+sacd_result_t sacd_internal_parse_audio_sector(
+    const uint8_t *sector_data,
+    sacd_audio_sector_t *sector
+);
+
+/**
+ * Audio frame demultiplexer (see sacd_demux.c). Sectors must be fed in disc
+ * order; after a jump, reset() drops the frame left incomplete.
+ */
+void sacd_internal_demux_init(sacd_demux_t *demux, int channel_count);
+void sacd_internal_demux_reset(sacd_demux_t *demux);
+void sacd_internal_demux_free(sacd_demux_t *demux);
+
+/**
+ * Feed the sector at 'lsn'; each frame it completes is passed to 'callback'.
+ * An error from the callback stops the sector and is returned.
  */
-uint8_t *sacd_internal_extract_dsd_from_sector(
+sacd_result_t sacd_internal_demux_sector(
+    sacd_demux_t *demux,
+    uint32_t lsn,
     const uint8_t *sector_data,
-    size_t *audio_size
+    sacd_frame_callback_t callback,
+    void *userdata
 );
 
+/**
+ * End of the stream: pass on the frame still being assembled, if complete
+ */
+sacd_result_t sacd_internal_demux_flush(sacd_demux_t *demux, sacd_frame_callback_t callback, void *userdata);
+
+/**
+ * DSD level meter (see sacd_level.c): set up for a track's frames, then
+ * measure each frame of interleaved DSD written
+ */
+void sacd_internal_level_init(sacd_level_meter_t *meter, int channel_count,
+                              uint32_t first_frame, uint32_t frame_count);
+void sacd_internal_level_frame(sacd_level_meter_t *meter, uint32_t frame, const uint8_t *data, size_t size);
+
+/**
+ * Silence detector (see sacd_silence.c): whether a frame of interleaved DSD
+ * is all idle pattern; then, per track, reset, pass each frame (which says
+ * whether to write it now or hold it back), drop the held frames once
+ * written, and finish at the end of the track
+ */
+bool sacd_internal_frame_is_silent(const uint8_t *data, size_t size);
+void sacd_internal_silence_reset(sacd_silence_t *silence, bool enabled, bool trim);
+sacd_result_t sacd_internal_silence_frame(sacd_silence_t *silence, uint32_t frame, const uint8_t *data,
+                                          size_t size, bool *write);
+void sacd_internal_silence_release(sacd_silence_t *silence);
+void sacd_internal_silence_finish(sacd_silence_t *silence);
+void sacd_internal_silence_free(sacd_silence_t *silence);
+
+/**
+ * Frame index (see sacd_index.c): build by scanning an area, look up the
+ * sector a frame starts in, save to and load from an index file
+ */
+sacd_result_t sacd_internal_frame_index_build(sacd_disc_internal_t *disc, const sacd_area_t *area,
+                                              sacd_frame_index_t *index);
+sacd_result_t sacd_internal_frame_index_lookup(const sacd_frame_index_t *index, uint32_t frame, uint32_t *lsn);
+void sacd_internal_frame_index_free(sacd_frame_index_t *index);
+sacd_result_t sacd_internal_frame_index_save(const sacd_frame_index_t *index, const sacd_area_t *area,
+                                             uint64_t disc_id, const char *path);
+sacd_result_t sacd_internal_frame_index_load(sacd_frame_index_t *index, const sacd_area_t *area,
+                                             uint64_t disc_id, const char *path);
+
+/**
+ * The disc's cached index of an area, built on first use. It lives until the
+ * disc is closed and is shared by every extractor of the disc.
+ */
+sacd_result_t sacd_internal_disc_frame_index(sacd_disc_internal_t *disc, const sacd_area_t *area,
+                                             const sacd_frame_index_t **index);
+
+/**
+ * Identity of the disc an area belongs to, for files kept across runs (frame
+ * index, journal): a hash of the master TOC's and the area TOC's first sectors
+ */
+uint64_t sacd_internal_disc_area_id(const sacd_disc_internal_t *disc, const sacd_area_t *area);
+
 /**
  * Create output filename for a track
  */
@@ -147,11 +550,16 @@ sacd_result_t sacd_internal_create_filename(
     size_t filename_size
 );
 
+/**
+ * Wrap an open stream in a file sink that reports 'position' as its offset
+ */
+sacd_result_t sacd_internal_sink_from_file(FILE *file, uint64_t position, sacd_sink_t **sink);
+
 /**
  * Write DSF file header
  */
 sacd_result_t sacd_internal_write_dsf_header(
-    FILE *file,
+    sacd_sink_t *sink,
     const sacd_track_t *track,
     const sacd_area_t *area,
     size_t audio_data_size
@@ -161,21 +569,226 @@ sacd_result_t sacd_internal_write_dsf_header(
  * Write DSDIFF file header
  */
 sacd_result_t sacd_internal_write_dsdiff_header(
-    FILE *file,
+    sacd_sink_t *sink,
     const sacd_track_t *track,
     const sacd_area_t *area,
     size_t audio_data_size
 );
 
 /**
- * Update file headers with final sizes
+ * Write WAV or Wave64 header (WAVE_FORMAT_EXTENSIBLE) for converted PCM.
+ * WAV reserves room for a ds64 chunk so it can become RF64 at finalize.
+ * On a sink that cannot seek the size must be exact, and a WAV that needs
+ * 64-bit sizes is written as RF64 immediately.
+ */
+sacd_result_t sacd_internal_write_pcm_header(
+    sacd_sink_t *sink,
+    sacd_output_format_t format,
+    const sacd_track_t *track,
+    uint32_t sample_rate,
+    sacd_pcm_sample_format_t sample_format,
+    uint64_t audio_data_size
+);
+
+/**
+ * Update WAV/Wave64 sizes at the end of the stream; a WAV that outgrew
+ * 32-bit sizes is promoted to RF64
+ */
+sacd_result_t sacd_internal_finalize_pcm_header(
+    sacd_sink_t *sink,
+    sacd_output_format_t format,
+    uint64_t audio_data_size,
+    int block_align
+);
+
+/**
+ * Write a DSDIFF header for DST-compressed audio (CMPR "DST "), followed by
+ * the "DST " chunk header and its FRTE chunk. Frames are added with
+ * sacd_internal_write_dst_frame(); sacd_internal_finalize_dsdiff_dst()
+ * appends the DSTI index and patches sizes.
+ */
+sacd_result_t sacd_internal_write_dsdiff_dst_header(
+    sacd_sink_t *sink,
+    const sacd_track_t *track,
+    const sacd_area_t *area,
+    sacd_dst_index_t *index
+);
+
+/**
+ * Write one DST frame as a DSTF chunk and record it in the index
+ */
+sacd_result_t sacd_internal_write_dst_frame(
+    sacd_sink_t *sink,
+    sacd_dst_index_t *index,
+    const uint8_t *frame,
+    size_t frame_size
+);
+
+/**
+ * Append the DSTI index chunk and patch chunk sizes and the frame count
+ */
+sacd_result_t sacd_internal_finalize_dsdiff_dst(sacd_sink_t *sink, sacd_dst_index_t *index);
+
+/**
+ * Free a DST frame index
+ */
+void sacd_internal_dst_index_free(sacd_dst_index_t *index);
+
+/**
+ * Update file headers with final sizes (and the DSF sample count)
  */
 sacd_result_t sacd_internal_finalize_file_headers(
-    FILE *file,
+    sacd_sink_t *sink,
     sacd_output_format_t format,
-    size_t audio_data_size
+    size_t audio_data_size,
+    int channel_count
+);
+
+/**
+ * Open the extraction journal in the output directory. With resume set, an
+ * existing journal for the same area and format is loaded; otherwise a fresh
+ * one replaces it.
+ */
+sacd_result_t sacd_internal_journal_open(
+    sacd_journal_t *journal,
+    const char *output_dir,
+    const sacd_area_t *area,
+    uint64_t disc_id,
+    sacd_output_format_t format,
+    bool resume
+);
+
+/**
+ * Close the journal and free its entries (the file is kept)
+ */
+void sacd_internal_journal_close(sacd_journal_t *journal);
+
+/**
+ * Delete the journal file, once there is nothing left to resume, and close it
+ */
+void sacd_internal_journal_remove(sacd_journal_t *journal);
+
+/**
+ * Look up the recorded state of a track (NULL if none)
+ */
+const sacd_journal_entry_t *sacd_internal_journal_lookup(
+    const sacd_journal_t *journal,
+    int track_number
+);
+
+/**
+ * Record a checkpoint; the caller must have synced the output file first
+ */
+sacd_result_t sacd_internal_journal_checkpoint(
+    sacd_journal_t *journal,
+    int track_number,
+    const char *filename,
+    uint32_t next_lsn,
+    uint32_t next_frame,
+    uint64_t bytes_written,
+    uint64_t file_offset
+);
+
+/**
+ * Record a completed track
+ */
+sacd_result_t sacd_internal_journal_complete(
+    sacd_journal_t *journal,
+    int track_number,
+    const char *filename,
+    uint64_t bytes_written
+);
+
+/**
+ * DSD to PCM converter. Input is interleaved DSD bytes (MSB first); output is
+ * interleaved little-endian PCM in the requested sample format. The returned
+ * buffer stays valid until the next call on the converter. stalls() counts the
+ * times the caller had to wait for the channel threads, which run on 'cpus'
+ * (NULL = anywhere).
+ */
+sacd_result_t sacd_internal_pcm_converter_create(
+    sacd_pcm_converter_t **converter,
+    int channel_count,
+    uint32_t sample_rate,
+    sacd_pcm_sample_format_t sample_format,
+    const sacd_cpuset_t *cpus
+);
+void sacd_internal_pcm_converter_destroy(sacd_pcm_converter_t *converter);
+void sacd_internal_pcm_converter_reset(sacd_pcm_converter_t *converter);
+uint64_t sacd_internal_pcm_converter_stalls(const sacd_pcm_converter_t *converter);
+sacd_result_t sacd_internal_pcm_convert(
+    sacd_pcm_converter_t *converter,
+    const uint8_t *dsd,
+    size_t dsd_size,
+    const uint8_t **pcm,
+    size_t *pcm_size
+);
+sacd_result_t sacd_internal_pcm_flush(
+    sacd_pcm_converter_t *converter,
+    const uint8_t **pcm,
+    size_t *pcm_size
 );
 
+/**
+ * FLAC encoder for 24-bit PCM from the converter. write_header resets the
+ * encoder for a new stream and reserves seek points for the estimated length;
+ * finalize rewrites STREAMINFO and SEEKTABLE in place. On a sink that cannot
+ * seek, the estimate must be the exact sample count and no SEEKTABLE or MD5
+ * is written. Encoded frames are
+ * returned in a buffer that stays valid until the next call. stalls() counts
+ * the times the caller had to wait for the worker threads. The workers run on
+ * 'cpus' (NULL = anywhere); thread_count 0 means one per CPU available.
+ */
+sacd_result_t sacd_internal_flac_encoder_create(
+    sacd_flac_encoder_t **encoder,
+    int channel_count,
+    uint32_t sample_rate,
+    int thread_count,
+    const sacd_cpuset_t *cpus
+);
+void sacd_internal_flac_encoder_destroy(sacd_flac_encoder_t *encoder);
+uint64_t sacd_internal_flac_encoder_stalls(const sacd_flac_encoder_t *encoder);
+sacd_result_t sacd_internal_flac_write_header(
+    sacd_flac_encoder_t *encoder,
+    sacd_sink_t *sink,
+    uint64_t estimated_samples
+);
+sacd_result_t sacd_internal_flac_encode(
+    sacd_flac_encoder_t *encoder,
+    const uint8_t *pcm,
+    size_t pcm_size,
+    const uint8_t **flac,
+    size_t *flac_size
+);
+sacd_result_t sacd_internal_flac_flush(
+    sacd_flac_encoder_t *encoder,
+    const uint8_t **flac,
+    size_t *flac_size
+);
+sacd_result_t sacd_internal_flac_finalize(sacd_flac_encoder_t *encoder, sacd_sink_t *sink);
+
+/**
+ * Streaming hash primitives
+ */
+void sacd_internal_xxh3_init(sacd_xxh3_state_t *state);
+void sacd_internal_xxh3_update(sacd_xxh3_state_t *state, const uint8_t *input, size_t len);
+uint64_t sacd_internal_xxh3_digest(const sacd_xxh3_state_t *state);
+
+void sacd_internal_md5_init(sacd_md5_state_t *state);
+void sacd_internal_md5_update(sacd_md5_state_t *state, const uint8_t *data, size_t len);
+void sacd_internal_md5_final(sacd_md5_state_t *state, uint8_t digest[16]);
+
+void sacd_internal_sha256_init(sacd_sha256_state_t *state);
+void sacd_internal_sha256_update(sacd_sha256_state_t *state, const uint8_t *data, size_t len);
+void sacd_internal_sha256_final(sacd_sha256_state_t *state, uint8_t digest[32]);
+
+/**
+ * Combined checksum context covering every enabled algorithm
+ */
+void sacd_internal_checksum_init(sacd_checksum_t *checksum, unsigned int types);
+void sacd_internal_checksum_update(sacd_checksum_t *checksum, const uint8_t *data, size_t len);
+void sacd_internal_checksum_final(sacd_checksum_t *checksum, sacd_track_report_t *report);
+
 /**
  * Calculate track duration in DSD samples
  */
@@ -186,6 +799,12 @@ uint64_t sacd_track_duration_samples(const sacd_track_t *track);
  */
 size_t sacd_estimate_track_file_size(const sacd_track_t *track, sacd_output_format_t format);
 
+/**
+ * Estimate the PCM payload size of a converted track
+ */
+uint64_t sacd_estimate_pcm_data_size(const sacd_track_t *track, uint32_t sample_rate,
+                                     sacd_pcm_sample_format_t sample_format);
+
 /* Debugging and logging (when enabled) */
 #ifdef SACD_DEBUG
 #define SACD_DEBUG_LOG(fmt, ...) fprintf(stderr, "[SACD] " fmt "\n", ##__VA_ARGS__)
@@ -0,0 +1,299 @@
+/**
+ * SACD Library - Extraction Journal
+ *
+ * A small text journal kept in the output directory that records which tracks
+ * are complete and, for the track in progress, the first LSN and frame whose
+ * data has not yet been durably written. A later run with options.resume set skips completed
+ * tracks and continues a partial file from its checkpoint instead of starting
+ * again at track 1, sector 0.
+ *
+ * The journal is rewritten atomically (temp file, fsync, rename, fsync of
+ * the directory) so a crash never leaves it half-written or loses it. Output
+ * data is always synced before the journal entry that refers to it. Once
+ * every track is done there is nothing to resume and the journal is removed.
+ */
+
+#include "sacd_lib.h"
+#include "sacd_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#define SACD_JOURNAL_FILENAME  ".sacd_journal"
+#define SACD_JOURNAL_MAGIC     "SACDJRNL"
+#define SACD_JOURNAL_VERSION   3
+
+/* Free per-track entries */
+static void journal_clear_entries(sacd_journal_t *journal) {
+    for (int i = 0; i < SACD_MAX_TRACKS; i++) {
+        free(journal->entries[i].filename);
+    }
+    memset(journal->entries, 0, sizeof(journal->entries));
+}
+
+/* Make a rename or unlink of the journal durable: sync the directory holding it */
+static bool sync_journal_directory(const sacd_journal_t *journal) {
+    const char *slash = strrchr(journal->path, '/');
+    char *directory = slash ? strndup(journal->path, (size_t)(slash - journal->path)) : strdup(".");
+    if (!directory) {
+        return false;
+    }
+
+    int fd = open(*directory ? directory : "/", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    free(directory);
+    if (fd < 0) {
+        return false;
+    }
+    bool ok = fsync(fd) == 0;
+    close(fd);
+    return ok;
+}
+
+/* Load an existing journal if it describes the same disc, area and format */
+static bool journal_load(sacd_journal_t *journal) {
+    FILE *f = fopen(journal->path, "r");
+    if (!f) {
+        return false;
+    }
+
+    char magic[16];
+    int version;
+    unsigned long long disc_id;
+    unsigned int start_lsn, end_lsn;
+    int track_count, format;
+
+    bool valid = fscanf(f, "%15s %d", magic, &version) == 2 &&
+                 strcmp(magic, SACD_JOURNAL_MAGIC) == 0 &&
+                 version == SACD_JOURNAL_VERSION &&
+                 fscanf(f, " disc %llx", &disc_id) == 1 &&
+                 disc_id == journal->disc_id &&
+                 fscanf(f, " area %u %u %d %d", &start_lsn, &end_lsn, &track_count, &format) == 4 &&
+                 start_lsn == journal->area_start_lsn &&
+                 end_lsn == journal->area_end_lsn &&
+                 track_count == journal->track_count &&
+                 format == (int)journal->format;
+
+    char kind[16];
+    while (valid && fscanf(f, "%15s", kind) == 1) {
+        int track;
+        unsigned int next_lsn, next_frame;
+        unsigned long long bytes, offset;
+        char filename[1024];
+
+        if (strcmp(kind, "done") == 0) {
+            if (fscanf(f, " %d %llu %1023[^\n]", &track, &bytes, filename) != 3) {
+                break;
+            }
+            next_lsn = 0;
+            next_frame = 0;
+            offset = 0;
+        } else if (strcmp(kind, "partial") == 0) {
+            if (fscanf(f, " %d %u %u %llu %llu %1023[^\n]", &track, &next_lsn, &next_frame,
+                       &bytes, &offset, filename) != 6) {
+                break;
+            }
+        } else {
+            break;
+        }
+
+        if (track < 0 || track >= SACD_MAX_TRACKS) {
+            continue;
+        }
+
+        sacd_journal_entry_t *entry = &journal->entries[track];
+        free(entry->filename);
+        entry->filename = strdup(filename);
+        entry->state = (kind[0] == 'd') ? SACD_JOURNAL_DONE : SACD_JOURNAL_PARTIAL;
+        entry->next_lsn = next_lsn;
+        entry->next_frame = next_frame;
+        entry->bytes_written = bytes;
+        entry->file_offset = offset;
+    }
+
+    fclose(f);
+
+    if (!valid) {
+        journal_clear_entries(journal);
+    }
+    return valid;
+}
+
+/* Atomically rewrite the journal file */
+static sacd_result_t journal_save(sacd_journal_t *journal) {
+    size_t tmp_len = strlen(journal->path) + 5;
+    char *tmp_path = malloc(tmp_len);
+    if (!tmp_path) {
+        return SACD_RESULT_OUT_OF_MEMORY;
+    }
+    snprintf(tmp_path, tmp_len, "%s.tmp", journal->path);
+
+    FILE *f = fopen(tmp_path, "w");
+    if (!f) {
+        free(tmp_path);
+        return SACD_RESULT_IO_ERROR;
+    }
+
+    fprintf(f, "%s %d\n", SACD_JOURNAL_MAGIC, SACD_JOURNAL_VERSION);
+    fprintf(f, "disc %016llx\n", (unsigned long long)journal->disc_id);
+    fprintf(f, "area %u %u %d %d\n", journal->area_start_lsn, journal->area_end_lsn,
+            journal->track_count, (int)journal->format);
+
+    for (int i = 0; i < SACD_MAX_TRACKS; i++) {
+        const sacd_journal_entry_t *entry = &journal->entries[i];
+        if (entry->state == SACD_JOURNAL_DONE) {
+            fprintf(f, "done %d %llu %s\n", i,
+                    (unsigned long long)entry->bytes_written, entry->filename);
+        } else if (entry->state == SACD_JOURNAL_PARTIAL) {
+            fprintf(f, "partial %d %u %u %llu %llu %s\n", i, entry->next_lsn, entry->next_frame,
+                    (unsigned long long)entry->bytes_written,
+                    (unsigned long long)entry->file_offset, entry->filename);
+        }
+    }
+
+    bool ok = fflush(f) == 0 && fsync(fileno(f)) == 0;
+    ok = (fclose(f) == 0) && ok;
+
+    if (!ok || rename(tmp_path, journal->path) != 0) {
+        unlink(tmp_path);
+        free(tmp_path);
+        return SACD_RESULT_IO_ERROR;
+    }
+
+    free(tmp_path);
+    return sync_journal_directory(journal) ? SACD_RESULT_OK : SACD_RESULT_IO_ERROR;
+}
+
+/* Open (or start) the journal for an extraction */
+sacd_result_t sacd_internal_journal_open(
+    sacd_journal_t *journal,
+    const char *output_dir,
+    const sacd_area_t *area,
+    uint64_t disc_id,
+    sacd_output_format_t format,
+    bool resume) {
+
+    if (!journal || !output_dir || !area) {
+        return SACD_RESULT_ERROR;
+    }
+
+    memset(journal, 0, sizeof(sacd_journal_t));
+
+    size_t path_len = strlen(output_dir) + strlen(SACD_JOURNAL_FILENAME) + 2;
+    journal->path = malloc(path_len);
+    if (!journal->path) {
+        return SACD_RESULT_OUT_OF_MEMORY;
+    }
+    snprintf(journal->path, path_len, "%s/%s", output_dir, SACD_JOURNAL_FILENAME);
+
+    journal->disc_id = disc_id;
+    journal->area_start_lsn = area->start_lsn;
+    journal->area_end_lsn = area->end_lsn;
+    journal->track_count = area->track_count;
+    journal->format = format;
+
+    if (resume && journal_load(journal)) {
+        SACD_DEBUG_LOG("Journal: resuming from %s", journal->path);
+        return SACD_RESULT_OK;
+    }
+
+    /* Fresh run: replace any stale journal */
+    return journal_save(journal);
+}
+
+/* Close the journal */
+void sacd_internal_journal_close(sacd_journal_t *journal) {
+    if (!journal) {
+        return;
+    }
+
+    journal_clear_entries(journal);
+    free(journal->path);
+    memset(journal, 0, sizeof(sacd_journal_t));
+}
+
+/* Delete the journal file and close it */
+void sacd_internal_journal_remove(sacd_journal_t *journal) {
+    if (!journal || !journal->path) {
+        return;
+    }
+
+    if (unlink(journal->path) == 0) {
+        sync_journal_directory(journal);
+    }
+    sacd_internal_journal_close(journal);
+}
+
+/* Look up a track's journal entry */
+const sacd_journal_entry_t *sacd_internal_journal_lookup(
+    const sacd_journal_t *journal,
+    int track_number) {
+
+    if (!journal || !journal->path || track_number < 0 || track_number >= SACD_MAX_TRACKS) {
+        return NULL;
+    }
+
+    const sacd_journal_entry_t *entry = &journal->entries[track_number];
+    return (entry->state == SACD_JOURNAL_NONE) ? NULL : entry;
+}
+
+/* Update a track entry and persist the journal */
+static sacd_result_t journal_record(
+    sacd_journal_t *journal,
+    int track_number,
+    sacd_journal_state_t state,
+    const char *filename,
+    uint32_t next_lsn,
+    uint32_t next_frame,
+    uint64_t bytes_written,
+    uint64_t file_offset) {
+
+    if (!journal || !journal->path || !filename ||
+        track_number < 0 || track_number >= SACD_MAX_TRACKS) {
+        return SACD_RESULT_ERROR;
+    }
+
+    sacd_journal_entry_t *entry = &journal->entries[track_number];
+    if (!entry->filename || strcmp(entry->filename, filename) != 0) {
+        char *copy = strdup(filename);
+        if (!copy) {
+            return SACD_RESULT_OUT_OF_MEMORY;
+        }
+        free(entry->filename);
+        entry->filename = copy;
+    }
+
+    entry->state = state;
+    entry->next_lsn = next_lsn;
+    entry->next_frame = next_frame;
+    entry->bytes_written = bytes_written;
+    entry->file_offset = file_offset;
+
+    return journal_save(journal);
+}
+
+/* Record a durable checkpoint for an in-progress track */
+sacd_result_t sacd_internal_journal_checkpoint(
+    sacd_journal_t *journal,
+    int track_number,
+    const char *filename,
+    uint32_t next_lsn,
+    uint32_t next_frame,
+    uint64_t bytes_written,
+    uint64_t file_offset) {
+
+    return journal_record(journal, track_number, SACD_JOURNAL_PARTIAL, filename,
+                          next_lsn, next_frame, bytes_written, file_offset);
+}
+
+/* Record a completed track */
+sacd_result_t sacd_internal_journal_complete(
+    sacd_journal_t *journal,
+    int track_number,
+    const char *filename,
+    uint64_t bytes_written) {
+
+    return journal_record(journal, track_number, SACD_JOURNAL_DONE, filename,
+                          0, 0, bytes_written, 0);
+}
@@ -0,0 +1,273 @@
+/**
+ * SACD Library - DSD Level Meter
+ *
+ * The level of a one-bit DSD stream is its density of ones: 50% is silence,
+ * 0% and 100% are full scale. Over a short window the modulation depth is
+ * |2 * ones - bits| / bits; the SACD specification puts 0 dB at 50%
+ * modulation and calls anything beyond it an overload.
+ *
+ * Windows are SACD_LEVEL_WINDOW_BYTES of each channel (256 bits, ~90 us at
+ * 2.8224 MHz), short enough to catch a peak but long enough to average out
+ * the shaped noise. Channels are byte interleaved, so the stream is loaded
+ * as 64-bit words and the ones in every byte are counted at once with the
+ * usual shift-and-add popcount, stopping while each byte still holds its own
+ * count. The byte counts are summed over the window and only then split up
+ * between the channels.
+ *
+ * Peaks are gathered into SACD_LEVEL_BUCKETS buckets spread over the track,
+ * for an overview of the whole track in a few bytes.
+ */
+
+#include "sacd_lib.h"
+#include "sacd_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Bits of a channel in a window, and the largest deviation |2 * ones - bits| within the limit */
+#define WINDOW_BITS       (SACD_LEVEL_WINDOW_BYTES * 8)
+#define OVERLOAD_LIMIT    (WINDOW_BITS / 2)
+
+/* Words handled together: one channel's share of a window */
+#define VECTOR_WORDS (SACD_LEVEL_WINDOW_BYTES / 8)
+typedef uint64_t word_vector_t __attribute__((vector_size(SACD_LEVEL_WINDOW_BYTES)));
+
+/* Number of ones in each byte of 'x', in that byte */
+static inline uint64_t byte_popcounts(uint64_t x) {
+    x = x - ((x >> 1) & 0x5555555555555555ULL);
+    x = (x & 0x3333333333333333ULL) + ((x >> 2) & 0x3333333333333333ULL);
+    return (x + (x >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+}
+
+/* Words before the channels of a word's bytes repeat: the odd part of the channel count */
+static inline int lane_period(int channels) {
+    return (channels % 4 == 0) ? channels / 4 : (channels % 2 == 0) ? channels / 2 : channels;
+}
+
+/* Set up a meter for a track of frames [first_frame, first_frame + frame_count) */
+void sacd_internal_level_init(sacd_level_meter_t *meter, int channel_count,
+                              uint32_t first_frame, uint32_t frame_count) {
+    memset(meter, 0, sizeof(sacd_level_meter_t));
+    if (channel_count < 1 || channel_count > SACD_PCM_MAX_CHANNELS) {
+        return;
+    }
+    meter->channel_count = channel_count;
+    meter->first_frame = first_frame;
+    meter->frame_count = frame_count ? frame_count : 1;
+    meter->report.valid = true;
+
+    /*
+     * Byte i of a window belongs to channel i % channel_count, so the
+     * channels of a word's bytes repeat every few words. Loading the channel
+     * numbers the same way as the audio tells which byte lane holds which
+     * channel.
+     */
+    for (int p = 0; p < lane_period(channel_count); p++) {
+        uint8_t bytes[8];
+        for (int b = 0; b < 8; b++) {
+            bytes[b] = (uint8_t)((p * 8 + b) % channel_count);
+        }
+        uint64_t word;
+        memcpy(&word, bytes, 8);
+        for (int lane = 0; lane < 8; lane++) {
+            if ((uint8_t)(word >> (8 * lane)) < channel_count) {
+                meter->lane_masks[p][(word >> (8 * lane)) & 0xff] |= 0xffULL << (8 * lane);
+            }
+        }
+    }
+}
+
+/* The same on a vector of words, in place (wide vectors are not passed by value) */
+static inline void byte_popcounts_vector(word_vector_t *x) {
+    word_vector_t v = *x;
+    v = v - ((v >> 1) & 0x5555555555555555ULL);
+    v = (v & 0x3333333333333333ULL) + ((v >> 2) & 0x3333333333333333ULL);
+    *x = (v + (v >> 4)) & 0x0f0f0f0f0f0f0f0fULL;
+}
+
+/* Sum of the bytes of 'x' picked out by 'mask' (at most 256 in a window) */
+static inline uint32_t masked_sum(uint64_t x, uint64_t mask) {
+    x &= mask;
+    x = (x & 0x00ff00ff00ff00ffULL) + ((x >> 8) & 0x00ff00ff00ff00ffULL);
+    return (uint32_t)((x * 0x0001000100010001ULL) >> 48);
+}
+
+/*
+ * Measure 'windows' consecutive windows of 'channels' channels: returns the
+ * largest deviation and adds the number of windows past the limit to
+ * '*overloads'. Inlined with a constant channel count so the loops unroll
+ * and the counts stay in registers.
+ */
+static inline uint32_t measure_windows(const sacd_level_meter_t *meter, int channels, const uint8_t *data,
+                                       size_t windows, uint64_t *overloads) {
+    const int period = lane_period(channels);
+    const int words = channels * SACD_LEVEL_WINDOW_BYTES / 8;
+    uint32_t peak = 0;
+    uint64_t overloaded = 0;
+
+    for (size_t n = 0; n < windows; n++) {
+        /* A lane sums at most 8 bits from each of words / period words, well under 256 */
+        uint64_t lanes[SACD_PCM_MAX_CHANNELS] = { 0 };
+        if (period == 1) {
+            /* Every word has the same layout, so whole vectors of words can be summed */
+            word_vector_t sum = { 0 };
+            for (int w = 0; w < words; w += VECTOR_WORDS) {
+                word_vector_t vector;
+                memcpy(&vector, data + w * 8, sizeof(vector));
+                byte_popcounts_vector(&vector);
+                sum += vector;
+            }
+            for (int i = 0; i < VECTOR_WORDS; i++) {
+                lanes[0] += sum[i];
+            }
+        } else {
+            for (int w = 0; w < words; w += period) {
+                for (int p = 0; p < period; p++) {
+                    uint64_t word;
+                    memcpy(&word, data + (w + p) * 8, 8);
+                    lanes[p] += byte_popcounts(word);
+                }
+            }
+        }
+        data += (size_t)words * 8;
+
+        bool overload = false;
+        for (int ch = 0; ch < channels; ch++) {
+            uint32_t ones = 0;
+            for (int p = 0; p < period; p++) {
+                ones += masked_sum(lanes[p], meter->lane_masks[p][ch]);
+            }
+            uint32_t deviation = (2 * ones > WINDOW_BITS) ? 2 * ones - WINDOW_BITS : WINDOW_BITS - 2 * ones;
+            if (deviation > peak) {
+                peak = deviation;
+            }
+            overload |= deviation > OVERLOAD_LIMIT;
+        }
+        overloaded += overload;
+    }
+
+    *overloads += overloaded;
+    return peak;
+}
+
+/* Measure whole windows of a frame with the kernel for its channel count */
+static uint32_t measure_frame(sacd_level_meter_t *meter, const uint8_t *data, size_t windows) {
+    uint64_t *overloads = &meter->report.overload_windows;
+    switch (meter->channel_count) {
+    case 1:  return measure_windows(meter, 1, data, windows, overloads);
+    case 2:  return measure_windows(meter, 2, data, windows, overloads);
+    case 3:  return measure_windows(meter, 3, data, windows, overloads);
+    case 4:  return measure_windows(meter, 4, data, windows, overloads);
+    case 5:  return measure_windows(meter, 5, data, windows, overloads);
+    default: return measure_windows(meter, 6, data, windows, overloads);
+    }
+}
+
+/* Measure one frame of interleaved DSD; 'frame' is its timecode in frames */
+void sacd_internal_level_frame(sacd_level_meter_t *meter, uint32_t frame, const uint8_t *data, size_t size) {
+    if (!meter->report.valid || !data) {
+        return;
+    }
+
+    size_t windows = size / ((size_t)meter->channel_count * SACD_LEVEL_WINDOW_BYTES);
+    uint32_t peak = measure_frame(meter, data, windows);
+    uint8_t percent = (uint8_t)((peak * 100 + WINDOW_BITS / 2) / WINDOW_BITS);
+
+    if (percent > meter->report.peak_modulation) {
+        meter->report.peak_modulation = percent;
+    }
+    uint32_t offset = frame > meter->first_frame ? frame - meter->first_frame : 0;
+    uint64_t bucket = (uint64_t)offset * SACD_LEVEL_BUCKETS / meter->frame_count;
+    if (bucket >= SACD_LEVEL_BUCKETS) {
+        bucket = SACD_LEVEL_BUCKETS - 1;
+    }
+    if (percent > meter->report.overview[bucket]) {
+        meter->report.overview[bucket] = percent;
+    }
+}
+
+/* State of a standalone scan */
+typedef struct {
+    sacd_level_meter_t meter;
+    sacd_dst_decoder_t decoder;
+    uint32_t end_frame;
+} level_scan_t;
+
+static sacd_result_t scan_frame(const sacd_audio_frame_t *frame, void *userdata) {
+    level_scan_t *scan = (level_scan_t*)userdata;
+    uint32_t number = sacd_internal_time_to_frames(&frame->timecode);
+
+    /* The track's last sector may start the next track */
+    if (number < scan->meter.first_frame || number >= scan->end_frame) {
+        return SACD_RESULT_OK;
+    }
+
+    if (!frame->dst_encoded) {
+        sacd_internal_level_frame(&scan->meter, number, frame->data, frame->size);
+        return SACD_RESULT_OK;
+    }
+
+    uint8_t *decoded = NULL;
+    size_t decoded_size = 0;
+    if (sacd_internal_dst_decode_frame(&scan->decoder, frame->data, frame->size,
+                                       &decoded, &decoded_size) == SACD_RESULT_OK) {
+        sacd_internal_level_frame(&scan->meter, number, decoded, decoded_size);
+    }
+    free(decoded);
+    return SACD_RESULT_OK;
+}
+
+/* Scan a track's levels without extracting it */
+sacd_result_t sacd_disc_scan_levels(const sacd_disc_t *disc, const sacd_area_t *area, int track_number,
+                                    sacd_level_report_t *report) {
+    if (!disc || !area || !report || track_number < 0 || track_number >= area->track_count) {
+        return SACD_RESULT_ERROR;
+    }
+    memset(report, 0, sizeof(sacd_level_report_t));
+
+    sacd_disc_internal_t *internal = (sacd_disc_internal_t*)disc->internal_data;
+    const sacd_track_t *track = &area->tracks[track_number];
+    uint32_t first_frame = sacd_internal_time_to_frames(&track->start_time);
+    uint32_t frame_count = sacd_internal_time_to_frames(&track->duration);
+
+    level_scan_t *scan = calloc(1, sizeof(level_scan_t));
+    uint8_t *buffer = malloc((size_t)SACD_SWEEP_READ_SECTORS * SACD_LSN_SIZE);
+    if (!scan || !buffer || sacd_internal_dst_decoder_init(&scan->decoder) != SACD_RESULT_OK) {
+        free(scan);
+        free(buffer);
+        return SACD_RESULT_OUT_OF_MEMORY;
+    }
+    sacd_internal_level_init(&scan->meter, area->channel_count, first_frame, frame_count);
+    scan->end_frame = first_frame + frame_count;
+
+    sacd_demux_t demux;
+    sacd_internal_demux_init(&demux, area->channel_count);
+
+    sacd_result_t result = SACD_RESULT_OK;
+    uint32_t end_lsn = track->start_lsn + track->length_lsn;
+    for (uint32_t lsn = track->start_lsn; result == SACD_RESULT_OK && lsn < end_lsn; ) {
+        uint32_t count = end_lsn - lsn;
+        if (count > SACD_SWEEP_READ_SECTORS) {
+            count = SACD_SWEEP_READ_SECTORS;
+        }
+        result = sacd_internal_read_sectors(internal, lsn, count, buffer);
+        for (uint32_t i = 0; result == SACD_RESULT_OK && i < count; i++) {
+            if (sacd_internal_demux_sector(&demux, lsn + i, buffer + (size_t)i * SACD_LSN_SIZE,
+                                           scan_frame, scan) == SACD_RESULT_OUT_OF_MEMORY) {
+                result = SACD_RESULT_OUT_OF_MEMORY;
+            }
+        }
+        lsn += count;
+    }
+    if (result == SACD_RESULT_OK) {
+        result = sacd_internal_demux_flush(&demux, scan_frame, scan);
+    }
+
+    if (result == SACD_RESULT_OK) {
+        *report = scan->meter.report;
+    }
+    sacd_internal_demux_free(&demux);
+    sacd_internal_dst_decoder_cleanup(&scan->decoder);
+    free(scan);
+    free(buffer);
+    return result;
+}
@@ -37,6 +37,9 @@ typedef struct sacd_disc sacd_disc_t;
 typedef struct sacd_area sacd_area_t;
 typedef struct sacd_track sacd_track_t;
 typedef struct sacd_extractor sacd_extractor_t;
+typedef struct sacd_scheduler sacd_scheduler_t;
+typedef struct sacd_sink sacd_sink_t;
+typedef struct sacd_library sacd_library_t;
 
 /* Enumerations */
 typedef enum {
@@ -47,9 +50,17 @@ typedef enum {
 typedef enum {
     SACD_FORMAT_DSF = 0,     /* Sony DSD Stream File */
     SACD_FORMAT_DSDIFF,      /* DSD Interchange File Format */
-    SACD_FORMAT_DSDIFF_EM    /* DSDIFF Edit Master */
+    SACD_FORMAT_DSDIFF_EM,   /* DSDIFF Edit Master */
+    SACD_FORMAT_WAV,         /* PCM converted from DSD, in WAV (RF64 past 4 GB) */
+    SACD_FORMAT_FLAC,        /* PCM converted from DSD, FLAC encoded (24-bit) */
+    SACD_FORMAT_W64          /* PCM converted from DSD, in Sony Wave64 */
 } sacd_output_format_t;
 
+typedef enum {
+    SACD_PCM_S24 = 0,        /* 24-bit signed integer */
+    SACD_PCM_F32             /* 32-bit IEEE float */
+} sacd_pcm_sample_format_t;
+
 typedef enum {
     SACD_FRAME_DST = 0,      /* DST compressed */
     SACD_FRAME_DSD_3_IN_14,  /* DSD 3-in-14 */
@@ -67,6 +78,36 @@ typedef enum {
     SACD_RESULT_CANCELLED
 } sacd_result_t;
 
+/* Where extracted tracks are written */
+typedef enum {
+    SACD_SINK_FILE = 0,      /* One file per track in the output directory */
+    SACD_SINK_FD,            /* Tracks written back to back to an open descriptor (pipe, stdout) */
+    SACD_SINK_MEMORY,        /* Each track buffered in memory and handed to track_data_callback */
+    SACD_SINK_NULL           /* Discarded (benchmarking, verification) */
+} sacd_sink_type_t;
+
+/* Placement of an extraction's threads on CPUs */
+typedef enum {
+    SACD_CPU_PLACEMENT_AUTO = 0,   /* Keep each extraction on one NUMA node (multi-node machines only) */
+    SACD_CPU_PLACEMENT_NONE,       /* Leave placement to the OS scheduler */
+    SACD_CPU_PLACEMENT_MANUAL      /* Use extraction_cpus and worker_cpus */
+} sacd_cpu_placement_t;
+
+/* I/O scheduling class of the extraction thread (Linux ioprio; ignored elsewhere) */
+typedef enum {
+    SACD_IO_PRIORITY_DEFAULT = 0,  /* Leave the class inherited from the process */
+    SACD_IO_PRIORITY_BEST_EFFORT,  /* Normal class, at io_priority_level */
+    SACD_IO_PRIORITY_IDLE          /* Only use the disk when nothing else does */
+} sacd_io_priority_t;
+
+/* Checksum algorithms (bit flags) */
+typedef enum {
+    SACD_CHECKSUM_NONE   = 0,
+    SACD_CHECKSUM_XXH3   = 1 << 0,   /* XXH3-64, fast default */
+    SACD_CHECKSUM_MD5    = 1 << 1,   /* MD5, for interop */
+    SACD_CHECKSUM_SHA256 = 1 << 2    /* SHA-256, for interop */
+} sacd_checksum_type_t;
+
 /* Character sets for text fields */
 typedef enum {
     SACD_CHARSET_UNKNOWN = 0,
@@ -174,6 +215,87 @@ struct sacd_disc {
     void *internal_data;           /* Private library data */
 };
 
+/* Buckets of a track's level overview */
+#define SACD_LEVEL_BUCKETS     64
+
+/*
+ * DSD levels of a track, as modulation depth in percent: 0 is silence, 50 is
+ * the SACD 0 dB limit, 100 is a stream of all ones or all zeros
+ */
+typedef struct {
+    bool valid;                    /* Levels were measured */
+    uint8_t peak_modulation;       /* Highest modulation in any ~90 us window */
+    uint64_t overload_windows;     /* Windows in which a channel went past 50% */
+    uint8_t overview[SACD_LEVEL_BUCKETS]; /* Peak modulation of each 1/64 of the track */
+} sacd_level_report_t;
+
+/*
+ * Digital silence in a track, in 1/75 second frames: frames holding nothing
+ * but the DSD idle pattern (0x69 or 0x96 in every byte)
+ */
+typedef struct {
+    bool valid;                    /* Frames were checked (not for DST passed through) */
+    uint32_t silent_frames;        /* Silent frames anywhere in the track */
+    uint32_t leading_frames;       /* Silence before the first audible frame */
+    uint32_t trailing_frames;      /* Silence after the last audible frame */
+    bool trimmed;                  /* Leading and trailing silence were left out of the file */
+} sacd_silence_report_t;
+
+/* Per-track extraction report */
+typedef struct {
+    /* Checksums of the audio payload only (headers excluded) */
+    unsigned int checksum_types;   /* SACD_CHECKSUM_* bits that are valid */
+    uint64_t xxh3;                 /* XXH3-64 */
+    uint8_t md5[16];               /* MD5 */
+    uint8_t sha256[32];            /* SHA-256 */
+    
+    /* DSD levels of the frames written (see measure_levels) */
+    sacd_level_report_t levels;
+    
+    /* Digital silence found (see trim_silence) */
+    sacd_silence_report_t silence;
+} sacd_track_report_t;
+
+/* Extraction statistics, cumulative since sacd_extractor_start() */
+typedef struct {
+    /* Input */
+    uint64_t sectors_read;         /* Disc sectors read */
+    uint64_t bytes_read;           /* Bytes read from the image */
+    uint64_t read_ns;              /* Time spent reading sectors */
+    uint64_t read_stalls;          /* Sector reads that took over 1 ms */
+    
+    /* Processing */
+    uint64_t decode_ns;            /* Demux, DST decode, PCM conversion and FLAC encoding */
+    uint64_t decode_stalls;        /* Waits for PCM/FLAC worker threads to finish a block */
+    
+    /* Output */
+    uint64_t bytes_written;        /* Bytes written to sinks, headers included */
+    uint64_t write_ns;             /* Time spent writing, flushing and finalizing output */
+    uint64_t write_stalls;         /* Output operations that took over 1 ms */
+    uint64_t throttle_ns;          /* Time held back by the bandwidth limits */
+    
+    /* Queue */
+    int tracks_queued;             /* Tracks in the extraction queue */
+    int tracks_pending;            /* Queued tracks not yet finished */
+    int tracks_completed;          /* Tracks finished successfully */
+    uint64_t elapsed_ns;           /* Wall time since start (frozen once finished) */
+    uint64_t track_wall_ns[SACD_MAX_TRACKS]; /* Wall time per track, indexed like sacd_area_t.tracks */
+} sacd_extractor_stats_t;
+
+/* Extraction progress, as published by the extraction thread */
+typedef struct {
+    bool running;                  /* Extraction thread active */
+    sacd_result_t result;          /* Overall result (final once !running) */
+    int track_number;              /* Current track (1-based, 0 before the first start) */
+    int queue_index;               /* Position of the current track in the queue */
+    int total_tracks;              /* Tracks in the extraction queue */
+    int track_progress_percent;    /* Progress within current track (0-100) */
+    int overall_progress_percent;  /* Overall progress (0-100) */
+    uint64_t track_bytes_written;  /* Audio bytes written for the current track */
+    uint64_t total_bytes_written;  /* Audio bytes written for finished tracks */
+    uint64_t sequence;             /* Increases with every update */
+} sacd_progress_t;
+
 /* Progress callback function types */
 typedef void (*sacd_progress_callback_t)(
     int track_number,              /* Current track (1-based) */
@@ -196,15 +318,39 @@ typedef void (*sacd_track_complete_callback_t)(
     const sacd_track_t *track,     /* Track information */
     const char *output_filename,   /* Output filename */
     size_t bytes_written,          /* Bytes written to file */
+    const sacd_track_report_t *report, /* Checksums and analysis */
     void *userdata                 /* User-provided data */
 );
 
+typedef void (*sacd_track_data_callback_t)(
+    int track_number,              /* Track completed (1-based) */
+    const sacd_track_t *track,     /* Track information */
+    const uint8_t *data,           /* Complete output file contents */
+    size_t size,                   /* Size of data */
+    void *userdata                 /* User-provided data */
+);
+
+/* Output sink. write() appends at position; pwrite() patches earlier bytes and
+ * is NULL when the sink is not seekable, in which case headers must be sized
+ * up front. close() releases the sink. */
+struct sacd_sink {
+    sacd_result_t (*write)(sacd_sink_t *sink, const void *data, size_t size);
+    sacd_result_t (*pwrite)(sacd_sink_t *sink, const void *data, size_t size, uint64_t offset);
+    sacd_result_t (*flush)(sacd_sink_t *sink, bool durable);
+    sacd_result_t (*close)(sacd_sink_t *sink);
+    uint64_t position;             /* Bytes written so far */
+    void *context;                 /* Implementation data */
+};
+
 /* Extraction options */
 typedef struct {
     sacd_output_format_t format;   /* Output format */
     bool convert_dst;              /* Convert DST to DSD */
     bool export_cue_sheet;         /* Export cue sheet */
-    bool include_pauses;           /* Include track pauses */
+    bool include_pauses;           /* Write the pause before each track (from the end of the
+                                      previous track, or the start of the area) into it */
+    bool area_sweep;               /* Read the queued tracks in disc order in one continuous
+                                      pass; off = one pass per track, in queue order */
     bool trim_whitespace;          /* Trim whitespace from filenames */
     
     /* DSF-specific options */
@@ -218,7 +364,45 @@ typedef struct {
     bool add_artist_to_folder;     /* Add artist to folder name */
     bool add_performer_to_filename; /* Add performer to filename */
     
-    /* Progress callbacks */
+    /* Crash-safe resume */
+    bool resume;                   /* Continue from the output directory's journal */
+    uint32_t checkpoint_sectors;   /* Sectors between durable checkpoints (0 = no journal) */
+    
+    /* Inline verification */
+    unsigned int checksums;        /* SACD_CHECKSUM_* flags computed while writing */
+    bool write_checksum_manifest;  /* Append checksums to audio-checksums.txt */
+    bool measure_levels;           /* Measure DSD levels and overloads into the track report
+                                      (off by default; not for DST passed through undecoded) */
+    bool trim_silence;             /* Leave out leading and trailing digital silence, in whole
+                                      frames (not for DST passed through or unseekable sinks) */
+    
+    /* PCM conversion (SACD_FORMAT_WAV, SACD_FORMAT_W64, SACD_FORMAT_FLAC) */
+    uint32_t pcm_sample_rate;      /* 88200 or 176400 */
+    sacd_pcm_sample_format_t pcm_sample_format; /* Output sample format (FLAC is always 24-bit) */
+    int encoder_threads;           /* FLAC encoding threads (0 = one per CPU) */
+    
+    /* Output destination */
+    sacd_sink_type_t sink_type;    /* Where tracks are written */
+    int sink_fd;                   /* Descriptor for SACD_SINK_FD (not closed) */
+    sacd_track_data_callback_t track_data_callback; /* Receives SACD_SINK_MEMORY output */
+    
+    /* I/O pacing, for extractions sharing disks with other users */
+    uint64_t read_bytes_per_sec;   /* Disc image read limit (0 = unlimited) */
+    uint64_t write_bytes_per_sec;  /* Output write limit (0 = unlimited) */
+    sacd_io_priority_t io_priority; /* I/O scheduling class of the extraction thread */
+    int io_priority_level;         /* Best-effort level, 0 (highest) to 7 */
+    
+    /* CPU placement (buffers are allocated on the node the threads run on) */
+    sacd_cpu_placement_t cpu_placement;
+    int numa_node;                 /* Node for SACD_CPU_PLACEMENT_AUTO (-1 = the caller's) */
+    const char *extraction_cpus;   /* Manual: CPU list ("0-3,8") for the read/write thread, NULL = any */
+    const char *worker_cpus;       /* Manual: CPU list for PCM/FLAC workers, NULL = extraction_cpus */
+    
+    /*
+     * Progress callbacks. progress_callback is optional and runs on its own
+     * notifier thread, never on the extraction thread;
+     * sacd_extractor_get_progress() can be polled instead.
+     */
     sacd_progress_callback_t progress_callback;
     sacd_track_start_callback_t track_start_callback;
     sacd_track_complete_callback_t track_complete_callback;
@@ -230,6 +414,86 @@ struct sacd_extractor {
     void *internal_data;               /* Internal implementation data */
 };
 
+/* Storage device classes used by the batch scheduler */
+typedef enum {
+    SACD_DEVICE_UNKNOWN = 0,           /* Network, virtual or undetected */
+    SACD_DEVICE_ROTATIONAL,            /* Spinning disk */
+    SACD_DEVICE_SOLID_STATE            /* SSD / NVMe */
+} sacd_device_class_t;
+
+/* Batch job completion callback */
+typedef void (*sacd_job_complete_callback_t)(
+    int job_id,                    /* Job identifier from sacd_scheduler_add_job() */
+    const char *iso_path,          /* Source ISO */
+    sacd_result_t result,          /* Extraction result */
+    void *userdata                 /* User-provided data */
+);
+
+/* Batch scheduler options (per-device concurrency defaults) */
+typedef struct {
+    int hdd_readers;               /* Concurrent jobs reading one rotational device */
+    int hdd_writers;               /* Concurrent jobs writing one rotational device */
+    int ssd_readers;               /* Concurrent jobs reading one solid-state device */
+    int ssd_writers;               /* Concurrent jobs writing one solid-state device */
+    int other_readers;             /* Concurrent jobs reading an unclassified device */
+    int other_writers;             /* Concurrent jobs writing an unclassified device */
+    int max_jobs;                  /* Global cap on running jobs (0 = no cap) */
+    bool balance_numa_nodes;       /* Put AUTO-placed jobs on the least busy NUMA node */
+    
+    sacd_job_complete_callback_t job_complete_callback;
+    void *callback_userdata;       /* User data for callbacks */
+} sacd_scheduler_options_t;
+
+/* A disc in a library catalogue; strings are owned by the library */
+typedef struct {
+    const char *path;              /* Image file */
+    const char *title;             /* Album title ("" if none) */
+    const char *artist;            /* Album artist ("" if none) */
+    uint16_t year;                 /* 0 if unknown */
+    uint16_t track_count;          /* Tracks of the stereo area, else the multichannel one */
+    uint8_t stereo_channels;       /* Channels of the two-channel area (0 = none) */
+    uint8_t multichannel_channels; /* Channels of the multichannel area (0 = none) */
+    bool dst_encoded;              /* Some area is DST coded */
+    bool hybrid;                   /* A CD layer is present */
+    uint64_t file_size;            /* File as catalogued, to spot changes */
+    int64_t mtime;
+} sacd_library_entry_t;
+
+/* Library catalogue query; every condition set must hold */
+typedef struct {
+    const char *title;             /* Case-insensitive part of the title (NULL = any) */
+    const char *artist;            /* Case-insensitive part of the artist (NULL = any) */
+    int year_from;                 /* Inclusive year range (0 = open) */
+    int year_to;
+    int channel_count;             /* Some area has this many channels (0 = any) */
+    int dst;                       /* 1 = DST coded, -1 = plain DSD, 0 = either */
+} sacd_library_query_t;
+
+/* File formats told apart by content */
+typedef enum {
+    SACD_FILE_UNKNOWN = 0,
+    SACD_FILE_SACD_ISO,            /* SACD disc image (master TOC at LSN 510) */
+    SACD_FILE_ISO9660,             /* Other ISO 9660 image */
+    SACD_FILE_DSF,
+    SACD_FILE_DSDIFF,              /* DSDIFF, DSD or DST coded (see dst_encoded) */
+    SACD_FILE_FLAC,
+    SACD_FILE_WAV,
+    SACD_FILE_RF64,
+    SACD_FILE_W64,
+    SACD_FILE_AIFF                 /* AIFF or AIFF-C */
+} sacd_file_type_t;
+
+/* What a probe found; stream fields are 0 where the header doesn't say */
+typedef struct {
+    sacd_file_type_t type;
+    uint32_t sample_rate;          /* Hz (2822400 for an SACD image) */
+    uint16_t channels;             /* Channels (an SACD image's stereo area if it has one) */
+    uint16_t bits_per_sample;      /* 1 for DSD */
+    uint64_t sample_count;         /* Samples per channel */
+    bool dst_encoded;              /* DST coded DSDIFF, or SACD area */
+    uint64_t file_size;
+} sacd_file_info_t;
+
 /* Main library functions */
 
 /**
@@ -265,6 +529,55 @@ const sacd_area_t *sacd_disc_get_area(const sacd_disc_t *disc, sacd_area_type_t
  */
 const sacd_area_t *sacd_disc_get_best_area(const sacd_disc_t *disc);
 
+/**
+ * Find the sector in which the audio frame at a given time starts. The first
+ * call for an area scans the area once to index its frames; the index is
+ * kept with the disc, so later lookups (and extractors) don't read anything.
+ * 
+ * @param disc The disc
+ * @param area Area the time refers to
+ * @param time Time from the start of the area
+ * @param lsn Pointer to receive the sector
+ * @return SACD_RESULT_OK on success, SACD_RESULT_ERROR if no frame has that time
+ */
+sacd_result_t sacd_disc_find_frame(const sacd_disc_t *disc, const sacd_area_t *area,
+                                   const sacd_time_t *time, uint32_t *lsn);
+
+/**
+ * Save an area's frame index (building it if needed) so a later session can
+ * load it instead of scanning the area
+ * 
+ * @param disc The disc
+ * @param area The area
+ * @param path Index file to write; replaced atomically
+ * @return SACD_RESULT_OK on success, error code on failure
+ */
+sacd_result_t sacd_disc_save_frame_index(const sacd_disc_t *disc, const sacd_area_t *area, const char *path);
+
+/**
+ * Load an area's frame index saved by sacd_disc_save_frame_index()
+ * 
+ * @param disc The disc
+ * @param area The area
+ * @param path Index file to read
+ * @return SACD_RESULT_OK on success, SACD_RESULT_INVALID_FILE if the file is
+ *         missing, damaged or belongs to another disc
+ */
+sacd_result_t sacd_disc_load_frame_index(const sacd_disc_t *disc, const sacd_area_t *area, const char *path);
+
+/**
+ * Measure a track's DSD levels without extracting it: peak modulation,
+ * overloads past the SACD 50% limit and an overview for drawing the track
+ * 
+ * @param disc The disc
+ * @param area Area of the track
+ * @param track_number Track number (0-based)
+ * @param report Pointer to receive the levels
+ * @return SACD_RESULT_OK on success, error code on failure
+ */
+sacd_result_t sacd_disc_scan_levels(const sacd_disc_t *disc, const sacd_area_t *area, int track_number,
+                                    sacd_level_report_t *report);
+
 /**
  * Create an extractor for the specified area
  * 
@@ -304,6 +617,26 @@ sacd_result_t sacd_extractor_add_tracks(
     int track_count
 );
 
+/**
+ * Add a time range to the extraction queue. The range is written as a file
+ * of its own, cut at frame (1/75 s) boundaries, in any output format; it may
+ * start or end inside a track, cover pauses and span several tracks. Only the
+ * sectors holding its frames are read, found through the area's frame index
+ * (see sacd_disc_find_frame()). Ranges are not journaled, so an interrupted
+ * range is extracted again in full.
+ * 
+ * @param extractor The extractor
+ * @param start_time First frame, from the start of the area
+ * @param end_time Frame after the last one
+ * @return SACD_RESULT_OK on success, SACD_RESULT_INVALID_TRACK if the range
+ *         ends after the area's last track, error code on other failures
+ */
+sacd_result_t sacd_extractor_add_range(
+    sacd_extractor_t *extractor,
+    const sacd_time_t *start_time,
+    const sacd_time_t *end_time
+);
+
 /**
  * Add all tracks in the area to the extraction queue
  * 
@@ -343,6 +676,300 @@ bool sacd_extractor_is_running(const sacd_extractor_t *extractor);
  */
 sacd_result_t sacd_extractor_wait(sacd_extractor_t *extractor);
 
+/**
+ * Get extraction statistics
+ * 
+ * Counters are kept by the extraction thread and published every few
+ * hundred sectors and at track boundaries, so this is cheap to poll. Where
+ * the time goes tells whether a slow rip is disk-bound (read_ns,
+ * read_stalls), CPU-bound (decode_ns, decode_stalls) or output-bound
+ * (write_ns, write_stalls).
+ * 
+ * @param extractor The extractor
+ * @param stats Receives the statistics of the current or last run
+ * @return SACD_RESULT_OK on success, error code on failure
+ */
+sacd_result_t sacd_extractor_get_stats(const sacd_extractor_t *extractor, sacd_extractor_stats_t *stats);
+
+/**
+ * Change the bandwidth limits of an extraction
+ * 
+ * Takes effect within a few milliseconds, also while an extraction is
+ * running. Overrides options.read_bytes_per_sec and write_bytes_per_sec.
+ * 
+ * @param extractor The extractor
+ * @param read_bytes_per_sec Disc image read limit (0 = unlimited)
+ * @param write_bytes_per_sec Output write limit (0 = unlimited)
+ * @return SACD_RESULT_OK on success, error code on failure
+ */
+sacd_result_t sacd_extractor_set_bandwidth(sacd_extractor_t *extractor,
+                                           uint64_t read_bytes_per_sec,
+                                           uint64_t write_bytes_per_sec);
+
+/**
+ * Change the I/O scheduling class of an extraction
+ * 
+ * Applies to the running extraction thread immediately, and to later runs.
+ * SACD_IO_PRIORITY_DEFAULT only affects later runs.
+ * 
+ * @param extractor The extractor
+ * @param priority I/O scheduling class
+ * @param level Best-effort level, 0 (highest) to 7
+ * @return SACD_RESULT_OK on success, SACD_RESULT_ERROR if the class
+ *         couldn't be applied (e.g. not supported on this platform)
+ */
+sacd_result_t sacd_extractor_set_io_priority(sacd_extractor_t *extractor,
+                                             sacd_io_priority_t priority, int level);
+
+/**
+ * Get extraction progress
+ * 
+ * Reads the latest snapshot published by the extraction thread without
+ * taking locks, so any thread can poll it (e.g. from a UI timer) at any
+ * rate without slowing the extraction down. The snapshot is updated on
+ * every percent of track progress and at track boundaries; compare
+ * sequence to tell whether anything changed since the last poll.
+ * 
+ * @param extractor The extractor
+ * @param progress Receives the progress of the current or last run
+ * @return SACD_RESULT_OK on success, error code on failure
+ */
+sacd_result_t sacd_extractor_get_progress(const sacd_extractor_t *extractor, sacd_progress_t *progress);
+
+/* Batch scheduling */
+
+/**
+ * Initialize default scheduler options
+ * 
+ * Defaults: one reader and one writer per rotational device, four of each
+ * per solid-state device, two of each for unclassified devices. Jobs with
+ * SACD_CPU_PLACEMENT_AUTO are spread over the NUMA nodes.
+ * 
+ * @param options Pointer to options structure to initialize
+ */
+void sacd_scheduler_options_init(sacd_scheduler_options_t *options);
+
+/**
+ * Create a batch scheduler
+ * 
+ * Jobs are grouped by the st_dev of their source ISO and output directory.
+ * A job only starts while both devices have a free reader/writer slot, so
+ * two rips on the same spinning disk never run at once while jobs on other
+ * devices proceed in parallel.
+ * 
+ * @param options Scheduler options (NULL for defaults)
+ * @param scheduler Pointer to receive scheduler
+ * @return SACD_RESULT_OK on success, error code on failure
+ */
+sacd_result_t sacd_scheduler_create(const sacd_scheduler_options_t *options,
+                                    sacd_scheduler_t **scheduler);
+
+/**
+ * Destroy a scheduler, cancelling any running jobs
+ * 
+ * @param scheduler Scheduler to destroy
+ */
+void sacd_scheduler_destroy(sacd_scheduler_t *scheduler);
+
+/**
+ * Override concurrency limits for the device holding a path
+ * 
+ * @param scheduler The scheduler
+ * @param path Any path on the device
+ * @param max_readers Concurrent reading jobs (0 keeps the class default)
+ * @param max_writers Concurrent writing jobs (0 keeps the class default)
+ * @return SACD_RESULT_OK on success, error code on failure
+ */
+sacd_result_t sacd_scheduler_set_device_limits(sacd_scheduler_t *scheduler,
+                                               const char *path,
+                                               int max_readers,
+                                               int max_writers);
+
+/**
+ * Queue an extraction job
+ * 
+ * The disc is opened when the job is dispatched and closed when it finishes.
+ * 
+ * @param scheduler The scheduler
+ * @param iso_path Path to the SACD ISO file
+ * @param area_type Preferred area (falls back to the best available area)
+ * @param output_dir Output directory for files
+ * @param track_numbers Track numbers (0-based), or NULL for all tracks
+ * @param track_count Number of entries in track_numbers
+ * @param options Extraction options (copied)
+ * @param job_id Optional pointer to receive the job identifier
+ * @return SACD_RESULT_OK on success, error code on failure
+ */
+sacd_result_t sacd_scheduler_add_job(sacd_scheduler_t *scheduler,
+                                     const char *iso_path,
+                                     sacd_area_type_t area_type,
+                                     const char *output_dir,
+                                     const int *track_numbers,
+                                     int track_count,
+                                     const sacd_extraction_options_t *options,
+                                     int *job_id);
+
+/**
+ * Start dispatching queued jobs
+ * 
+ * Jobs may still be added while the scheduler is running.
+ * 
+ * @param scheduler The scheduler
+ * @return SACD_RESULT_OK on success, error code on failure
+ */
+sacd_result_t sacd_scheduler_start(sacd_scheduler_t *scheduler);
+
+/**
+ * Cancel running jobs and drop pending ones
+ * 
+ * @param scheduler The scheduler
+ */
+void sacd_scheduler_cancel(sacd_scheduler_t *scheduler);
+
+/**
+ * Wait until every queued job has finished
+ * 
+ * @param scheduler The scheduler
+ * @return SACD_RESULT_OK if all jobs succeeded, otherwise the first failure
+ */
+sacd_result_t sacd_scheduler_wait(sacd_scheduler_t *scheduler);
+
+/**
+ * Create an empty library catalogue
+ * 
+ * @param library Pointer to receive the catalogue
+ * @return SACD_RESULT_OK on success, error code on failure
+ */
+sacd_result_t sacd_library_create(sacd_library_t **library);
+
+/**
+ * Destroy a library catalogue and every entry and string in it
+ * 
+ * @param library Catalogue to destroy (NULL is ignored)
+ */
+void sacd_library_destroy(sacd_library_t *library);
+
+/**
+ * Catalogue every SACD image under a directory
+ * 
+ * The tree is walked by a pool of threads. Files are recognised by the
+ * master TOC signature, whatever their name. Symbolic links to directories
+ * are not followed. Entries already catalogued under the root are kept
+ * without reopening the image if its size and modification time are
+ * unchanged, and dropped if the file is gone.
+ * 
+ * @param library The catalogue
+ * @param root Directory to walk
+ * @param threads Worker threads (0 = default)
+ * @return SACD_RESULT_OK on success, SACD_RESULT_IO_ERROR if the root can't be read
+ */
+sacd_result_t sacd_library_crawl(sacd_library_t *library, const char *root, int threads);
+
+/**
+ * Save a catalogue; the file is replaced atomically
+ * 
+ * @param library The catalogue
+ * @param path Index file to write
+ * @return SACD_RESULT_OK on success, error code on failure
+ */
+sacd_result_t sacd_library_save(const sacd_library_t *library, const char *path);
+
+/**
+ * Load a catalogue saved by sacd_library_save(), replacing the entries
+ * 
+ * @param library The catalogue
+ * @param path Index file to read
+ * @return SACD_RESULT_OK on success, SACD_RESULT_INVALID_FILE if the file is
+ *         missing or damaged
+ */
+sacd_result_t sacd_library_load(sacd_library_t *library, const char *path);
+
+/**
+ * Number of discs in a catalogue
+ * 
+ * @param library The catalogue
+ * @return Entry count
+ */
+int sacd_library_count(const sacd_library_t *library);
+
+/**
+ * Get a catalogue entry; entries are sorted by path
+ * 
+ * @param library The catalogue
+ * @param index Entry index (0-based)
+ * @return The entry, or NULL if out of range. Valid until the catalogue
+ *         is next crawled, loaded or destroyed.
+ */
+const sacd_library_entry_t *sacd_library_get(const sacd_library_t *library, int index);
+
+/**
+ * Initialize a query that matches everything
+ * 
+ * @param query Query to initialize
+ */
+void sacd_library_query_init(sacd_library_query_t *query);
+
+/**
+ * Find the entries matching a query
+ * 
+ * @param library The catalogue
+ * @param query Conditions
+ * @param indices Array to receive matching entry indices, in path order (may be NULL)
+ * @param max_indices Size of the array
+ * @return Number of matching entries (may exceed max_indices)
+ */
+int sacd_library_find(const sacd_library_t *library, const sacd_library_query_t *query,
+                      int *indices, int max_indices);
+
+/**
+ * Tell what a file holds from its content
+ * 
+ * One block at the start of the file is read and checked for the DSF,
+ * DSDIFF, FLAC, WAV, RF64, Wave64 and AIFF headers; files that are none of
+ * those are checked for the SACD master TOC and then the ISO 9660 volume
+ * descriptor. The extension plays no part.
+ * 
+ * @param path File to probe
+ * @param info Structure to receive the result (type SACD_FILE_UNKNOWN if unrecognised)
+ * @return SACD_RESULT_OK if the file was read, SACD_RESULT_IO_ERROR if it can't be
+ */
+sacd_result_t sacd_probe_file(const char *path, sacd_file_info_t *info);
+
+/**
+ * sacd_probe_file() for a name relative to an open directory
+ * 
+ * @param dir_fd Directory descriptor (AT_FDCWD for the working directory)
+ * @param name File to probe
+ * @param info Structure to receive the result
+ * @return SACD_RESULT_OK if the file was read, SACD_RESULT_IO_ERROR if it can't be
+ */
+sacd_result_t sacd_probe_file_at(int dir_fd, const char *name, sacd_file_info_t *info);
+
+/**
+ * Probe many files at once
+ * 
+ * The files are split into batches shared among worker threads. A worker
+ * opens a whole batch and asks for every header it will read before
+ * reading the first, so the reads of a batch are in flight together.
+ * 
+ * @param dir_fd Directory relative names are resolved against (AT_FDCWD for the working directory)
+ * @param names Files to probe
+ * @param count Number of files
+ * @param infos Array of count results; unreadable files get SACD_FILE_UNKNOWN
+ * @param threads Worker threads (0 = default)
+ * @return Number of files recognised
+ */
+int sacd_probe_files(int dir_fd, const char *const *names, int count,
+                     sacd_file_info_t *infos, int threads);
+
+/**
+ * Get the name of a file type
+ * 
+ * @param type File type
+ * @return Short name (e.g. "DSF")
+ */
+const char *sacd_file_type_name(sacd_file_type_t type);
+
 /* Utility functions */
 
 /**
@@ -385,6 +1012,26 @@ const char *sacd_format_extension(sacd_output_format_t format);
  */
 const char *sacd_format_description(sacd_output_format_t format);
 
+/**
+ * Get the name of a checksum algorithm
+ * 
+ * @param type Single checksum type
+ * @return Algorithm name (e.g. "XXH3")
+ */
+const char *sacd_checksum_name(sacd_checksum_type_t type);
+
+/**
+ * Format a reported checksum as lowercase hex
+ * 
+ * @param report Track report
+ * @param type Single checksum type
+ * @param buffer Buffer to receive the hex string (65 bytes fits all types)
+ * @param buffer_size Size of buffer
+ * @return True if the checksum was present and formatted
+ */
+bool sacd_checksum_format(const sacd_track_report_t *report, sacd_checksum_type_t type,
+                          char *buffer, size_t buffer_size);
+
 /**
  * Initialize default extraction options
  * 
@@ -392,6 +1039,61 @@ const char *sacd_format_description(sacd_output_format_t format);
  */
 void sacd_extraction_options_init(sacd_extraction_options_t *options);
 
+/**
+ * Open a sink that creates (or truncates) a file
+ * 
+ * @param path File to write
+ * @param sink Pointer to receive the sink
+ * @return SACD_RESULT_OK on success
+ */
+sacd_result_t sacd_sink_open_file(const char *path, sacd_sink_t **sink);
+
+/**
+ * Open a sink on an existing descriptor
+ * 
+ * The sink is seekable only if the descriptor is; offsets are relative to
+ * the descriptor's position when the sink was opened. The descriptor is
+ * left open when the sink is closed.
+ * 
+ * @param fd Open descriptor
+ * @param sink Pointer to receive the sink
+ * @return SACD_RESULT_OK on success
+ */
+sacd_result_t sacd_sink_open_fd(int fd, sacd_sink_t **sink);
+
+/**
+ * Open a sink that collects everything in a growable buffer
+ * 
+ * @param sink Pointer to receive the sink
+ * @return SACD_RESULT_OK on success
+ */
+sacd_result_t sacd_sink_open_memory(sacd_sink_t **sink);
+
+/**
+ * Get the contents of a memory sink
+ * 
+ * @param sink Memory sink
+ * @param size Pointer to receive the size
+ * @return Buffer owned by the sink, or NULL if it is not a memory sink
+ */
+const uint8_t *sacd_sink_memory_data(const sacd_sink_t *sink, size_t *size);
+
+/**
+ * Open a sink that discards everything
+ * 
+ * @param sink Pointer to receive the sink
+ * @return SACD_RESULT_OK on success
+ */
+sacd_result_t sacd_sink_open_null(sacd_sink_t **sink);
+
+/**
+ * Flush and close a sink
+ * 
+ * @param sink Sink to close (NULL is ignored)
+ * @return SACD_RESULT_OK if all buffered data was written
+ */
+sacd_result_t sacd_sink_close(sacd_sink_t *sink);
+
 /**
  * Create a safe filename from track text
  * 
@@ -0,0 +1,735 @@
+/**
+ * SACD Library - Disc Library Catalogue
+ *
+ * A catalogue lists the SACD images found under one or more directory
+ * trees with the album details needed to search them. A crawl walks a tree
+ * with a pool of threads sharing one queue of directories and files, so
+ * opening and parsing thousands of images overlaps with reading the next
+ * directories instead of waiting on each in turn. Files are recognised by
+ * content (the master TOC signature, found by sacd_probe_file()), not by
+ * name; only the images that have it are parsed.
+ *
+ * Strings live in a few large blocks owned by the catalogue rather than in
+ * a small allocation each. The saved index is the entry records followed by
+ * one block of strings, which is loaded back with a single read.
+ */
+
+#include "sacd_lib.h"
+#include "sacd_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+#define LIBRARY_MAGIC      "SACDLIBX"
+#define LIBRARY_VERSION    1
+
+/* Bytes of a saved entry record */
+#define RECORD_BYTES       36
+
+#define RECORD_DST         0x01
+#define RECORD_HYBRID      0x02
+
+#define DEFAULT_THREADS    16
+#define MAX_THREADS        64
+
+/* Allocation unit of the string blocks */
+#define STRING_BLOCK_BYTES (64 * 1024)
+
+typedef struct string_block {
+    struct string_block *next;
+    size_t used;
+    size_t size;
+    char data[];
+} string_block_t;
+
+struct sacd_library {
+    sacd_library_entry_t *entries; /* Sorted by path */
+    int count;
+    int capacity;
+    string_block_t *strings;
+};
+
+/* A directory to list or a file to probe */
+typedef struct {
+    char *path;
+    bool is_directory;
+} crawl_item_t;
+
+typedef struct {
+    const sacd_library_t *previous; /* Catalogue before the crawl, for unchanged files */
+
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    crawl_item_t *queue;           /* Stack: depth first keeps it short */
+    int queue_count;
+    int queue_capacity;
+    int busy;                      /* Workers holding an item */
+    bool failed;                   /* Out of memory: stop early */
+
+    sacd_library_t *found;         /* Entries found under the root */
+} crawl_t;
+
+/* ---- Entries and strings ---- */
+
+/* Copy a string into the catalogue's blocks */
+static const char *intern(sacd_library_t *library, const char *s) {
+    if (!s || !*s) {
+        return "";
+    }
+
+    size_t length = strlen(s) + 1;
+    string_block_t *block = library->strings;
+    if (!block || block->size - block->used < length) {
+        size_t size = length > STRING_BLOCK_BYTES ? length : STRING_BLOCK_BYTES;
+        block = malloc(sizeof(string_block_t) + size);
+        if (!block) {
+            return NULL;
+        }
+        block->used = 0;
+        block->size = size;
+        block->next = library->strings;
+        library->strings = block;
+    }
+
+    char *copy = block->data + block->used;
+    memcpy(copy, s, length);
+    block->used += length;
+    return copy;
+}
+
+static void free_strings(sacd_library_t *library) {
+    while (library->strings) {
+        string_block_t *next = library->strings->next;
+        free(library->strings);
+        library->strings = next;
+    }
+}
+
+/* Append a copy of an entry, its strings copied into this catalogue */
+static sacd_result_t add_entry(sacd_library_t *library, const sacd_library_entry_t *entry) {
+    if (library->count == library->capacity) {
+        int capacity = library->capacity ? library->capacity * 2 : 64;
+        sacd_library_entry_t *entries = realloc(library->entries, capacity * sizeof(sacd_library_entry_t));
+        if (!entries) {
+            return SACD_RESULT_OUT_OF_MEMORY;
+        }
+        library->entries = entries;
+        library->capacity = capacity;
+    }
+
+    sacd_library_entry_t *copy = &library->entries[library->count];
+    *copy = *entry;
+    copy->path = intern(library, entry->path);
+    copy->title = intern(library, entry->title);
+    copy->artist = intern(library, entry->artist);
+    if (!copy->path || !copy->title || !copy->artist) {
+        return SACD_RESULT_OUT_OF_MEMORY;
+    }
+    library->count++;
+    return SACD_RESULT_OK;
+}
+
+static int compare_entries(const void *a, const void *b) {
+    return strcmp(((const sacd_library_entry_t *)a)->path, ((const sacd_library_entry_t *)b)->path);
+}
+
+static const sacd_library_entry_t *find_path(const sacd_library_t *library, const char *path) {
+    if (library->count == 0) {
+        return NULL;
+    }
+    sacd_library_entry_t key = { .path = path };
+    return bsearch(&key, library->entries, library->count, sizeof(sacd_library_entry_t), compare_entries);
+}
+
+/* Take over another catalogue's entries and strings, dropping our own */
+static void replace_contents(sacd_library_t *library, sacd_library_t *from) {
+    free(library->entries);
+    free_strings(library);
+    *library = *from;
+    memset(from, 0, sizeof(sacd_library_t));
+}
+
+sacd_result_t sacd_library_create(sacd_library_t **library) {
+    if (!library) {
+        return SACD_RESULT_ERROR;
+    }
+
+    *library = calloc(1, sizeof(sacd_library_t));
+    if (!*library) {
+        return SACD_RESULT_OUT_OF_MEMORY;
+    }
+    return SACD_RESULT_OK;
+}
+
+void sacd_library_destroy(sacd_library_t *library) {
+    if (!library) {
+        return;
+    }
+
+    free(library->entries);
+    free_strings(library);
+    free(library);
+}
+
+int sacd_library_count(const sacd_library_t *library) {
+    return library ? library->count : 0;
+}
+
+const sacd_library_entry_t *sacd_library_get(const sacd_library_t *library, int index) {
+    if (!library || index < 0 || index >= library->count) {
+        return NULL;
+    }
+    return &library->entries[index];
+}
+
+/* ---- Crawling ---- */
+
+/* Fill in an entry from a parsed disc */
+static void describe_disc(const sacd_disc_t *disc, sacd_library_entry_t *entry) {
+    const sacd_area_t *best = sacd_disc_get_best_area(disc);
+
+    entry->title = disc->text.title;
+    entry->artist = disc->text.artist;
+    if (best && (!entry->title || !*entry->title)) {
+        entry->title = best->text.title;
+    }
+    if (best && (!entry->artist || !*entry->artist)) {
+        entry->artist = best->text.artist;
+    }
+    entry->year = disc->year;
+    entry->track_count = best ? (uint16_t)best->track_count : 0;
+    entry->hybrid = disc->is_hybrid;
+
+    for (int a = 0; a < disc->area_count; a++) {
+        const sacd_area_t *area = &disc->areas[a];
+        if (area->type == SACD_AREA_STEREO) {
+            entry->stereo_channels = (uint8_t)area->channel_count;
+        } else {
+            entry->multichannel_channels = (uint8_t)area->channel_count;
+        }
+        for (int t = 0; t < area->track_count; t++) {
+            if (area->tracks[t].dst_encoded) {
+                entry->dst_encoded = true;
+            }
+        }
+    }
+}
+
+static void record_entry(crawl_t *crawl, const sacd_library_entry_t *entry) {
+    pthread_mutex_lock(&crawl->mutex);
+    if (add_entry(crawl->found, entry) != SACD_RESULT_OK) {
+        crawl->failed = true;
+    }
+    pthread_mutex_unlock(&crawl->mutex);
+}
+
+static void crawl_file(crawl_t *crawl, const char *path) {
+    struct stat st;
+    if (stat(path, &st) != 0 || !S_ISREG(st.st_mode)) {
+        return;
+    }
+    int64_t mtime = (int64_t)st.st_mtim.tv_sec * 1000000000 + st.st_mtim.tv_nsec;
+
+    /* Unchanged since the last crawl: keep what we knew */
+    const sacd_library_entry_t *known = find_path(crawl->previous, path);
+    if (known && known->file_size == (uint64_t)st.st_size && known->mtime == mtime) {
+        record_entry(crawl, known);
+        return;
+    }
+
+    sacd_file_info_t info;
+    if (sacd_probe_file(path, &info) != SACD_RESULT_OK || info.type != SACD_FILE_SACD_ISO) {
+        return;
+    }
+    sacd_disc_t *disc;
+    if (sacd_disc_open(path, &disc) != SACD_RESULT_OK) {
+        return;
+    }
+
+    sacd_library_entry_t entry = { 0 };
+    describe_disc(disc, &entry);
+    entry.path = path;
+    entry.file_size = (uint64_t)st.st_size;
+    entry.mtime = mtime;
+    record_entry(crawl, &entry);
+    sacd_disc_close(disc);
+}
+
+static char *join_path(const char *directory, const char *name) {
+    size_t dir_len = strlen(directory);
+    size_t name_len = strlen(name);
+    char *path = malloc(dir_len + name_len + 2);
+    if (!path) {
+        return NULL;
+    }
+    memcpy(path, directory, dir_len);
+    path[dir_len] = '/';
+    memcpy(path + dir_len + 1, name, name_len + 1);
+    return path;
+}
+
+/* Queue a batch of items; called with the mutex held */
+static bool push_items(crawl_t *crawl, crawl_item_t *items, int count) {
+    if (crawl->queue_count + count > crawl->queue_capacity) {
+        int capacity = crawl->queue_capacity ? crawl->queue_capacity : 256;
+        while (capacity < crawl->queue_count + count) {
+            capacity *= 2;
+        }
+        crawl_item_t *queue = realloc(crawl->queue, capacity * sizeof(crawl_item_t));
+        if (!queue) {
+            return false;
+        }
+        crawl->queue = queue;
+        crawl->queue_capacity = capacity;
+    }
+    memcpy(crawl->queue + crawl->queue_count, items, count * sizeof(crawl_item_t));
+    crawl->queue_count += count;
+    return true;
+}
+
+/* List a directory and queue what it holds, all at once */
+static void crawl_directory(crawl_t *crawl, const char *path) {
+    DIR *dir = opendir(path);
+    if (!dir) {
+        return;
+    }
+
+    crawl_item_t *items = NULL;
+    int count = 0;
+    int capacity = 0;
+    bool ok = true;
+    struct dirent *de;
+    while (ok && (de = readdir(dir)) != NULL) {
+        if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0) {
+            continue;
+        }
+
+        /* Symbolic links are followed to files but never to directories */
+        bool is_directory = de->d_type == DT_DIR;
+        if (de->d_type == DT_UNKNOWN) {
+            struct stat st;
+            if (fstatat(dirfd(dir), de->d_name, &st, AT_SYMLINK_NOFOLLOW) != 0) {
+                continue;
+            }
+            is_directory = S_ISDIR(st.st_mode);
+            if (!is_directory && !S_ISREG(st.st_mode) && !S_ISLNK(st.st_mode)) {
+                continue;
+            }
+        } else if (de->d_type != DT_DIR && de->d_type != DT_REG && de->d_type != DT_LNK) {
+            continue;
+        }
+
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 64;
+            crawl_item_t *grown = realloc(items, capacity * sizeof(crawl_item_t));
+            if (!grown) {
+                ok = false;
+                break;
+            }
+            items = grown;
+        }
+        items[count].path = join_path(path, de->d_name);
+        items[count].is_directory = is_directory;
+        ok = items[count].path != NULL;
+        count += ok;
+    }
+    closedir(dir);
+
+    pthread_mutex_lock(&crawl->mutex);
+    if (ok && count > 0) {
+        ok = push_items(crawl, items, count);
+    }
+    if (!ok) {
+        crawl->failed = true;
+        for (int i = 0; i < count; i++) {
+            free(items[i].path);
+        }
+    }
+    pthread_cond_broadcast(&crawl->cond);
+    pthread_mutex_unlock(&crawl->mutex);
+    free(items);
+}
+
+/* Take items until the queue is empty and no worker can add more */
+static void *crawl_worker(void *arg) {
+    crawl_t *crawl = arg;
+
+    pthread_mutex_lock(&crawl->mutex);
+    for (;;) {
+        while (crawl->queue_count == 0 && crawl->busy > 0 && !crawl->failed) {
+            pthread_cond_wait(&crawl->cond, &crawl->mutex);
+        }
+        if (crawl->queue_count == 0 || crawl->failed) {
+            break;
+        }
+
+        crawl_item_t item = crawl->queue[--crawl->queue_count];
+        crawl->busy++;
+        pthread_mutex_unlock(&crawl->mutex);
+
+        if (item.is_directory) {
+            crawl_directory(crawl, item.path);
+        } else {
+            crawl_file(crawl, item.path);
+        }
+        free(item.path);
+
+        pthread_mutex_lock(&crawl->mutex);
+        crawl->busy--;
+    }
+    pthread_cond_broadcast(&crawl->cond);
+    pthread_mutex_unlock(&crawl->mutex);
+    return NULL;
+}
+
+/* Whether a catalogued path lies under the root being crawled */
+static bool under_root(const char *path, const char *root, size_t root_len) {
+    return strncmp(path, root, root_len) == 0 && (path[root_len] == '/' || root[root_len - 1] == '/');
+}
+
+sacd_result_t sacd_library_crawl(sacd_library_t *library, const char *root, int threads) {
+    if (!library || !root || !*root) {
+        return SACD_RESULT_ERROR;
+    }
+
+    struct stat st;
+    if (stat(root, &st) != 0 || !S_ISDIR(st.st_mode) || access(root, R_OK | X_OK) != 0) {
+        return SACD_RESULT_IO_ERROR;
+    }
+
+    /* "dir/" and "dir" are the same root */
+    size_t root_len = strlen(root);
+    while (root_len > 1 && root[root_len - 1] == '/') {
+        root_len--;
+    }
+    char *root_path = strndup(root, root_len);
+    if (!root_path) {
+        return SACD_RESULT_OUT_OF_MEMORY;
+    }
+
+    if (threads <= 0) {
+        threads = DEFAULT_THREADS;
+    }
+    if (threads > MAX_THREADS) {
+        threads = MAX_THREADS;
+    }
+
+    sacd_library_t found = { 0 };
+    crawl_t crawl = { 0 };
+    crawl.previous = library;
+    crawl.found = &found;
+    pthread_mutex_init(&crawl.mutex, NULL);
+    pthread_cond_init(&crawl.cond, NULL);
+
+    crawl_item_t first = { root_path, true };
+    sacd_result_t result = push_items(&crawl, &first, 1) ? SACD_RESULT_OK : SACD_RESULT_OUT_OF_MEMORY;
+    if (result != SACD_RESULT_OK) {
+        free(root_path);
+    }
+
+    pthread_t workers[MAX_THREADS];
+    int started = 0;
+    while (result == SACD_RESULT_OK && started < threads &&
+           pthread_create(&workers[started], NULL, crawl_worker, &crawl) == 0) {
+        started++;
+    }
+    if (result == SACD_RESULT_OK && started == 0) {
+        crawl_worker(&crawl);
+    }
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+
+    if (crawl.failed) {
+        result = SACD_RESULT_OUT_OF_MEMORY;
+    }
+    for (int i = 0; i < crawl.queue_count; i++) {
+        free(crawl.queue[i].path);
+    }
+    free(crawl.queue);
+    pthread_cond_destroy(&crawl.cond);
+    pthread_mutex_destroy(&crawl.mutex);
+
+    /* Entries from other roots stay; those under this one are replaced by what was found */
+    for (int i = 0; result == SACD_RESULT_OK && i < library->count; i++) {
+        if (!under_root(library->entries[i].path, root, root_len)) {
+            result = add_entry(&found, &library->entries[i]);
+        }
+    }
+
+    if (result == SACD_RESULT_OK) {
+        qsort(found.entries, found.count, sizeof(sacd_library_entry_t), compare_entries);
+        replace_contents(library, &found);
+    }
+    free(found.entries);
+    free_strings(&found);
+    return result;
+}
+
+/* ---- Index files (little endian) ---- */
+
+static void put16(uint8_t *p, uint16_t value) {
+    p[0] = value & 0xff;
+    p[1] = value >> 8;
+}
+
+static void put32(uint8_t *p, uint32_t value) {
+    put16(p, value & 0xffff);
+    put16(p + 2, value >> 16);
+}
+
+static void put64(uint8_t *p, uint64_t value) {
+    put32(p, (uint32_t)value);
+    put32(p + 4, (uint32_t)(value >> 32));
+}
+
+static uint16_t get16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t *p) {
+    return get16(p) | ((uint32_t)get16(p + 2) << 16);
+}
+
+static uint64_t get64(const uint8_t *p) {
+    return get32(p) | ((uint64_t)get32(p + 4) << 32);
+}
+
+/* Offset of a string in the saved block; the block starts with "" for empty strings */
+static uint32_t string_offset(const char *s, uint64_t *next) {
+    if (!*s) {
+        return 0;
+    }
+    uint32_t offset = (uint32_t)*next;
+    *next += strlen(s) + 1;
+    return offset;
+}
+
+sacd_result_t sacd_library_save(const sacd_library_t *library, const char *path) {
+    if (!library || !path) {
+        return SACD_RESULT_ERROR;
+    }
+
+    size_t tmp_len = strlen(path) + 5;
+    char *tmp_path = malloc(tmp_len);
+    if (!tmp_path) {
+        return SACD_RESULT_OUT_OF_MEMORY;
+    }
+    snprintf(tmp_path, tmp_len, "%s.tmp", path);
+
+    FILE *f = fopen(tmp_path, "wb");
+    if (!f) {
+        free(tmp_path);
+        return SACD_RESULT_IO_ERROR;
+    }
+
+    /* Records first, then the strings they point at in the same order */
+    uint64_t string_bytes = 1;
+    for (int i = 0; i < library->count; i++) {
+        const sacd_library_entry_t *entry = &library->entries[i];
+        string_offset(entry->path, &string_bytes);
+        string_offset(entry->title, &string_bytes);
+        string_offset(entry->artist, &string_bytes);
+    }
+
+    uint8_t header[16];
+    put32(header, LIBRARY_VERSION);
+    put32(header + 4, (uint32_t)library->count);
+    put64(header + 8, string_bytes);
+    bool ok = string_bytes <= UINT32_MAX && fwrite(LIBRARY_MAGIC, 1, 8, f) == 8 &&
+              fwrite(header, 1, sizeof(header), f) == sizeof(header);
+
+    uint64_t next = 1;
+    for (int i = 0; ok && i < library->count; i++) {
+        const sacd_library_entry_t *entry = &library->entries[i];
+        uint8_t record[RECORD_BYTES];
+        put32(record, string_offset(entry->path, &next));
+        put32(record + 4, string_offset(entry->title, &next));
+        put32(record + 8, string_offset(entry->artist, &next));
+        put64(record + 12, entry->file_size);
+        put64(record + 20, (uint64_t)entry->mtime);
+        put16(record + 28, entry->year);
+        put16(record + 30, entry->track_count);
+        record[32] = entry->stereo_channels;
+        record[33] = entry->multichannel_channels;
+        record[34] = (entry->dst_encoded ? RECORD_DST : 0) | (entry->hybrid ? RECORD_HYBRID : 0);
+        record[35] = 0;
+        ok = fwrite(record, 1, RECORD_BYTES, f) == RECORD_BYTES;
+    }
+
+    ok = ok && fputc('\0', f) != EOF;
+    for (int i = 0; ok && i < library->count; i++) {
+        const sacd_library_entry_t *entry = &library->entries[i];
+        const char *strings[3] = { entry->path, entry->title, entry->artist };
+        for (int s = 0; ok && s < 3; s++) {
+            if (*strings[s]) {
+                ok = fwrite(strings[s], 1, strlen(strings[s]) + 1, f) == strlen(strings[s]) + 1;
+            }
+        }
+    }
+
+    ok = fflush(f) == 0 && fsync(fileno(f)) == 0 && ok;
+    ok = (fclose(f) == 0) && ok;
+
+    if (!ok || rename(tmp_path, path) != 0) {
+        unlink(tmp_path);
+        free(tmp_path);
+        return SACD_RESULT_IO_ERROR;
+    }
+
+    free(tmp_path);
+    return SACD_RESULT_OK;
+}
+
+/* Read 'size' bytes, all or nothing */
+static bool read_all(FILE *f, void *data, size_t size) {
+    return size == 0 || fread(data, 1, size, f) == size;
+}
+
+sacd_result_t sacd_library_load(sacd_library_t *library, const char *path) {
+    if (!library || !path) {
+        return SACD_RESULT_ERROR;
+    }
+
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return SACD_RESULT_INVALID_FILE;
+    }
+
+    char magic[8];
+    uint8_t header[16];
+    if (!read_all(f, magic, 8) || memcmp(magic, LIBRARY_MAGIC, 8) != 0 || !read_all(f, header, sizeof(header)) ||
+        get32(header) != LIBRARY_VERSION) {
+        fclose(f);
+        return SACD_RESULT_INVALID_FILE;
+    }
+    uint32_t count = get32(header + 4);
+    uint64_t string_bytes = get64(header + 8);
+
+    struct stat st;
+    if (fstat(fileno(f), &st) != 0 || string_bytes == 0 || count > INT32_MAX / 2 ||
+        (uint64_t)st.st_size != 24 + (uint64_t)count * RECORD_BYTES + string_bytes) {
+        fclose(f);
+        return SACD_RESULT_INVALID_FILE;
+    }
+
+    /* The saved string block becomes the catalogue's only string block */
+    sacd_library_t loaded = { 0 };
+    uint8_t *records = malloc((size_t)count * RECORD_BYTES + 1);
+    loaded.entries = malloc(((size_t)count + 1) * sizeof(sacd_library_entry_t));
+    loaded.strings = malloc(sizeof(string_block_t) + string_bytes);
+    if (!records || !loaded.entries || !loaded.strings) {
+        free(records);
+        free(loaded.entries);
+        free(loaded.strings);
+        fclose(f);
+        return SACD_RESULT_OUT_OF_MEMORY;
+    }
+    loaded.capacity = (int)count + 1;
+    loaded.strings->next = NULL;
+    loaded.strings->size = string_bytes;
+    loaded.strings->used = string_bytes;
+
+    char *strings = loaded.strings->data;
+    bool ok = read_all(f, records, (size_t)count * RECORD_BYTES) && read_all(f, strings, string_bytes) &&
+              strings[string_bytes - 1] == '\0';
+    fclose(f);
+
+    for (uint32_t i = 0; ok && i < count; i++) {
+        const uint8_t *record = records + (size_t)i * RECORD_BYTES;
+        uint32_t offsets[3] = { get32(record), get32(record + 4), get32(record + 8) };
+        ok = offsets[0] < string_bytes && offsets[1] < string_bytes && offsets[2] < string_bytes;
+        if (!ok) {
+            break;
+        }
+
+        sacd_library_entry_t *entry = &loaded.entries[i];
+        entry->path = strings + offsets[0];
+        entry->title = strings + offsets[1];
+        entry->artist = strings + offsets[2];
+        entry->file_size = get64(record + 12);
+        entry->mtime = (int64_t)get64(record + 20);
+        entry->year = get16(record + 28);
+        entry->track_count = get16(record + 30);
+        entry->stereo_channels = record[32];
+        entry->multichannel_channels = record[33];
+        entry->dst_encoded = (record[34] & RECORD_DST) != 0;
+        entry->hybrid = (record[34] & RECORD_HYBRID) != 0;
+        loaded.count++;
+
+        /* Lookups by path rely on the order */
+        ok = i == 0 || strcmp(loaded.entries[i - 1].path, entry->path) < 0;
+    }
+    free(records);
+
+    if (!ok) {
+        free(loaded.entries);
+        free_strings(&loaded);
+        return SACD_RESULT_INVALID_FILE;
+    }
+
+    replace_contents(library, &loaded);
+    return SACD_RESULT_OK;
+}
+
+/* ---- Queries ---- */
+
+void sacd_library_query_init(sacd_library_query_t *query) {
+    if (!query) {
+        return;
+    }
+
+    query->title = NULL;
+    query->artist = NULL;
+    query->year_from = 0;
+    query->year_to = 0;
+    query->channel_count = 0;
+    query->dst = 0;
+}
+
+static bool matches(const sacd_library_entry_t *entry, const sacd_library_query_t *query) {
+    if (query->title && *query->title && !strcasestr(entry->title, query->title)) {
+        return false;
+    }
+    if (query->artist && *query->artist && !strcasestr(entry->artist, query->artist)) {
+        return false;
+    }
+    if (query->year_from > 0 && entry->year < query->year_from) {
+        return false;
+    }
+    if (query->year_to > 0 && (entry->year == 0 || entry->year > query->year_to)) {
+        return false;
+    }
+    if (query->channel_count > 0 && entry->stereo_channels != query->channel_count &&
+        entry->multichannel_channels != query->channel_count) {
+        return false;
+    }
+    if ((query->dst > 0 && !entry->dst_encoded) || (query->dst < 0 && entry->dst_encoded)) {
+        return false;
+    }
+    return true;
+}
+
+int sacd_library_find(const sacd_library_t *library, const sacd_library_query_t *query,
+                      int *indices, int max_indices) {
+    if (!library || !query) {
+        return 0;
+    }
+
+    int found = 0;
+    for (int i = 0; i < library->count; i++) {
+        if (matches(&library->entries[i], query)) {
+            if (indices && found < max_indices) {
+                indices[found] = i;
+            }
+            found++;
+        }
+    }
+    return found;
+}
@@ -0,0 +1,144 @@
+/**
+ * sacd-mkiso - write a synthetic SACD image
+ *
+ * Copyright (c) 2024
+ * Licensed under MIT License
+ */
+
+#include "sacd_generator.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+static void usage(const char *program) {
+    fprintf(stderr,
+            "Usage: %s [options] OUTPUT.iso\n"
+            "\n"
+            "  -s, --seed N              Seed for generated audio (default 1)\n"
+            "  -c, --content TYPE        sine, noise or silence (default sine)\n"
+            "  -t, --tracks N            Stereo tracks (default 2, 0 = no stereo area)\n"
+            "  -l, --length SECONDS      Track length (default 10)\n"
+            "  -p, --pause SECONDS       Silence between tracks (default 0)\n"
+            "  -f, --format FORMAT       Stereo frames: dsd14, dsd16 or dst (default dsd14)\n"
+            "  -m, --multichannel N      Multichannel (DST) tracks (default 0)\n"
+            "  -n, --channels N          Multichannel channels, 5 or 6 (default 6)\n"
+            "      --title TEXT          Album title\n"
+            "      --artist TEXT         Album artist\n"
+            "      --catalog TEXT        Catalog number\n"
+            "      --hybrid              Flag the disc as hybrid\n"
+            "  -h, --help                Show this help\n",
+            program);
+}
+
+int main(int argc, char **argv) {
+    sacd_generator_options_t options;
+    sacd_generator_options_init(&options);
+    double seconds = 10.0;
+    double pause = 0.0;
+
+    enum { OPT_TITLE = 256, OPT_ARTIST, OPT_CATALOG, OPT_HYBRID };
+    static const struct option long_options[] = {
+        { "seed",         required_argument, NULL, 's' },
+        { "content",      required_argument, NULL, 'c' },
+        { "tracks",       required_argument, NULL, 't' },
+        { "length",       required_argument, NULL, 'l' },
+        { "pause",        required_argument, NULL, 'p' },
+        { "format",       required_argument, NULL, 'f' },
+        { "multichannel", required_argument, NULL, 'm' },
+        { "channels",     required_argument, NULL, 'n' },
+        { "title",        required_argument, NULL, OPT_TITLE },
+        { "artist",       required_argument, NULL, OPT_ARTIST },
+        { "catalog",      required_argument, NULL, OPT_CATALOG },
+        { "hybrid",       no_argument,       NULL, OPT_HYBRID },
+        { "help",         no_argument,       NULL, 'h' },
+        { NULL, 0, NULL, 0 }
+    };
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "s:c:t:l:p:f:m:n:h", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 's':
+            options.seed = strtoull(optarg, NULL, 0);
+            break;
+        case 'c':
+            if (strcmp(optarg, "sine") == 0) {
+                options.content = SACD_GENERATOR_SINE;
+            } else if (strcmp(optarg, "noise") == 0) {
+                options.content = SACD_GENERATOR_NOISE;
+            } else if (strcmp(optarg, "silence") == 0) {
+                options.content = SACD_GENERATOR_SILENCE;
+            } else {
+                fprintf(stderr, "Unknown content type: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 't':
+            options.areas[0].track_count = atoi(optarg);
+            options.areas[0].present = (options.areas[0].track_count > 0);
+            break;
+        case 'l':
+            seconds = atof(optarg);
+            break;
+        case 'p':
+            pause = atof(optarg);
+            break;
+        case 'f':
+            if (strcmp(optarg, "dsd14") == 0) {
+                options.areas[0].frame_format = SACD_FRAME_DSD_3_IN_14;
+            } else if (strcmp(optarg, "dsd16") == 0) {
+                options.areas[0].frame_format = SACD_FRAME_DSD_3_IN_16;
+            } else if (strcmp(optarg, "dst") == 0) {
+                options.areas[0].frame_format = SACD_FRAME_DST;
+            } else {
+                fprintf(stderr, "Unknown frame format: %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'm':
+            options.areas[1].track_count = atoi(optarg);
+            options.areas[1].present = (options.areas[1].track_count > 0);
+            break;
+        case 'n':
+            options.areas[1].channel_count = atoi(optarg);
+            break;
+        case OPT_TITLE:
+            options.album_title = optarg;
+            break;
+        case OPT_ARTIST:
+            options.album_artist = optarg;
+            break;
+        case OPT_CATALOG:
+            options.catalog_number = optarg;
+            break;
+        case OPT_HYBRID:
+            options.hybrid = true;
+            break;
+        case 'h':
+            usage(argv[0]);
+            return 0;
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (optind != argc - 1 || seconds <= 0.0 || pause < 0.0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    uint32_t frames = (uint32_t)(seconds * SACD_FRAME_RATE + 0.5);
+    options.areas[0].track_frames = frames ? frames : 1;
+    options.areas[1].track_frames = options.areas[0].track_frames;
+    options.areas[0].pause_frames = (uint32_t)(pause * SACD_FRAME_RATE + 0.5);
+    options.areas[1].pause_frames = options.areas[0].pause_frames;
+
+    sacd_result_t result = sacd_generator_write_iso(argv[optind], &options);
+    if (result != SACD_RESULT_OK) {
+        fprintf(stderr, "%s: %s\n", argv[optind], sacd_result_string(result));
+        return 1;
+    }
+
+    return 0;
+}
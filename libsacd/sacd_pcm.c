@@ -0,0 +1,512 @@
+/**
+ * SACD Library - DSD to PCM Conversion
+ *
+ * Converts DSD64 (2.8224 MHz, 1 bit) to 176.4 kHz or 88.2 kHz PCM with a
+ * multistage decimator:
+ *
+ *   stage 1  2822.4 kHz -> 352.8 kHz  (/8)  FIR evaluated through byte-indexed
+ *                                            lookup tables, one table per 8 taps
+ *   stage 2   352.8 kHz -> 176.4 kHz  (/2)  windowed-sinc FIR
+ *   stage 3   176.4 kHz ->  88.2 kHz  (/2)  windowed-sinc FIR (88.2 kHz only)
+ *
+ * Stage 1 consumes one DSD byte (8 samples) per output sample, so the byte
+ * tables replace 8 multiply-adds with one table lookup. The later stages are
+ * plain dot products written so the compiler can vectorize the accumulation.
+ *
+ * Each channel runs on its own worker thread; the caller feeds interleaved
+ * DSD bytes and receives interleaved, encoded PCM.
+ */
+
+#include "sacd_lib.h"
+#include "sacd_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <math.h>
+#include <pthread.h>
+
+#define PCM_STAGE1_TAPS      128                    /* Multiple of 8 */
+#define PCM_STAGE1_TABLES    (PCM_STAGE1_TAPS / 8)
+#define PCM_HALFBAND_TAPS    64
+#define PCM_BLOCK_BYTES      16384                  /* DSD bytes per channel per block */
+
+/*
+ * Full modulation maps to PCM full scale. SACD's 0 dB reference (50%
+ * modulation) then lands at -6 dBFS, which leaves room for the +3 dB peaks
+ * the format allows above it.
+ */
+#define PCM_GAIN             1.0f
+
+/* FIR decimator with history carried across blocks */
+typedef struct {
+    const float *taps;
+    int tap_count;
+    int factor;
+    int phase;              /* Offset of the next output within the next block */
+    float *buffer;          /* History (tap_count - 1) followed by the block */
+} pcm_decimator_t;
+
+typedef struct pcm_channel {
+    struct sacd_pcm_converter *converter;
+    int index;
+    pthread_t thread;
+
+    uint8_t *dsd;           /* Stage 1 history followed by this block's bytes */
+    float *stage1_out;      /* 352.8 kHz */
+    float *stage2_out;      /* 176.4 kHz */
+    float *stage3_out;      /* 88.2 kHz */
+    pcm_decimator_t stage2;
+    pcm_decimator_t stage3;
+
+    const float *out;       /* Final output of the last block */
+    size_t out_count;
+} pcm_channel_t;
+
+struct sacd_pcm_converter {
+    int channel_count;
+    uint32_t sample_rate;
+    sacd_pcm_sample_format_t sample_format;
+
+    /* Filters shared by all channels */
+    float stage1_table[PCM_STAGE1_TABLES][256];
+    float halfband_taps[PCM_HALFBAND_TAPS];
+    float final_taps[PCM_HALFBAND_TAPS];
+
+    /* Interleaved DSD staging */
+    uint8_t *staging;
+    size_t staging_size;
+    size_t staging_capacity;
+
+    /* Encoded interleaved output */
+    uint8_t *pcm;
+    size_t pcm_capacity;
+
+    /* Workers */
+    pcm_channel_t channels[SACD_PCM_MAX_CHANNELS];
+    int threads_started;
+    size_t block_bytes;     /* Per-channel bytes in the current block */
+    unsigned int generation;
+    int pending;
+    bool shutdown;
+    uint64_t stalls;        /* Waits in process_block */
+    pthread_mutex_t mutex;
+    pthread_cond_t work_cond;
+    pthread_cond_t done_cond;
+};
+
+/* Zeroth-order modified Bessel function, for the Kaiser window */
+static double bessel_i0(double x) {
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 32; k++) {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+/* Kaiser-windowed sinc lowpass with unity DC gain; cutoff relative to fs */
+static void design_lowpass(double *taps, int count, double cutoff, double beta) {
+    double center = (count - 1) / 2.0;
+    double sum = 0.0;
+
+    for (int i = 0; i < count; i++) {
+        double t = i - center;
+        double sinc = (t == 0.0) ? 2.0 * cutoff : sin(2.0 * M_PI * cutoff * t) / (M_PI * t);
+        double r = t / center;
+        double window = bessel_i0(beta * sqrt(1.0 - r * r)) / bessel_i0(beta);
+        taps[i] = sinc * window;
+        sum += taps[i];
+    }
+
+    for (int i = 0; i < count; i++) {
+        taps[i] /= sum;
+    }
+}
+
+/* Build the stage 1 byte tables: table[k][b] is taps k*8..k*8+7 applied to byte b */
+static void build_stage1_tables(sacd_pcm_converter_t *converter) {
+    double taps[PCM_STAGE1_TAPS];
+
+    /* Passband to ~100 kHz; first alias image starts at 352.8 - 105.8 kHz */
+    design_lowpass(taps, PCM_STAGE1_TAPS, 100000.0 / SACD_SAMPLING_FREQ, 9.0);
+
+    for (int k = 0; k < PCM_STAGE1_TABLES; k++) {
+        for (int byte = 0; byte < 256; byte++) {
+            double acc = 0.0;
+            /* DSD bytes are MSB first: bit 7 is the oldest sample */
+            for (int bit = 0; bit < 8; bit++) {
+                double sample = ((byte >> (7 - bit)) & 1) ? 1.0 : -1.0;
+                acc += taps[k * 8 + bit] * sample;
+            }
+            converter->stage1_table[k][byte] = (float)(acc * PCM_GAIN);
+        }
+    }
+}
+
+static void build_decimator_taps(float *out, double cutoff) {
+    double taps[PCM_HALFBAND_TAPS];
+    design_lowpass(taps, PCM_HALFBAND_TAPS, cutoff, 8.0);
+    for (int i = 0; i < PCM_HALFBAND_TAPS; i++) {
+        out[i] = (float)taps[i];
+    }
+}
+
+/* Stage 1: one output per DSD byte */
+static void run_stage1(const sacd_pcm_converter_t *converter, const uint8_t *dsd,
+                       size_t count, float *out) {
+    for (size_t i = 0; i < count; i++) {
+        float acc = 0.0f;
+        for (int k = 0; k < PCM_STAGE1_TABLES; k++) {
+            acc += converter->stage1_table[k][dsd[i + k]];
+        }
+        out[i] = acc;
+    }
+}
+
+/* FIR decimation of a block; returns the number of outputs */
+static size_t run_decimator(pcm_decimator_t *d, const float *in, size_t count, float *out) {
+    int history = d->tap_count - 1;
+    memcpy(d->buffer + history, in, count * sizeof(float));
+
+    size_t produced = 0;
+    size_t i = d->phase;
+    for (; i < count; i += d->factor) {
+        const float *window = d->buffer + i;
+        float acc = 0.0f;
+        for (int k = 0; k < d->tap_count; k++) {
+            acc += d->taps[k] * window[k];
+        }
+        out[produced++] = acc;
+    }
+    d->phase = (int)(i - count);
+
+    memmove(d->buffer, d->buffer + count, history * sizeof(float));
+    return produced;
+}
+
+/* Run the whole filter chain for one channel's block */
+static void process_channel(pcm_channel_t *channel) {
+    sacd_pcm_converter_t *converter = channel->converter;
+    size_t count = converter->block_bytes;
+    int channels = converter->channel_count;
+    uint8_t *dsd = channel->dsd + (PCM_STAGE1_TABLES - 1);
+
+    /* De-interleave this channel's bytes after the stage 1 history */
+    const uint8_t *src = converter->staging + channel->index;
+    for (size_t i = 0; i < count; i++) {
+        dsd[i] = src[i * channels];
+    }
+
+    run_stage1(converter, channel->dsd, count, channel->stage1_out);
+    memmove(channel->dsd, channel->dsd + count, PCM_STAGE1_TABLES - 1);
+
+    size_t n = run_decimator(&channel->stage2, channel->stage1_out, count, channel->stage2_out);
+    channel->out = channel->stage2_out;
+
+    if (converter->sample_rate == 88200) {
+        n = run_decimator(&channel->stage3, channel->stage2_out, n, channel->stage3_out);
+        channel->out = channel->stage3_out;
+    }
+
+    channel->out_count = n;
+}
+
+static void *channel_thread(void *arg) {
+    pcm_channel_t *channel = (pcm_channel_t*)arg;
+    sacd_pcm_converter_t *converter = channel->converter;
+    unsigned int seen = 0;
+
+    pthread_mutex_lock(&converter->mutex);
+    for (;;) {
+        while (!converter->shutdown && converter->generation == seen) {
+            pthread_cond_wait(&converter->work_cond, &converter->mutex);
+        }
+        if (converter->shutdown) {
+            break;
+        }
+        seen = converter->generation;
+        pthread_mutex_unlock(&converter->mutex);
+
+        process_channel(channel);
+
+        pthread_mutex_lock(&converter->mutex);
+        if (--converter->pending == 0) {
+            pthread_cond_signal(&converter->done_cond);
+        }
+    }
+    pthread_mutex_unlock(&converter->mutex);
+
+    return NULL;
+}
+
+/* Round to S24, saturating at the limits rather than wrapping */
+static int32_t clamp_s24(float sample) {
+    float scaled = sample * 8388607.0f;
+    if (scaled >= 8388607.0f) {
+        return 8388607;
+    }
+    if (scaled <= -8388608.0f) {
+        return -8388608;
+    }
+    return (int32_t)lrintf(scaled);
+}
+
+/* Make room for one more block of output after 'used' bytes */
+static sacd_result_t reserve_pcm(sacd_pcm_converter_t *converter, size_t used) {
+    size_t block_max = (PCM_BLOCK_BYTES / 2 + 1) * converter->channel_count * 4;
+    if (used + block_max <= converter->pcm_capacity) {
+        return SACD_RESULT_OK;
+    }
+
+    uint8_t *pcm = realloc(converter->pcm, used + block_max);
+    if (!pcm) {
+        return SACD_RESULT_OUT_OF_MEMORY;
+    }
+    converter->pcm = pcm;
+    converter->pcm_capacity = used + block_max;
+    return SACD_RESULT_OK;
+}
+
+/* Convert the staged block on all channel threads and encode the result */
+static sacd_result_t process_block(sacd_pcm_converter_t *converter, size_t block_bytes,
+                                   size_t *pcm_size) {
+    pthread_mutex_lock(&converter->mutex);
+    converter->block_bytes = block_bytes;
+    converter->pending = converter->channel_count;
+    converter->generation++;
+    pthread_cond_broadcast(&converter->work_cond);
+    while (converter->pending > 0) {
+        converter->stalls++;
+        pthread_cond_wait(&converter->done_cond, &converter->mutex);
+    }
+    pthread_mutex_unlock(&converter->mutex);
+
+    size_t frames = converter->channels[0].out_count;
+    int channels = converter->channel_count;
+    size_t sample_bytes = (converter->sample_format == SACD_PCM_F32) ? 4 : 3;
+    uint8_t *dst = converter->pcm + *pcm_size;
+
+    for (size_t f = 0; f < frames; f++) {
+        for (int c = 0; c < channels; c++) {
+            float sample = converter->channels[c].out[f];
+            if (converter->sample_format == SACD_PCM_F32) {
+                uint32_t bits;
+                memcpy(&bits, &sample, 4);
+                dst[0] = bits & 0xFF;
+                dst[1] = (bits >> 8) & 0xFF;
+                dst[2] = (bits >> 16) & 0xFF;
+                dst[3] = (bits >> 24) & 0xFF;
+            } else {
+                int32_t value = clamp_s24(sample);
+                dst[0] = value & 0xFF;
+                dst[1] = (value >> 8) & 0xFF;
+                dst[2] = (value >> 16) & 0xFF;
+            }
+            dst += sample_bytes;
+        }
+    }
+
+    *pcm_size += frames * channels * sample_bytes;
+    return SACD_RESULT_OK;
+}
+
+/* Create a converter */
+sacd_result_t sacd_internal_pcm_converter_create(
+    sacd_pcm_converter_t **converter,
+    int channel_count,
+    uint32_t sample_rate,
+    sacd_pcm_sample_format_t sample_format,
+    const sacd_cpuset_t *cpus) {
+
+    if (!converter || channel_count < 1 || channel_count > SACD_PCM_MAX_CHANNELS ||
+        (sample_rate != 88200 && sample_rate != 176400)) {
+        return SACD_RESULT_ERROR;
+    }
+
+    *converter = NULL;
+
+    sacd_pcm_converter_t *conv = calloc(1, sizeof(sacd_pcm_converter_t));
+    if (!conv) {
+        return SACD_RESULT_OUT_OF_MEMORY;
+    }
+
+    conv->channel_count = channel_count;
+    conv->sample_rate = sample_rate;
+    conv->sample_format = sample_format;
+
+    build_stage1_tables(conv);
+    /* Passband to 40% of each stage's output rate */
+    build_decimator_taps(conv->halfband_taps, 0.40 * 176400.0 / 352800.0);
+    build_decimator_taps(conv->final_taps, 0.40 * 88200.0 / 176400.0);
+
+    conv->staging_capacity = PCM_BLOCK_BYTES * channel_count;
+    conv->staging = malloc(conv->staging_capacity);
+    /* A block never yields more than one stage 2 output per two DSD bytes */
+    conv->pcm_capacity = (PCM_BLOCK_BYTES / 2 + 1) * channel_count * 4;
+    conv->pcm = malloc(conv->pcm_capacity);
+    if (!conv->staging || !conv->pcm) {
+        sacd_internal_pcm_converter_destroy(conv);
+        return SACD_RESULT_OUT_OF_MEMORY;
+    }
+
+    for (int c = 0; c < channel_count; c++) {
+        pcm_channel_t *channel = &conv->channels[c];
+        channel->converter = conv;
+        channel->index = c;
+        channel->dsd = malloc(PCM_STAGE1_TABLES - 1 + PCM_BLOCK_BYTES);
+        channel->stage1_out = malloc(PCM_BLOCK_BYTES * sizeof(float));
+        channel->stage2_out = malloc((PCM_BLOCK_BYTES / 2 + 1) * sizeof(float));
+        channel->stage3_out = malloc((PCM_BLOCK_BYTES / 4 + 1) * sizeof(float));
+        channel->stage2.buffer = malloc((PCM_HALFBAND_TAPS - 1 + PCM_BLOCK_BYTES) * sizeof(float));
+        channel->stage3.buffer = malloc((PCM_HALFBAND_TAPS - 1 + PCM_BLOCK_BYTES / 2 + 1) * sizeof(float));
+        if (!channel->dsd || !channel->stage1_out || !channel->stage2_out ||
+            !channel->stage3_out || !channel->stage2.buffer || !channel->stage3.buffer) {
+            sacd_internal_pcm_converter_destroy(conv);
+            return SACD_RESULT_OUT_OF_MEMORY;
+        }
+
+        channel->stage2.taps = conv->halfband_taps;
+        channel->stage2.tap_count = PCM_HALFBAND_TAPS;
+        channel->stage2.factor = 2;
+        channel->stage3.taps = conv->final_taps;
+        channel->stage3.tap_count = PCM_HALFBAND_TAPS;
+        channel->stage3.factor = 2;
+    }
+
+    sacd_internal_pcm_converter_reset(conv);
+
+    if (pthread_mutex_init(&conv->mutex, NULL) != 0) {
+        sacd_internal_pcm_converter_destroy(conv);
+        return SACD_RESULT_ERROR;
+    }
+    pthread_cond_init(&conv->work_cond, NULL);
+    pthread_cond_init(&conv->done_cond, NULL);
+
+    for (int c = 0; c < channel_count; c++) {
+        if (sacd_internal_thread_create(&conv->channels[c].thread, cpus, channel_thread, &conv->channels[c]) != 0) {
+            sacd_internal_pcm_converter_destroy(conv);
+            return SACD_RESULT_ERROR;
+        }
+        conv->threads_started++;
+    }
+
+    *converter = conv;
+    return SACD_RESULT_OK;
+}
+
+/* Destroy a converter */
+void sacd_internal_pcm_converter_destroy(sacd_pcm_converter_t *converter) {
+    if (!converter) {
+        return;
+    }
+
+    if (converter->threads_started > 0) {
+        pthread_mutex_lock(&converter->mutex);
+        converter->shutdown = true;
+        pthread_cond_broadcast(&converter->work_cond);
+        pthread_mutex_unlock(&converter->mutex);
+
+        for (int c = 0; c < converter->threads_started; c++) {
+            pthread_join(converter->channels[c].thread, NULL);
+        }
+
+        pthread_cond_destroy(&converter->work_cond);
+        pthread_cond_destroy(&converter->done_cond);
+        pthread_mutex_destroy(&converter->mutex);
+    }
+
+    for (int c = 0; c < converter->channel_count; c++) {
+        pcm_channel_t *channel = &converter->channels[c];
+        free(channel->dsd);
+        free(channel->stage1_out);
+        free(channel->stage2_out);
+        free(channel->stage3_out);
+        free(channel->stage2.buffer);
+        free(channel->stage3.buffer);
+    }
+
+    free(converter->staging);
+    free(converter->pcm);
+    free(converter);
+}
+
+/* Start a new, unrelated stream (e.g. the next track) */
+void sacd_internal_pcm_converter_reset(sacd_pcm_converter_t *converter) {
+    if (!converter) {
+        return;
+    }
+
+    converter->staging_size = 0;
+
+    for (int c = 0; c < converter->channel_count; c++) {
+        pcm_channel_t *channel = &converter->channels[c];
+        /* Alternating 0x69 history is DSD silence */
+        memset(channel->dsd, 0x69, PCM_STAGE1_TABLES - 1);
+        memset(channel->stage2.buffer, 0, (PCM_HALFBAND_TAPS - 1) * sizeof(float));
+        memset(channel->stage3.buffer, 0, (PCM_HALFBAND_TAPS - 1) * sizeof(float));
+        channel->stage2.phase = 0;
+        channel->stage3.phase = 0;
+    }
+}
+
+/* Times the caller waited for the channel threads */
+uint64_t sacd_internal_pcm_converter_stalls(const sacd_pcm_converter_t *converter) {
+    return converter ? converter->stalls : 0;
+}
+
+/* Feed interleaved DSD and collect whatever PCM becomes available */
+sacd_result_t sacd_internal_pcm_convert(
+    sacd_pcm_converter_t *converter,
+    const uint8_t *dsd,
+    size_t dsd_size,
+    const uint8_t **pcm,
+    size_t *pcm_size) {
+
+    if (!converter || (!dsd && dsd_size) || !pcm || !pcm_size) {
+        return SACD_RESULT_ERROR;
+    }
+
+    *pcm = converter->pcm;
+    *pcm_size = 0;
+
+    while (dsd_size > 0) {
+        size_t space = converter->staging_capacity - converter->staging_size;
+        size_t chunk = dsd_size < space ? dsd_size : space;
+        memcpy(converter->staging + converter->staging_size, dsd, chunk);
+        converter->staging_size += chunk;
+        dsd += chunk;
+        dsd_size -= chunk;
+
+        if (converter->staging_size == converter->staging_capacity) {
+            SACD_CHECK_RESULT(reserve_pcm(converter, *pcm_size));
+            *pcm = converter->pcm;
+            SACD_CHECK_RESULT(process_block(converter, PCM_BLOCK_BYTES, pcm_size));
+            converter->staging_size = 0;
+        }
+    }
+
+    return SACD_RESULT_OK;
+}
+
+/* Convert whatever is staged (end of stream) */
+sacd_result_t sacd_internal_pcm_flush(
+    sacd_pcm_converter_t *converter,
+    const uint8_t **pcm,
+    size_t *pcm_size) {
+
+    if (!converter || !pcm || !pcm_size) {
+        return SACD_RESULT_ERROR;
+    }
+
+    *pcm = converter->pcm;
+    *pcm_size = 0;
+
+    /* Only whole channel groups can be converted */
+    size_t block_bytes = converter->staging_size / converter->channel_count;
+    if (block_bytes > 0) {
+        SACD_CHECK_RESULT(process_block(converter, block_bytes, pcm_size));
+    }
+    converter->staging_size = 0;
+
+    return SACD_RESULT_OK;
+}
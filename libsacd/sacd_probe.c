@@ -0,0 +1,528 @@
+/**
+ * SACD Library - Content-Based File Type Detection
+ *
+ * A file is classified from what it holds, not from its name. One block at
+ * the start of the file carries the header of every audio format we know,
+ * so a single read tells a DSF, DSDIFF, FLAC, WAV, RF64, Wave64 or AIFF file
+ * apart and gives its stream parameters. Only files that are none of those
+ * are read again, at the master TOC and then at the ISO 9660 volume
+ * descriptor, to find disc images.
+ *
+ * Probing a directory's worth of files is dominated by waiting for those
+ * few reads. Files are probed in batches: a batch is opened and the kernel
+ * told about every block it will need before the first one is read, so the
+ * reads of the whole batch are in flight together rather than one after
+ * another. Batches are shared among a few threads.
+ */
+
+#include "sacd_lib.h"
+#include "sacd_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+
+/* Bytes read from the start of every file: all the headers we parse fit */
+#define HEADER_BYTES       4096
+
+/* Files opened and read ahead together */
+#define BATCH_FILES        32
+
+#define DEFAULT_THREADS    8
+#define MAX_THREADS        64
+
+/* ISO 9660 primary volume descriptor: sector 16, "CD001" after the type byte */
+#define ISO9660_PVD_OFFSET (16 * 2048)
+
+/* DSD rate of an SACD area */
+#define SACD_SAMPLE_RATE   2822400
+
+/* Wave64 GUIDs share their last twelve bytes, after a four-character name */
+static const uint8_t w64_riff_tail[12] = {
+    0x2E, 0x91, 0xCF, 0x11, 0xA5, 0xD6, 0x28, 0xDB, 0x04, 0xC1, 0x00, 0x00
+};
+static const uint8_t w64_chunk_tail[12] = {
+    0xF3, 0xAC, 0xD3, 0x11, 0x8C, 0xD1, 0x00, 0xC0, 0x4F, 0x8E, 0xDB, 0x8A
+};
+
+static uint16_t le16(const uint8_t *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t le32(const uint8_t *p) {
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint64_t le64(const uint8_t *p) {
+    return (uint64_t)le32(p) | ((uint64_t)le32(p + 4) << 32);
+}
+
+static uint16_t be16(const uint8_t *p) {
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static uint32_t be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | (uint32_t)p[3];
+}
+
+static uint64_t be64(const uint8_t *p) {
+    return ((uint64_t)be32(p) << 32) | (uint64_t)be32(p + 4);
+}
+
+/* ---- Headers ---- */
+
+static bool parse_dsf(const uint8_t *data, size_t size, sacd_file_info_t *info) {
+    /* "DSD " chunk of 28 bytes, then "fmt " */
+    if (size < 80 || memcmp(data, "DSD ", 4) != 0 || le64(data + 4) != 28 ||
+        memcmp(data + 28, "fmt ", 4) != 0) {
+        return false;
+    }
+    info->type = SACD_FILE_DSF;
+    info->channels = (uint16_t)le32(data + 52);
+    info->sample_rate = le32(data + 56);
+    info->bits_per_sample = (uint16_t)le32(data + 60);
+    info->sample_count = le64(data + 64);
+    return true;
+}
+
+/* Properties chunk: sample rate, channels and compression type */
+static void parse_dsdiff_properties(const uint8_t *p, const uint8_t *end, sacd_file_info_t *info) {
+    while (p + 12 <= end) {
+        uint64_t size = be64(p + 4);
+        const uint8_t *body = p + 12;
+        if (memcmp(p, "FS  ", 4) == 0 && body + 4 <= end) {
+            info->sample_rate = be32(body);
+        } else if (memcmp(p, "CHNL", 4) == 0 && body + 2 <= end) {
+            info->channels = be16(body);
+        } else if (memcmp(p, "CMPR", 4) == 0 && body + 4 <= end) {
+            info->dst_encoded = memcmp(body, "DST ", 4) == 0;
+        }
+        if (size > (uint64_t)(end - body)) {
+            break;
+        }
+        p = body + size + (size & 1);
+    }
+}
+
+static bool parse_dsdiff(const uint8_t *data, size_t size, sacd_file_info_t *info) {
+    if (size < 16 || memcmp(data, "FRM8", 4) != 0 || memcmp(data + 12, "DSD ", 4) != 0) {
+        return false;
+    }
+    info->type = SACD_FILE_DSDIFF;
+    info->bits_per_sample = 1;
+
+    const uint8_t *end = data + size;
+    const uint8_t *p = data + 16;
+    while (p + 12 <= end) {
+        uint64_t chunk_size = be64(p + 4);
+        const uint8_t *body = p + 12;
+
+        if (memcmp(p, "PROP", 4) == 0 && body + 4 <= end && memcmp(body, "SND ", 4) == 0) {
+            const uint8_t *prop_end = chunk_size < (uint64_t)(end - body) ? body + chunk_size : end;
+            parse_dsdiff_properties(body + 4, prop_end, info);
+        } else if (memcmp(p, "DSD ", 4) == 0) {
+            /* Sample data: one bit per sample and channel */
+            if (info->channels) {
+                info->sample_count = chunk_size * 8 / info->channels;
+            }
+            break;
+        } else if (memcmp(p, "DST ", 4) == 0) {
+            /* Frame count and rate come first */
+            if (body + 18 <= end && memcmp(body, "FRTE", 4) == 0 && be16(body + 16)) {
+                info->sample_count = (uint64_t)be32(body + 12) * (info->sample_rate / be16(body + 16));
+            }
+            break;
+        }
+        if (chunk_size > (uint64_t)(end - body)) {
+            break;
+        }
+        p = body + chunk_size + (chunk_size & 1);
+    }
+    return true;
+}
+
+static bool parse_flac(const uint8_t *data, size_t size, sacd_file_info_t *info) {
+    if (size < 4 || memcmp(data, "fLaC", 4) != 0) {
+        return false;
+    }
+    info->type = SACD_FILE_FLAC;
+
+    /* STREAMINFO is always the first metadata block */
+    if (size >= 26 && (data[4] & 0x7F) == 0) {
+        const uint8_t *s = data + 8;
+        info->sample_rate = ((uint32_t)s[10] << 12) | ((uint32_t)s[11] << 4) | (s[12] >> 4);
+        info->channels = (uint16_t)(((s[12] >> 1) & 0x07) + 1);
+        info->bits_per_sample = (uint16_t)((((s[12] & 0x01) << 4) | (s[13] >> 4)) + 1);
+        info->sample_count = ((uint64_t)(s[13] & 0x0F) << 32) | be32(s + 14);
+    }
+    return true;
+}
+
+/* WAVEFORMATEX: the part every WAV flavour shares; returns the block alignment */
+static uint16_t parse_wave_format(const uint8_t *fmt, sacd_file_info_t *info) {
+    info->channels = le16(fmt + 2);
+    info->sample_rate = le32(fmt + 4);
+    info->bits_per_sample = le16(fmt + 14);
+    return le16(fmt + 12);
+}
+
+static bool parse_riff(const uint8_t *data, size_t size, sacd_file_info_t *info) {
+    bool rf64 = size >= 12 && memcmp(data, "RF64", 4) == 0;
+    if (size < 12 || (!rf64 && memcmp(data, "RIFF", 4) != 0) || memcmp(data + 8, "WAVE", 4) != 0) {
+        return false;
+    }
+    info->type = rf64 ? SACD_FILE_RF64 : SACD_FILE_WAV;
+
+    const uint8_t *end = data + size;
+    const uint8_t *p = data + 12;
+    uint64_t ds64_data_size = 0;
+    uint16_t block_align = 0;
+    while (p + 8 <= end) {
+        uint32_t chunk_size = le32(p + 4);
+        const uint8_t *body = p + 8;
+
+        if (memcmp(p, "ds64", 4) == 0 && body + 16 <= end) {
+            ds64_data_size = le64(body + 8);
+        } else if (memcmp(p, "fmt ", 4) == 0 && body + 16 <= end) {
+            block_align = parse_wave_format(body, info);
+        } else if (memcmp(p, "data", 4) == 0) {
+            uint64_t data_size = (rf64 && chunk_size == 0xFFFFFFFF) ? ds64_data_size : chunk_size;
+            if (block_align) {
+                info->sample_count = data_size / block_align;
+            }
+            break;
+        }
+        if (chunk_size > (uint64_t)(end - body)) {
+            break;
+        }
+        p = body + chunk_size + (chunk_size & 1);
+    }
+    return true;
+}
+
+static bool parse_w64(const uint8_t *data, size_t size, sacd_file_info_t *info) {
+    if (size < 40 || memcmp(data, "riff", 4) != 0 || memcmp(data + 4, w64_riff_tail, 12) != 0 ||
+        memcmp(data + 24, "wave", 4) != 0 || memcmp(data + 28, w64_chunk_tail, 12) != 0) {
+        return false;
+    }
+    info->type = SACD_FILE_W64;
+
+    /* Chunk sizes include the 24-byte GUID and size header; chunks are 8-byte aligned */
+    const uint8_t *end = data + size;
+    const uint8_t *p = data + 40;
+    uint16_t block_align = 0;
+    while (p + 24 <= end && memcmp(p + 4, w64_chunk_tail, 12) == 0) {
+        uint64_t chunk_size = le64(p + 16);
+        const uint8_t *body = p + 24;
+        if (chunk_size < 24) {
+            break;
+        }
+
+        if (memcmp(p, "fmt ", 4) == 0 && body + 16 <= end) {
+            block_align = parse_wave_format(body, info);
+        } else if (memcmp(p, "data", 4) == 0) {
+            if (block_align) {
+                info->sample_count = (chunk_size - 24) / block_align;
+            }
+            break;
+        }
+        uint64_t step = (chunk_size + 7) & ~(uint64_t)7;
+        if (step > (uint64_t)(end - p)) {
+            break;
+        }
+        p += step;
+    }
+    return true;
+}
+
+/* 80-bit IEEE extended, as AIFF stores its sample rate */
+static uint32_t extended_to_uint(const uint8_t *p) {
+    int exponent = ((p[0] & 0x7F) << 8 | p[1]) - 16383;
+    uint64_t mantissa = be64(p + 2);
+    if ((p[0] & 0x80) || exponent < 0 || exponent > 31) {
+        return 0;
+    }
+    return (uint32_t)(mantissa >> (63 - exponent));
+}
+
+static bool parse_aiff(const uint8_t *data, size_t size, sacd_file_info_t *info) {
+    if (size < 12 || memcmp(data, "FORM", 4) != 0 ||
+        (memcmp(data + 8, "AIFF", 4) != 0 && memcmp(data + 8, "AIFC", 4) != 0)) {
+        return false;
+    }
+    info->type = SACD_FILE_AIFF;
+
+    const uint8_t *end = data + size;
+    const uint8_t *p = data + 12;
+    while (p + 8 <= end) {
+        uint32_t chunk_size = be32(p + 4);
+        const uint8_t *body = p + 8;
+
+        if (memcmp(p, "COMM", 4) == 0 && body + 18 <= end) {
+            info->channels = be16(body);
+            info->sample_count = be32(body + 2);
+            info->bits_per_sample = be16(body + 6);
+            info->sample_rate = extended_to_uint(body + 8);
+            break;
+        }
+        if (chunk_size > (uint64_t)(end - body)) {
+            break;
+        }
+        p = body + chunk_size + (chunk_size & 1);
+    }
+    return true;
+}
+
+/* Size of an ID3v2 tag at the start of the file, or 0 */
+static uint64_t id3_size(const uint8_t *data, size_t size) {
+    if (size < 10 || memcmp(data, "ID3", 3) != 0) {
+        return 0;
+    }
+    uint32_t tag = ((uint32_t)(data[6] & 0x7F) << 21) | ((uint32_t)(data[7] & 0x7F) << 14) |
+                   ((uint32_t)(data[8] & 0x7F) << 7) | (data[9] & 0x7F);
+    /* Header, body and the optional footer */
+    return 10 + (uint64_t)tag + ((data[5] & 0x10) ? 10 : 0);
+}
+
+static bool parse_header(const uint8_t *data, size_t size, sacd_file_info_t *info) {
+    return parse_dsf(data, size, info) || parse_dsdiff(data, size, info) ||
+           parse_flac(data, size, info) || parse_riff(data, size, info) ||
+           parse_w64(data, size, info) || parse_aiff(data, size, info);
+}
+
+/* ---- Disc images ---- */
+
+static off_t master_toc_offset(void) {
+    return (off_t)SACD_MASTER_TOC_START_LSN * SACD_LSN_SIZE;
+}
+
+/* Whether a file is large enough to be looked at as a disc image */
+static bool may_be_image(uint64_t file_size) {
+    return file_size >= (uint64_t)ISO9660_PVD_OFFSET + 2048;
+}
+
+/* Ask for the sectors probe_image() reads */
+static void advise_image(int fd, uint64_t file_size) {
+    posix_fadvise(fd, ISO9660_PVD_OFFSET, 2048, POSIX_FADV_WILLNEED);
+    if (file_size >= (uint64_t)master_toc_offset() + SACD_LSN_SIZE) {
+        posix_fadvise(fd, master_toc_offset(), SACD_LSN_SIZE, POSIX_FADV_WILLNEED);
+    }
+}
+
+/* SACD image from the master TOC (and the first area's TOC), else an ISO 9660 volume */
+static void probe_image(int fd, uint64_t file_size, sacd_file_info_t *info) {
+    uint8_t sector[SACD_LSN_SIZE];
+
+    if (file_size >= (uint64_t)master_toc_offset() + SACD_LSN_SIZE &&
+        pread(fd, sector, SACD_LSN_SIZE, master_toc_offset()) == SACD_LSN_SIZE &&
+        memcmp(sector, SACD_SIGNATURE, 8) == 0) {
+        info->type = SACD_FILE_SACD_ISO;
+        info->sample_rate = SACD_SAMPLE_RATE;
+        info->bits_per_sample = 1;
+
+        /* The stereo area if there is one */
+        uint32_t area_lsn = be32(sector + 64);
+        if (area_lsn == 0) {
+            area_lsn = be32(sector + 72);
+        }
+        uint8_t area[64];
+        if (area_lsn && pread(fd, area, sizeof(area), (off_t)area_lsn * SACD_LSN_SIZE) == (ssize_t)sizeof(area) &&
+            (memcmp(area, "TWOCHTOC", 8) == 0 || memcmp(area, "MULCHTOC", 8) == 0)) {
+            info->channels = area[32];
+            info->dst_encoded = (area[21] & 0x0F) == 0;
+        }
+        return;
+    }
+
+    if (pread(fd, sector, 6, ISO9660_PVD_OFFSET) == 6 && memcmp(sector + 1, "CD001", 5) == 0) {
+        info->type = SACD_FILE_ISO9660;
+    }
+}
+
+/* ---- Probing ---- */
+
+typedef struct {
+    int fd;                        /* -1 if the file couldn't be opened */
+    uint64_t size;
+    sacd_file_info_t *info;
+} probe_t;
+
+static void open_probe(int dir_fd, const char *name, sacd_file_info_t *info, probe_t *probe) {
+    memset(info, 0, sizeof(sacd_file_info_t));
+    probe->info = info;
+    probe->fd = openat(dir_fd, name, O_RDONLY | O_CLOEXEC | O_NOCTTY | O_NONBLOCK);
+    if (probe->fd < 0) {
+        return;
+    }
+
+    /* Only regular files: reading a FIFO or a device could block or never end */
+    struct stat st;
+    if (fstat(probe->fd, &st) != 0 || !S_ISREG(st.st_mode)) {
+        close(probe->fd);
+        probe->fd = -1;
+        return;
+    }
+    probe->size = (uint64_t)st.st_size;
+    info->file_size = probe->size;
+    posix_fadvise(probe->fd, 0, HEADER_BYTES, POSIX_FADV_WILLNEED);
+}
+
+/* Classify by the header; false if the file still needs looking at as an image */
+static bool read_header(probe_t *probe) {
+    uint8_t data[HEADER_BYTES];
+    ssize_t got = pread(probe->fd, data, sizeof(data), 0);
+    if (got <= 0) {
+        return true;
+    }
+
+    /* FLAC files may carry an ID3 tag in front */
+    uint64_t skip = id3_size(data, (size_t)got);
+    if (skip && skip < probe->size) {
+        got = pread(probe->fd, data, sizeof(data), (off_t)skip);
+        if (got <= 0) {
+            return true;
+        }
+        return parse_flac(data, (size_t)got, probe->info);
+    }
+    return parse_header(data, (size_t)got, probe->info);
+}
+
+/*
+ * Probe a batch: open everything and ask for the headers, read them, then
+ * ask for and read the image sectors of whatever is left.
+ */
+static int probe_batch(int dir_fd, const char *const *names, sacd_file_info_t *infos, int count) {
+    probe_t probes[BATCH_FILES];
+    for (int i = 0; i < count; i++) {
+        open_probe(dir_fd, names[i], &infos[i], &probes[i]);
+    }
+
+    bool pending[BATCH_FILES];
+    for (int i = 0; i < count; i++) {
+        pending[i] = probes[i].fd >= 0 && !read_header(&probes[i]) && may_be_image(probes[i].size);
+        if (pending[i]) {
+            advise_image(probes[i].fd, probes[i].size);
+        }
+    }
+
+    int recognised = 0;
+    for (int i = 0; i < count; i++) {
+        if (pending[i]) {
+            probe_image(probes[i].fd, probes[i].size, probes[i].info);
+        }
+        if (probes[i].fd >= 0) {
+            close(probes[i].fd);
+        }
+        if (infos[i].type != SACD_FILE_UNKNOWN) {
+            recognised++;
+        }
+    }
+    return recognised;
+}
+
+typedef struct {
+    int dir_fd;
+    const char *const *names;
+    sacd_file_info_t *infos;
+    int count;
+    int next;                      /* First file of the next unclaimed batch (atomic) */
+    int recognised;                /* (atomic) */
+} probe_job_t;
+
+static void *probe_worker(void *arg) {
+    probe_job_t *job = arg;
+    for (;;) {
+        int first = __atomic_fetch_add(&job->next, BATCH_FILES, __ATOMIC_RELAXED);
+        if (first >= job->count) {
+            break;
+        }
+        int count = job->count - first < BATCH_FILES ? job->count - first : BATCH_FILES;
+        int found = probe_batch(job->dir_fd, job->names + first, job->infos + first, count);
+        __atomic_fetch_add(&job->recognised, found, __ATOMIC_RELAXED);
+    }
+    return NULL;
+}
+
+int sacd_probe_files(int dir_fd, const char *const *names, int count,
+                     sacd_file_info_t *infos, int threads) {
+    if (!names || !infos || count <= 0) {
+        return 0;
+    }
+
+    probe_job_t job = { dir_fd, names, infos, count, 0, 0 };
+
+    int batches = (count + BATCH_FILES - 1) / BATCH_FILES;
+    if (threads <= 0) {
+        threads = DEFAULT_THREADS;
+    }
+    if (threads > MAX_THREADS) {
+        threads = MAX_THREADS;
+    }
+    if (threads > batches) {
+        threads = batches;
+    }
+
+    /* The calling thread takes batches too */
+    pthread_t workers[MAX_THREADS];
+    int started = 0;
+    for (int i = 1; i < threads; i++) {
+        if (pthread_create(&workers[started], NULL, probe_worker, &job) != 0) {
+            break;
+        }
+        started++;
+    }
+    probe_worker(&job);
+    for (int i = 0; i < started; i++) {
+        pthread_join(workers[i], NULL);
+    }
+    return job.recognised;
+}
+
+sacd_result_t sacd_probe_file_at(int dir_fd, const char *name, sacd_file_info_t *info) {
+    if (!name || !info) {
+        return SACD_RESULT_ERROR;
+    }
+
+    probe_t probe;
+    open_probe(dir_fd, name, info, &probe);
+    if (probe.fd < 0) {
+        return SACD_RESULT_IO_ERROR;
+    }
+    if (!read_header(&probe) && may_be_image(probe.size)) {
+        probe_image(probe.fd, probe.size, info);
+    }
+    close(probe.fd);
+    return SACD_RESULT_OK;
+}
+
+sacd_result_t sacd_probe_file(const char *path, sacd_file_info_t *info) {
+    return sacd_probe_file_at(AT_FDCWD, path, info);
+}
+
+const char *sacd_file_type_name(sacd_file_type_t type) {
+    switch (type) {
+        case SACD_FILE_SACD_ISO:
+            return "SACD";
+        case SACD_FILE_ISO9660:
+            return "ISO9660";
+        case SACD_FILE_DSF:
+            return "DSF";
+        case SACD_FILE_DSDIFF:
+            return "DSDIFF";
+        case SACD_FILE_FLAC:
+            return "FLAC";
+        case SACD_FILE_WAV:
+            return "WAV";
+        case SACD_FILE_RF64:
+            return "RF64";
+        case SACD_FILE_W64:
+            return "W64";
+        case SACD_FILE_AIFF:
+            return "AIFF";
+        default:
+            return "Unknown";
+    }
+}
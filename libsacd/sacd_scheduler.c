@@ -0,0 +1,750 @@
+/**
+ * SACD Library - Batch Scheduler
+ *
+ * Runs many extractions at once while keeping each storage device within its
+ * concurrency budget. Jobs are grouped by the st_dev of the source ISO and the
+ * output directory: two jobs reading the same spinning disk would destroy each
+ * other's sequential throughput, while jobs on different devices can run fully
+ * in parallel. Each job is an ordinary extractor driven through the public
+ * create/add/start lifecycle.
+ */
+
+#include "sacd_lib.h"
+#include "sacd_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+/* Per-device slot accounting */
+typedef struct {
+    dev_t dev;                        /* Device number (st_dev) */
+    sacd_device_class_t device_class; /* Detected device class */
+    int max_readers;                  /* Reader slots (0 = class default) */
+    int max_writers;                  /* Writer slots (0 = class default) */
+    int active_readers;               /* Jobs currently reading this device */
+    int active_writers;               /* Jobs currently writing this device */
+} sched_device_t;
+
+typedef enum {
+    SCHED_JOB_PENDING = 0,
+    SCHED_JOB_RUNNING,
+    SCHED_JOB_DONE
+} sched_job_state_t;
+
+/* NUMA nodes tracked for balance_numa_nodes */
+#define SCHED_MAX_NODES 64
+
+typedef struct sched_job {
+    struct sacd_scheduler *scheduler; /* Owning scheduler */
+    int id;                           /* Job identifier */
+
+    /* Job description */
+    char *iso_path;
+    char *output_dir;
+    sacd_area_type_t area_type;
+    int *track_numbers;               /* NULL = all tracks */
+    int track_count;
+    sacd_extraction_options_t options;
+    char *extraction_cpus;            /* Copies of the options' CPU lists */
+    char *worker_cpus;
+
+    /* Device slots */
+    int read_device;                  /* Index into device table */
+    int write_device;                 /* Index into device table */
+    int numa_node;                    /* Node the job was placed on (-1 = none) */
+
+    /* Runtime state */
+    sched_job_state_t state;
+    bool finished;                    /* Set by the extractor finish hook */
+    sacd_result_t result;
+    sacd_disc_t *disc;
+    sacd_extractor_t *extractor;
+
+    struct sched_job *next;
+} sched_job_t;
+
+struct sacd_scheduler {
+    sacd_scheduler_options_t options;
+
+    /* Device table */
+    sched_device_t *devices;
+    int device_count;
+    int device_capacity;
+
+    /* Job list (FIFO, nodes are only freed on destroy) */
+    sched_job_t *jobs_head;
+    sched_job_t *jobs_tail;
+    int next_job_id;
+    int running_jobs;
+
+    /* Running jobs per NUMA node (balance_numa_nodes) */
+    int node_count;
+    int node_jobs[SCHED_MAX_NODES];
+
+    /* State */
+    bool is_running;                  /* A dispatcher thread is active */
+    bool started;                     /* Started and not cancelled: added jobs get dispatched */
+    bool cancel_requested;
+    bool thread_joinable;
+    sacd_result_t result;             /* First job failure */
+
+    /* Threading */
+    pthread_t dispatch_thread;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+};
+
+static sacd_result_t spawn_dispatcher(sacd_scheduler_t *scheduler);
+
+/* Initialize default scheduler options */
+void sacd_scheduler_options_init(sacd_scheduler_options_t *options) {
+    if (!options) {
+        return;
+    }
+
+    memset(options, 0, sizeof(sacd_scheduler_options_t));
+
+    options->hdd_readers = 1;
+    options->hdd_writers = 1;
+    options->ssd_readers = 4;
+    options->ssd_writers = 4;
+    options->other_readers = 2;
+    options->other_writers = 2;
+    options->max_jobs = 0;
+    options->balance_numa_nodes = true;
+}
+
+/* Classify a block device through sysfs */
+static sacd_device_class_t detect_device_class(dev_t dev) {
+    char link[64];
+    char resolved[PATH_MAX];
+
+    snprintf(link, sizeof(link), "/sys/dev/block/%u:%u", major(dev), minor(dev));
+    if (!realpath(link, resolved)) {
+        return SACD_DEVICE_UNKNOWN;
+    }
+
+    /* Partitions keep their queue attributes on the parent disk */
+    for (int depth = 0; depth < 2; depth++) {
+        char attr[PATH_MAX + 32];
+        snprintf(attr, sizeof(attr), "%s/queue/rotational", resolved);
+
+        FILE *f = fopen(attr, "r");
+        if (f) {
+            int rotational = -1;
+            if (fscanf(f, "%d", &rotational) != 1) {
+                rotational = -1;
+            }
+            fclose(f);
+
+            if (rotational == 1) {
+                return SACD_DEVICE_ROTATIONAL;
+            }
+            if (rotational == 0) {
+                return SACD_DEVICE_SOLID_STATE;
+            }
+            return SACD_DEVICE_UNKNOWN;
+        }
+
+        char *slash = strrchr(resolved, '/');
+        if (!slash || slash == resolved) {
+            break;
+        }
+        *slash = '\0';
+    }
+
+    return SACD_DEVICE_UNKNOWN;
+}
+
+/* Find the device holding a path, walking up to the nearest existing parent */
+static sacd_result_t path_device(const char *path, dev_t *dev) {
+    char buffer[PATH_MAX];
+    struct stat st;
+
+    if (strlen(path) >= sizeof(buffer)) {
+        return SACD_RESULT_ERROR;
+    }
+    strcpy(buffer, path);
+
+    while (stat(buffer, &st) != 0) {
+        char *slash = strrchr(buffer, '/');
+        if (!slash) {
+            strcpy(buffer, ".");
+        } else if (slash == buffer) {
+            buffer[1] = '\0';
+        } else {
+            *slash = '\0';
+        }
+
+        if (strcmp(buffer, ".") == 0 || strcmp(buffer, "/") == 0) {
+            if (stat(buffer, &st) != 0) {
+                return SACD_RESULT_IO_ERROR;
+            }
+            break;
+        }
+    }
+
+    *dev = st.st_dev;
+    return SACD_RESULT_OK;
+}
+
+/* Look up (or add) a device table entry; caller holds the mutex */
+static int device_index(sacd_scheduler_t *scheduler, dev_t dev) {
+    for (int i = 0; i < scheduler->device_count; i++) {
+        if (scheduler->devices[i].dev == dev) {
+            return i;
+        }
+    }
+
+    if (scheduler->device_count == scheduler->device_capacity) {
+        int new_capacity = scheduler->device_capacity ? scheduler->device_capacity * 2 : 4;
+        sched_device_t *new_devices = realloc(scheduler->devices,
+                                              new_capacity * sizeof(sched_device_t));
+        if (!new_devices) {
+            return -1;
+        }
+        scheduler->devices = new_devices;
+        scheduler->device_capacity = new_capacity;
+    }
+
+    sched_device_t *device = &scheduler->devices[scheduler->device_count];
+    memset(device, 0, sizeof(sched_device_t));
+    device->dev = dev;
+    device->device_class = detect_device_class(dev);
+
+    return scheduler->device_count++;
+}
+
+/* Effective slot limits for a device */
+static int device_max_readers(const sacd_scheduler_t *scheduler, const sched_device_t *device) {
+    if (device->max_readers > 0) {
+        return device->max_readers;
+    }
+    switch (device->device_class) {
+        case SACD_DEVICE_ROTATIONAL:  return scheduler->options.hdd_readers;
+        case SACD_DEVICE_SOLID_STATE: return scheduler->options.ssd_readers;
+        default:                      return scheduler->options.other_readers;
+    }
+}
+
+static int device_max_writers(const sacd_scheduler_t *scheduler, const sched_device_t *device) {
+    if (device->max_writers > 0) {
+        return device->max_writers;
+    }
+    switch (device->device_class) {
+        case SACD_DEVICE_ROTATIONAL:  return scheduler->options.hdd_writers;
+        case SACD_DEVICE_SOLID_STATE: return scheduler->options.ssd_writers;
+        default:                      return scheduler->options.other_writers;
+    }
+}
+
+/* Free a job description */
+static void free_job(sched_job_t *job) {
+    free(job->iso_path);
+    free(job->output_dir);
+    free(job->track_numbers);
+    free(job->extraction_cpus);
+    free(job->worker_cpus);
+    free(job);
+}
+
+/* Create a scheduler */
+sacd_result_t sacd_scheduler_create(const sacd_scheduler_options_t *options,
+                                    sacd_scheduler_t **scheduler) {
+    if (!scheduler) {
+        return SACD_RESULT_ERROR;
+    }
+
+    *scheduler = NULL;
+
+    sacd_scheduler_t *s = calloc(1, sizeof(sacd_scheduler_t));
+    if (!s) {
+        return SACD_RESULT_OUT_OF_MEMORY;
+    }
+
+    if (options) {
+        s->options = *options;
+    } else {
+        sacd_scheduler_options_init(&s->options);
+    }
+
+    /* Never allow a class to be starved entirely */
+    if (s->options.hdd_readers < 1) s->options.hdd_readers = 1;
+    if (s->options.hdd_writers < 1) s->options.hdd_writers = 1;
+    if (s->options.ssd_readers < 1) s->options.ssd_readers = 1;
+    if (s->options.ssd_writers < 1) s->options.ssd_writers = 1;
+    if (s->options.other_readers < 1) s->options.other_readers = 1;
+    if (s->options.other_writers < 1) s->options.other_writers = 1;
+
+    if (pthread_mutex_init(&s->mutex, NULL) != 0) {
+        free(s);
+        return SACD_RESULT_ERROR;
+    }
+
+    if (pthread_cond_init(&s->cond, NULL) != 0) {
+        pthread_mutex_destroy(&s->mutex);
+        free(s);
+        return SACD_RESULT_ERROR;
+    }
+
+    s->node_count = sacd_internal_numa_node_count();
+    if (s->node_count > SCHED_MAX_NODES) {
+        s->node_count = SCHED_MAX_NODES;
+    }
+
+    s->next_job_id = 1;
+    *scheduler = s;
+
+    return SACD_RESULT_OK;
+}
+
+/* Destroy a scheduler */
+void sacd_scheduler_destroy(sacd_scheduler_t *scheduler) {
+    if (!scheduler) {
+        return;
+    }
+
+    sacd_scheduler_cancel(scheduler);
+    sacd_scheduler_wait(scheduler);
+
+    sched_job_t *job = scheduler->jobs_head;
+    while (job) {
+        sched_job_t *next = job->next;
+        free_job(job);
+        job = next;
+    }
+
+    pthread_cond_destroy(&scheduler->cond);
+    pthread_mutex_destroy(&scheduler->mutex);
+    free(scheduler->devices);
+    free(scheduler);
+}
+
+/* Override limits for a device */
+sacd_result_t sacd_scheduler_set_device_limits(sacd_scheduler_t *scheduler,
+                                               const char *path,
+                                               int max_readers,
+                                               int max_writers) {
+    if (!scheduler || !path) {
+        return SACD_RESULT_ERROR;
+    }
+
+    dev_t dev;
+    SACD_CHECK_RESULT(path_device(path, &dev));
+
+    pthread_mutex_lock(&scheduler->mutex);
+
+    int index = device_index(scheduler, dev);
+    if (index < 0) {
+        pthread_mutex_unlock(&scheduler->mutex);
+        return SACD_RESULT_OUT_OF_MEMORY;
+    }
+
+    scheduler->devices[index].max_readers = max_readers > 0 ? max_readers : 0;
+    scheduler->devices[index].max_writers = max_writers > 0 ? max_writers : 0;
+
+    /* Raised limits may unblock pending jobs */
+    pthread_cond_signal(&scheduler->cond);
+    pthread_mutex_unlock(&scheduler->mutex);
+
+    return SACD_RESULT_OK;
+}
+
+/* Queue a job */
+sacd_result_t sacd_scheduler_add_job(sacd_scheduler_t *scheduler,
+                                     const char *iso_path,
+                                     sacd_area_type_t area_type,
+                                     const char *output_dir,
+                                     const int *track_numbers,
+                                     int track_count,
+                                     const sacd_extraction_options_t *options,
+                                     int *job_id) {
+    if (!scheduler || !iso_path || !output_dir || !options) {
+        return SACD_RESULT_ERROR;
+    }
+
+    if (track_numbers && track_count <= 0) {
+        return SACD_RESULT_ERROR;
+    }
+
+    /* Resolve devices before taking the lock; stat() may block */
+    dev_t read_dev, write_dev;
+    SACD_CHECK_RESULT(path_device(iso_path, &read_dev));
+    SACD_CHECK_RESULT(path_device(output_dir, &write_dev));
+
+    sched_job_t *job = calloc(1, sizeof(sched_job_t));
+    if (!job) {
+        return SACD_RESULT_OUT_OF_MEMORY;
+    }
+
+    job->scheduler = scheduler;
+    job->area_type = area_type;
+    job->options = *options;
+    job->numa_node = -1;
+    job->iso_path = strdup(iso_path);
+    job->output_dir = strdup(output_dir);
+
+    /* Jobs may start long after the caller's strings are gone */
+    if (options->extraction_cpus) {
+        job->extraction_cpus = strdup(options->extraction_cpus);
+        job->options.extraction_cpus = job->extraction_cpus;
+    }
+    if (options->worker_cpus) {
+        job->worker_cpus = strdup(options->worker_cpus);
+        job->options.worker_cpus = job->worker_cpus;
+    }
+    if (track_numbers) {
+        job->track_numbers = malloc(track_count * sizeof(int));
+        if (job->track_numbers) {
+            memcpy(job->track_numbers, track_numbers, track_count * sizeof(int));
+        }
+        job->track_count = track_count;
+    }
+
+    if (!job->iso_path || !job->output_dir || (track_numbers && !job->track_numbers) ||
+        (options->extraction_cpus && !job->extraction_cpus) ||
+        (options->worker_cpus && !job->worker_cpus)) {
+        free_job(job);
+        return SACD_RESULT_OUT_OF_MEMORY;
+    }
+
+    pthread_mutex_lock(&scheduler->mutex);
+
+    job->read_device = device_index(scheduler, read_dev);
+    job->write_device = device_index(scheduler, write_dev);
+    if (job->read_device < 0 || job->write_device < 0) {
+        pthread_mutex_unlock(&scheduler->mutex);
+        free_job(job);
+        return SACD_RESULT_OUT_OF_MEMORY;
+    }
+
+    job->id = scheduler->next_job_id++;
+    job->state = SCHED_JOB_PENDING;
+
+    if (scheduler->jobs_tail) {
+        scheduler->jobs_tail->next = job;
+    } else {
+        scheduler->jobs_head = job;
+    }
+    scheduler->jobs_tail = job;
+
+    if (job_id) {
+        *job_id = job->id;
+    }
+
+    /* The dispatcher exits once it runs out of work; bring it back */
+    sacd_result_t result = SACD_RESULT_OK;
+    if (scheduler->started && !scheduler->is_running) {
+        result = spawn_dispatcher(scheduler);
+    }
+
+    pthread_cond_signal(&scheduler->cond);
+    pthread_mutex_unlock(&scheduler->mutex);
+
+    return result;
+}
+
+/* Extractor finish hook: runs on the extraction thread */
+static void job_finished(void *data, sacd_result_t result) {
+    sched_job_t *job = (sched_job_t*)data;
+    sacd_scheduler_t *scheduler = job->scheduler;
+
+    pthread_mutex_lock(&scheduler->mutex);
+    job->finished = true;
+    job->result = result;
+    pthread_cond_signal(&scheduler->cond);
+    pthread_mutex_unlock(&scheduler->mutex);
+}
+
+/* Put an automatically placed job on the NUMA node running the fewest jobs */
+static void place_job(sacd_scheduler_t *scheduler, sched_job_t *job) {
+    job->numa_node = -1;
+    if (!scheduler->options.balance_numa_nodes || scheduler->node_count < 2 ||
+        job->options.cpu_placement != SACD_CPU_PLACEMENT_AUTO || job->options.numa_node >= 0) {
+        return;
+    }
+
+    int best = 0;
+    for (int node = 1; node < scheduler->node_count; node++) {
+        if (scheduler->node_jobs[node] < scheduler->node_jobs[best]) {
+            best = node;
+        }
+    }
+
+    job->numa_node = best;
+    scheduler->node_jobs[best]++;
+}
+
+/* Open the disc and start the extractor for a job (called without the lock) */
+static sacd_result_t start_job(sched_job_t *job) {
+    sacd_extractor_t *extractor = NULL;
+    sacd_result_t result = sacd_disc_open(job->iso_path, &job->disc);
+    if (result != SACD_RESULT_OK) {
+        return result;
+    }
+
+    const sacd_area_t *area = sacd_disc_get_area(job->disc, job->area_type);
+    if (!area) {
+        area = sacd_disc_get_best_area(job->disc);
+    }
+    if (!area) {
+        result = SACD_RESULT_INVALID_AREA;
+        goto fail;
+    }
+
+    sacd_extraction_options_t options = job->options;
+    if (job->numa_node >= 0) {
+        options.numa_node = job->numa_node;
+    }
+
+    result = sacd_extractor_create(job->disc, area, job->output_dir, &options, &extractor);
+    if (result != SACD_RESULT_OK) {
+        goto fail;
+    }
+
+    if (job->track_numbers) {
+        result = sacd_extractor_add_tracks(extractor, job->track_numbers, job->track_count);
+    } else {
+        result = sacd_extractor_add_all_tracks(extractor);
+    }
+    if (result != SACD_RESULT_OK) {
+        goto fail;
+    }
+
+    sacd_internal_extractor_set_finish_hook(extractor, job_finished, job);
+
+    result = sacd_extractor_start(extractor);
+    if (result != SACD_RESULT_OK) {
+        goto fail;
+    }
+
+    /* sacd_scheduler_cancel() looks at it under the lock */
+    pthread_mutex_lock(&job->scheduler->mutex);
+    job->extractor = extractor;
+    pthread_mutex_unlock(&job->scheduler->mutex);
+    return SACD_RESULT_OK;
+
+fail:
+    sacd_extractor_destroy(extractor);
+    sacd_disc_close(job->disc);
+    job->disc = NULL;
+    return result;
+}
+
+/* Release a job's slots and record its result; caller holds the mutex */
+static void retire_job(sacd_scheduler_t *scheduler, sched_job_t *job, sacd_result_t result) {
+    if (job->state == SCHED_JOB_RUNNING) {
+        scheduler->devices[job->read_device].active_readers--;
+        scheduler->devices[job->write_device].active_writers--;
+        scheduler->running_jobs--;
+        if (job->numa_node >= 0) {
+            scheduler->node_jobs[job->numa_node]--;
+            job->numa_node = -1;
+        }
+    }
+
+    job->state = SCHED_JOB_DONE;
+    job->result = result;
+
+    if (result != SACD_RESULT_OK && scheduler->result == SACD_RESULT_OK) {
+        scheduler->result = result;
+    }
+}
+
+/* Report a retired job to the user without holding the lock */
+static void notify_job(sacd_scheduler_t *scheduler, sched_job_t *job) {
+    if (!scheduler->options.job_complete_callback) {
+        return;
+    }
+
+    pthread_mutex_unlock(&scheduler->mutex);
+    scheduler->options.job_complete_callback(job->id, job->iso_path, job->result,
+                                             scheduler->options.callback_userdata);
+    pthread_mutex_lock(&scheduler->mutex);
+}
+
+/* Check whether a pending job fits within its devices' budgets */
+static bool job_can_start(const sacd_scheduler_t *scheduler, const sched_job_t *job) {
+    if (scheduler->options.max_jobs > 0 && scheduler->running_jobs >= scheduler->options.max_jobs) {
+        return false;
+    }
+
+    const sched_device_t *reader = &scheduler->devices[job->read_device];
+    const sched_device_t *writer = &scheduler->devices[job->write_device];
+
+    return reader->active_readers < device_max_readers(scheduler, reader) &&
+           writer->active_writers < device_max_writers(scheduler, writer);
+}
+
+/* Dispatcher thread: reap finished jobs, start eligible ones, sleep */
+static void *dispatch_thread(void *arg) {
+    sacd_scheduler_t *scheduler = (sacd_scheduler_t*)arg;
+
+    pthread_mutex_lock(&scheduler->mutex);
+
+    for (;;) {
+        bool progressed = false;
+        int pending = 0;
+
+        for (sched_job_t *job = scheduler->jobs_head; job; job = job->next) {
+            /* Reap jobs whose extractor has finished */
+            if (job->state == SCHED_JOB_RUNNING && job->finished) {
+                sacd_extractor_t *extractor = job->extractor;
+                sacd_disc_t *disc = job->disc;
+                job->extractor = NULL;
+                job->disc = NULL;
+                retire_job(scheduler, job, job->result);
+
+                pthread_mutex_unlock(&scheduler->mutex);
+                sacd_extractor_wait(extractor);
+                sacd_extractor_destroy(extractor);
+                sacd_disc_close(disc);
+                pthread_mutex_lock(&scheduler->mutex);
+
+                notify_job(scheduler, job);
+                progressed = true;
+                continue;
+            }
+
+            if (job->state != SCHED_JOB_PENDING) {
+                continue;
+            }
+
+            if (scheduler->cancel_requested) {
+                retire_job(scheduler, job, SACD_RESULT_CANCELLED);
+                notify_job(scheduler, job);
+                progressed = true;
+                continue;
+            }
+
+            if (!job_can_start(scheduler, job)) {
+                pending++;
+                continue;
+            }
+
+            /* Reserve slots, then open the disc outside the lock */
+            job->state = SCHED_JOB_RUNNING;
+            job->finished = false;
+            scheduler->devices[job->read_device].active_readers++;
+            scheduler->devices[job->write_device].active_writers++;
+            scheduler->running_jobs++;
+            place_job(scheduler, job);
+
+            pthread_mutex_unlock(&scheduler->mutex);
+            sacd_result_t result = start_job(job);
+            pthread_mutex_lock(&scheduler->mutex);
+
+            if (result != SACD_RESULT_OK) {
+                retire_job(scheduler, job, result);
+                notify_job(scheduler, job);
+            } else if (scheduler->cancel_requested && job->extractor) {
+                sacd_extractor_cancel(job->extractor);
+            }
+            progressed = true;
+        }
+
+        if (progressed) {
+            continue;
+        }
+
+        if (pending == 0 && scheduler->running_jobs == 0) {
+            break;
+        }
+
+        pthread_cond_wait(&scheduler->cond, &scheduler->mutex);
+    }
+
+    scheduler->is_running = false;
+    pthread_mutex_unlock(&scheduler->mutex);
+
+    return NULL;
+}
+
+/* Run a dispatcher thread, reaping one that went idle; caller holds the mutex */
+static sacd_result_t spawn_dispatcher(sacd_scheduler_t *scheduler) {
+    /* An idle dispatcher cleared is_running under the mutex and only returns after that */
+    if (scheduler->thread_joinable) {
+        pthread_join(scheduler->dispatch_thread, NULL);
+        scheduler->thread_joinable = false;
+    }
+
+    scheduler->is_running = true;
+    if (pthread_create(&scheduler->dispatch_thread, NULL, dispatch_thread, scheduler) != 0) {
+        scheduler->is_running = false;
+        return SACD_RESULT_ERROR;
+    }
+    scheduler->thread_joinable = true;
+    return SACD_RESULT_OK;
+}
+
+/* Start dispatching */
+sacd_result_t sacd_scheduler_start(sacd_scheduler_t *scheduler) {
+    if (!scheduler) {
+        return SACD_RESULT_ERROR;
+    }
+
+    pthread_mutex_lock(&scheduler->mutex);
+
+    if (scheduler->is_running) {
+        pthread_mutex_unlock(&scheduler->mutex);
+        return SACD_RESULT_ERROR;
+    }
+
+    scheduler->cancel_requested = false;
+    scheduler->result = SACD_RESULT_OK;
+
+    sacd_result_t result = spawn_dispatcher(scheduler);
+    scheduler->started = (result == SACD_RESULT_OK);
+
+    pthread_mutex_unlock(&scheduler->mutex);
+    return result;
+}
+
+/* Cancel everything */
+void sacd_scheduler_cancel(sacd_scheduler_t *scheduler) {
+    if (!scheduler) {
+        return;
+    }
+
+    pthread_mutex_lock(&scheduler->mutex);
+
+    scheduler->cancel_requested = true;
+    scheduler->started = false;
+    for (sched_job_t *job = scheduler->jobs_head; job; job = job->next) {
+        if (job->state == SCHED_JOB_RUNNING && job->extractor) {
+            sacd_extractor_cancel(job->extractor);
+        }
+    }
+
+    pthread_cond_signal(&scheduler->cond);
+    pthread_mutex_unlock(&scheduler->mutex);
+}
+
+/* Wait for all jobs */
+sacd_result_t sacd_scheduler_wait(sacd_scheduler_t *scheduler) {
+    if (!scheduler) {
+        return SACD_RESULT_ERROR;
+    }
+
+    /* A job added meanwhile may have started another dispatcher: wait for that too */
+    pthread_mutex_lock(&scheduler->mutex);
+    while (scheduler->thread_joinable) {
+        pthread_t thread = scheduler->dispatch_thread;
+        scheduler->thread_joinable = false;
+        pthread_mutex_unlock(&scheduler->mutex);
+
+        if (pthread_join(thread, NULL) != 0) {
+            return SACD_RESULT_ERROR;
+        }
+        pthread_mutex_lock(&scheduler->mutex);
+    }
+    sacd_result_t result = scheduler->result;
+    pthread_mutex_unlock(&scheduler->mutex);
+
+    return result;
+}
@@ -0,0 +1,183 @@
+/**
+ * SACD Library - Digital Silence Detection and Trimming
+ *
+ * A DSD stream at rest carries the idle pattern 0x69 (or its complement
+ * 0x96, depending on where the encoder started it) in every byte. Tracks
+ * often begin and end with whole seconds of it. A frame is silent when every
+ * byte is one of the two: XOR with the pattern leaves each byte all zeros or
+ * all ones, which is a byte whose bits all agree with their neighbour. The
+ * test runs a vector of words at a time and gives up at the first block
+ * that isn't silent, so audible frames cost next to nothing.
+ *
+ * Trimming drops silence before the first audible frame straight away.
+ * Silence after an audible frame may still be followed by more audio, so it
+ * is held back until either more audio comes (and it is written after all)
+ * or the track ends (and it is dropped). Held frames are kept as runs of
+ * identical frames, so seconds of steady idle pattern take one frame of
+ * memory.
+ */
+
+#include "sacd_lib.h"
+#include "sacd_internal.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Frame data held back before giving up and writing it (only for odd, varying "silence") */
+#define HOLD_LIMIT (64 * 1024 * 1024)
+
+/* Bytes tested before checking for an audible byte */
+#define BLOCK_BYTES 128
+
+#define IDLE_PATTERN 0x6969696969696969ULL
+
+typedef uint64_t word_vector_t __attribute__((vector_size(32)));
+
+/* Whether a frame of interleaved DSD is all idle pattern */
+bool sacd_internal_frame_is_silent(const uint8_t *data, size_t size) {
+    size_t i = 0;
+
+    for (; i + BLOCK_BYTES <= size; i += BLOCK_BYTES) {
+        /* Bits that differ from the next bit up within their byte */
+        word_vector_t disagree = { 0 };
+        for (size_t v = 0; v < BLOCK_BYTES; v += sizeof(word_vector_t)) {
+            word_vector_t x;
+            memcpy(&x, data + i + v, sizeof(x));
+            x ^= IDLE_PATTERN;
+            disagree |= x ^ (x << 1);
+        }
+        uint64_t any = 0;
+        for (size_t w = 0; w < sizeof(word_vector_t) / 8; w++) {
+            any |= disagree[w];
+        }
+        if (any & 0xfefefefefefefefeULL) {
+            return false;
+        }
+    }
+
+    for (; i < size; i++) {
+        if (data[i] != 0x69 && data[i] != 0x96) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/* Start on a new track; buffers are kept for the next one */
+void sacd_internal_silence_reset(sacd_silence_t *silence, bool enabled, bool trim) {
+    silence->enabled = enabled;
+    silence->trim = enabled && trim;
+    silence->audible = false;
+    silence->run = 0;
+    silence->run_count = 0;
+    silence->held_size = 0;
+    memset(&silence->report, 0, sizeof(sacd_silence_report_t));
+    silence->report.valid = enabled;
+}
+
+/* Hold back a silent frame, as one more of the last run if it is the same */
+static sacd_result_t hold_frame(sacd_silence_t *silence, uint32_t frame, const uint8_t *data, size_t size) {
+    if (silence->run_count > 0) {
+        sacd_silence_run_t *last = &silence->runs[silence->run_count - 1];
+        if (last->size == size && last->frame + last->count == frame &&
+            memcmp(silence->held + last->offset, data, size) == 0) {
+            last->count++;
+            return SACD_RESULT_OK;
+        }
+    }
+
+    if (silence->run_count == silence->run_capacity) {
+        int capacity = silence->run_capacity ? silence->run_capacity * 2 : 16;
+        sacd_silence_run_t *runs = realloc(silence->runs, capacity * sizeof(sacd_silence_run_t));
+        if (!runs) {
+            return SACD_RESULT_OUT_OF_MEMORY;
+        }
+        silence->runs = runs;
+        silence->run_capacity = capacity;
+    }
+    if (silence->held_size + size > silence->held_capacity) {
+        size_t capacity = silence->held_capacity ? silence->held_capacity : 4 * size;
+        while (capacity < silence->held_size + size) {
+            capacity *= 2;
+        }
+        uint8_t *held = realloc(silence->held, capacity);
+        if (!held) {
+            return SACD_RESULT_OUT_OF_MEMORY;
+        }
+        silence->held = held;
+        silence->held_capacity = capacity;
+    }
+
+    sacd_silence_run_t *run = &silence->runs[silence->run_count++];
+    run->frame = frame;
+    run->count = 1;
+    run->offset = silence->held_size;
+    run->size = size;
+    memcpy(silence->held + silence->held_size, data, size);
+    silence->held_size += size;
+    return SACD_RESULT_OK;
+}
+
+/*
+ * Check the next frame of the track. '*write' tells whether to write the
+ * held runs and then the frame now; otherwise the frame has been dropped or
+ * held back.
+ */
+sacd_result_t sacd_internal_silence_frame(sacd_silence_t *silence, uint32_t frame, const uint8_t *data,
+                                          size_t size, bool *write) {
+    *write = true;
+    if (!silence->enabled) {
+        return SACD_RESULT_OK;
+    }
+
+    if (!sacd_internal_frame_is_silent(data, size)) {
+        if (!silence->audible) {
+            silence->report.leading_frames = silence->run;
+            silence->audible = true;
+        }
+        silence->run = 0;
+        return SACD_RESULT_OK;
+    }
+
+    silence->report.silent_frames++;
+    silence->run++;
+    if (!silence->trim) {
+        return SACD_RESULT_OK;
+    }
+    if (!silence->audible) {
+        *write = false;
+        return SACD_RESULT_OK;
+    }
+    if (silence->held_size + size > HOLD_LIMIT) {
+        return SACD_RESULT_OK;
+    }
+    SACD_CHECK_RESULT(hold_frame(silence, frame, data, size));
+    *write = false;
+    return SACD_RESULT_OK;
+}
+
+/* The held runs have been written */
+void sacd_internal_silence_release(sacd_silence_t *silence) {
+    silence->run_count = 0;
+    silence->held_size = 0;
+}
+
+/* End of the track: whatever is still held is trailing silence and is dropped */
+void sacd_internal_silence_finish(sacd_silence_t *silence) {
+    if (!silence->enabled) {
+        return;
+    }
+    if (silence->audible) {
+        silence->report.trailing_frames = silence->run;
+    } else {
+        silence->report.leading_frames = silence->run;
+    }
+    silence->report.trimmed = silence->trim;
+    sacd_internal_silence_release(silence);
+}
+
+/* Release the buffers */
+void sacd_internal_silence_free(sacd_silence_t *silence) {
+    free(silence->runs);
+    free(silence->held);
+    memset(silence, 0, sizeof(sacd_silence_t));
+}
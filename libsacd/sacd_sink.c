@@ -0,0 +1,397 @@
+/**
+ * SACD Library - Output Sinks
+ *
+ * Everything the extractor writes for a track goes through a sacd_sink_t:
+ *
+ *   file    a regular file, buffered in large page-aligned chunks
+ *   fd      an already open descriptor (pipe, socket, stdout); seekable only
+ *           if the descriptor is, with offsets relative to where the track began
+ *   memory  a growable buffer
+ *   null    discards everything but counts it
+ *
+ * Sinks without pwrite cannot patch headers afterwards; writers must size
+ * everything up front for them.
+ */
+
+#include "sacd_lib.h"
+#include "sacd_internal.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+
+#define SINK_BUFFER_SIZE SACD_OUTPUT_BUFFER_SIZE
+
+/* Write all of a buffer to a descriptor, retrying short writes */
+static sacd_result_t write_all(int fd, const uint8_t *data, size_t size) {
+    while (size > 0) {
+        ssize_t n = write(fd, data, size);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return SACD_RESULT_IO_ERROR;
+        }
+        data += n;
+        size -= (size_t)n;
+    }
+    return SACD_RESULT_OK;
+}
+
+static sacd_result_t pwrite_all(int fd, const uint8_t *data, size_t size, off_t offset) {
+    while (size > 0) {
+        ssize_t n = pwrite(fd, data, size, offset);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return SACD_RESULT_IO_ERROR;
+        }
+        data += n;
+        size -= (size_t)n;
+        offset += n;
+    }
+    return SACD_RESULT_OK;
+}
+
+/* ---- File sink ---- */
+
+typedef struct {
+    FILE *file;
+    uint8_t *buffer;
+} file_sink_t;
+
+static sacd_result_t file_sink_write(sacd_sink_t *sink, const void *data, size_t size) {
+    file_sink_t *ctx = (file_sink_t*)sink->context;
+    if (fwrite(data, 1, size, ctx->file) != size) {
+        return SACD_RESULT_IO_ERROR;
+    }
+    sink->position += size;
+    return SACD_RESULT_OK;
+}
+
+static sacd_result_t file_sink_pwrite(sacd_sink_t *sink, const void *data, size_t size, uint64_t offset) {
+    file_sink_t *ctx = (file_sink_t*)sink->context;
+    if (fflush(ctx->file) != 0) {
+        return SACD_RESULT_IO_ERROR;
+    }
+    return pwrite_all(fileno(ctx->file), data, size, (off_t)offset);
+}
+
+static sacd_result_t file_sink_flush(sacd_sink_t *sink, bool durable) {
+    file_sink_t *ctx = (file_sink_t*)sink->context;
+    if (fflush(ctx->file) != 0) {
+        return SACD_RESULT_IO_ERROR;
+    }
+    if (durable && fdatasync(fileno(ctx->file)) != 0) {
+        return SACD_RESULT_IO_ERROR;
+    }
+    return SACD_RESULT_OK;
+}
+
+static sacd_result_t file_sink_close(sacd_sink_t *sink) {
+    file_sink_t *ctx = (file_sink_t*)sink->context;
+    sacd_result_t result = (fclose(ctx->file) == 0) ? SACD_RESULT_OK : SACD_RESULT_IO_ERROR;
+    free(ctx->buffer);
+    free(ctx);
+    free(sink);
+    return result;
+}
+
+/* Wrap an open stream positioned at 'position' */
+sacd_result_t sacd_internal_sink_from_file(FILE *file, uint64_t position, sacd_sink_t **sink) {
+    if (!file || !sink) {
+        return SACD_RESULT_ERROR;
+    }
+
+    *sink = NULL;
+
+    sacd_sink_t *s = calloc(1, sizeof(sacd_sink_t));
+    file_sink_t *ctx = calloc(1, sizeof(file_sink_t));
+    if (!s || !ctx) {
+        free(s);
+        free(ctx);
+        return SACD_RESULT_OUT_OF_MEMORY;
+    }
+
+    /* Large, page-aligned buffer so data reaches the kernel in big aligned writes */
+    if (posix_memalign((void**)&ctx->buffer, 4096, SINK_BUFFER_SIZE) == 0) {
+        setvbuf(file, (char*)ctx->buffer, _IOFBF, SINK_BUFFER_SIZE);
+    } else {
+        ctx->buffer = NULL;
+    }
+
+    ctx->file = file;
+    s->write = file_sink_write;
+    s->pwrite = file_sink_pwrite;
+    s->flush = file_sink_flush;
+    s->close = file_sink_close;
+    s->position = position;
+    s->context = ctx;
+
+    *sink = s;
+    return SACD_RESULT_OK;
+}
+
+/* Create (or truncate) a file */
+sacd_result_t sacd_sink_open_file(const char *path, sacd_sink_t **sink) {
+    if (!path || !sink) {
+        return SACD_RESULT_ERROR;
+    }
+
+    FILE *file = fopen(path, "wb");
+    if (!file) {
+        *sink = NULL;
+        return SACD_RESULT_IO_ERROR;
+    }
+
+    sacd_result_t result = sacd_internal_sink_from_file(file, 0, sink);
+    if (result != SACD_RESULT_OK) {
+        fclose(file);
+    }
+    return result;
+}
+
+/* ---- Descriptor sink ---- */
+
+typedef struct {
+    int fd;
+    off_t base;              /* Descriptor offset where this sink began (-1 = not seekable) */
+    uint8_t *buffer;
+    size_t buffered;
+} fd_sink_t;
+
+static sacd_result_t fd_sink_drain(fd_sink_t *ctx) {
+    sacd_result_t result = write_all(ctx->fd, ctx->buffer, ctx->buffered);
+    ctx->buffered = 0;
+    return result;
+}
+
+static sacd_result_t fd_sink_write(sacd_sink_t *sink, const void *data, size_t size) {
+    fd_sink_t *ctx = (fd_sink_t*)sink->context;
+    const uint8_t *p = (const uint8_t*)data;
+    sink->position += size;
+
+    /* Large writes bypass the buffer once it is drained */
+    if (ctx->buffered + size > SINK_BUFFER_SIZE) {
+        SACD_CHECK_RESULT(fd_sink_drain(ctx));
+        if (size >= SINK_BUFFER_SIZE) {
+            return write_all(ctx->fd, p, size);
+        }
+    }
+
+    memcpy(ctx->buffer + ctx->buffered, p, size);
+    ctx->buffered += size;
+    return SACD_RESULT_OK;
+}
+
+static sacd_result_t fd_sink_pwrite(sacd_sink_t *sink, const void *data, size_t size, uint64_t offset) {
+    fd_sink_t *ctx = (fd_sink_t*)sink->context;
+    SACD_CHECK_RESULT(fd_sink_drain(ctx));
+    return pwrite_all(ctx->fd, data, size, ctx->base + (off_t)offset);
+}
+
+static sacd_result_t fd_sink_flush(sacd_sink_t *sink, bool durable) {
+    fd_sink_t *ctx = (fd_sink_t*)sink->context;
+    SACD_CHECK_RESULT(fd_sink_drain(ctx));
+    /* Pipes and sockets have nothing to sync */
+    if (durable && fdatasync(ctx->fd) != 0 && errno != EINVAL && errno != EROFS) {
+        return SACD_RESULT_IO_ERROR;
+    }
+    return SACD_RESULT_OK;
+}
+
+static sacd_result_t fd_sink_close(sacd_sink_t *sink) {
+    fd_sink_t *ctx = (fd_sink_t*)sink->context;
+    sacd_result_t result = fd_sink_drain(ctx);
+    free(ctx->buffer);
+    free(ctx);
+    free(sink);
+    return result;
+}
+
+/* Write to an open descriptor; it is not closed with the sink */
+sacd_result_t sacd_sink_open_fd(int fd, sacd_sink_t **sink) {
+    if (fd < 0 || !sink) {
+        return SACD_RESULT_ERROR;
+    }
+
+    *sink = NULL;
+
+    sacd_sink_t *s = calloc(1, sizeof(sacd_sink_t));
+    fd_sink_t *ctx = calloc(1, sizeof(fd_sink_t));
+    uint8_t *buffer = malloc(SINK_BUFFER_SIZE);
+    if (!s || !ctx || !buffer) {
+        free(s);
+        free(ctx);
+        free(buffer);
+        return SACD_RESULT_OUT_OF_MEMORY;
+    }
+
+    ctx->fd = fd;
+    ctx->buffer = buffer;
+    ctx->base = lseek(fd, 0, SEEK_CUR);
+
+    s->write = fd_sink_write;
+    s->pwrite = (ctx->base >= 0) ? fd_sink_pwrite : NULL;
+    s->flush = fd_sink_flush;
+    s->close = fd_sink_close;
+    s->context = ctx;
+
+    *sink = s;
+    return SACD_RESULT_OK;
+}
+
+/* ---- Memory sink ---- */
+
+typedef struct {
+    uint8_t *data;
+    size_t size;
+    size_t capacity;
+} memory_sink_t;
+
+static sacd_result_t memory_sink_reserve(memory_sink_t *ctx, size_t size) {
+    if (size <= ctx->capacity) {
+        return SACD_RESULT_OK;
+    }
+
+    size_t capacity = ctx->capacity ? ctx->capacity : SINK_BUFFER_SIZE;
+    while (capacity < size) {
+        capacity *= 2;
+    }
+
+    uint8_t *data = realloc(ctx->data, capacity);
+    if (!data) {
+        return SACD_RESULT_OUT_OF_MEMORY;
+    }
+    ctx->data = data;
+    ctx->capacity = capacity;
+    return SACD_RESULT_OK;
+}
+
+static sacd_result_t memory_sink_pwrite(sacd_sink_t *sink, const void *data, size_t size, uint64_t offset) {
+    memory_sink_t *ctx = (memory_sink_t*)sink->context;
+    SACD_CHECK_RESULT(memory_sink_reserve(ctx, (size_t)offset + size));
+    if (offset > ctx->size) {
+        memset(ctx->data + ctx->size, 0, (size_t)offset - ctx->size);
+    }
+    memcpy(ctx->data + offset, data, size);
+    if (offset + size > ctx->size) {
+        ctx->size = (size_t)offset + size;
+    }
+    return SACD_RESULT_OK;
+}
+
+static sacd_result_t memory_sink_write(sacd_sink_t *sink, const void *data, size_t size) {
+    SACD_CHECK_RESULT(memory_sink_pwrite(sink, data, size, sink->position));
+    sink->position += size;
+    return SACD_RESULT_OK;
+}
+
+static sacd_result_t memory_sink_flush(sacd_sink_t *sink, bool durable) {
+    (void)sink;
+    (void)durable;
+    return SACD_RESULT_OK;
+}
+
+static sacd_result_t memory_sink_close(sacd_sink_t *sink) {
+    memory_sink_t *ctx = (memory_sink_t*)sink->context;
+    free(ctx->data);
+    free(ctx);
+    free(sink);
+    return SACD_RESULT_OK;
+}
+
+/* Keep everything in a growable buffer */
+sacd_result_t sacd_sink_open_memory(sacd_sink_t **sink) {
+    if (!sink) {
+        return SACD_RESULT_ERROR;
+    }
+
+    *sink = NULL;
+
+    sacd_sink_t *s = calloc(1, sizeof(sacd_sink_t));
+    memory_sink_t *ctx = calloc(1, sizeof(memory_sink_t));
+    if (!s || !ctx) {
+        free(s);
+        free(ctx);
+        return SACD_RESULT_OUT_OF_MEMORY;
+    }
+
+    s->write = memory_sink_write;
+    s->pwrite = memory_sink_pwrite;
+    s->flush = memory_sink_flush;
+    s->close = memory_sink_close;
+    s->context = ctx;
+
+    *sink = s;
+    return SACD_RESULT_OK;
+}
+
+/* Contents of a memory sink */
+const uint8_t *sacd_sink_memory_data(const sacd_sink_t *sink, size_t *size) {
+    if (!sink || sink->write != memory_sink_write) {
+        if (size) {
+            *size = 0;
+        }
+        return NULL;
+    }
+
+    const memory_sink_t *ctx = (const memory_sink_t*)sink->context;
+    if (size) {
+        *size = ctx->size;
+    }
+    return ctx->data;
+}
+
+/* ---- Null sink ---- */
+
+static sacd_result_t null_sink_write(sacd_sink_t *sink, const void *data, size_t size) {
+    (void)data;
+    sink->position += size;
+    return SACD_RESULT_OK;
+}
+
+static sacd_result_t null_sink_pwrite(sacd_sink_t *sink, const void *data, size_t size, uint64_t offset) {
+    (void)sink;
+    (void)data;
+    (void)size;
+    (void)offset;
+    return SACD_RESULT_OK;
+}
+
+static sacd_result_t null_sink_close(sacd_sink_t *sink) {
+    free(sink);
+    return SACD_RESULT_OK;
+}
+
+/* Discard everything */
+sacd_result_t sacd_sink_open_null(sacd_sink_t **sink) {
+    if (!sink) {
+        return SACD_RESULT_ERROR;
+    }
+
+    sacd_sink_t *s = calloc(1, sizeof(sacd_sink_t));
+    if (!s) {
+        *sink = NULL;
+        return SACD_RESULT_OUT_OF_MEMORY;
+    }
+
+    s->write = null_sink_write;
+    s->pwrite = null_sink_pwrite;
+    s->flush = memory_sink_flush;
+    s->close = null_sink_close;
+
+    *sink = s;
+    return SACD_RESULT_OK;
+}
+
+/* Close any sink */
+sacd_result_t sacd_sink_close(sacd_sink_t *sink) {
+    if (!sink) {
+        return SACD_RESULT_OK;
+    }
+    return sink->close(sink);
+}
@@ -0,0 +1,121 @@
+/**
+ * SACD Library - I/O Pacing
+ *
+ * Token buckets that hold the extraction thread to a configured read or
+ * write bandwidth, and the I/O scheduling class of the extraction thread, so
+ * a background rip doesn't starve other users of the same disks.
+ *
+ * A bucket holds up to SACD_THROTTLE_BURST_NS worth of bytes. Consuming more
+ * than is available puts the bucket in debt, and the caller sleeps until the
+ * debt is paid off. Rates are read atomically on every call, so they can be
+ * changed while an extraction is running.
+ */
+
+#include "sacd_lib.h"
+#include "sacd_internal.h"
+#include <time.h>
+#include <unistd.h>
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+/* ioprio_set(2) encoding; glibc doesn't provide these */
+#define IOPRIO_CLASS_SHIFT  13
+#define IOPRIO_CLASS_BE     2
+#define IOPRIO_CLASS_IDLE   3
+#define IOPRIO_WHO_PROCESS  1
+
+/* Add the tokens earned since the last call, up to the burst size */
+static void refill(sacd_throttle_t *throttle, uint64_t rate, uint64_t now) {
+    double burst = (double)rate * SACD_THROTTLE_BURST_NS / 1e9;
+
+    if (throttle->last_ns == 0) {
+        throttle->tokens = burst;
+    } else {
+        throttle->tokens += (double)(now - throttle->last_ns) * rate / 1e9;
+        if (throttle->tokens > burst) {
+            throttle->tokens = burst;
+        }
+    }
+    throttle->last_ns = now;
+}
+
+/* Set the bucket's rate (any thread) */
+void sacd_internal_throttle_set_rate(sacd_throttle_t *throttle, uint64_t bytes_per_second) {
+    __atomic_store_n(&throttle->rate, bytes_per_second, __ATOMIC_RELAXED);
+}
+
+/* Take 'bytes' from the bucket, sleeping while it is in debt */
+uint64_t sacd_internal_throttle(sacd_throttle_t *throttle, uint64_t bytes, const bool *cancel) {
+    uint64_t rate = __atomic_load_n(&throttle->rate, __ATOMIC_RELAXED);
+    if (rate == 0) {
+        /* Start with a full bucket if a limit is set later */
+        throttle->last_ns = 0;
+        return 0;
+    }
+
+    uint64_t start = sacd_internal_clock_ns();
+    refill(throttle, rate, start);
+    throttle->tokens -= (double)bytes;
+
+    uint64_t now = start;
+    while (throttle->tokens < 0 && !(cancel && __atomic_load_n(cancel, __ATOMIC_RELAXED))) {
+        /* Sleep in slices so cancellation and rate changes take effect promptly */
+        uint64_t wait = (uint64_t)(-throttle->tokens * 1e9 / rate) + 1;
+        if (wait > SACD_THROTTLE_SLICE_NS) {
+            wait = SACD_THROTTLE_SLICE_NS;
+        }
+        struct timespec ts = { (time_t)(wait / 1000000000ULL), (long)(wait % 1000000000ULL) };
+        nanosleep(&ts, NULL);
+
+        now = sacd_internal_clock_ns();
+        rate = __atomic_load_n(&throttle->rate, __ATOMIC_RELAXED);
+        if (rate == 0) {
+            throttle->last_ns = 0;
+            break;
+        }
+        refill(throttle, rate, now);
+    }
+
+    return now - start;
+}
+
+/* Apply an I/O scheduling class to a thread */
+sacd_result_t sacd_internal_set_io_priority(int tid, sacd_io_priority_t priority, int level) {
+    if (priority == SACD_IO_PRIORITY_DEFAULT) {
+        return SACD_RESULT_OK;
+    }
+
+#if defined(__linux__) && defined(SYS_ioprio_set)
+    int ioprio;
+    if (priority == SACD_IO_PRIORITY_IDLE) {
+        ioprio = IOPRIO_CLASS_IDLE << IOPRIO_CLASS_SHIFT;
+    } else {
+        if (level < 0) {
+            level = 0;
+        } else if (level > 7) {
+            level = 7;
+        }
+        ioprio = (IOPRIO_CLASS_BE << IOPRIO_CLASS_SHIFT) | level;
+    }
+
+    if (syscall(SYS_ioprio_set, IOPRIO_WHO_PROCESS, tid, ioprio) != 0) {
+        SACD_DEBUG_LOG("ioprio_set(%d, %d) failed", tid, ioprio);
+        return SACD_RESULT_ERROR;
+    }
+    return SACD_RESULT_OK;
+#else
+    (void)tid;
+    (void)level;
+    return SACD_RESULT_ERROR;
+#endif
+}
+
+/* Kernel thread id of the caller, for sacd_internal_set_io_priority() */
+int sacd_internal_thread_id(void) {
+#if defined(__linux__) && defined(SYS_gettid)
+    return (int)syscall(SYS_gettid);
+#else
+    return 0;
+#endif
+}
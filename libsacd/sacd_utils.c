@@ -11,6 +11,8 @@
 #include <stdio.h>
 #include <ctype.h>
 #include <math.h>
+#include <time.h>
+#include <sched.h>
 
 /* Convert SACD time to seconds */
 double sacd_time_to_seconds(const sacd_time_t *time) {
@@ -74,6 +76,12 @@ const char *sacd_format_extension(sacd_output_format_t format) {
         case SACD_FORMAT_DSDIFF:
         case SACD_FORMAT_DSDIFF_EM:
             return "dff";
+        case SACD_FORMAT_WAV:
+            return "wav";
+        case SACD_FORMAT_FLAC:
+            return "flac";
+        case SACD_FORMAT_W64:
+            return "w64";
         default:
             return "dsf";
     }
@@ -88,6 +96,12 @@ const char *sacd_format_description(sacd_output_format_t format) {
             return "DSDIFF (DSD Interchange File Format)";
         case SACD_FORMAT_DSDIFF_EM:
             return "DSDIFF Edit Master";
+        case SACD_FORMAT_WAV:
+            return "WAV/RF64 (PCM converted from DSD)";
+        case SACD_FORMAT_W64:
+            return "Wave64 (PCM converted from DSD)";
+        case SACD_FORMAT_FLAC:
+            return "FLAC (PCM converted from DSD)";
         default:
             return "Unknown format";
     }
@@ -106,12 +120,32 @@ void sacd_extraction_options_init(sacd_extraction_options_t *options) {
     options->convert_dst = true;
     options->export_cue_sheet = false;
     options->include_pauses = true;
+    options->area_sweep = true;
     options->trim_whitespace = true;
     options->dsf_nopad = false;
     options->add_id3_tags = false;
     options->id3_version = 3;
     options->add_artist_to_folder = false;
     options->add_performer_to_filename = false;
+    options->resume = false;
+    options->checkpoint_sectors = 4096; /* 8 MB of sectors */
+    options->checksums = SACD_CHECKSUM_XXH3;
+    options->write_checksum_manifest = true;
+    options->measure_levels = false;
+    options->trim_silence = false;
+    options->pcm_sample_rate = 176400;
+    options->pcm_sample_format = SACD_PCM_S24;
+    options->encoder_threads = 0;
+    options->sink_type = SACD_SINK_FILE;
+    options->sink_fd = -1;
+    options->read_bytes_per_sec = 0;
+    options->write_bytes_per_sec = 0;
+    options->io_priority = SACD_IO_PRIORITY_DEFAULT;
+    options->io_priority_level = 4;
+    options->cpu_placement = SACD_CPU_PLACEMENT_AUTO;
+    options->numa_node = -1;
+    options->extraction_cpus = NULL;
+    options->worker_cpus = NULL;
 }
 
 /* Create safe filename from text */
@@ -265,7 +299,77 @@ size_t sacd_estimate_track_file_size(const sacd_track_t *track, sacd_output_form
         case SACD_FORMAT_DSDIFF_EM:
             header_size = 512; /* Estimated DSDIFF header size */
             break;
+        case SACD_FORMAT_WAV:
+        case SACD_FORMAT_W64:
+            /* Assumes the default 176.4 kHz / 24-bit conversion */
+            audio_data_size = sacd_estimate_pcm_data_size(track, 176400, SACD_PCM_S24);
+            header_size = (format == SACD_FORMAT_W64) ? 128 : 104;
+            break;
+        case SACD_FORMAT_FLAC:
+            /* Rough: lossless compression of converted DSD is about 60% */
+            audio_data_size = sacd_estimate_pcm_data_size(track, 176400, SACD_PCM_S24) * 6 / 10;
+            header_size = 8192; /* STREAMINFO + SEEKTABLE */
+            break;
     }
     
     return audio_data_size + header_size;
-}
\ No newline at end of file
+}
+
+/* Calculate PCM payload size of a converted track */
+uint64_t sacd_estimate_pcm_data_size(const sacd_track_t *track, uint32_t sample_rate,
+                                     sacd_pcm_sample_format_t sample_format) {
+    if (!track || sample_rate == 0) {
+        return 0;
+    }
+    
+    uint64_t frames = sacd_track_duration_samples(track) / (SACD_SAMPLING_FREQ / sample_rate);
+    size_t sample_bytes = (sample_format == SACD_PCM_F32) ? 4 : 3;
+    return frames * track->channel_count * sample_bytes;
+}
+
+/* SACD time as a frame count */
+uint32_t sacd_internal_time_to_frames(const sacd_time_t *time) {
+    return ((uint32_t)time->minutes * 60 + time->seconds) * SACD_FRAME_RATE + time->frames;
+}
+
+/* Frame count as SACD time */
+void sacd_internal_frames_to_time(uint32_t frames, sacd_time_t *time) {
+    time->minutes = (uint8_t)(frames / (SACD_FRAME_RATE * 60));
+    time->seconds = (uint8_t)((frames / SACD_FRAME_RATE) % 60);
+    time->frames = (uint8_t)(frames % SACD_FRAME_RATE);
+}
+
+/* Monotonic clock in nanoseconds */
+uint64_t sacd_internal_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* Start an update; readers retry until the matching write_end */
+void sacd_internal_seqlock_write_begin(sacd_seqlock_t *lock) {
+    __atomic_store_n(&lock->sequence, lock->sequence + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+/* Finish an update */
+void sacd_internal_seqlock_write_end(sacd_seqlock_t *lock) {
+    __atomic_store_n(&lock->sequence, lock->sequence + 1, __ATOMIC_RELEASE);
+}
+
+/* Copy a snapshot that no update overlapped */
+void sacd_internal_seqlock_read(const sacd_seqlock_t *lock, void *dest, const void *src, size_t size) {
+    for (;;) {
+        unsigned int before = __atomic_load_n(&lock->sequence, __ATOMIC_ACQUIRE);
+        if (before & 1) {
+            /* The writer may be preempted mid-update; let it finish */
+            sched_yield();
+            continue;
+        }
+        memcpy(dest, src, size);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&lock->sequence, __ATOMIC_RELAXED) == before) {
+            return;
+        }
+    }
+}
@@ -82,6 +82,7 @@ struct tui_pane {
     tui_pane_type_t type;
     const char *title;
     bool active;
+    bool text_input;    /* Keys reach the pane before global bindings */
     
     /* Position and size */
     int x, y;
@@ -129,6 +130,10 @@ struct tui_app {
         void (*handler)(tui_app_t *app);
     } *key_bindings;
     int key_binding_count;
+    
+    /* Periodic callback while waiting for input */
+    int tick_interval_ms;
+    void (*tick)(tui_app_t *app);
 };
 
 /* Core API */
@@ -138,6 +143,7 @@ bool tui_init(tui_app_t *app);
 void tui_cleanup(tui_app_t *app);
 void tui_run(tui_app_t *app);
 void tui_quit(tui_app_t *app);
+void tui_set_tick(tui_app_t *app, int interval_ms, void (*tick)(tui_app_t *app));
 
 /* Theme API */
 tui_theme_t *tui_theme_harlequin(void);
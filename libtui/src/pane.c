@@ -8,6 +8,7 @@ tui_pane_t *tui_create_pane(tui_pane_type_t type) {
     
     pane->type = type;
     pane->active = false;
+    pane->text_input = false;
     pane->title = NULL;
     pane->win = NULL;
     pane->border_win = NULL;
@@ -78,6 +78,9 @@ void tui_run(tui_app_t *app) {
     }
     tui_draw_status(app);
     
+    /* Wake up for the tick even without input */
+    timeout(app->tick ? app->tick_interval_ms : -1);
+    
     /* Main event loop */
     while (app->running) {
         /* Handle resize */
@@ -96,6 +99,12 @@ void tui_run(tui_app_t *app) {
         
         /* Get input */
         int ch = getch();
+        if (ch == ERR) {
+            if (app->tick) {
+                app->tick(app);
+            }
+            continue;
+        }
         
         /* Handle mouse events */
         if (app->mouse_enabled && ch == KEY_MOUSE) {
@@ -131,8 +140,26 @@ void tui_run(tui_app_t *app) {
             }
         }
         
-        /* Handle global key bindings */
+        /* A pane taking text gets first look at keys; what it declines is global */
         bool handled = false;
+        if (app->main_window->active_pane >= 0) {
+            tui_pane_t *active = app->main_window->panes[app->main_window->active_pane];
+            if (active->text_input && active->handle_event) {
+                tui_event_t event = {
+                    .type = TUI_EVENT_KEY,
+                    .data.key = {
+                        .key = ch,
+                        .alt = false,
+                        .ctrl = false
+                    }
+                };
+                if (active->handle_event(active, &event)) {
+                    continue;
+                }
+            }
+        }
+        
+        /* Handle global key bindings */
         for (int i = 0; i < app->key_binding_count; i++) {
             if (app->key_bindings[i].key == ch) {
                 if (app->key_bindings[i].handler) {
@@ -146,7 +173,7 @@ void tui_run(tui_app_t *app) {
         /* Send to active pane if not handled globally */
         if (!handled && app->main_window->active_pane >= 0) {
             tui_pane_t *active = app->main_window->panes[app->main_window->active_pane];
-            if (active->handle_event) {
+            if (active->handle_event && !active->text_input) {
                 tui_event_t event = {
                     .type = TUI_EVENT_KEY,
                     .data.key = {
@@ -167,6 +194,13 @@ void tui_quit(tui_app_t *app) {
     }
 }
 
+void tui_set_tick(tui_app_t *app, int interval_ms, void (*tick)(tui_app_t *app)) {
+    if (app) {
+        app->tick_interval_ms = interval_ms;
+        app->tick = tick;
+    }
+}
+
 void tui_set_status(tui_app_t *app, const char *text) {
     if (app) {
         app->status_text = text;
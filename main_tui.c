@@ -47,6 +47,15 @@ static void extract_handler(tui_app_t *app) {
     }
 }
 
+static void tick_handler(tui_app_t *app) {
+    if (!app || !app->main_window || app->main_window->pane_count < 3) return;
+    
+    /* The browser follows its directory; the extraction pane polls progress
+     * instead of being drawn from the extraction thread */
+    sacd_browser_pane_poll(app->main_window->panes[0]);
+    sacd_extract_pane_poll(app->main_window->panes[2]);
+}
+
 int main(void) {
     /* Create application */
     app = tui_create_app();
@@ -100,6 +109,9 @@ int main(void) {
     /* Set status */
     tui_set_status(app, "SACD Lab - Harlequin Edition");
     
+    /* Refresh the listing and extraction progress ten times a second */
+    tui_set_tick(app, 100, tick_handler);
+    
     /* Run the application */
     tui_run(app);
     
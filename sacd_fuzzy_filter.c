@@ -0,0 +1,220 @@
+/*
+ * Fuzzy type-to-filter for the browser and track lists
+ *
+ * Matching a query implies matching every prefix of it, so the names that
+ * can match after a key is typed are among those that matched before it.
+ * Each query length keeps its own match list; typing scans only the list of
+ * the previous length and backspace returns to it without scanning at all.
+ * Scores are kept with the matches, so only the ordering is redone.
+ */
+
+#include "sacd_fuzzy_filter.h"
+#include <stdlib.h>
+#include <string.h>
+
+/* Scoring: every matched character counts, hits that start words or
+ * continue the previous hit count extra, and skipped characters cost */
+#define SCORE_MATCH        16
+#define BONUS_BOUNDARY     10
+#define BONUS_CONSECUTIVE  12
+#define PENALTY_GAP_MAX    6
+
+static inline char fold(char c) {
+    return (c >= 'A' && c <= 'Z') ? (char)(c + ('a' - 'A')) : c;
+}
+
+/* Whether a name character starts a word */
+static bool is_boundary(const char *name, int i) {
+    if (i == 0) return true;
+
+    char prev = name[i - 1];
+    char cur = name[i];
+    if (prev == ' ' || prev == '-' || prev == '_' || prev == '.' || prev == '/' ||
+        prev == '(' || prev == '[') {
+        return true;
+    }
+    /* "SomeName": the N */
+    return prev >= 'a' && prev <= 'z' && cur >= 'A' && cur <= 'Z';
+}
+
+/*
+ * Score a name against a (folded) query, or -1 if it doesn't match. The
+ * first match found forward fixes where the query can end at the earliest;
+ * matching backward from there finds the tightest start, and the score is
+ * taken over that span.
+ */
+static int fuzzy_score(const char *name, const char *query, int length) {
+    if (length == 0) return 0;
+
+    /* Forward: does it match at all, and where does the first match end */
+    int end = 0;
+    int q = 0;
+    for (; name[end]; end++) {
+        if (fold(name[end]) == query[q] && ++q == length) break;
+    }
+    if (q < length) return -1;
+
+    /* Backward: the latest start that still fits the query before 'end' */
+    int start = end;
+    q = length - 1;
+    for (; start >= 0; start--) {
+        if (fold(name[start]) == query[q] && --q < 0) break;
+    }
+
+    int score = 0;
+    int last = -2;
+    q = 0;
+    for (int i = start; i <= end && q < length; i++) {
+        if (fold(name[i]) != query[q]) continue;
+
+        score += SCORE_MATCH;
+        if (i == last + 1) {
+            score += BONUS_CONSECUTIVE;
+        } else if (last >= 0) {
+            int gap = i - last - 1;
+            score -= gap < PENALTY_GAP_MAX ? gap : PENALTY_GAP_MAX;
+        }
+        if (is_boundary(name, i)) {
+            score += BONUS_BOUNDARY;
+        }
+        last = i;
+        q++;
+    }
+    return score;
+}
+
+/*
+ * Order the current level's matches for display: best score first, equal
+ * scores in list order. Scores are small non-negative numbers, so a counting
+ * sort does it in two passes over the matches.
+ */
+static void rank_matches(fuzzy_filter_t *filter) {
+    int length = filter->query_length;
+    int count = filter->level_counts[length];
+    const int *matches = filter->level_matches[length];
+    const int *scores = filter->level_scores[length];
+
+    filter->ranked_count = 0;
+    if (length == 0 || count == 0) return;
+
+    int max_score = 0;
+    for (int i = 0; i < count; i++) {
+        if (scores[i] > max_score) max_score = scores[i];
+    }
+
+    int *ranked = realloc(filter->ranked, count * sizeof(int));
+    int *starts = calloc(max_score + 2, sizeof(int));
+    if (!ranked || !starts) {
+        free(starts);
+        if (ranked) filter->ranked = ranked;
+        return;
+    }
+    filter->ranked = ranked;
+
+    /* Bucket n holds score max_score - n */
+    for (int i = 0; i < count; i++) {
+        starts[max_score - scores[i] + 1]++;
+    }
+    for (int s = 1; s <= max_score + 1; s++) {
+        starts[s] += starts[s - 1];
+    }
+    for (int i = 0; i < count; i++) {
+        ranked[starts[max_score - scores[i]]++] = matches[i];
+    }
+    filter->ranked_count = count;
+    free(starts);
+}
+
+/* Build the match list for the query's current length from the one before it */
+static void narrow(fuzzy_filter_t *filter) {
+    int length = filter->query_length;
+    int parent_count = length > 1 ? filter->level_counts[length - 1] : filter->name_count;
+    const int *parent = length > 1 ? filter->level_matches[length - 1] : NULL;
+
+    filter->level_counts[length] = 0;
+    size_t size = (parent_count ? parent_count : 1) * sizeof(int);
+    int *matches = realloc(filter->level_matches[length], size);
+    if (matches) filter->level_matches[length] = matches;
+    int *scores = realloc(filter->level_scores[length], size);
+    if (scores) filter->level_scores[length] = scores;
+    if (!matches || !scores) return;
+
+    int count = 0;
+    for (int i = 0; i < parent_count; i++) {
+        int index = parent ? parent[i] : i;
+        int score = fuzzy_score(filter->names[index], filter->query, length);
+        if (score >= 0) {
+            matches[count] = index;
+            scores[count] = score;
+            count++;
+        }
+    }
+    filter->level_counts[length] = count;
+}
+
+void fuzzy_filter_init(fuzzy_filter_t *filter) {
+    memset(filter, 0, sizeof(fuzzy_filter_t));
+}
+
+void fuzzy_filter_free(fuzzy_filter_t *filter) {
+    for (int i = 0; i <= FUZZY_FILTER_MAX_QUERY; i++) {
+        free(filter->level_matches[i]);
+        free(filter->level_scores[i]);
+    }
+    free(filter->ranked);
+    fuzzy_filter_init(filter);
+}
+
+void fuzzy_filter_set_names(fuzzy_filter_t *filter, const char *const *names, int count) {
+    filter->names = names;
+    filter->name_count = count;
+
+    /* Every level depends on the names: rebuild them all */
+    int length = filter->query_length;
+    for (filter->query_length = 1; filter->query_length <= length; filter->query_length++) {
+        narrow(filter);
+    }
+    filter->query_length = length;
+    rank_matches(filter);
+}
+
+bool fuzzy_filter_push(fuzzy_filter_t *filter, char c) {
+    if (filter->query_length >= FUZZY_FILTER_MAX_QUERY || c == '\0') return false;
+
+    filter->query[filter->query_length++] = fold(c);
+    filter->query[filter->query_length] = '\0';
+    narrow(filter);
+    rank_matches(filter);
+    return true;
+}
+
+bool fuzzy_filter_pop(fuzzy_filter_t *filter) {
+    if (filter->query_length == 0) return false;
+
+    filter->query[--filter->query_length] = '\0';
+    rank_matches(filter);
+    return true;
+}
+
+void fuzzy_filter_clear(fuzzy_filter_t *filter) {
+    filter->query_length = 0;
+    filter->query[0] = '\0';
+    filter->ranked_count = 0;
+}
+
+int fuzzy_filter_count(const fuzzy_filter_t *filter) {
+    return filter->query_length > 0 ? filter->ranked_count : filter->name_count;
+}
+
+int fuzzy_filter_get(const fuzzy_filter_t *filter, int rank) {
+    if (rank < 0 || rank >= fuzzy_filter_count(filter)) return -1;
+    return filter->query_length > 0 ? filter->ranked[rank] : rank;
+}
+
+int fuzzy_filter_rank_of(const fuzzy_filter_t *filter, int index) {
+    int count = fuzzy_filter_count(filter);
+    for (int rank = 0; rank < count; rank++) {
+        if (fuzzy_filter_get(filter, rank) == index) return rank;
+    }
+    return -1;
+}
@@ -0,0 +1,59 @@
+#ifndef SACD_FUZZY_FILTER_H
+#define SACD_FUZZY_FILTER_H
+
+#include <stdbool.h>
+
+/* Longest query the filter takes */
+#define FUZZY_FILTER_MAX_QUERY 64
+
+/*
+ * Type-to-filter over a list of names. A name matches when the query's
+ * characters appear in it in order (case-insensitively); matches are ranked
+ * by how tightly and where they hit. Each typed character narrows the
+ * previous result set instead of rescanning the list, and the result set
+ * of every shorter query is kept so backspace costs no rescan either.
+ */
+typedef struct {
+    char query[FUZZY_FILTER_MAX_QUERY + 1];
+    int query_length;
+
+    const char *const *names;         /* Candidates, owned by the caller */
+    int name_count;
+
+    /* Matches of the first n query characters, in candidate order, with their scores */
+    int *level_matches[FUZZY_FILTER_MAX_QUERY + 1];
+    int *level_scores[FUZZY_FILTER_MAX_QUERY + 1];
+    int level_counts[FUZZY_FILTER_MAX_QUERY + 1];
+
+    int *ranked;                      /* Matches of the whole query, best first */
+    int ranked_count;
+} fuzzy_filter_t;
+
+/* Set up an empty filter */
+void fuzzy_filter_init(fuzzy_filter_t *filter);
+
+/* Release the filter's result sets */
+void fuzzy_filter_free(fuzzy_filter_t *filter);
+
+/* Filter a new list of names with the current query */
+void fuzzy_filter_set_names(fuzzy_filter_t *filter, const char *const *names, int count);
+
+/* Add a character to the query; false if the query is full */
+bool fuzzy_filter_push(fuzzy_filter_t *filter, char c);
+
+/* Remove the last character of the query; false if it was empty */
+bool fuzzy_filter_pop(fuzzy_filter_t *filter);
+
+/* Empty the query */
+void fuzzy_filter_clear(fuzzy_filter_t *filter);
+
+/* Number of names matching the query (all of them for an empty query) */
+int fuzzy_filter_count(const fuzzy_filter_t *filter);
+
+/* Candidate index of the rank'th best match */
+int fuzzy_filter_get(const fuzzy_filter_t *filter, int rank);
+
+/* Rank of a candidate among the matches, or -1 if it doesn't match */
+int fuzzy_filter_rank_of(const fuzzy_filter_t *filter, int index);
+
+#endif /* SACD_FUZZY_FILTER_H */
@@ -8,27 +8,24 @@
 #include <unistd.h>
 #include <limits.h>
 #include <dirent.h>
-#include <errno.h>
 #include <strings.h>
 #include <ctype.h>
 #include <time.h>
 #include <math.h>
 #include <stdbool.h>
+#include <sys/inotify.h>
+#include <fcntl.h>
 
 /* Include the header for all type definitions */
 #include "sacd_tui_adapter.h"
 
-/* Helper functions to replace old API calls */
-static bool libsacd_is_valid_iso(const char *path) {
-    sacd_disc_t *disc = NULL;
-    sacd_result_t result = sacd_disc_open(path, &disc);
-    if (result == SACD_RESULT_OK) {
-        sacd_disc_close(disc);
-        return true;
-    }
-    return false;
-}
+/* Allocation unit of the browser's name blocks */
+#define NAME_BLOCK_SIZE (64 * 1024)
+
+/* Changes that alter the browser listing */
+#define BROWSER_WATCH_EVENTS (IN_CREATE | IN_DELETE | IN_MOVED_FROM | IN_MOVED_TO | IN_CLOSE_WRITE | IN_ONLYDIR)
 
+/* Helper functions to replace old API calls */
 static void libsacd_format_duration(double seconds, char *buffer, size_t size) {
     int mins = (int)(seconds / 60);
     int secs = (int)(seconds) % 60;
@@ -47,8 +44,9 @@ static void libsacd_format_filesize(size_t bytes, char *buffer, size_t size) {
     }
 }
 
-static void libsacd_read_iso_info(const char *iso_path, sacd_iso_info_t *info) {
-    if (!info) return;
+/* Read an ISO's metadata; the open disc is returned, as the info's areas point into it */
+static sacd_disc_t *libsacd_read_iso_info(const char *iso_path, sacd_iso_info_t *info) {
+    if (!info) return NULL;
     
     /* Clear the structure */
     memset(info, 0, sizeof(sacd_iso_info_t));
@@ -61,7 +59,7 @@ static void libsacd_read_iso_info(const char *iso_path, sacd_iso_info_t *info) {
         strcpy(info->title, "Invalid SACD");
         strcpy(info->artist, "Unknown");
         strcpy(info->year, "0000");
-        return;
+        return NULL;
     }
     
     /* Extract metadata from disc */
@@ -93,8 +91,7 @@ static void libsacd_read_iso_info(const char *iso_path, sacd_iso_info_t *info) {
         info->file_size = st.st_size;
     }
     
-    /* Don't close disc here - store it for later use */
-    /* sacd_disc_close(disc); */
+    return disc;
 }
 
 /* Track selection helper functions */
@@ -116,6 +113,7 @@ void init_track_selection(sacd_iso_info_t *sacd_info) {
                 sacd_info->track_selected[i] = true;
             }
         }
+        sacd_info->track_levels = calloc(primary_area->track_count, sizeof(sacd_level_report_t));
         sacd_info->track_selection_cursor = 0;
         sacd_info->track_selection_mode = false;
     }
@@ -128,8 +126,15 @@ void cleanup_track_selection(sacd_iso_info_t *sacd_info) {
         free(sacd_info->track_selected);
         sacd_info->track_selected = NULL;
     }
+    free(sacd_info->track_levels);
+    sacd_info->track_levels = NULL;
     sacd_info->track_selection_cursor = 0;
     sacd_info->track_selection_mode = false;
+    
+    fuzzy_filter_free(&sacd_info->track_filter);
+    free(sacd_info->track_titles);
+    sacd_info->track_titles = NULL;
+    sacd_info->track_filtering = false;
 }
 
 void toggle_track_selection(sacd_iso_info_t *sacd_info, int track_index) {
@@ -207,12 +212,23 @@ static bool handle_sacd_browser_event(tui_pane_t *pane, const tui_event_t *event
 static void draw_sacd_info(tui_pane_t *pane);
 static bool handle_sacd_info_event(tui_pane_t *pane, const tui_event_t *event);
 static void draw_sacd_extract(tui_pane_t *pane);
+static bool handle_sacd_extract_event(tui_pane_t *pane, const tui_event_t *event);
 static int load_directory(sacd_browser_data_t *data, const char *path);
 static void free_file_list(sacd_browser_data_t *data);
 static int file_entry_compare(const void *a, const void *b);
 static bool is_audio_video_file(const char *filename);
+static const char *store_name(sacd_browser_data_t *data, const char *name);
+static file_entry_t *create_file_entry(sacd_browser_data_t *data, const char *name, unsigned char d_type);
+static void stat_file_entry(sacd_browser_data_t *data, file_entry_t *entry);
+static void probe_visible_entries(sacd_browser_data_t *data, int row, int rows);
+static void file_entry_path(const sacd_browser_data_t *data, const file_entry_t *entry, char *buffer, size_t size);
+static bool apply_directory_events(sacd_browser_data_t *data);
+static void update_browser_filter(sacd_browser_data_t *data);
+static file_entry_t *browser_entry_at(sacd_browser_data_t *data, int row);
+static int browser_row_count(sacd_browser_data_t *data);
+static bool handle_browser_filter_key(tui_pane_t *pane, sacd_browser_data_t *data, int key);
+static bool handle_track_filter_key(tui_pane_t *pane, sacd_iso_info_t *sacd_info, const sacd_area_t *area, int key);
 static void start_extraction(sacd_extract_data_t *extract_data, sacd_iso_info_t *iso_info, const char *iso_path);
-static void tui_progress_callback(int track_number, int total_tracks, int track_progress_percent, int overall_progress_percent, const char *status_message, void *userdata);
 /* Removed old callback function */
 
 tui_pane_t *create_sacd_browser_pane(void) {
@@ -224,6 +240,11 @@ tui_pane_t *create_sacd_browser_pane(void) {
     /* Initialize SACD browser data */
     sacd_browser_data_t *data = calloc(1, sizeof(sacd_browser_data_t));
     if (data) {
+        /* Watch the listed directory so new rips show up without re-entering it */
+        data->watch_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        data->watch_wd = -1;
+        data->dir_fd = -1;
+        
         /* Load test-isos directory for testing, fallback to current directory */
         char cwd[PATH_MAX];
         if (load_directory(data, "./test-isos") == 0) {
@@ -283,6 +304,7 @@ tui_pane_t *create_sacd_extract_pane(void) {
     
     pane->user_data = extract_data;
     pane->draw = draw_sacd_extract;
+    pane->handle_event = handle_sacd_extract_event;
     
     /* Store pane reference for progress updates */
     if (extract_data) {
@@ -301,32 +323,33 @@ static void draw_sacd_browser(tui_pane_t *pane) {
     int h, w;
     getmaxyx(pane->win, h, w);
     
-    /* Draw current directory path */
+    /* Draw current directory path, or the filter being typed */
     wattron(pane->win, COLOR_PAIR(TUI_COLOR_STATUS));
-    mvwprintw(pane->win, 0, 1, " %s [%d files] ", 
-              data->current_dir ? data->current_dir : "(no dir)", 
-              data->file_count);
+    if (data->filtering) {
+        mvwprintw(pane->win, 0, 1, " /%s_ [%d of %d] ", data->filter.query,
+                  fuzzy_filter_count(&data->filter), data->filter.name_count);
+    } else {
+        mvwprintw(pane->win, 0, 1, " %s [%d files] ", 
+                  data->current_dir ? data->current_dir : "(no dir)", 
+                  data->file_count);
+    }
     wattroff(pane->win, COLOR_PAIR(TUI_COLOR_STATUS));
     
-    /* Draw files */
-    file_entry_t *entry = data->files;
+    /* Draw files: the listing, or the filter's matches best first */
     int line = 1;
-    int skip = data->scroll_offset;
+    int row = data->scroll_offset;
+    file_entry_t *entry = browser_entry_at(data, row);
     
     /* If no files, show a message */
-    if (!entry) {
-        mvwprintw(pane->win, 2, 1, "Empty directory");
-    }
-    
-    /* Skip to visible start */
-    while (entry && skip > 0) {
-        entry = entry->next;
-        skip--;
+    if (!entry && row == 0) {
+        mvwprintw(pane->win, 2, 1, data->filtering ? "No matches" : "Empty directory");
     }
     
-    /* Draw visible entries */
+    /* Draw visible entries; only these are ever stat'ed and probed */
+    probe_visible_entries(data, row, h - 2);
     while (entry && line < h - 1) {
         bool selected = (entry == data->selected);
+        stat_file_entry(data, entry);
         
         if (selected) {
             wattron(pane->win, COLOR_PAIR(TUI_COLOR_HIGHLIGHT) | A_BOLD);
@@ -342,6 +365,17 @@ static void draw_sacd_browser(tui_pane_t *pane) {
         } else if (entry->is_sacd) {
             icon = "[S]";
             color = TUI_COLOR_BUTTON;
+        } else if (entry->type == SACD_FILE_DSF || entry->type == SACD_FILE_DSDIFF) {
+            icon = "[D]";
+        } else if (entry->type == SACD_FILE_FLAC) {
+            icon = "[F]";
+        } else if (entry->type == SACD_FILE_WAV || entry->type == SACD_FILE_RF64 ||
+                   entry->type == SACD_FILE_W64) {
+            icon = "[W]";
+        } else if (entry->type == SACD_FILE_AIFF) {
+            icon = "[A]";
+        } else if (entry->type == SACD_FILE_ISO9660) {
+            icon = "[I]";
         } else {
             icon = "[ ]";
             color = TUI_COLOR_INACTIVE;
@@ -367,7 +401,8 @@ static void draw_sacd_browser(tui_pane_t *pane) {
             wattroff(pane->win, COLOR_PAIR(color));
         }
         
-        entry = entry->next;
+        row++;
+        entry = data->filtering ? browser_entry_at(data, row) : entry->next;
         line++;
     }
 }
@@ -379,7 +414,19 @@ static bool handle_sacd_browser_event(tui_pane_t *pane, const tui_event_t *event
     if (!data) return false;
     
     if (event->type == TUI_EVENT_KEY) {
+        if (data->filtering && handle_browser_filter_key(pane, data, event->data.key.key)) {
+            return true;
+        }
+        
         switch (event->data.key.key) {
+            case '/':  /* Type to filter the listing */
+                data->filtering = true;
+                pane->text_input = true;
+                data->scroll_offset = 0;
+                update_browser_filter(data);
+                tui_pane_draw(pane);
+                return true;
+                
             case KEY_UP:
             case 'k':
                 if (data->selected && data->selected->prev) {
@@ -432,6 +479,7 @@ static bool handle_sacd_browser_event(tui_pane_t *pane, const tui_event_t *event
             case '\r':
             case '\n':
                 if (data->selected) {
+                    stat_file_entry(data, data->selected);
                     if (data->selected->is_directory) {
                         /* Change directory */
                         if (strcmp(data->selected->name, "..") == 0) {
@@ -450,21 +498,10 @@ static bool handle_sacd_browser_event(tui_pane_t *pane, const tui_event_t *event
                             }
                         } else {
                             /* Enter subdirectory */
-                            FILE *debug = fopen("/tmp/sacd_debug.log", "a");
-                            if (debug) {
-                                fprintf(debug, "=== ENTERING SUBDIRECTORY ===\n");
-                                fprintf(debug, "Selected path: '%s'\n", data->selected->path);
-                                fprintf(debug, "Selected name: '%s'\n", data->selected->name);
-                                fprintf(debug, "Is directory: %s\n", data->selected->is_directory ? "yes" : "no");
-                                fclose(debug);
-                            }
-                            /* Make a copy of the path to prevent memory corruption */
-                            char *path_copy = malloc(strlen(data->selected->path) + 1);
-                            if (path_copy) {
-                                strcpy(path_copy, data->selected->path);
-                                load_directory(data, path_copy);
-                                free(path_copy);
-                            }
+                            char path[PATH_MAX];
+                            file_entry_path(data, data->selected, path, sizeof(path));
+                            /* The path is a copy: loading frees the entry's name */
+                            load_directory(data, path);
                         }
                         tui_pane_draw(pane);
                         return true;
@@ -474,9 +511,16 @@ static bool handle_sacd_browser_event(tui_pane_t *pane, const tui_event_t *event
                             cleanup_track_selection(data->current_sacd);
                             free(data->current_sacd);
                         }
+                        if (data->current_disc) {
+                            sacd_disc_close(data->current_disc);
+                            data->current_disc = NULL;
+                        }
                         data->current_sacd = calloc(1, sizeof(sacd_iso_info_t));
                         if (data->current_sacd) {
-                            libsacd_read_iso_info(data->selected->path, data->current_sacd);
+                            char path[PATH_MAX];
+                            file_entry_path(data, data->selected, path, sizeof(path));
+                            /* Kept open for the level scan ('L') */
+                            data->current_disc = libsacd_read_iso_info(path, data->current_sacd);
                             
                             /* Initialize track selection */
                             init_track_selection(data->current_sacd);
@@ -497,25 +541,10 @@ static bool handle_sacd_browser_event(tui_pane_t *pane, const tui_event_t *event
                 
             case KEY_F(5):
                 /* Start extraction of current SACD */
-                {
-                    FILE *debug = fopen("/tmp/f5_debug.log", "w");
-                    if (debug) {
-                        fprintf(debug, "F5 pressed!\n");
-                        fprintf(debug, "current_sacd: %p\n", (void*)data->current_sacd);
-                        if (data->current_sacd) {
-                            fprintf(debug, "current_sacd->has_metadata: %s\n", data->current_sacd->has_metadata ? "true" : "false");
-                            fprintf(debug, "current_sacd->title: %s\n", data->current_sacd->title);
-                        }
-                        fprintf(debug, "selected: %p\n", (void*)data->selected);
-                        if (data->selected) {
-                            fprintf(debug, "selected->path: %s\n", data->selected->path);
-                            fprintf(debug, "selected->is_sacd: %s\n", data->selected->is_sacd ? "true" : "false");
-                        }
-                        fclose(debug);
-                    }
-                }
-                
-                if (data->current_sacd && data->current_sacd->has_metadata) {
+                if (data->current_sacd && data->current_sacd->has_metadata && data->selected) {
+                    char path[PATH_MAX];
+                    file_entry_path(data, data->selected, path, sizeof(path));
+                    
                     /* Find the extract pane in the window and start extraction */
                     if (pane->window) {
                         for (int i = 0; i < pane->window->pane_count; i++) {
@@ -524,7 +553,7 @@ static bool handle_sacd_browser_event(tui_pane_t *pane, const tui_event_t *event
                                 sacd_extract_data_t *extract_data = (sacd_extract_data_t*)check_pane->user_data;
                                 /* Check if this is the extract pane by checking if it has extraction data */
                                 if (extract_data && !extract_data->extraction_active) {
-                                    start_extraction(extract_data, data->current_sacd, data->selected->path);
+                                    start_extraction(extract_data, data->current_sacd, path);
                                     break;
                                 }
                             }
@@ -541,12 +570,7 @@ static bool handle_sacd_browser_event(tui_pane_t *pane, const tui_event_t *event
             int clicked_line = event->data.mouse.y - 1 + data->scroll_offset;
             
             /* Find the clicked entry */
-            file_entry_t *entry = data->files;
-            int count = 0;
-            while (entry && count < clicked_line) {
-                entry = entry->next;
-                count++;
-            }
+            file_entry_t *entry = browser_entry_at(data, clicked_line);
             
             if (entry) {
                 data->selected = entry;
@@ -565,6 +589,7 @@ static bool handle_sacd_info_event(tui_pane_t *pane, const tui_event_t *event) {
     if (event->type == TUI_EVENT_KEY) {
         /* Find the current SACD from the browser pane */
         sacd_iso_info_t *current_sacd = NULL;
+        sacd_disc_t *current_disc = NULL;
         if (pane->window) {
             for (int i = 0; i < pane->window->pane_count; i++) {
                 tui_pane_t *other_pane = pane->window->panes[i];
@@ -572,6 +597,7 @@ static bool handle_sacd_info_event(tui_pane_t *pane, const tui_event_t *event) {
                     sacd_browser_data_t *browser_data = (sacd_browser_data_t *)other_pane->user_data;
                     if (browser_data && browser_data->current_sacd) {
                         current_sacd = browser_data->current_sacd;
+                        current_disc = browser_data->current_disc;
                         break;
                     }
                 }
@@ -587,7 +613,30 @@ static bool handle_sacd_info_event(tui_pane_t *pane, const tui_event_t *event) {
         
         if (!primary_area) return false;
         
+        /* Keys go to the filter first while it is being typed */
+        pane->text_input = current_sacd->track_filtering;
+        if (current_sacd->track_filtering &&
+            handle_track_filter_key(pane, current_sacd, primary_area, event->data.key.key)) {
+            return true;
+        }
+        
         switch (event->data.key.key) {
+            case '/':  /* Type to filter the tracks by title */
+                free(current_sacd->track_titles);
+                current_sacd->track_titles = malloc(primary_area->track_count * sizeof(char *));
+                if (!current_sacd->track_titles) return false;
+                for (int i = 0; i < primary_area->track_count; i++) {
+                    const char *title = primary_area->tracks[i].text.title;
+                    current_sacd->track_titles[i] = title ? title : "Unknown Track";
+                }
+                fuzzy_filter_clear(&current_sacd->track_filter);
+                fuzzy_filter_set_names(&current_sacd->track_filter, current_sacd->track_titles,
+                                       primary_area->track_count);
+                current_sacd->track_filtering = true;
+                pane->text_input = true;
+                tui_pane_draw(pane);
+                return true;
+                
             case KEY_UP:
             case 'k':
                 if (current_sacd->track_selection_cursor > 0) {
@@ -626,6 +675,16 @@ static bool handle_sacd_info_event(tui_pane_t *pane, const tui_event_t *event) {
                 tui_pane_draw(pane);
                 return true;
                 
+            case 'l':  /* L - scan the current track's levels */
+            case 'L':
+                if (current_disc && current_sacd->track_levels) {
+                    int cursor = current_sacd->track_selection_cursor;
+                    sacd_disc_scan_levels(current_disc, primary_area, cursor, &current_sacd->track_levels[cursor]);
+                    tui_pane_draw(pane);
+                    return true;
+                }
+                break;
+                
             case KEY_ENTER:
             case '\r':
             case '\n':
@@ -639,6 +698,81 @@ static bool handle_sacd_info_event(tui_pane_t *pane, const tui_event_t *event) {
     return false;
 }
 
+/* Bandwidth limits cycled with 'b' (MB/s, 0 = unlimited) */
+static const int bandwidth_steps[] = { 0, 100, 50, 20, 10 };
+#define BANDWIDTH_STEP_COUNT (int)(sizeof(bandwidth_steps) / sizeof(bandwidth_steps[0]))
+
+static bool handle_sacd_extract_event(tui_pane_t *pane, const tui_event_t *event) {
+    if (!pane || !event || event->type != TUI_EVENT_KEY) return false;
+    
+    sacd_extract_data_t *extract_data = (sacd_extract_data_t*)pane->user_data;
+    if (!extract_data) return false;
+    
+    switch (event->data.key.key) {
+        case 'b':  /* B - cycle the I/O bandwidth limit */
+        case 'B':
+            extract_data->bandwidth_step = (extract_data->bandwidth_step + 1) % BANDWIDTH_STEP_COUNT;
+            break;
+            
+        case 'i':  /* I - toggle idle I/O priority */
+        case 'I':
+            extract_data->idle_io = !extract_data->idle_io;
+            break;
+            
+        default:
+            return false;
+    }
+    
+    /* Limits apply to a running extraction straight away */
+    if (extract_data->extraction_active && extract_data->libsacd_extractor) {
+        uint64_t limit = (uint64_t)bandwidth_steps[extract_data->bandwidth_step] * 1000000;
+        sacd_extractor_set_bandwidth(extract_data->libsacd_extractor, limit, limit);
+        sacd_extractor_set_io_priority(extract_data->libsacd_extractor,
+                                       extract_data->idle_io ? SACD_IO_PRIORITY_IDLE :
+                                       SACD_IO_PRIORITY_BEST_EFFORT, 4);
+    }
+    
+    tui_pane_draw(pane);
+    return true;
+}
+
+/* Draw a track's level overview as a sparkline, followed by its overload count */
+static void draw_level_overview(tui_pane_t *pane, int y, int x, int width, const sacd_level_report_t *levels) {
+    static const char *blocks[] = { "▁", "▂", "▃", "▄", "▅", "▆", "▇", "█" };
+    
+    if (!levels->valid || width < 8) return;
+    
+    char overloads[24] = "";
+    if (levels->overload_windows > 0) {
+        snprintf(overloads, sizeof(overloads), " !%llu", (unsigned long long)levels->overload_windows);
+    }
+    int columns = width - (int)strlen(overloads);
+    if (columns > SACD_LEVEL_BUCKETS) columns = SACD_LEVEL_BUCKETS;
+    if (columns < 1) return;
+    
+    /* Each column shows the peak of the buckets it covers; 50% modulation is full scale */
+    wmove(pane->win, y, x);
+    for (int c = 0; c < columns; c++) {
+        int first = c * SACD_LEVEL_BUCKETS / columns;
+        int last = (c + 1) * SACD_LEVEL_BUCKETS / columns;
+        int peak = 0;
+        for (int b = first; b < last; b++) {
+            if (levels->overview[b] > peak) peak = levels->overview[b];
+        }
+        int level = peak * 8 / 51;
+        if (level > 7) level = 7;
+        if (peak > 50) wattron(pane->win, COLOR_PAIR(TUI_COLOR_ERROR));
+        waddstr(pane->win, blocks[level]);
+        if (peak > 50) wattroff(pane->win, COLOR_PAIR(TUI_COLOR_ERROR));
+    }
+    
+    if (overloads[0]) {
+        wattron(pane->win, COLOR_PAIR(TUI_COLOR_ERROR));
+        waddstr(pane->win, overloads);
+        wattroff(pane->win, COLOR_PAIR(TUI_COLOR_ERROR));
+    }
+}
+
 static void draw_sacd_info(tui_pane_t *pane) {
     if (!pane || !pane->win) return;
     
@@ -719,19 +853,29 @@ static void draw_sacd_info(tui_pane_t *pane) {
                                          current_sacd->stereo_area : current_sacd->mulch_area;
         
         if (primary_area && current_sacd->track_selected) {
-            /* Track selection header */
-            mvwprintw(pane->win, y++, 1, "Track Selection (Space=toggle, A=all, N=none):");
+            /* Track selection header, or the filter being typed */
+            if (current_sacd->track_filtering) {
+                mvwprintw(pane->win, y++, 1, "Filter: /%s_ [%d of %d] (Enter=done, Esc=clear)",
+                          current_sacd->track_filter.query, fuzzy_filter_count(&current_sacd->track_filter),
+                          primary_area->track_count);
+            } else {
+                mvwprintw(pane->win, y++, 1, "Track Selection (Space=toggle, A=all, N=none, L=levels, /=filter):");
+            }
             y++; /* Add spacing */
             
             /* Calculate display parameters */
-            int h, w __attribute__((unused));
+            int h, w;
             getmaxyx(pane->win, h, w);
             int max_tracks_display = h - y - 6; /* Leave room for summary and controls */
-            int tracks_to_show = (primary_area->track_count < max_tracks_display) ? 
-                                primary_area->track_count : max_tracks_display;
+            int track_rows = current_sacd->track_filtering ?
+                             fuzzy_filter_count(&current_sacd->track_filter) : primary_area->track_count;
+            int tracks_to_show = (track_rows < max_tracks_display) ? 
+                                track_rows : max_tracks_display;
             
-            /* Draw track list with checkmarks */
-            for (int i = 0; i < tracks_to_show; i++) {
+            /* Draw track list with checkmarks; a filter shows its matches best first */
+            for (int row = 0; row < tracks_to_show; row++) {
+                int i = current_sacd->track_filtering ?
+                        fuzzy_filter_get(&current_sacd->track_filter, row) : row;
                 const sacd_track_t *track = &primary_area->tracks[i];
                 char duration_str[16];
                 double track_seconds = sacd_time_to_seconds(&track->duration);
@@ -760,12 +904,16 @@ static void draw_sacd_info(tui_pane_t *pane) {
                     wattroff(pane->win, A_REVERSE);
                 }
                 
+                if (current_sacd->track_levels) {
+                    draw_level_overview(pane, y, 58, w - 59, &current_sacd->track_levels[i]);
+                }
+                
                 y++;
             }
             
-            if (primary_area->track_count > tracks_to_show) {
+            if (track_rows > tracks_to_show) {
                 mvwprintw(pane->win, y++, 1, "... and %d more tracks", 
-                         primary_area->track_count - tracks_to_show);
+                         track_rows - tracks_to_show);
             }
             
             y++; /* Add spacing */
@@ -844,10 +992,11 @@ static void draw_sacd_extract(tui_pane_t *pane) {
             }
         }
         
-        /* Time and speed statistics */
-        if (extract_data->start_time > 0) {
-            time_t current_time = time(NULL);
-            int elapsed = (int)(current_time - extract_data->start_time);
+        /* Time and speed statistics from the extractor's counters */
+        sacd_extractor_stats_t stats;
+        if (sacd_extractor_get_stats(extract_data->libsacd_extractor, &stats) == SACD_RESULT_OK &&
+            stats.elapsed_ns > 0) {
+            int elapsed = (int)(stats.elapsed_ns / 1000000000ULL);
             int eta = 0;
             
             if (extract_data->percent_complete > 5) {
@@ -856,12 +1005,33 @@ static void draw_sacd_extract(tui_pane_t *pane) {
             
             mvwprintw(pane->win, y++, 1, "Elapsed: %02d:%02d  ETA: %02d:%02d", 
                     elapsed / 60, elapsed % 60, eta / 60, eta % 60);
+            
+            double seconds = stats.elapsed_ns / 1e9;
+            extract_data->extraction_speed = stats.bytes_read / 1e6 / seconds;
+            mvwprintw(pane->win, y++, 1, "Speed: %.1f MB/s read, %.1f MB/s written",
+                    extract_data->extraction_speed, stats.bytes_written / 1e6 / seconds);
+            
+            /* Where the time goes: disc, decoding or output */
+            uint64_t busy = stats.read_ns + stats.decode_ns + stats.write_ns;
+            if (busy > 0) {
+                mvwprintw(pane->win, y++, 1, "Time: read %d%%  decode %d%%  write %d%%",
+                        (int)(stats.read_ns * 100 / busy), (int)(stats.decode_ns * 100 / busy),
+                        (int)(stats.write_ns * 100 / busy));
+            }
         }
         
         /* Extraction statistics */
         mvwprintw(pane->win, y++, 1, "Format: %s", 
                 sacd_format_description(extract_data->selected_format));
         mvwprintw(pane->win, y++, 1, "Output: %s", extract_data->output_dir);
+        if (bandwidth_steps[extract_data->bandwidth_step] > 0) {
+            mvwprintw(pane->win, y++, 1, "I/O: %d MB/s limit, %s priority",
+                    bandwidth_steps[extract_data->bandwidth_step],
+                    extract_data->idle_io ? "idle" : "normal");
+        } else {
+            mvwprintw(pane->win, y++, 1, "I/O: unlimited, %s priority",
+                    extract_data->idle_io ? "idle" : "normal");
+        }
         
         y++; /* blank line */
         
@@ -896,29 +1066,25 @@ static void draw_sacd_extract(tui_pane_t *pane) {
         wattron(pane->win, COLOR_PAIR(1)); /* Red for cancel */
         mvwaddstr(pane->win, y++, 1, "ESC - Cancel extraction");
         wattroff(pane->win, COLOR_PAIR(1));
+        mvwaddstr(pane->win, y++, 1, "B - Bandwidth limit  I - Idle I/O priority");
     }
 }
 
 static int load_directory(sacd_browser_data_t *data, const char *path) {
-    FILE *debug_f = fopen("/tmp/sacd_debug.log", "a");
-    if (debug_f) {
-        fprintf(debug_f, "=== LOAD_DIRECTORY START ===\n");
-        fprintf(debug_f, "Trying to load path: '%s'\n", path ? path : "(null)");
-        fprintf(debug_f, "Data pointer: %p\n", (void*)data);
-        fclose(debug_f);
-    }
-    
     if (!data || !path) {
-        FILE *debug_f2 = fopen("/tmp/sacd_debug.log", "a");
-        if (debug_f2) {
-            fprintf(debug_f2, "ERROR: data=%p, path=%p - returning -1\n", (void*)data, (void*)path);
-            fclose(debug_f2);
-        }
         return -1;
     }
     
-    /* Free existing file list */
+    /* Free existing file list and stop following the old directory */
     free_file_list(data);
+    if (data->watch_fd >= 0 && data->watch_wd >= 0) {
+        inotify_rm_watch(data->watch_fd, data->watch_wd);
+        data->watch_wd = -1;
+    }
+    if (data->dir_fd >= 0) {
+        close(data->dir_fd);
+        data->dir_fd = -1;
+    }
     
     /* Update current directory - manual copy instead of strdup */
     if (data->current_dir) {
@@ -934,26 +1100,23 @@ static int load_directory(sacd_browser_data_t *data, const char *path) {
         return -1;
     }
     
-    DIR *dir = opendir(path);
+    /* Entries are looked up relative to the directory, not by full path */
+    data->dir_fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    int list_fd = data->dir_fd >= 0 ? dup(data->dir_fd) : -1;
+    DIR *dir = list_fd >= 0 ? fdopendir(list_fd) : NULL;
     if (!dir) {
-        /* If opendir fails, restore the directory state */
-        FILE *debug_f3 = fopen("/tmp/sacd_debug.log", "a");
-        if (debug_f3) {
-            fprintf(debug_f3, "ERROR: opendir('%s') failed: %s\n", path, strerror(errno));
-            fclose(debug_f3);
+        if (list_fd >= 0) close(list_fd);
+        if (data->dir_fd >= 0) {
+            close(data->dir_fd);
+            data->dir_fd = -1;
         }
+        /* If opendir fails, restore the directory state */
         free(data->current_dir);
         data->current_dir = malloc(2);
         strcpy(data->current_dir, ".");
         return -1;
     }
     
-    FILE *debug_f4 = fopen("/tmp/sacd_debug.log", "a");
-    if (debug_f4) {
-        fprintf(debug_f4, "SUCCESS: opendir('%s') succeeded\n", path);
-        fclose(debug_f4);
-    }
-    
     file_entry_t *head = NULL;
     file_entry_t *tail = NULL;
     int count = 0;
@@ -962,65 +1125,39 @@ static int load_directory(sacd_browser_data_t *data, const char *path) {
     if (strcmp(path, "/") != 0) {
         file_entry_t *parent = calloc(1, sizeof(file_entry_t));
         if (parent) {
-            parent->name = malloc(3);
-            strcpy(parent->name, "..");
-            parent->path = malloc(1);
-            strcpy(parent->path, ""); /* Will be handled specially */
+            parent->name = store_name(data, ".."); /* Will be handled specially */
             parent->is_directory = true;
             parent->is_sacd = false;
+            parent->stat_done = true;
             
-            head = tail = parent;
-            count++;
+            if (parent->name) {
+                head = tail = parent;
+                count++;
+            } else {
+                free(parent);
+            }
         }
     }
     
-    /* Read directory entries */
+    /* Read directory entries; d_type tells directories apart without a stat */
     struct dirent *de;
     while ((de = readdir(dir)) != NULL) {
         if (strcmp(de->d_name, ".") == 0 || strcmp(de->d_name, "..") == 0) {
             continue;
         }
         
-        char full_path[4096];
-        snprintf(full_path, sizeof(full_path), "%s/%s", 
-                 strcmp(path, "/") == 0 ? "" : path, de->d_name);
-        
-        struct stat st;
-        if (stat(full_path, &st) != 0) continue;
-        
-        file_entry_t *entry = calloc(1, sizeof(file_entry_t));
+        file_entry_t *entry = create_file_entry(data, de->d_name, de->d_type);
         if (!entry) continue;
         
-        /* Manual string copy */
-        size_t name_len = strlen(de->d_name);
-        entry->name = malloc(name_len + 1);
-        if (entry->name) strcpy(entry->name, de->d_name);
-        
-        size_t path_len = strlen(full_path);
-        entry->path = malloc(path_len + 1);
-        if (entry->path) strcpy(entry->path, full_path);
-        entry->is_directory = S_ISDIR(st.st_mode);
-        entry->is_sacd = !entry->is_directory && libsacd_is_valid_iso(full_path);
-        entry->size = st.st_size;
-        
-        
-        /* Only add directories and audio/video files */
-        if (entry->is_directory || is_audio_video_file(de->d_name)) {
-            /* Add to list */
-            if (tail) {
-                tail->next = entry;
-                entry->prev = tail;
-                tail = entry;
-            } else {
-                head = tail = entry;
-            }
-            count++;
+        /* Add to list */
+        if (tail) {
+            tail->next = entry;
+            entry->prev = tail;
+            tail = entry;
         } else {
-            /* Skip this file - free the allocated memory */
-            free(entry->name);
-            free(entry->path);
-            free(entry);
+            head = tail = entry;
         }
+        count++;
     }
     
     closedir(dir);
@@ -1052,43 +1189,287 @@ static int load_directory(sacd_browser_data_t *data, const char *path) {
         }
     }
     
-    /* Debug: write directory contents to a file */
-    FILE *debug = fopen("/tmp/sacd_debug.log", "a");
-    if (debug) {
-        fprintf(debug, "=== Loading directory: %s ===\n", path);
-        fprintf(debug, "Found %d entries:\n", count);
-        file_entry_t *dbg_entry = head;
-        while (dbg_entry) {
-            fprintf(debug, "  %s %s (%s)\n", 
-                    dbg_entry->is_directory ? " " : 
-                    (dbg_entry->is_sacd ? "[S]" : "[ ]"),
-                    dbg_entry->name, dbg_entry->path);
-            dbg_entry = dbg_entry->next;
-        }
-        fprintf(debug, "=============================\n");
-        fclose(debug);
-    }
-    
     data->files = head;
     data->selected = head;
     data->file_count = count;
     data->scroll_offset = 0;
     
+    /* Follow changes to the new directory */
+    if (data->watch_fd >= 0) {
+        data->watch_wd = inotify_add_watch(data->watch_fd, path, BROWSER_WATCH_EVENTS);
+    }
+    
     return 0;
 }
 
+/* Copy a name into the browser's name blocks */
+static const char *store_name(sacd_browser_data_t *data, const char *name) {
+    size_t length = strlen(name) + 1;
+    name_block_t *block = data->names;
+    if (!block || block->size - block->used < length) {
+        size_t size = length > NAME_BLOCK_SIZE ? length : NAME_BLOCK_SIZE;
+        block = malloc(sizeof(name_block_t) + size);
+        if (!block) return NULL;
+        block->used = 0;
+        block->size = size;
+        block->next = data->names;
+        data->names = block;
+    }
+    
+    char *copy = block->data + block->used;
+    memcpy(copy, name, length);
+    block->used += length;
+    return copy;
+}
+
+/* Build the entry for one name in the current directory; NULL if it isn't listed.
+ * Only names whose type d_type leaves open cost a stat here. */
+static file_entry_t *create_file_entry(sacd_browser_data_t *data, const char *name, unsigned char d_type) {
+    bool is_directory = (d_type == DT_DIR);
+    if (d_type != DT_DIR && d_type != DT_REG) {
+        /* Symbolic links and filesystems that don't fill in d_type */
+        struct stat st;
+        if (fstatat(data->dir_fd, name, &st, 0) != 0) return NULL;
+        is_directory = S_ISDIR(st.st_mode);
+    }
+    
+    /* Only add directories and audio/video files */
+    if (!is_directory && !is_audio_video_file(name)) return NULL;
+    
+    file_entry_t *entry = calloc(1, sizeof(file_entry_t));
+    if (!entry) return NULL;
+    
+    entry->name = store_name(data, name);
+    if (!entry->name) {
+        free(entry);
+        return NULL;
+    }
+    entry->is_directory = is_directory;
+    
+    return entry;
+}
+
+static void set_file_entry_info(file_entry_t *entry, const sacd_file_info_t *info) {
+    entry->size = (off_t)info->file_size;
+    entry->type = info->type;
+    entry->is_sacd = (info->type == SACD_FILE_SACD_ISO);
+    entry->stat_done = true;
+}
+
+/* Fill in size and file type the first time an entry is shown */
+static void stat_file_entry(sacd_browser_data_t *data, file_entry_t *entry) {
+    if (entry->stat_done) return;
+    entry->stat_done = true;
+    
+    if (entry->is_directory) {
+        struct stat st;
+        if (fstatat(data->dir_fd, entry->name, &st, 0) == 0) entry->size = st.st_size;
+        return;
+    }
+    
+    sacd_file_info_t info;
+    if (sacd_probe_file_at(data->dir_fd, entry->name, &info) == SACD_RESULT_OK) {
+        set_file_entry_info(entry, &info);
+    }
+}
+
+/* Probe the files about to be drawn together, rather than one at a time as
+ * each row is drawn: their header reads are then in flight at once */
+static void probe_visible_entries(sacd_browser_data_t *data, int row, int rows) {
+    if (rows <= 0) return;
+    
+    file_entry_t **entries = malloc(rows * sizeof(file_entry_t *));
+    const char **names = malloc(rows * sizeof(char *));
+    sacd_file_info_t *infos = malloc(rows * sizeof(sacd_file_info_t));
+    int count = 0;
+    
+    if (entries && names && infos) {
+        file_entry_t *entry = browser_entry_at(data, row);
+        for (int i = 0; entry && i < rows; i++) {
+            if (!entry->stat_done && !entry->is_directory) {
+                entries[count] = entry;
+                names[count] = entry->name;
+                count++;
+            }
+            entry = data->filtering ? browser_entry_at(data, row + i + 1) : entry->next;
+        }
+    }
+    
+    if (count > 1) {
+        sacd_probe_files(data->dir_fd, names, count, infos, 0);
+        for (int i = 0; i < count; i++) {
+            set_file_entry_info(entries[i], &infos[i]);
+        }
+    }
+    /* A single file is left to stat_file_entry */
+    
+    free(entries);
+    free(names);
+    free(infos);
+}
+
+/* Full path of an entry of the current directory */
+static void file_entry_path(const sacd_browser_data_t *data, const file_entry_t *entry, char *buffer, size_t size) {
+    snprintf(buffer, size, "%s/%s", 
+             strcmp(data->current_dir, "/") == 0 ? "" : data->current_dir, entry->name);
+}
+
+/* Position of an entry in the listing, or -1 */
+static int file_entry_index(sacd_browser_data_t *data, file_entry_t *target) {
+    int index = 0;
+    for (file_entry_t *entry = data->files; entry; entry = entry->next, index++) {
+        if (entry == target) return index;
+    }
+    return -1;
+}
+
+static file_entry_t *find_file_entry(sacd_browser_data_t *data, const char *name) {
+    for (file_entry_t *entry = data->files; entry; entry = entry->next) {
+        if (strcmp(entry->name, name) == 0) return entry;
+    }
+    return NULL;
+}
+
+/* Unlink and free an entry; the cursor moves to a neighbour if it was on it */
+static void remove_file_entry(sacd_browser_data_t *data, file_entry_t *entry) {
+    if (data->selected == entry) {
+        data->selected = entry->next ? entry->next : entry->prev;
+    }
+    
+    int index = file_entry_index(data, entry);
+    if (index >= 0 && index < data->scroll_offset) {
+        data->scroll_offset--;
+    }
+    
+    if (entry->prev) {
+        entry->prev->next = entry->next;
+    } else {
+        data->files = entry->next;
+    }
+    if (entry->next) {
+        entry->next->prev = entry->prev;
+    }
+    
+    free(entry);
+    data->file_count--;
+}
+
+/* Link an entry in at its sorted position, keeping the visible rows in place */
+static void insert_file_entry(sacd_browser_data_t *data, file_entry_t *entry) {
+    file_entry_t *prev = NULL;
+    file_entry_t *next = data->files;
+    while (next && file_entry_compare(&entry, &next) > 0) {
+        prev = next;
+        next = next->next;
+    }
+    
+    entry->prev = prev;
+    entry->next = next;
+    if (prev) {
+        prev->next = entry;
+    } else {
+        data->files = entry;
+    }
+    if (next) {
+        next->prev = entry;
+    }
+    data->file_count++;
+    
+    if (!data->selected) {
+        data->selected = entry;
+    } else if (file_entry_index(data, entry) < data->scroll_offset) {
+        data->scroll_offset++;
+    }
+}
+
+/* Re-read one name of the current directory: it appeared, changed or went away */
+static void refresh_file_entry(sacd_browser_data_t *data, const char *name) {
+    file_entry_t *old = find_file_entry(data, name);
+    struct stat st;
+    bool exists = fstatat(data->dir_fd, name, &st, 0) == 0;
+    
+    if (old && exists && old->is_directory == S_ISDIR(st.st_mode)) {
+        /* Keep the node, so the cursor stays on it; probe it again when next shown */
+        old->stat_done = false;
+        return;
+    }
+    
+    if (old) {
+        remove_file_entry(data, old);
+    }
+    if (exists) {
+        file_entry_t *entry = create_file_entry(data, name, S_ISDIR(st.st_mode) ? DT_DIR : DT_REG);
+        if (entry) {
+            insert_file_entry(data, entry);
+        }
+    }
+}
+
+/* Apply the directory's pending change notifications; reports whether the listing changed */
+static bool apply_directory_events(sacd_browser_data_t *data) {
+    char buffer[16384] __attribute__((aligned(__alignof__(struct inotify_event))));
+    bool changed = false;
+    bool reload = false;
+    
+    for (;;) {
+        ssize_t length = read(data->watch_fd, buffer, sizeof(buffer));
+        if (length <= 0) break;
+        
+        const char *last_name = NULL;
+        for (char *p = buffer; p < buffer + length; ) {
+            const struct inotify_event *event = (const struct inotify_event *)p;
+            p += sizeof(struct inotify_event) + event->len;
+            
+            if (event->mask & IN_Q_OVERFLOW) {
+                /* Events were lost: only a full reload is right */
+                reload = true;
+            } else if (event->wd == data->watch_wd && event->len > 0 && !reload) {
+                /* A new file's create and close come together: one look does for both */
+                if (last_name && strcmp(last_name, event->name) == 0) continue;
+                last_name = event->name;
+                
+                /* A rename is a delete and a create; a rewrite needs a new probe */
+                refresh_file_entry(data, event->name);
+                changed = true;
+            }
+        }
+    }
+    
+    if (reload) {
+        char *dir_path = strdup(data->current_dir);
+        char *selected = data->selected ? strdup(data->selected->name) : NULL;
+        int scroll_offset = data->scroll_offset;
+        
+        if (dir_path && load_directory(data, dir_path) == 0) {
+            file_entry_t *entry = selected ? find_file_entry(data, selected) : NULL;
+            if (entry) {
+                data->selected = entry;
+                data->scroll_offset = scroll_offset < data->file_count ? scroll_offset : 0;
+            }
+        }
+        free(selected);
+        free(dir_path);
+        changed = true;
+    }
+    return changed;
+}
+
 static void free_file_list(sacd_browser_data_t *data) {
     if (!data) return;
     
     file_entry_t *entry = data->files;
     while (entry) {
         file_entry_t *next = entry->next;
-        free(entry->name);
-        free(entry->path);
         free(entry);
         entry = next;
     }
     
+    while (data->names) {
+        name_block_t *next = data->names->next;
+        free(data->names);
+        data->names = next;
+    }
+    
     data->files = NULL;
     data->selected = NULL;
     data->file_count = 0;
@@ -1133,7 +1514,11 @@ static bool is_audio_video_file(const char *filename) {
     if (strcmp(ext, "dsf") == 0) return true;    /* DSD Stream File */
     if (strcmp(ext, "dff") == 0) return true;    /* DSD Interchange File */
     if (strcmp(ext, "wav") == 0) return true;    /* WAV */
+    if (strcmp(ext, "w64") == 0) return true;    /* Sony Wave64 */
+    if (strcmp(ext, "rf64") == 0) return true;   /* RF64 */
     if (strcmp(ext, "aiff") == 0) return true;   /* AIFF */
+    if (strcmp(ext, "aif") == 0) return true;    /* AIFF */
+    if (strcmp(ext, "aifc") == 0) return true;   /* AIFF-C */
     if (strcmp(ext, "mp3") == 0) return true;    /* MP3 */
     if (strcmp(ext, "m4a") == 0) return true;    /* M4A */
     if (strcmp(ext, "aac") == 0) return true;    /* AAC */
@@ -1156,69 +1541,263 @@ static bool is_audio_video_file(const char *filename) {
     return false;
 }
 
-/* TUI progress callback for new libsacd API */
-static void tui_progress_callback(
-    int track_number,              /* Current track (1-based) */
-    int total_tracks,              /* Total tracks */
-    int track_progress_percent __attribute__((unused)),    /* Progress within current track (0-100) */
-    int overall_progress_percent,  /* Overall progress (0-100) */
-    const char *status_message,    /* Human-readable status */
-    void *userdata                 /* User-provided data */
-) {
-    sacd_extract_data_t *extract_data = (sacd_extract_data_t*)userdata;
-    if (!extract_data) return;
+/* Take a fresh snapshot of the listing for the filter and run the query over it */
+static void update_browser_filter(sacd_browser_data_t *data) {
+    if (!data->filtering) return;
     
-    /* Update progress data with timing */
-    time_t current_time = time(NULL);
+    free(data->filter_entries);
+    free(data->filter_names);
+    data->filter_entries = malloc((data->file_count + 1) * sizeof(file_entry_t *));
+    data->filter_names = malloc((data->file_count + 1) * sizeof(char *));
     
-    if (extract_data->start_time == 0) {
-        extract_data->start_time = current_time;
+    int count = 0;
+    if (data->filter_entries && data->filter_names) {
+        for (file_entry_t *entry = data->files; entry; entry = entry->next) {
+            if (strcmp(entry->name, "..") == 0) continue;
+            data->filter_entries[count] = entry;
+            data->filter_names[count] = entry->name;
+            count++;
+        }
+    }
+    fuzzy_filter_set_names(&data->filter, data->filter_names, count);
+}
+
+/* Number of rows the browser shows */
+static int browser_row_count(sacd_browser_data_t *data) {
+    return data->filtering ? fuzzy_filter_count(&data->filter) : data->file_count;
+}
+
+/* Entry shown on a row (0-based, ignoring scrolling), or NULL */
+static file_entry_t *browser_entry_at(sacd_browser_data_t *data, int row) {
+    if (row < 0) return NULL;
+    
+    if (data->filtering) {
+        int index = fuzzy_filter_get(&data->filter, row);
+        return index >= 0 ? data->filter_entries[index] : NULL;
+    }
+    
+    file_entry_t *entry = data->files;
+    while (entry && row-- > 0) {
+        entry = entry->next;
+    }
+    return entry;
+}
+
+/* Row an entry is shown on, or -1 */
+static int browser_row_of(sacd_browser_data_t *data, file_entry_t *target) {
+    if (!data->filtering) return file_entry_index(data, target);
+    
+    int count = fuzzy_filter_count(&data->filter);
+    for (int row = 0; row < count; row++) {
+        if (browser_entry_at(data, row) == target) return row;
+    }
+    return -1;
+}
+
+/* Scroll so the cursor is visible */
+static void scroll_to_selected(tui_pane_t *pane, sacd_browser_data_t *data) {
+    int h = 3, w __attribute__((unused));
+    if (pane->win) getmaxyx(pane->win, h, w);
+    int visible_lines = h - 2 > 1 ? h - 2 : 1;
+    
+    int row = browser_row_of(data, data->selected);
+    if (row < 0) {
+        data->scroll_offset = 0;
+    } else if (row < data->scroll_offset) {
+        data->scroll_offset = row;
+    } else if (row >= data->scroll_offset + visible_lines) {
+        data->scroll_offset = row - visible_lines + 1;
+    }
+}
+
+static void end_browser_filter(tui_pane_t *pane, sacd_browser_data_t *data) {
+    data->filtering = false;
+    pane->text_input = false;
+    fuzzy_filter_clear(&data->filter);
+    free(data->filter_entries);
+    free(data->filter_names);
+    data->filter_entries = NULL;
+    data->filter_names = NULL;
+    scroll_to_selected(pane, data);
+}
+
+/* Keys while the filter is typed; false lets the browser handle the key as usual */
+static bool handle_browser_filter_key(tui_pane_t *pane, sacd_browser_data_t *data, int key) {
+    int rows = browser_row_count(data);
+    int row = browser_row_of(data, data->selected);
+    bool query_changed = false;
+    
+    switch (key) {
+        case 27:  /* Esc - drop the filter, keep the cursor */
+            end_browser_filter(pane, data);
+            break;
+            
+        case KEY_BACKSPACE:
+        case 127:
+        case 8:
+            if (fuzzy_filter_pop(&data->filter)) {
+                query_changed = true;
+            } else {
+                end_browser_filter(pane, data);
+            }
+            break;
+            
+        case KEY_UP:
+            if (row > 0) data->selected = browser_entry_at(data, row - 1);
+            scroll_to_selected(pane, data);
+            break;
+            
+        case KEY_DOWN:
+            if (row + 1 < rows) data->selected = browser_entry_at(data, row + 1);
+            scroll_to_selected(pane, data);
+            break;
+            
+        case KEY_ENTER:
+        case '\r':
+        case '\n':
+            /* Leave the filter and open the match; with no match, just leave */
+            end_browser_filter(pane, data);
+            if (rows > 0 && row >= 0) return false;
+            break;
+            
+        default:
+            if (key < 32 || key > 126) return false;
+            query_changed = fuzzy_filter_push(&data->filter, (char)key);
+            break;
+    }
+    
+    /* A new query puts the cursor on the best match */
+    if (query_changed) {
+        file_entry_t *best = browser_entry_at(data, 0);
+        if (best) data->selected = best;
+        data->scroll_offset = 0;
+    }
+    
+    tui_pane_draw(pane);
+    return true;
+}
+
+/* Keys while the track filter is typed; false lets the pane handle the key as usual */
+static bool handle_track_filter_key(tui_pane_t *pane, sacd_iso_info_t *sacd_info, const sacd_area_t *area, int key) {
+    fuzzy_filter_t *filter = &sacd_info->track_filter;
+    int rank = fuzzy_filter_rank_of(filter, sacd_info->track_selection_cursor);
+    bool query_changed = false;
+    
+    switch (key) {
+        case 27:  /* Esc - drop the filter, keep the cursor */
+        case KEY_ENTER:
+        case '\r':
+        case '\n':
+            sacd_info->track_filtering = false;
+            pane->text_input = false;
+            fuzzy_filter_clear(filter);
+            break;
+            
+        case KEY_BACKSPACE:
+        case 127:
+        case 8:
+            if (fuzzy_filter_pop(filter)) {
+                query_changed = true;
+            } else {
+                sacd_info->track_filtering = false;
+                pane->text_input = false;
+            }
+            break;
+            
+        case KEY_UP:
+            if (rank > 0) sacd_info->track_selection_cursor = fuzzy_filter_get(filter, rank - 1);
+            break;
+            
+        case KEY_DOWN:
+            if (rank + 1 < fuzzy_filter_count(filter)) {
+                sacd_info->track_selection_cursor = fuzzy_filter_get(filter, rank + 1);
+            }
+            break;
+            
+        default:
+            if (key < 32 || key > 126) return false;
+            query_changed = fuzzy_filter_push(filter, (char)key);
+            break;
+    }
+    
+    if (query_changed && fuzzy_filter_count(filter) > 0) {
+        int best = fuzzy_filter_get(filter, 0);
+        if (best < area->track_count) sacd_info->track_selection_cursor = best;
     }
     
-    /* Throttle UI updates - only update every 1 second OR when progress changes by 1% */
-    static time_t last_ui_update = 0;
-    static int last_ui_percent = -1;
+    tui_pane_draw(pane);
+    return true;
+}
+
+/* Pick up changes to the listed directory and redraw the pane when there were any */
+void sacd_browser_pane_poll(tui_pane_t *pane) {
+    if (!pane || !pane->user_data) return;
     
-    bool should_update = false;
+    sacd_browser_data_t *data = (sacd_browser_data_t *)pane->user_data;
+    if (data->watch_fd < 0 || data->watch_wd < 0) return;
     
-    /* Update if enough time has passed (1 second) */
-    if (current_time - last_ui_update >= 1) {
-        should_update = true;
+    if (apply_directory_events(data)) {
+        update_browser_filter(data);
+        tui_pane_draw(pane);
     }
+}
+
+/* Poll the extractor's progress snapshot and redraw the pane when it changed */
+void sacd_extract_pane_poll(tui_pane_t *pane) {
+    if (!pane || !pane->user_data) return;
     
-    /* Update if progress changed by at least 1% */
-    if (overall_progress_percent != last_ui_percent) {
-        should_update = true;
+    sacd_extract_data_t *extract_data = (sacd_extract_data_t*)pane->user_data;
+    if (!extract_data->extraction_active || !extract_data->libsacd_extractor) return;
+    
+    sacd_progress_t progress;
+    if (sacd_extractor_get_progress(extract_data->libsacd_extractor, &progress) != SACD_RESULT_OK) return;
+    
+    time_t current_time = time(NULL);
+    if (extract_data->start_time == 0) {
+        extract_data->start_time = current_time;
     }
     
-    /* Always update progress data, but conditionally update UI */
+    /* Redraw on new progress, and once a second for the elapsed time */
+    if (progress.sequence == extract_data->progress_sequence &&
+        current_time == extract_data->last_update_time) {
+        return;
+    }
+    extract_data->progress_sequence = progress.sequence;
     extract_data->last_update_time = current_time;
     extract_data->last_percent = extract_data->percent_complete;
-    extract_data->percent_complete = overall_progress_percent;
+    extract_data->percent_complete = progress.overall_progress_percent;
     
-    strncpy(extract_data->status_message, status_message, sizeof(extract_data->status_message) - 1);
-    extract_data->status_message[sizeof(extract_data->status_message) - 1] = '\0';
+    if (progress.running) {
+        const sacd_area_t *area = extract_data->libsacd_area;
+        const char *title = NULL;
+        if (area && progress.track_number > 0 && progress.track_number <= area->track_count) {
+            title = area->tracks[progress.track_number - 1].text.title;
+        }
+        snprintf(extract_data->status_message, sizeof(extract_data->status_message),
+                 "Extracting track %d/%d: %s (%d%%) - %llu MB",
+                 progress.queue_index + 1, progress.total_tracks, title ? title : "Unknown",
+                 progress.track_progress_percent,
+                 (unsigned long long)(progress.track_bytes_written / (1024 * 1024)));
+    } else if (progress.result == SACD_RESULT_OK) {
+        snprintf(extract_data->status_message, sizeof(extract_data->status_message),
+                 "Extraction completed");
+    } else if (progress.result == SACD_RESULT_CANCELLED) {
+        snprintf(extract_data->status_message, sizeof(extract_data->status_message),
+                 "Extraction cancelled");
+    } else {
+        snprintf(extract_data->status_message, sizeof(extract_data->status_message),
+                 "Extraction failed: %s", sacd_result_string(progress.result));
+    }
     
-    /* Update current track name */
-    snprintf(extract_data->current_track_name, sizeof(extract_data->current_track_name), 
-             "Track %d of %d", track_number, total_tracks);
+    snprintf(extract_data->current_track_name, sizeof(extract_data->current_track_name),
+             "Track %d of %d", progress.track_number, progress.total_tracks);
     
-    /* Only update UI when throttle conditions are met */
-    if (should_update && extract_data->pane && extract_data->pane->draw) {
+    if (pane->draw) {
         /* Clear the pane first for clean redraw */
-        werase(extract_data->pane->win);
-        box(extract_data->pane->win, 0, 0);
-        
-        /* Redraw with updated information */
-        extract_data->pane->draw(extract_data->pane);
-        
-        /* Force immediate screen refresh */
-        wrefresh(extract_data->pane->win);
-        doupdate(); /* Ensure all updates are displayed immediately */
-        
-        /* Update throttle state */
-        last_ui_update = current_time;
-        last_ui_percent = overall_progress_percent;
+        werase(pane->win);
+        box(pane->win, 0, 0);
+        pane->draw(pane);
+        wrefresh(pane->win);
     }
 }
 
@@ -1266,9 +1845,15 @@ static void start_extraction(sacd_extract_data_t *extract_data, sacd_iso_info_t
     sacd_extraction_options_init(&libsacd_options);
     libsacd_options.format = SACD_FORMAT_DSF;
     
-    /* Set up progress callback to update TUI */
-    libsacd_options.progress_callback = tui_progress_callback;
-    libsacd_options.callback_userdata = extract_data;
+    /* Progress is polled by sacd_extract_pane_poll() from the UI loop */
+    
+    /* Keep background rips from starving other users of the disks */
+    uint64_t limit = (uint64_t)bandwidth_steps[extract_data->bandwidth_step] * 1000000;
+    libsacd_options.read_bytes_per_sec = limit;
+    libsacd_options.write_bytes_per_sec = limit;
+    if (extract_data->idle_io) {
+        libsacd_options.io_priority = SACD_IO_PRIORITY_IDLE;
+    }
     
     /* Create real extractor */
     sacd_extractor_t *extractor = NULL;
@@ -1303,6 +1888,8 @@ static void start_extraction(sacd_extract_data_t *extract_data, sacd_iso_info_t
     /* Store extractor for cleanup later */
     extract_data->libsacd_extractor = extractor;
     extract_data->libsacd_disc = disc;
+    extract_data->libsacd_area = area;
+    extract_data->progress_sequence = 0;
     extract_data->extraction_active = true;
     
     snprintf(extract_data->status_message, sizeof(extract_data->status_message), 
@@ -4,20 +4,30 @@
 #include "libtui/include/tui.h"
 /* Use new libsacd API instead of old conflicting headers */
 #include "libsacd/sacd_lib.h"
+#include "sacd_fuzzy_filter.h"
 #include <dirent.h>
 #include <sys/types.h>
 
-/* Simple file entry for libtui browser */
+/* Simple file entry for libtui browser; size, type and is_sacd are filled in when first shown */
 typedef struct file_entry {
-    char *name;
-    char *path;
+    const char *name;                 /* In the browser's name blocks */
     bool is_directory;
     bool is_sacd;
+    bool stat_done;                   /* size, type and is_sacd are valid */
+    sacd_file_type_t type;            /* What the file holds, by content */
     off_t size;
     struct file_entry *next;
     struct file_entry *prev;
 } file_entry_t;
 
+/* Block of entry names, so a listing doesn't allocate each name apart */
+typedef struct name_block {
+    struct name_block *next;
+    size_t used;
+    size_t size;
+    char data[];
+} name_block_t;
+
 /* SACD ISO information structure */
 typedef struct {
     char title[256];
@@ -33,17 +43,33 @@ typedef struct {
     bool *track_selected;             /* Array of selected track flags */
     int track_selection_cursor;       /* Current cursor position in track list */
     bool track_selection_mode;        /* True when in track selection mode */
+    sacd_level_report_t *track_levels; /* Scanned levels per track (valid=false until scanned) */
+    
+    /* Type-to-filter over the track titles ('/') */
+    bool track_filtering;
+    fuzzy_filter_t track_filter;
+    const char **track_titles;        /* Names the filter ranks, by track index */
 } sacd_iso_info_t;
 
 /* SACD-specific pane data */
 typedef struct {
     char *current_dir;
+    int dir_fd;                       /* current_dir, for lookups relative to it (-1 if none) */
+    name_block_t *names;              /* Names of the listed entries */
     file_entry_t *files;
     file_entry_t *selected;
     int file_count;
     int scroll_offset;
     sacd_disc_t *current_disc;        /* Direct libsacd disc handle */
     sacd_iso_info_t *current_sacd;    /* Cached metadata */
+    int watch_fd;                     /* inotify instance (-1 if unavailable) */
+    int watch_wd;                     /* Watch on current_dir (-1 if none) */
+    
+    /* Type-to-filter over the listing ('/') */
+    bool filtering;
+    fuzzy_filter_t filter;
+    file_entry_t **filter_entries;    /* Snapshot of the listing the filter ranks */
+    const char **filter_names;
 } sacd_browser_data_t;
 
 /* Forward declaration */
@@ -71,6 +97,10 @@ typedef struct {
     /* NEW LIBSACD API */
     sacd_extractor_t *libsacd_extractor;
     sacd_disc_t *libsacd_disc;
+    const sacd_area_t *libsacd_area;  /* Area being extracted */
+    uint64_t progress_sequence;       /* Last sacd_progress_t.sequence drawn */
+    int bandwidth_step;               /* Selected I/O bandwidth limit */
+    bool idle_io;                     /* Run at idle I/O priority */
     
     /* Enhanced progress tracking */
     time_t start_time;
@@ -98,4 +128,10 @@ double calculate_selected_duration(sacd_iso_info_t *sacd_info);
 /* Initialize extraction progress pane */
 tui_pane_t *create_sacd_extract_pane(void);
 
+/* Apply changes to the browser's directory (call periodically) */
+void sacd_browser_pane_poll(tui_pane_t *pane);
+
+/* Refresh the extraction pane from the extractor's progress (call periodically) */
+void sacd_extract_pane_poll(tui_pane_t *pane);
+
 #endif /* SACD_TUI_ADAPTER_H */
\ No newline at end of file